@@ -37,6 +37,7 @@
 #include <lc3.h>
 
 #include "lc3.h"
+#include "rx_stats.h"
 #include "stream_rx.h"
 #include "usb.h"
 
@@ -45,16 +46,26 @@ LOG_MODULE_REGISTER(lc3, CONFIG_LOG_DEFAULT_LEVEL);
 #define LC3_ENCODER_STACK_SIZE 4096
 #define LC3_ENCODER_PRIORITY   5
 
-struct lc3_data {
-	void *fifo_reserved; /* 1st word reserved for use by FIFO */
-	struct net_buf *buf;
-	struct stream_rx *stream;
+/* Metadata for an SDU enqueued for decoding.
+ *
+ * This is stored in the user data of the ISO net_buf itself, and the net_buf is put directly in
+ * the FIFO, so that no additional allocation is needed per SDU. The SDU is decoded in place from
+ * the net_buf, and the net_buf is released as soon as the last frame of it has been decoded.
+ * The number of SDUs that can be in flight is thus only limited by CONFIG_BT_ISO_RX_BUF_COUNT.
+ */
+struct lc3_sdu_meta {
 	uint32_t ts;
-	bool do_plc;
-};
+	/* Index of the stream in rx_streams */
+	uint8_t stream_idx: 7;
+	uint8_t do_plc: 1;
+} __packed;
 
-K_MEM_SLAB_DEFINE_STATIC(lc3_data_slab, sizeof(struct lc3_data), CONFIG_BT_ISO_RX_BUF_COUNT,
-			 __alignof__(struct lc3_data));
+/* The ISO stack stores the struct bt_iso_recv_info of an SDU in the user data of its buffer,
+ * so the user data of the ISO RX buffers is at least that large, whatever the host version.
+ */
+BUILD_ASSERT(sizeof(struct lc3_sdu_meta) <= sizeof(struct bt_iso_recv_info),
+	     "LC3 SDU metadata does not fit in the ISO RX buffer user data");
+BUILD_ASSERT(ARRAY_SIZE(rx_streams) <= BIT(7), "Too many streams for the LC3 SDU metadata");
 
 static int16_t lc3_rx_buf[LC3_MAX_NUM_SAMPLES_MONO];
 static K_FIFO_DEFINE(lc3_in_fifo);
@@ -103,16 +114,28 @@ static int init_lc3_decoder(struct stream_rx *stream, uint32_t lc3_frame_duratio
 	return 0;
 }
 
-static bool decode_frame(struct lc3_data *data, size_t frame_cnt)
+static struct lc3_sdu_meta *lc3_sdu_meta(struct net_buf *buf)
+{
+	return net_buf_user_data(buf);
+}
+
+static struct stream_rx *lc3_sdu_stream(struct net_buf *buf)
+{
+	return &rx_streams[lc3_sdu_meta(buf)->stream_idx];
+}
+
+static bool decode_frame(struct net_buf *buf, size_t frame_cnt)
 {
-	const struct stream_rx *stream = data->stream;
+	struct lc3_sdu_meta *meta = lc3_sdu_meta(buf);
+	struct stream_rx *stream = lc3_sdu_stream(buf);
 	const size_t total_frames = stream->lc3_chan_cnt * stream->lc3_frame_blocks_per_sdu;
 	const uint16_t octets_per_frame = stream->lc3_octets_per_frame;
-	struct net_buf *buf = data->buf;
+	const bool do_plc = meta->do_plc;
+	uint32_t start_cycles;
 	void *iso_data;
 	int err;
 
-	if (data->do_plc) {
+	if (do_plc) {
 		iso_data = NULL; /* perform PLC */
 
 #if CONFIG_INFO_REPORTING_INTERVAL > 0
@@ -122,9 +145,10 @@ static bool decode_frame(struct lc3_data *data, size_t frame_cnt)
 		}
 #endif /* CONFIG_INFO_REPORTING_INTERVAL > 0 */
 
-		data->do_plc = false; /* clear flag */
+		meta->do_plc = false; /* clear flag */
 	} else {
-		iso_data = net_buf_pull_mem(data->buf, octets_per_frame);
+		/* Decode in place from the ISO buffer */
+		iso_data = net_buf_pull_mem(buf, octets_per_frame);
 
 #if CONFIG_INFO_REPORTING_INTERVAL > 0
 		if ((stream->reporting_info.lc3_decoded_cnt % CONFIG_INFO_REPORTING_INTERVAL) ==
@@ -136,8 +160,10 @@ static bool decode_frame(struct lc3_data *data, size_t frame_cnt)
 #endif /* CONFIG_INFO_REPORTING_INTERVAL > 0 */
 	}
 
+	start_cycles = k_cycle_get_32();
 	err = lc3_decode(stream->lc3_decoder, iso_data, octets_per_frame, LC3_PCM_FORMAT_S16,
 			 lc3_rx_buf, 1);
+	rx_stats_frame_decoded(stream, do_plc, err >= 0, k_cycle_get_32() - start_cycles);
 	if (err < 0) {
 		LOG_ERR("Failed to decode LC3 data (%u/%u - %u/%u)", frame_cnt + 1, total_frames,
 			octets_per_frame * frame_cnt, buf->len);
@@ -177,9 +203,10 @@ static int get_lc3_chan_alloc_from_index(const struct stream_rx *stream, uint8_t
 #endif /* CONFIG_USE_USB_AUDIO_OUTPUT */
 }
 
-static size_t decode_frame_block(struct lc3_data *data, size_t frame_cnt)
+static size_t decode_frame_block(struct net_buf *buf, size_t frame_cnt)
 {
-	const struct stream_rx *stream = data->stream;
+	const struct lc3_sdu_meta *meta = lc3_sdu_meta(buf);
+	const struct stream_rx *stream = lc3_sdu_stream(buf);
 	const uint8_t chan_cnt = stream->lc3_chan_cnt;
 	size_t decoded_frames = 0U;
 
@@ -187,7 +214,7 @@ static size_t decode_frame_block(struct lc3_data *data, size_t frame_cnt)
 		/* We provide the total number of decoded frames to `decode_frame` for logging
 		 * purposes
 		 */
-		if (decode_frame(data, frame_cnt + decoded_frames)) {
+		if (decode_frame(buf, frame_cnt + decoded_frames)) {
 			decoded_frames++;
 
 			if (IS_ENABLED(CONFIG_USE_USB_AUDIO_OUTPUT)) {
@@ -212,7 +239,7 @@ static size_t decode_frame_block(struct lc3_data *data, size_t frame_cnt)
 				 * For now we just send audio to USB as soon as we get it
 				 */
 				err = usb_add_frame_to_usb(chan_alloc, lc3_rx_buf,
-							   sizeof(lc3_rx_buf), data->ts);
+							   sizeof(lc3_rx_buf), meta->ts);
 				if (err == -EINVAL) {
 					continue;
 				}
@@ -232,9 +259,9 @@ static size_t decode_frame_block(struct lc3_data *data, size_t frame_cnt)
 	return decoded_frames;
 }
 
-static void do_lc3_decode(struct lc3_data *data)
+static void do_lc3_decode(struct net_buf *buf)
 {
-	struct stream_rx *stream = data->stream;
+	struct stream_rx *stream = lc3_sdu_stream(buf);
 
 	if (stream->lc3_decoder != NULL) {
 		const uint8_t frame_blocks_per_sdu = stream->lc3_frame_blocks_per_sdu;
@@ -242,7 +269,7 @@ static void do_lc3_decode(struct lc3_data *data)
 
 		frame_cnt = 0;
 		for (uint8_t i = 0U; i < frame_blocks_per_sdu; i++) {
-			const size_t decoded_frames = decode_frame_block(data, frame_cnt);
+			const size_t decoded_frames = decode_frame_block(buf, frame_cnt);
 
 			if (decoded_frames == 0) {
 				break;
@@ -256,24 +283,22 @@ static void do_lc3_decode(struct lc3_data *data)
 #endif /* CONFIG_INFO_REPORTING_INTERVAL > 0 */
 	}
 
-	net_buf_unref(data->buf);
+	net_buf_unref(buf);
 }
 
 static void lc3_decoder_thread_func(void *arg1, void *arg2, void *arg3)
 {
 	while (true) {
-		struct lc3_data *data = k_fifo_get(&lc3_in_fifo, K_FOREVER);
-		struct stream_rx *stream = data->stream;
+		struct net_buf *buf = k_fifo_get(&lc3_in_fifo, K_FOREVER);
+		struct stream_rx *stream = lc3_sdu_stream(buf);
 
 		if (stream->lc3_decoder == NULL) {
 			LOG_WRN("Decoder is NULL, discarding data from FIFO");
-			k_mem_slab_free(&lc3_data_slab, (void *)data);
+			net_buf_unref(buf);
 			continue; /* Wait for new data */
 		}
 
-		do_lc3_decode(data);
-
-		k_mem_slab_free(&lc3_data_slab, (void *)data);
+		do_lc3_decode(buf);
 	}
 }
 
@@ -426,23 +451,18 @@ void lc3_enqueue_for_decoding(struct stream_rx *stream, const struct bt_iso_recv
 	const uint8_t frame_blocks_per_sdu = stream->lc3_frame_blocks_per_sdu;
 	const uint16_t octets_per_frame = stream->lc3_octets_per_frame;
 	const uint8_t chan_cnt = stream->lc3_chan_cnt;
-	struct lc3_data *data;
+	struct lc3_sdu_meta *meta;
+	bool do_plc = false;
+	uint32_t ts;
 
 	if (stream->lc3_decoder == NULL) {
 		return;
 	}
 
-	/* Allocate a context that holds both the buffer and the stream so that we can
-	 * send both of these values to the LC3 decoder thread as a single struct
-	 * in a FIFO
-	 */
-	if (k_mem_slab_alloc(&lc3_data_slab, (void **)&data, K_NO_WAIT)) {
-		LOG_WRN("Could not allocate LC3 data item");
-		return;
-	}
+	__ASSERT_NO_MSG(buf->user_data_size >= sizeof(*meta));
 
 	if ((info->flags & BT_ISO_FLAGS_VALID) == 0) {
-		data->do_plc = true;
+		do_plc = true;
 	} else if (buf->len != (octets_per_frame * chan_cnt * frame_blocks_per_sdu)) {
 		if (buf->len != 0U) {
 			LOG_WRN("Expected %u frame blocks with %u channels of size %u, but "
@@ -450,18 +470,24 @@ void lc3_enqueue_for_decoding(struct stream_rx *stream, const struct bt_iso_recv
 				frame_blocks_per_sdu, chan_cnt, octets_per_frame, buf->len);
 		}
 
-		data->do_plc = true;
+		do_plc = true;
 	}
 
-	data->buf = net_buf_ref(buf);
-	data->stream = stream;
 	if (info->flags & BT_ISO_FLAGS_TS) {
-		data->ts = info->ts;
+		ts = info->ts;
 	} else {
-		data->ts = 0U;
+		ts = 0U;
 	}
 
-	k_fifo_put(&lc3_in_fifo, data);
+	/* The ISO stack may store @p info in the user data of @p buf, so the metadata shall only
+	 * be written once we are done reading @p info
+	 */
+	meta = lc3_sdu_meta(buf);
+	meta->stream_idx = ARRAY_INDEX(rx_streams, stream);
+	meta->ts = ts;
+	meta->do_plc = do_plc;
+
+	k_fifo_put(&lc3_in_fifo, net_buf_ref(buf));
 }
 
 int lc3_init(void)
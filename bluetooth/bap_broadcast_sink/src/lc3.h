@@ -66,6 +66,9 @@ int lc3_disable(struct stream_rx *stream);
 /**
  * @brief Enqueue an SDU for decoding
  *
+ * A reference to @p buf is taken and @p buf is decoded in place by the decoder thread. The user
+ * data of @p buf is used to store the decoding metadata, so no other allocation is done.
+ *
  * @param stream The stream that received the SDU
  * @param info Information about the SDU
  * @param buf The buffer of the SDU
@@ -0,0 +1,366 @@
+/**
+ * @file
+ * @brief Bluetooth BAP Broadcast Sink receive path statistics
+ *
+ * This files collects statistics about the receive path in rolling windows, and exposes them
+ * through the shell, either human readable or as a binary snapshot written directly to the UART
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <zephyr/autoconf.h>
+#include <zephyr/bluetooth/audio/bap.h>
+#include <zephyr/bluetooth/iso.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/sys/util_macro.h>
+#include <zephyr/sys_clock.h>
+
+#include "rx_stats.h"
+#include "stream_rx.h"
+
+static struct k_spinlock rx_stats_lock;
+static uint32_t window_start_ms;
+static uint32_t usb_fill_hist_current[RX_STATS_USB_FILL_BUCKETS];
+static uint32_t usb_fill_hist_previous[RX_STATS_USB_FILL_BUCKETS];
+
+static void window_clear(struct rx_stats_window *window)
+{
+	memset(window, 0, sizeof(*window));
+	window->decode_cycles_min = UINT32_MAX;
+}
+
+static struct rx_stats_stream *get_stats(struct stream_rx *stream)
+{
+	return &stream->rx_stats;
+}
+
+/* Must be called with rx_stats_lock held */
+static void rotate_windows_if_expired(void)
+{
+	struct bt_bap_stream *bap_streams[CONFIG_BT_BAP_BROADCAST_SNK_STREAM_COUNT];
+	const uint32_t now = k_uptime_get_32();
+
+	if ((now - window_start_ms) < CONFIG_RX_STATS_WINDOW_MS) {
+		return;
+	}
+
+	stream_rx_get_streams(bap_streams);
+	for (size_t i = 0U; i < ARRAY_SIZE(bap_streams); i++) {
+		struct stream_rx *stream = CONTAINER_OF(bap_streams[i], struct stream_rx, stream);
+		struct rx_stats_stream *stats = get_stats(stream);
+
+		stats->previous = stats->current;
+		window_clear(&stats->current);
+	}
+
+	memcpy(usb_fill_hist_previous, usb_fill_hist_current, sizeof(usb_fill_hist_previous));
+	memset(usb_fill_hist_current, 0, sizeof(usb_fill_hist_current));
+
+	window_start_ms = now;
+}
+
+static uint8_t loss_burst_bucket(uint32_t burst_len)
+{
+	if (burst_len <= 4U) {
+		return (uint8_t)(burst_len - 1U);
+	} else if (burst_len <= 8U) {
+		return 4U;
+	} else if (burst_len <= 16U) {
+		return 5U;
+	} else if (burst_len <= 32U) {
+		return 6U;
+	}
+
+	return 7U;
+}
+
+void rx_stats_stream_reset(struct stream_rx *stream)
+{
+	struct rx_stats_stream *stats = get_stats(stream);
+	k_spinlock_key_t key = k_spin_lock(&rx_stats_lock);
+
+	memset(stats, 0, sizeof(*stats));
+	window_clear(&stats->current);
+	window_clear(&stats->previous);
+
+	k_spin_unlock(&rx_stats_lock, key);
+}
+
+void rx_stats_sdu_recv(struct stream_rx *stream, const struct bt_iso_recv_info *info,
+		       const struct net_buf *buf)
+{
+	struct rx_stats_stream *stats = get_stats(stream);
+	struct rx_stats_window *window = &stats->current;
+	k_spinlock_key_t key = k_spin_lock(&rx_stats_lock);
+
+	rotate_windows_if_expired();
+
+	window->recv_cnt++;
+
+	if (stats->has_last) {
+		if (info->ts == stats->last_ts) {
+			window->dup_ts_cnt++;
+		}
+
+		if (info->seq_num == stats->last_seq_num) {
+			window->dup_psn_cnt++;
+		}
+	}
+
+	if (info->flags & BT_ISO_FLAGS_ERROR) {
+		window->error_cnt++;
+	}
+
+	if (info->flags & BT_ISO_FLAGS_LOST) {
+		window->loss_cnt++;
+		stats->loss_burst_len++;
+	} else if (stats->loss_burst_len > 0U) {
+		/* The burst ended - Add it to the window in which it ended */
+		window->loss_burst_hist[loss_burst_bucket(stats->loss_burst_len)]++;
+		stats->loss_burst_len = 0U;
+	}
+
+	if (info->flags & BT_ISO_FLAGS_VALID) {
+		if (buf->len == 0U) {
+			window->empty_sdu_cnt++;
+		} else {
+			window->valid_cnt++;
+		}
+	}
+
+	stats->last_ts = info->ts;
+	stats->last_seq_num = info->seq_num;
+	stats->has_last = true;
+
+	k_spin_unlock(&rx_stats_lock, key);
+}
+
+void rx_stats_frame_decoded(struct stream_rx *stream, bool plc, bool success, uint32_t cycles)
+{
+	struct rx_stats_window *window = &get_stats(stream)->current;
+	k_spinlock_key_t key = k_spin_lock(&rx_stats_lock);
+
+	rotate_windows_if_expired();
+
+	if (!success) {
+		window->decode_err_cnt++;
+	} else {
+		window->decoded_frame_cnt++;
+		if (plc) {
+			window->plc_frame_cnt++;
+		}
+
+		window->decode_cycles_min = MIN(window->decode_cycles_min, cycles);
+		window->decode_cycles_max = MAX(window->decode_cycles_max, cycles);
+		window->decode_cycles_sum += cycles;
+	}
+
+	k_spin_unlock(&rx_stats_lock, key);
+}
+
+void rx_stats_usb_fill(uint32_t fill, uint32_t capacity)
+{
+	k_spinlock_key_t key;
+	uint32_t bucket;
+
+	if (capacity == 0U) {
+		return;
+	}
+
+	bucket = MIN((uint32_t)(((uint64_t)fill * RX_STATS_USB_FILL_BUCKETS) / capacity),
+		     RX_STATS_USB_FILL_BUCKETS - 1U);
+
+	key = k_spin_lock(&rx_stats_lock);
+	rotate_windows_if_expired();
+	usb_fill_hist_current[bucket]++;
+	k_spin_unlock(&rx_stats_lock, key);
+}
+
+void rx_stats_snapshot_get(struct rx_stats_snapshot *snapshot)
+{
+	struct bt_bap_stream *bap_streams[CONFIG_BT_BAP_BROADCAST_SNK_STREAM_COUNT];
+	k_spinlock_key_t key;
+
+	memset(snapshot, 0, sizeof(*snapshot));
+	snapshot->magic = RX_STATS_SNAPSHOT_MAGIC;
+	snapshot->version = RX_STATS_SNAPSHOT_VERSION;
+	snapshot->stream_cnt = CONFIG_BT_BAP_BROADCAST_SNK_STREAM_COUNT;
+	snapshot->size = sizeof(*snapshot);
+	snapshot->window_ms = CONFIG_RX_STATS_WINDOW_MS;
+	snapshot->cycles_per_sec = sys_clock_hw_cycles_per_sec();
+
+	stream_rx_get_streams(bap_streams);
+
+	key = k_spin_lock(&rx_stats_lock);
+
+	rotate_windows_if_expired();
+
+	snapshot->uptime_ms = k_uptime_get_32();
+	snapshot->window_age_ms = snapshot->uptime_ms - window_start_ms;
+	memcpy(snapshot->usb_fill_hist_current, usb_fill_hist_current,
+	       sizeof(snapshot->usb_fill_hist_current));
+	memcpy(snapshot->usb_fill_hist_previous, usb_fill_hist_previous,
+	       sizeof(snapshot->usb_fill_hist_previous));
+
+	for (size_t i = 0U; i < ARRAY_SIZE(bap_streams); i++) {
+		struct stream_rx *stream = CONTAINER_OF(bap_streams[i], struct stream_rx, stream);
+		const struct rx_stats_stream *stats = get_stats(stream);
+
+		snapshot->streams[i].started = bap_streams[i]->ep != NULL ? 1U : 0U;
+		snapshot->streams[i].current = stats->current;
+		snapshot->streams[i].previous = stats->previous;
+	}
+
+	k_spin_unlock(&rx_stats_lock, key);
+}
+
+void rx_stats_reset(void)
+{
+	struct bt_bap_stream *bap_streams[CONFIG_BT_BAP_BROADCAST_SNK_STREAM_COUNT];
+
+	stream_rx_get_streams(bap_streams);
+	for (size_t i = 0U; i < ARRAY_SIZE(bap_streams); i++) {
+		rx_stats_stream_reset(CONTAINER_OF(bap_streams[i], struct stream_rx, stream));
+	}
+
+	K_SPINLOCK(&rx_stats_lock) {
+		memset(usb_fill_hist_current, 0, sizeof(usb_fill_hist_current));
+		memset(usb_fill_hist_previous, 0, sizeof(usb_fill_hist_previous));
+		window_start_ms = k_uptime_get_32();
+	}
+}
+
+#if defined(CONFIG_RX_STATS_SHELL)
+static struct rx_stats_snapshot shell_snapshot;
+
+static void print_window(const struct shell *sh, const char *name,
+			 const struct rx_stats_window *window, uint32_t cycles_per_sec)
+{
+	const uint32_t decoded_cnt = window->decoded_frame_cnt;
+	const uint32_t cycles_avg =
+		decoded_cnt > 0U ? (uint32_t)(window->decode_cycles_sum / decoded_cnt) : 0U;
+	const uint32_t cycles_min = decoded_cnt > 0U ? window->decode_cycles_min : 0U;
+
+	shell_print(sh,
+		    "  %s: recv %u | valid %u | loss %u | error %u | empty %u | dup TS %u | "
+		    "dup PSN %u",
+		    name, window->recv_cnt, window->valid_cnt, window->loss_cnt, window->error_cnt,
+		    window->empty_sdu_cnt, window->dup_ts_cnt, window->dup_psn_cnt);
+	shell_print(sh,
+		    "    LC3: decoded %u | PLC %u | errors %u | cycles min/avg/max %u/%u/%u "
+		    "(avg %u us)",
+		    decoded_cnt, window->plc_frame_cnt, window->decode_err_cnt, cycles_min,
+		    cycles_avg, window->decode_cycles_max,
+		    (uint32_t)(((uint64_t)cycles_avg * USEC_PER_SEC) / cycles_per_sec));
+	shell_print(sh, "    Loss bursts 1|2|3|4|5-8|9-16|17-32|>32: %u|%u|%u|%u|%u|%u|%u|%u",
+		    window->loss_burst_hist[0], window->loss_burst_hist[1],
+		    window->loss_burst_hist[2], window->loss_burst_hist[3],
+		    window->loss_burst_hist[4], window->loss_burst_hist[5],
+		    window->loss_burst_hist[6], window->loss_burst_hist[7]);
+}
+
+static void print_usb_fill_hist(const struct shell *sh, const char *name, const uint32_t *hist)
+{
+	shell_print(sh, "  USB ring fill %s (1/8 steps): %u|%u|%u|%u|%u|%u|%u|%u", name, hist[0],
+		    hist[1], hist[2], hist[3], hist[4], hist[5], hist[6], hist[7]);
+}
+
+static int cmd_rx_stats_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct rx_stats_snapshot *snapshot = &shell_snapshot;
+
+	rx_stats_snapshot_get(snapshot);
+
+	shell_print(sh, "Uptime %u ms, window %u ms (current window age %u ms)",
+		    snapshot->uptime_ms, snapshot->window_ms, snapshot->window_age_ms);
+
+	for (size_t i = 0U; i < snapshot->stream_cnt; i++) {
+		if (snapshot->streams[i].started == 0U && snapshot->streams[i].current.recv_cnt == 0U &&
+		    snapshot->streams[i].previous.recv_cnt == 0U) {
+			continue;
+		}
+
+		shell_print(sh, "Stream %zu%s:", i,
+			    snapshot->streams[i].started != 0U ? "" : " (stopped)");
+		print_window(sh, "current ", &snapshot->streams[i].current,
+			     snapshot->cycles_per_sec);
+		print_window(sh, "previous", &snapshot->streams[i].previous,
+			     snapshot->cycles_per_sec);
+	}
+
+	if (IS_ENABLED(CONFIG_USE_USB_AUDIO_OUTPUT)) {
+		print_usb_fill_hist(sh, "current ", snapshot->usb_fill_hist_current);
+		print_usb_fill_hist(sh, "previous", snapshot->usb_fill_hist_previous);
+	}
+
+	return 0;
+}
+
+static int cmd_rx_stats_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	rx_stats_reset();
+	shell_print(sh, "Statistics reset");
+
+	return 0;
+}
+
+static int cmd_rx_stats_dump(const struct shell *sh, size_t argc, char **argv)
+{
+#if DT_HAS_CHOSEN(zephyr_console)
+	const struct device *uart_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+	struct rx_stats_snapshot *snapshot = &shell_snapshot;
+	const uint8_t *data = (const uint8_t *)snapshot;
+	uint16_t crc;
+
+	if (!device_is_ready(uart_dev)) {
+		shell_error(sh, "UART device not ready");
+		return -ENODEV;
+	}
+
+	rx_stats_snapshot_get(snapshot);
+	crc = crc16_ccitt(0xFFFF, data, sizeof(*snapshot));
+
+	/* The snapshot is written raw and is followed by its CRC16-CCITT (little endian), so that
+	 * a host tool can find it in the console output by searching for the magic value
+	 */
+	for (size_t i = 0U; i < sizeof(*snapshot); i++) {
+		uart_poll_out(uart_dev, data[i]);
+	}
+
+	uart_poll_out(uart_dev, (uint8_t)(crc & 0xFFU));
+	uart_poll_out(uart_dev, (uint8_t)(crc >> 8));
+
+	return 0;
+#else  /* !DT_HAS_CHOSEN(zephyr_console) */
+	shell_error(sh, "No console UART");
+
+	return -ENODEV;
+#endif /* DT_HAS_CHOSEN(zephyr_console) */
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	rx_stats_cmds,
+	SHELL_CMD_ARG(show, NULL, "Print receive path statistics", cmd_rx_stats_show, 1, 0),
+	SHELL_CMD_ARG(reset, NULL, "Reset receive path statistics", cmd_rx_stats_reset, 1, 0),
+	SHELL_CMD_ARG(dump, NULL, "Write a binary statistics snapshot to the console UART",
+		      cmd_rx_stats_dump, 1, 0),
+	SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(rx_stats, &rx_stats_cmds, "Receive path statistics", NULL);
+#endif /* CONFIG_RX_STATS_SHELL */
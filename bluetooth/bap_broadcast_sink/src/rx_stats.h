@@ -0,0 +1,190 @@
+/**
+ * @file
+ * @brief Bluetooth BAP Broadcast Sink receive path statistics header
+ *
+ * This files handles the structured receive path statistics of the sample
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef SAMPLE_BAP_BROADCAST_SINK_RX_STATS_H
+#define SAMPLE_BAP_BROADCAST_SINK_RX_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/autoconf.h>
+#include <zephyr/bluetooth/iso.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/toolchain.h>
+
+/** Loss burst histogram buckets: 1, 2, 3, 4, 5-8, 9-16, 17-32 and >32 consecutive lost SDUs */
+#define RX_STATS_LOSS_BURST_BUCKETS 8U
+/** USB ring buffer fill histogram buckets, each covering 1/8 of the ring buffer */
+#define RX_STATS_USB_FILL_BUCKETS   8U
+
+/** Magic value of a binary snapshot ("RXST" in little endian) */
+#define RX_STATS_SNAPSHOT_MAGIC   0x54535852U
+/** Version of the binary snapshot format. Increase when changing the layout */
+#define RX_STATS_SNAPSHOT_VERSION 1U
+
+struct stream_rx;
+
+/** Statistics for a single stream for a single window */
+struct rx_stats_window {
+	/** Total Number of SDUs received */
+	uint32_t recv_cnt;
+	/** Number of valid SDUs received */
+	uint32_t valid_cnt;
+	/** Number of lost SDUs */
+	uint32_t loss_cnt;
+	/** Number of SDUs containing errors */
+	uint32_t error_cnt;
+	/** Number of empty SDUs received */
+	uint32_t empty_sdu_cnt;
+	/** Number of SDUs with duplicated packet sequence number received */
+	uint32_t dup_psn_cnt;
+	/** Number of SDUs with duplicated timestamps received */
+	uint32_t dup_ts_cnt;
+	/** Number of LC3 frames successfully decoded, including PLC frames */
+	uint32_t decoded_frame_cnt;
+	/** Number of LC3 frames generated by packet loss concealment */
+	uint32_t plc_frame_cnt;
+	/** Number of LC3 frames that failed to decode */
+	uint32_t decode_err_cnt;
+	/** Minimum number of cycles spent decoding a single frame */
+	uint32_t decode_cycles_min;
+	/** Maximum number of cycles spent decoding a single frame */
+	uint32_t decode_cycles_max;
+	/** Sum of cycles spent decoding frames, used to calculate the average */
+	uint64_t decode_cycles_sum;
+	/** Histogram of the length of loss bursts (consecutive lost SDUs) */
+	uint32_t loss_burst_hist[RX_STATS_LOSS_BURST_BUCKETS];
+} __packed;
+
+/** Statistics state for a single stream */
+struct rx_stats_stream {
+	/** The window currently being filled */
+	struct rx_stats_window current;
+	/** The last completed window */
+	struct rx_stats_window previous;
+	/** Number of consecutive lost SDUs not yet added to the histogram */
+	uint32_t loss_burst_len;
+	/** The last received timestamp to track dup_ts_cnt */
+	uint32_t last_ts;
+	/** The last received sequence number to track dup_psn_cnt */
+	uint16_t last_seq_num;
+	/** Whether any SDU has been received, as the first SDU cannot be a duplicate */
+	bool has_last;
+};
+
+/**
+ * @brief Binary snapshot of all statistics
+ *
+ * The snapshot is sent as-is from the device, so all values are in the (little endian) byte
+ * order of the device.
+ */
+struct rx_stats_snapshot {
+	/** @ref RX_STATS_SNAPSHOT_MAGIC */
+	uint32_t magic;
+	/** @ref RX_STATS_SNAPSHOT_VERSION */
+	uint8_t version;
+	/** Number of streams in @ref rx_stats_snapshot.streams */
+	uint8_t stream_cnt;
+	/** Size of the snapshot in octets */
+	uint16_t size;
+	/** Uptime in milliseconds when the snapshot was taken */
+	uint32_t uptime_ms;
+	/** Length of a window in milliseconds */
+	uint32_t window_ms;
+	/** Time in milliseconds since the current window was started */
+	uint32_t window_age_ms;
+	/** Frequency of the cycle counter used for decode timing */
+	uint32_t cycles_per_sec;
+	/** Histogram of the USB ring buffer fill level in the current window */
+	uint32_t usb_fill_hist_current[RX_STATS_USB_FILL_BUCKETS];
+	/** Histogram of the USB ring buffer fill level in the last completed window */
+	uint32_t usb_fill_hist_previous[RX_STATS_USB_FILL_BUCKETS];
+	struct {
+		/** Whether the stream is currently started */
+		uint8_t started;
+		/** The window currently being filled */
+		struct rx_stats_window current;
+		/** The last completed window */
+		struct rx_stats_window previous;
+	} __packed streams[CONFIG_BT_BAP_BROADCAST_SNK_STREAM_COUNT];
+} __packed;
+
+#if defined(CONFIG_RX_STATS)
+/**
+ * @brief Reset the statistics of a stream
+ *
+ * Should be called when a stream is started
+ *
+ * @param stream The stream to reset the statistics for
+ */
+void rx_stats_stream_reset(struct stream_rx *stream);
+
+/**
+ * @brief Record a received SDU
+ *
+ * @param stream The stream that received the SDU
+ * @param info Information about the SDU
+ * @param buf The buffer of the SDU
+ */
+void rx_stats_sdu_recv(struct stream_rx *stream, const struct bt_iso_recv_info *info,
+		       const struct net_buf *buf);
+
+/**
+ * @brief Record a decoded LC3 frame
+ *
+ * @param stream The stream the frame belongs to
+ * @param plc Whether the frame was generated by packet loss concealment
+ * @param success Whether the frame was decoded successfully
+ * @param cycles Number of cycles spent decoding the frame
+ */
+void rx_stats_frame_decoded(struct stream_rx *stream, bool plc, bool success, uint32_t cycles);
+
+/**
+ * @brief Record the fill level of the USB ring buffer
+ *
+ * Can be called from ISR context
+ *
+ * @param fill Number of octets currently in the ring buffer
+ * @param capacity Total size of the ring buffer in octets
+ */
+void rx_stats_usb_fill(uint32_t fill, uint32_t capacity);
+
+/**
+ * @brief Get a consistent snapshot of all statistics
+ *
+ * @param snapshot The snapshot to fill
+ */
+void rx_stats_snapshot_get(struct rx_stats_snapshot *snapshot);
+
+/** @brief Reset all statistics and start a new window */
+void rx_stats_reset(void);
+#else /* !CONFIG_RX_STATS */
+static inline void rx_stats_stream_reset(struct stream_rx *stream)
+{
+}
+
+static inline void rx_stats_sdu_recv(struct stream_rx *stream,
+				     const struct bt_iso_recv_info *info,
+				     const struct net_buf *buf)
+{
+}
+
+static inline void rx_stats_frame_decoded(struct stream_rx *stream, bool plc, bool success,
+					  uint32_t cycles)
+{
+}
+
+static inline void rx_stats_usb_fill(uint32_t fill, uint32_t capacity)
+{
+}
+#endif /* CONFIG_RX_STATS */
+
+#endif /* SAMPLE_BAP_BROADCAST_SINK_RX_STATS_H */
@@ -25,6 +25,7 @@
 
 #include "stream_rx.h"
 #include "lc3.h"
+#include "rx_stats.h"
 
 struct stream_rx rx_streams[CONFIG_BT_BAP_BROADCAST_SNK_STREAM_COUNT];
 uint64_t total_rx_iso_packet_count; /* This value is exposed to test code */
@@ -103,6 +104,8 @@ void stream_rx_recv(struct bt_bap_stream *bap_stream, const struct bt_iso_recv_i
 	stream->reporting_info.last_ts = info->ts;
 #endif /* CONFIG_INFO_REPORTING_INTERVAL > 0 */
 
+	rx_stats_sdu_recv(stream, info, buf);
+
 	total_rx_iso_packet_count++;
 
 	if (IS_ENABLED(CONFIG_LIBLC3)) {
@@ -123,6 +126,8 @@ int stream_rx_started(struct bt_bap_stream *bap_stream)
 	memset(&stream->reporting_info, 0, sizeof((stream->reporting_info)));
 #endif /* CONFIG_INFO_REPORTING_INTERVAL > 0 */
 
+	rx_stats_stream_reset(stream);
+
 	if (IS_ENABLED(CONFIG_LIBLC3) && bap_stream->codec_cfg != NULL &&
 	    bap_stream->codec_cfg->id == BT_HCI_CODING_FORMAT_LC3) {
 		int err;
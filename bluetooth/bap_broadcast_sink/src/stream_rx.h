@@ -20,6 +20,8 @@
 #include <lc3.h>
 #endif /* defined(CONFIG_LIBLC3) */
 
+#include "rx_stats.h"
+
 struct stream_rx {
 	/* A BAP stream object */
 	struct bt_bap_stream stream;
@@ -51,6 +53,11 @@ struct stream_rx {
 	} reporting_info;
 #endif /* CONFIG_INFO_REPORTING_INTERVAL > 0 */
 
+#if defined(CONFIG_RX_STATS)
+	/** Rolling window statistics exposed by the rx_stats shell commands */
+	struct rx_stats_stream rx_stats;
+#endif /* CONFIG_RX_STATS */
+
 #if defined(CONFIG_LIBLC3)
 	/** Octets per frame - Used to validate that the incoming data is of correct size  */
 	uint16_t lc3_octets_per_frame;
@@ -82,6 +89,9 @@ struct stream_rx {
 void stream_rx_recv(struct bt_bap_stream *bap_stream, const struct bt_iso_recv_info *info,
 		    struct net_buf *buf);
 
+/** Receive streams, one per BAP broadcast sink stream */
+extern struct stream_rx rx_streams[CONFIG_BT_BAP_BROADCAST_SNK_STREAM_COUNT];
+
 size_t stream_rx_get_streaming_cnt(void);
 int stream_rx_started(struct bt_bap_stream *bap_stream);
 int stream_rx_stopped(struct bt_bap_stream *bap_stream);
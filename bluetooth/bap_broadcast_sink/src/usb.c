@@ -35,6 +35,7 @@
 #include <sample_usbd.h>
 
 #include "lc3.h"
+#include "rx_stats.h"
 #include "usb.h"
 
 LOG_MODULE_REGISTER(usb, CONFIG_LOG_DEFAULT_LEVEL);
@@ -77,6 +78,8 @@ static void uac2_sof_cb(const struct device *dev, void *user_data)
 		return;
 	}
 
+	rx_stats_usb_fill(ring_buf_size_get(&usb_in_ring_buf), USB_IN_RING_BUF_SIZE);
+
 	err = k_mem_slab_alloc(&usb_in_buf_pool, &pcm_buf, K_NO_WAIT);
 	if (err != 0) {
 		LOG_WRN("Could not allocate pcm_buf");
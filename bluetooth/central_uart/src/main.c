@@ -19,6 +19,7 @@
 #include <zephyr/bluetooth/hci.h>
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/att.h>
 #include <zephyr/bluetooth/gatt.h>
 
 #include <bluetooth/services/nus.h>
@@ -32,49 +33,117 @@
 
 #include <zephyr/logging/log.h>
 
+#include "nus_packer.h"
+#include "uart_handler.h"
+
 #define LOG_MODULE_NAME central_uart
 LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 
-/* UART payload buffer element size. */
-#define UART_BUF_SIZE 20
-
 #define KEY_PASSKEY_ACCEPT DK_BTN1_MSK
 #define KEY_PASSKEY_REJECT DK_BTN2_MSK
 
-#define NUS_WRITE_TIMEOUT K_MSEC(150)
-#define UART_WAIT_FOR_BUF_DELAY K_MSEC(50)
-#define UART_RX_TIMEOUT 50000 /* Wait for RX complete event time in microseconds. */
+#define NUS_TX_CREDITS CONFIG_BT_NUS_TX_CREDITS
+#define NUS_TX_IDLE_TIMEOUT K_MSEC(CONFIG_BT_NUS_TX_IDLE_TIMEOUT)
+
+/* Largest write payload, the ATT MTU less the opcode and handle. */
+#define NUS_PACKET_SIZE(mtu) ((mtu) - 3)
 
 static const struct device *uart = DEVICE_DT_GET(DT_CHOSEN(nordic_nus_uart));
-static struct k_work_delayable uart_work;
 static struct k_work scan_work;
 
-K_SEM_DEFINE(nus_write_sem, 0, 1);
+/* Writes without response that can be queued before the previous ones were sent. */
+static K_SEM_DEFINE(nus_tx_credits, NUS_TX_CREDITS, NUS_TX_CREDITS);
 
-struct uart_data_t {
-	void *fifo_reserved;
-	uint8_t  data[UART_BUF_SIZE];
-	uint16_t len;
-};
+static atomic_t uart_tx_dropped;
 
-static K_FIFO_DEFINE(fifo_uart_tx_data);
-static K_FIFO_DEFINE(fifo_uart_rx_data);
+/* Data received over UART is packed here by nus_packer, up to the payload limit. */
+static uint8_t nus_packet[NUS_PACKET_SIZE(CONFIG_BT_L2CAP_TX_MTU)];
+
+/* Set when the NUS RX characteristic of the peer was discovered. */
+static atomic_t nus_ready;
 
 static struct bt_conn *default_conn;
 static struct bt_nus_client nus_client;
 
-static void ble_data_sent(struct bt_nus_client *nus, uint8_t err,
-					const uint8_t *const data, uint16_t len)
+static void uart_buf_stats_log(void)
 {
-	ARG_UNUSED(nus);
-	ARG_UNUSED(data);
-	ARG_UNUSED(len);
+	struct uart_handler_stats stats;
+	struct nus_packer_stats tx_stats;
+
+	uart_handler_stats_get(&stats);
+	nus_packer_stats_get(&tx_stats);
+
+	LOG_INF("UART buffers: %u of %u used at most, UART RX paused %u times",
+		stats.max_used, CONFIG_BT_NUS_UART_BUF_COUNT, stats.rx_pauses);
+	LOG_INF("Dropped %ld bytes to UART, %u bytes to Bluetooth",
+		atomic_get(&uart_tx_dropped), tx_stats.dropped);
+}
+
+/* UART to Bluetooth throughput, from the first to the last write of the connection. */
+static void ble_tx_stats_log(void)
+{
+	struct nus_packer_stats stats;
+
+	nus_packer_stats_get(&stats);
+	nus_packer_stats_reset();
+
+	if (stats.packets == 0) {
+		return;
+	}
+
+	LOG_INF("Sent %u bytes in %u writes, %lld bytes/s", stats.bytes, stats.packets,
+		(stats.duration > 0) ? ((int64_t)stats.bytes * MSEC_PER_SEC / stats.duration) : 0);
+}
+
+static void nus_tx_credits_reset(void)
+{
+	k_sem_reset(&nus_tx_credits);
+
+	for (int i = 0; i < NUS_TX_CREDITS; i++) {
+		k_sem_give(&nus_tx_credits);
+	}
+}
+
+static void ble_data_sent(struct bt_conn *conn, void *user_data)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(user_data);
+
+	k_sem_give(&nus_tx_credits);
+}
+
+/* Write without response, several writes are queued so that every connection event can
+ * carry data. Wait for a credit, so that a slow link holds the data in the UART buffers and
+ * pauses UART RX, instead of failing once the Bluetooth buffers are full.
+ */
+static int nus_send(const uint8_t *data, uint16_t len)
+{
+	int err;
 
-	k_sem_give(&nus_write_sem);
+	if (!atomic_get(&nus_ready)) {
+		return -ENOTCONN;
+	}
+
+	err = k_sem_take(&nus_tx_credits, K_FOREVER);
+	if (err) {
+		/* Credits were reset. */
+		return err;
+	}
 
+	err = bt_gatt_write_without_response_cb(nus_client.conn, nus_client.handles.rx, data,
+						len, false, ble_data_sent, NULL);
 	if (err) {
-		LOG_WRN("ATT error code: 0x%02X", err);
+		k_sem_give(&nus_tx_credits);
 	}
+
+	return err;
+}
+
+static void nus_packet_len_update(struct bt_conn *conn)
+{
+	uint16_t len = nus_packer_len_set(NUS_PACKET_SIZE(bt_gatt_get_mtu(conn)));
+
+	LOG_INF("Writes of up to %u bytes", len);
 }
 
 static uint8_t ble_data_received(struct bt_nus_client *nus,
@@ -82,13 +151,12 @@ static uint8_t ble_data_received(struct bt_nus_client *nus,
 {
 	ARG_UNUSED(nus);
 
-	int err;
-
 	for (uint16_t pos = 0; pos != len;) {
-		struct uart_data_t *tx = k_malloc(sizeof(*tx));
+		struct uart_data_t *tx = uart_buf_alloc();
 
 		if (!tx) {
 			LOG_WRN("Not able to allocate UART send data buffer");
+			atomic_add(&uart_tx_dropped, len - pos);
 			return BT_GATT_ITER_CONTINUE;
 		}
 
@@ -113,178 +181,27 @@ static uint8_t ble_data_received(struct bt_nus_client *nus,
 			tx->len++;
 		}
 
-		err = uart_tx(uart, tx->data, tx->len, SYS_FOREVER_MS);
-		if (err) {
-			k_fifo_put(&fifo_uart_tx_data, tx);
-		}
+		uart_buf_send(tx);
 	}
 
 	return BT_GATT_ITER_CONTINUE;
 }
 
-static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
-{
-	ARG_UNUSED(dev);
-
-	static size_t aborted_len;
-	struct uart_data_t *buf;
-	static uint8_t *aborted_buf;
-	static bool disable_req;
-
-	switch (evt->type) {
-	case UART_TX_DONE:
-		LOG_DBG("UART_TX_DONE");
-		if ((evt->data.tx.len == 0) ||
-		    (!evt->data.tx.buf)) {
-			return;
-		}
-
-		if (aborted_buf) {
-			buf = CONTAINER_OF(aborted_buf, struct uart_data_t,
-					   data[0]);
-			aborted_buf = NULL;
-			aborted_len = 0;
-		} else {
-			buf = CONTAINER_OF(evt->data.tx.buf,
-					   struct uart_data_t,
-					   data[0]);
-		}
-
-		k_free(buf);
-
-		buf = k_fifo_get(&fifo_uart_tx_data, K_NO_WAIT);
-		if (!buf) {
-			return;
-		}
-
-		if (uart_tx(uart, buf->data, buf->len, SYS_FOREVER_MS)) {
-			LOG_WRN("Failed to send data over UART");
-		}
-
-		break;
-
-	case UART_RX_RDY:
-		LOG_DBG("UART_RX_RDY");
-		buf = CONTAINER_OF(evt->data.rx.buf, struct uart_data_t, data[0]);
-		buf->len += evt->data.rx.len;
-
-		if (disable_req) {
-			return;
-		}
-
-		if ((evt->data.rx.buf[buf->len - 1] == '\n') ||
-		    (evt->data.rx.buf[buf->len - 1] == '\r')) {
-			disable_req = true;
-			uart_rx_disable(uart);
-		}
-
-		break;
-
-	case UART_RX_DISABLED:
-		LOG_DBG("UART_RX_DISABLED");
-		disable_req = false;
-
-		buf = k_malloc(sizeof(*buf));
-		if (buf) {
-			buf->len = 0;
-		} else {
-			LOG_WRN("Not able to allocate UART receive buffer");
-			k_work_reschedule(&uart_work, UART_WAIT_FOR_BUF_DELAY);
-			return;
-		}
-
-		uart_rx_enable(uart, buf->data, sizeof(buf->data),
-			       UART_RX_TIMEOUT);
-
-		break;
-
-	case UART_RX_BUF_REQUEST:
-		LOG_DBG("UART_RX_BUF_REQUEST");
-		buf = k_malloc(sizeof(*buf));
-		if (buf) {
-			buf->len = 0;
-			uart_rx_buf_rsp(uart, buf->data, sizeof(buf->data));
-		} else {
-			LOG_WRN("Not able to allocate UART receive buffer");
-		}
-
-		break;
-
-	case UART_RX_BUF_RELEASED:
-		LOG_DBG("UART_RX_BUF_RELEASED");
-		buf = CONTAINER_OF(evt->data.rx_buf.buf, struct uart_data_t,
-				   data[0]);
-
-		if (buf->len > 0) {
-			k_fifo_put(&fifo_uart_rx_data, buf);
-		} else {
-			k_free(buf);
-		}
-
-		break;
-
-	case UART_TX_ABORTED:
-		LOG_DBG("UART_TX_ABORTED");
-		if (!aborted_buf) {
-			aborted_buf = (uint8_t *)evt->data.tx.buf;
-		}
-
-		aborted_len += evt->data.tx.len;
-		buf = CONTAINER_OF(aborted_buf, struct uart_data_t,
-				   data[0]);
-
-		uart_tx(uart, &buf->data[aborted_len],
-			buf->len - aborted_len, SYS_FOREVER_MS);
-
-		break;
-
-	default:
-		break;
-	}
-}
-
-static void uart_work_handler(struct k_work *item)
-{
-	struct uart_data_t *buf;
-
-	buf = k_malloc(sizeof(*buf));
-	if (buf) {
-		buf->len = 0;
-	} else {
-		LOG_WRN("Not able to allocate UART receive buffer");
-		k_work_reschedule(&uart_work, UART_WAIT_FOR_BUF_DELAY);
-		return;
-	}
-
-	uart_rx_enable(uart, buf->data, sizeof(buf->data), UART_RX_TIMEOUT);
-}
-
 static int uart_init(void)
 {
 	int err;
-	struct uart_data_t *rx;
 
 	if (!device_is_ready(uart)) {
 		LOG_ERR("UART device not ready");
 		return -ENODEV;
 	}
 
-	rx = k_malloc(sizeof(*rx));
-	if (rx) {
-		rx->len = 0;
-	} else {
-		return -ENOMEM;
-	}
-
-	k_work_init_delayable(&uart_work, uart_work_handler);
-
-	err = uart_callback_set(uart, uart_cb, NULL);
+	err = uart_handler_init(uart);
 	if (err) {
 		return err;
 	}
 
-	return uart_rx_enable(uart, rx->data, sizeof(rx->data),
-			      UART_RX_TIMEOUT);
+	return uart_handler_rx_enable();
 }
 
 static void discovery_complete(struct bt_gatt_dm *dm,
@@ -295,7 +212,9 @@ static void discovery_complete(struct bt_gatt_dm *dm,
 
 	bt_gatt_dm_data_print(dm);
 
-	bt_nus_handles_assign(dm, nus);
+	if (!bt_nus_handles_assign(dm, nus)) {
+		atomic_set(&nus_ready, 1);
+	}
 	bt_nus_subscribe_receive(nus);
 
 	bt_gatt_dm_data_release(dm);
@@ -342,6 +261,7 @@ static void exchange_func(struct bt_conn *conn, uint8_t err, struct bt_gatt_exch
 {
 	if (!err) {
 		LOG_INF("MTU exchange done");
+		nus_packet_len_update(conn);
 	} else {
 		LOG_WRN("MTU exchange failed (err %" PRIu8 ")", err);
 	}
@@ -370,6 +290,9 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
 
 	LOG_INF("Connected: %s", addr);
 
+	nus_tx_credits_reset();
+	nus_packet_len_update(conn);
+
 	static struct bt_gatt_exchange_params exchange_params;
 
 	exchange_params.func = exchange_func;
@@ -406,6 +329,12 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 	bt_conn_unref(default_conn);
 	default_conn = NULL;
 
+	atomic_set(&nus_ready, 0);
+	nus_tx_credits_reset();
+
+	uart_buf_stats_log();
+	ble_tx_stats_log();
+
 	(void)k_work_submit(&scan_work);
 }
 
@@ -461,7 +390,6 @@ static int nus_client_init(void)
 	struct bt_nus_client_init_param init = {
 		.cb = {
 			.received = ble_data_received,
-			.sent = ble_data_sent,
 		}
 	};
 
@@ -633,6 +561,9 @@ int main(void)
 		return 0;
 	}
 
+	nus_packer_init(nus_packet, sizeof(nus_packet), nus_send);
+	nus_packer_len_set(NUS_PACKET_SIZE(BT_ATT_DEFAULT_LE_MTU));
+
 	err = nus_client_init();
 	if (err != 0) {
 		LOG_ERR("nus_client_init failed (err %d)", err);
@@ -647,42 +578,19 @@ int main(void)
 
 	printk("Starting Bluetooth Central UART sample\n");
 
-	struct uart_data_t nus_data = {
-		.len = 0,
-	};
-
 	for (;;) {
-		/* Wait indefinitely for data to be sent over Bluetooth */
-		struct uart_data_t *buf = k_fifo_get(&fifo_uart_rx_data,
-						     K_FOREVER);
-
-		int plen = MIN(sizeof(nus_data.data) - nus_data.len, buf->len);
-		int loc = 0;
-
-		while (plen > 0) {
-			memcpy(&nus_data.data[nus_data.len], &buf->data[loc], plen);
-			nus_data.len += plen;
-			loc += plen;
-			if (nus_data.len >= sizeof(nus_data.data) ||
-			   (nus_data.data[nus_data.len - 1] == '\n') ||
-			   (nus_data.data[nus_data.len - 1] == '\r')) {
-				err = bt_nus_client_send(&nus_client, nus_data.data, nus_data.len);
-				if (err) {
-					LOG_WRN("Failed to send data over BLE connection"
-						"(err %d)", err);
-				}
-
-				err = k_sem_take(&nus_write_sem, NUS_WRITE_TIMEOUT);
-				if (err) {
-					LOG_WRN("NUS send timeout");
-				}
-
-				nus_data.len = 0;
-			}
-
-			plen = MIN(sizeof(nus_data.data), buf->len - loc);
+		/* Wait indefinitely for data to be sent over Bluetooth. A partly filled
+		 * packet is sent when no more data comes within the idle timeout.
+		 */
+		struct uart_data_t *buf = uart_rx_get(nus_packer_pending() ? NUS_TX_IDLE_TIMEOUT :
+									     K_FOREVER);
+
+		if (!buf) {
+			nus_packer_flush();
+			continue;
 		}
 
-		k_free(buf);
+		nus_packer_add(buf->data, buf->len);
+		uart_buf_free(buf);
 	}
 }
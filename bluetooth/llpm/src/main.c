@@ -25,6 +25,8 @@
 #include <bluetooth/gatt_dm.h>
 #include <bluetooth/hci_vs_sdc.h>
 
+#include "latency_hist.h"
+
 #define DEVICE_NAME	CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
 #define INTERVAL_MIN      0x6    /* 6 units,  7.5 ms */
@@ -32,6 +34,9 @@
 #define INTERVAL_LLPM  0x0D01    /* Proprietary  1 ms */
 #define INTERVAL_LLPM_US 1000
 
+/* Measurement time at each connection interval before switching to the other one */
+#define MEASURE_WINDOW_MS 5000
+#define RESPONSE_TIMEOUT  K_MSEC(200)
 
 static K_SEM_DEFINE(test_ready_sem, 0, 1);
 static bool test_ready;
@@ -51,10 +56,30 @@ static const struct bt_data sd[] = {
 	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
 };
 
+/* Written to the peer. The peer sends nothing back: once the write is acknowledged, the
+ * latency client hands this same buffer to the response callback.
+ */
+struct latency_payload {
+	uint32_t seq;
+	uint32_t stamp;
+} __packed;
+
+static K_SEM_DEFINE(latency_received_sem, 0, 1);
+static K_MUTEX_DEFINE(stats_lock);
+
+/* CRC errors of all connection events, from the QoS connection event reports */
+static atomic_t crc_mismatches;
+
+static struct latency_ring latency_ring;
+static struct latency_hist latency_all;
+/* Samples whose request or response overlapped a connection event with CRC errors */
+static struct latency_hist latency_crc;
+
 static struct {
 	uint32_t latency;
+	uint32_t seq;
 	uint32_t crc_mismatches;
-} llpm_latency;
+} latency_worst;
 
 void scan_filter_match(struct bt_scan_device_info *device_info,
 		       struct bt_scan_filter_match *filter_match,
@@ -291,7 +316,7 @@ static bool on_vs_evt(struct net_buf_simple *buf)
 	}
 
 	evt = (void *)buf->data;
-	llpm_latency.crc_mismatches += evt->crc_error_count;
+	atomic_add(&crc_mismatches, evt->crc_error_count);
 
 	return true;
 }
@@ -322,24 +347,138 @@ static int enable_qos_conn_evt_report(void)
 
 static void latency_response_handler(const void *buf, uint16_t len)
 {
-	uint32_t latency_time;
+	struct latency_payload payload;
+	struct latency_ring_entry request;
+	uint32_t cycles_spent;
+	uint32_t latency_us;
+	uint32_t crc;
+	int err;
 
-	if (len == sizeof(latency_time)) {
+	if (len != sizeof(payload)) {
+		return;
+	}
+
+	cycles_spent = k_cycle_get_32();
+	memcpy(&payload, buf, sizeof(payload));
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+
+	err = latency_ring_pop(&latency_ring, payload.seq, &request);
+	if (!err) {
 		/* compute how long the time spent */
-		latency_time = *((uint32_t *)buf);
-		uint32_t cycles_spent = k_cycle_get_32() - latency_time;
-		llpm_latency.latency =
-			(uint32_t)k_cyc_to_ns_floor64(cycles_spent) / 2000;
+		cycles_spent -= request.stamp;
+		latency_us = (uint32_t)k_cyc_to_ns_floor64(cycles_spent) / 2000;
+		crc = (uint32_t)atomic_get(&crc_mismatches) - request.tag;
+
+		latency_hist_record(&latency_all, latency_us);
+		if (crc) {
+			latency_hist_record(&latency_crc, latency_us);
+		}
+
+		if (latency_us > latency_worst.latency) {
+			latency_worst.latency = latency_us;
+			latency_worst.seq = payload.seq;
+			latency_worst.crc_mismatches = crc;
+		}
 	}
+
+	k_mutex_unlock(&stats_lock);
+
+	k_sem_give(&latency_received_sem);
 }
 
 static const struct bt_latency_client_cb latency_client_cb = {
 	.latency_response = latency_response_handler
 };
 
-static void test_run(void)
+static void latency_stats_reset(void)
+{
+	k_mutex_lock(&stats_lock, K_FOREVER);
+
+	latency_ring_reset(&latency_ring);
+	latency_hist_reset(&latency_all);
+	latency_hist_reset(&latency_crc);
+	memset(&latency_worst, 0, sizeof(latency_worst));
+
+	k_mutex_unlock(&stats_lock);
+}
+
+static void latency_stats_print(uint32_t crc_total)
+{
+	struct latency_hist_summary all;
+	struct latency_hist_summary crc;
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+
+	latency_hist_summarize(&latency_all, &all);
+	latency_hist_summarize(&latency_crc, &crc);
+
+	printk("Transmission latency (us) of %u samples: p50 %u, p99 %u, p99.9 %u, max %u\n",
+	       all.count, all.p50, all.p99, all.p99_9, all.max);
+	printk("  with CRC mismatches: %u samples, p50 %u, p99 %u, max %u\n",
+	       crc.count, crc.p50, crc.p99, crc.max);
+	printk("  worst: %u us (request %u, %u CRC mismatches meanwhile)\n",
+	       latency_worst.latency, latency_worst.seq, latency_worst.crc_mismatches);
+	printk("  lost %u, unmatched %u, CRC mismatches %u\n",
+	       latency_ring.lost, latency_ring.unmatched, crc_total);
+
+	k_mutex_unlock(&stats_lock);
+}
+
+/* Send the requests back to back for MEASURE_WINDOW_MS. The latency service uses ATT
+ * Write Requests, so a single request is in flight and the next one is sent as soon as
+ * the response came in.
+ */
+static void latency_measure(void)
 {
+	int64_t end = k_uptime_get() + MEASURE_WINDOW_MS;
+	uint32_t crc_start = (uint32_t)atomic_get(&crc_mismatches);
+	/* Kept by the latency client until the write completes */
+	static struct latency_payload payload;
 	int err;
+
+	latency_stats_reset();
+	k_sem_reset(&latency_received_sem);
+
+	while (default_conn && (k_uptime_get() < end)) {
+		k_mutex_lock(&stats_lock, K_FOREVER);
+		payload.stamp = k_cycle_get_32();
+		payload.seq = latency_ring_push(&latency_ring, payload.stamp,
+						(uint32_t)atomic_get(&crc_mismatches));
+		k_mutex_unlock(&stats_lock);
+
+		err = bt_latency_request(&latency_client, &payload, sizeof(payload));
+		if (err) {
+			k_mutex_lock(&stats_lock, K_FOREVER);
+			latency_ring_cancel(&latency_ring, payload.seq);
+			k_mutex_unlock(&stats_lock);
+
+			if (err != -EALREADY) {
+				printk("Latency failed (err %d)\n", err);
+				k_sleep(RESPONSE_TIMEOUT);
+				continue;
+			}
+		}
+
+		/* A late response still carries the payload written, so the next request
+		 * is not pushed before it came in.
+		 */
+		while (k_sem_take(&latency_received_sem, RESPONSE_TIMEOUT)) {
+			printk("Did not receive a latency response\n");
+
+			if (!default_conn) {
+				break;
+			}
+		}
+	}
+
+	latency_stats_print((uint32_t)atomic_get(&crc_mismatches) - crc_start);
+}
+
+static void test_run(void)
+{
+	static uint16_t interval_us = INTERVAL_LLPM_US;
+
 	if (!test_ready) {
 		/* disconnected while blocking inside _getchar() */
 		return;
@@ -350,45 +489,26 @@ static void test_run(void)
 	printk("Press any key to start measuring transmission latency\n");
 	console_getchar();
 
-	/* Start sending the timestamp to its peer */
 	while (default_conn) {
-		uint32_t time = k_cycle_get_32();
+		struct bt_conn_info info = {0};
 
-		err = bt_latency_request(&latency_client, &time, sizeof(time));
-		if (err && err != -EALREADY) {
-			printk("Latency failed (err %d)\n", err);
+		if (!bt_conn_get_info(default_conn, &info)) {
+			printk("Measuring for %d ms at %s connection interval\n",
+			       MEASURE_WINDOW_MS,
+			       (info.le.interval == INTERVAL_LLPM) ? "1 ms" : "7.5 ms");
 		}
 
-		k_sleep(K_MSEC(200)); /* wait for latency response */
-
-		if (llpm_latency.latency) {
-			printk("Transmission Latency: %u (us), CRC mismatches: %u\n",
-			       llpm_latency.latency,
-			       llpm_latency.crc_mismatches);
-		} else {
-			printk("Did not receive a latency response\n");
-		}
+		latency_measure();
 
-		memset(&llpm_latency, 0, sizeof(llpm_latency));
 		if (conn_info.role == BT_CONN_ROLE_CENTRAL) {
-			static int counter;
-			static uint16_t interval_us = INTERVAL_LLPM_US;
-
-			counter++;
-			/* Arbitrarily chosen number of measurments
-			 * to do before switching interval
-			 */
-			if (counter == 20) {
-				counter = 0;
-				if (interval_us == INTERVAL_LLPM_US) {
-					interval_us = INTERVAL_MIN_US;
-				} else {
-					interval_us = INTERVAL_LLPM_US;
-				}
-				if (vs_change_connection_interval(interval_us)) {
-					printk("Enable LLPM short connection interval failed\n");
-					return;
-				}
+			if (interval_us == INTERVAL_LLPM_US) {
+				interval_us = INTERVAL_MIN_US;
+			} else {
+				interval_us = INTERVAL_LLPM_US;
+			}
+			if (vs_change_connection_interval(interval_us)) {
+				printk("Enable LLPM short connection interval failed\n");
+				return;
 			}
 		}
 	}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "latency_hist.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#define MAX_VALUES 100000
+
+/* Requests and responses of the ring test, and how many requests back a response can come */
+#define RING_STEPS  200000
+#define RING_WINDOW (2 * LATENCY_RING_SIZE)
+
+static uint32_t values[MAX_VALUES];
+static struct latency_hist hist;
+#define RAND_SEED 0x2545F491
+
+static uint32_t rand_state = RAND_SEED;
+
+static const uint32_t percentiles[] = {
+	1, LATENCY_HIST_P50, LATENCY_HIST_P99, LATENCY_HIST_P99_9, 1000000,
+};
+
+static uint32_t rand_next(void)
+{
+	/* xorshift32, the same sequence on every run */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+enum distribution {
+	/* About 1 ms, a few retransmissions one or two events later, rare stalls */
+	DIST_LLPM,
+	/* The full 32-bit range */
+	DIST_WIDE,
+	/* Below LATENCY_HIST_SUB_COUNT, where every value has its bucket */
+	DIST_SMALL,
+	DIST_CONSTANT,
+};
+
+static const char *const distribution_names[] = {"llpm", "wide", "small", "constant"};
+
+static uint32_t value_next(enum distribution dist)
+{
+	uint32_t r = rand_next();
+
+	switch (dist) {
+	case DIST_LLPM:
+		if (r % 2000 == 0) {
+			return 10000 + rand_next() % 40000;
+		}
+
+		return 950 + rand_next() % 100 + ((r % 100 == 0) ? 1000 * (1 + r % 2) : 0);
+	case DIST_WIDE:
+		return r;
+	case DIST_SMALL:
+		return r % LATENCY_HIST_SUB_COUNT;
+	default:
+		return 1234;
+	}
+}
+
+static int value_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * A percentile is the upper bound of its bucket capped to the largest value, never below
+ * the exact one and less than a bucket width, 1/LATENCY_HIST_SUB_COUNT, above it.
+ */
+static void check_percentile(const char *name, uint32_t count, uint32_t ppm, uint32_t exact,
+			     uint32_t value)
+{
+	uint64_t limit = (uint64_t)exact + exact / LATENCY_HIST_SUB_COUNT;
+
+	zassert_true(value >= exact && value <= limit && value <= hist.max,
+		     "%s, %u values: percentile %u ppm is %u, exact %u", name, count, ppm, value,
+		     exact);
+}
+
+static void check_hist(enum distribution dist, uint32_t count)
+{
+	const char *name = distribution_names[dist];
+	struct latency_hist_summary summary;
+	uint64_t sum = 0;
+
+	latency_hist_reset(&hist);
+
+	for (uint32_t i = 0; i < count; i++) {
+		values[i] = value_next(dist);
+		sum += values[i];
+		latency_hist_record(&hist, values[i]);
+	}
+
+	qsort(values, count, sizeof(values[0]), value_cmp);
+
+	for (size_t i = 0; i < ARRAY_SIZE(percentiles); i++) {
+		/* The smallest rank covering the share, as in the sorted values */
+		uint64_t rank = ((uint64_t)count * percentiles[i] + 999999) / 1000000;
+
+		check_percentile(name, count, percentiles[i], values[MAX(rank, 1) - 1],
+				 latency_hist_percentile(&hist, percentiles[i]));
+	}
+
+	latency_hist_summarize(&hist, &summary);
+
+	zassert_equal(summary.count, count, "%s, %u values: count %u", name, count,
+		      summary.count);
+	zassert_equal(summary.min, values[0], "%s, %u values: min %u", name, count, summary.min);
+	zassert_equal(summary.max, values[count - 1], "%s, %u values: max %u", name, count,
+		      summary.max);
+	zassert_equal(summary.mean, (uint32_t)(sum / count), "%s, %u values: mean %u", name,
+		      count, summary.mean);
+	zassert_true(dist != DIST_SMALL || summary.p99 == values[(count * 99 + 99) / 100 - 1],
+		     "%s, %u values: p99 %u is not exact", name, count, summary.p99);
+
+	if (count == MAX_VALUES) {
+		printk("%-8s %6u values: p50 %u (%u), p99 %u (%u), p99.9 %u (%u), max %u\n",
+		       name, count, summary.p50, values[count / 2 - 1], summary.p99,
+		       values[count / 100 * 99 - 1], summary.p99_9,
+		       values[count / 1000 * 999 - 1], summary.max);
+	}
+}
+
+ZTEST(latency_hist, test_hist_edges)
+{
+	struct latency_hist_summary summary;
+
+	latency_hist_reset(&hist);
+	latency_hist_summarize(&hist, &summary);
+
+	/* An empty histogram is summarized as zeros */
+	zassert_equal(summary.count, 0);
+	zassert_equal(summary.min, 0);
+	zassert_equal(summary.max, 0);
+	zassert_equal(latency_hist_percentile(&hist, LATENCY_HIST_P50), 0);
+
+	/* The last bucket ends at the largest 32-bit value */
+	latency_hist_record(&hist, UINT32_MAX);
+	latency_hist_record(&hist, 0);
+	latency_hist_summarize(&hist, &summary);
+
+	zassert_equal(summary.min, 0);
+	zassert_equal(summary.p50, 0);
+	zassert_equal(summary.p99, UINT32_MAX);
+	zassert_equal(summary.max, UINT32_MAX);
+	zassert_equal(summary.mean, UINT32_MAX / 2);
+}
+
+/*
+ * Requests are pushed, and responses come out of order, twice, after their slot was
+ * reused, for requests never sent, or not at all. A plain model of the pending requests
+ * gives the matches, and the lost and unmatched counts the ring must report.
+ */
+static void check_ring(const char *name, uint32_t first_seq)
+{
+	static struct latency_ring ring;
+	static bool pending[RING_STEPS];
+	uint32_t lost = 0;
+	uint32_t unmatched = 0;
+	uint32_t matched = 0;
+	uint32_t pushed = 0;
+	uint32_t errors = 0;
+
+	latency_ring_reset(&ring);
+	ring.next_seq = first_seq;
+
+	for (uint32_t step = 0; step < RING_STEPS; step++) {
+		uint32_t r = rand_next();
+		struct latency_ring_entry entry;
+		uint32_t i;
+		int err;
+
+		if (r % 2 == 0 || pushed == 0) {
+			/* The request in the slot to reuse is lost, if still pending */
+			if (pushed >= LATENCY_RING_SIZE && pending[pushed - LATENCY_RING_SIZE]) {
+				pending[pushed - LATENCY_RING_SIZE] = false;
+				lost++;
+			}
+
+			if (latency_ring_push(&ring, step, ~step) != first_seq + pushed) {
+				errors++;
+			}
+
+			pending[pushed++] = true;
+
+			/* Not sent after all */
+			if (r % 7 == 0) {
+				latency_ring_cancel(&ring, first_seq + pushed - 1);
+				pending[pushed - 1] = false;
+			} else if (r % 11 == 0 && pushed > LATENCY_RING_SIZE) {
+				/* Too late, the slot holds the request just pushed */
+				i = pushed - 1 - LATENCY_RING_SIZE;
+				latency_ring_cancel(&ring, first_seq + i);
+			}
+
+			continue;
+		}
+
+		/* A response to one of the recent requests, or to one not sent yet */
+		i = pushed - MIN(pushed, 1 + (r >> 8) % RING_WINDOW) + ((r % 50 == 1) ? 3 : 0);
+
+		err = latency_ring_pop(&ring, first_seq + i, &entry);
+
+		if (i >= pushed || !pending[i]) {
+			unmatched++;
+
+			if (err != -ENOENT) {
+				errors++;
+			}
+
+			continue;
+		}
+
+		pending[i] = false;
+		matched++;
+
+		if (err || entry.seq != first_seq + i || entry.tag != ~entry.stamp) {
+			errors++;
+		}
+	}
+
+	printk("%-8s %6u requests: %u matched, %u lost, %u unmatched\n", name, pushed, matched,
+	       ring.lost, ring.unmatched);
+
+	zassert_equal(errors, 0, "%s: %u requests misnumbered or responses mismatched", name,
+		      errors);
+	zassert_equal(ring.lost, lost, "%s: lost %u, expected %u", name, ring.lost, lost);
+	zassert_equal(ring.unmatched, unmatched, "%s: unmatched %u, expected %u", name,
+		      ring.unmatched, unmatched);
+}
+
+static void check_distribution(enum distribution dist)
+{
+	static const uint32_t counts[] = {1, 7, 1000, MAX_VALUES};
+
+	for (size_t i = 0; i < ARRAY_SIZE(counts); i++) {
+		check_hist(dist, counts[i]);
+	}
+}
+
+ZTEST(latency_hist, test_hist_llpm)
+{
+	check_distribution(DIST_LLPM);
+}
+
+ZTEST(latency_hist, test_hist_wide)
+{
+	check_distribution(DIST_WIDE);
+}
+
+ZTEST(latency_hist, test_hist_small)
+{
+	check_distribution(DIST_SMALL);
+}
+
+ZTEST(latency_hist, test_hist_constant)
+{
+	check_distribution(DIST_CONSTANT);
+}
+
+ZTEST(latency_hist, test_ring)
+{
+	check_ring("ring", 0);
+}
+
+/* Sequence numbers that wrap around during the test */
+ZTEST(latency_hist, test_ring_wrap)
+{
+	check_ring("wrap", UINT32_MAX - RING_STEPS / 10);
+}
+
+static void *latency_hist_setup(void)
+{
+	printk("Latency histogram test: %u buckets, %u per power of two\n",
+	       LATENCY_HIST_BUCKETS, LATENCY_HIST_SUB_COUNT);
+
+	return NULL;
+}
+
+static void latency_hist_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	/* The same values whatever the order the tests run in */
+	rand_state = RAND_SEED;
+}
+
+ZTEST_SUITE(latency_hist, NULL, latency_hist_setup, latency_hist_before, NULL, NULL);
@@ -0,0 +1,965 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "lc3_read_ahead.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "sd_card.h"
+#include "sd_card_index.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(lc3_read_ahead, CONFIG_LC3_READ_AHEAD_LOG_LEVEL);
+
+/* Each frame in an LC3 file is preceded by its size as a 16-bit little endian value */
+#define LC3_FRAME_HDR_SIZE 2
+
+#define NUM_FRAMES CONFIG_LC3_READ_AHEAD_FRAMES
+
+BUILD_ASSERT(CONFIG_LC3_READ_AHEAD_READ_SIZE >=
+		     (LC3_FRAME_HDR_SIZE + CONFIG_LC3_READ_AHEAD_MAX_FRAME_SIZE),
+	     "A read must be able to hold at least one frame");
+BUILD_ASSERT(CONFIG_LC3_READ_AHEAD_STREAMS < LC3_READ_AHEAD_IDX_UNUSED,
+	     "Too many streams for the index type");
+
+struct ra_file {
+	bool in_use;
+	bool loop;
+	bool eof;
+	bool error;
+	uint8_t users;
+	char path[CONFIG_FS_FATFS_MAX_LFN + 1];
+	struct fs_file_t file;
+	/* Index of the file in the SD card index, valid in generation index_gen of the index.
+	 * The file is identified by its path, size and frame count across index rebuilds.
+	 */
+	uint32_t index_idx;
+	uint32_t index_gen;
+	uint32_t file_size;
+	/* Frame the streams of the file start at */
+	uint32_t start_frame;
+	uint32_t frame_count;
+	uint32_t frame_duration_us;
+
+	/* Frames with sequence number [head_seq, tail_seq) are in the cache. Frame seq is stored
+	 * in slot (seq % NUM_FRAMES). Only the refill thread increases tail_seq.
+	 */
+	uint32_t head_seq;
+	uint32_t tail_seq;
+	uint16_t frame_len[NUM_FRAMES];
+	uint8_t frames[NUM_FRAMES][CONFIG_LC3_READ_AHEAD_MAX_FRAME_SIZE];
+
+	/* Raw data read from the SD card. Only accessed with io_lock held */
+	uint8_t chunk[CONFIG_LC3_READ_AHEAD_READ_SIZE];
+	size_t chunk_len;
+	size_t chunk_pos;
+	/* Number of the next frame to parse, and number of frames to parse without caching them
+	 * to get to the frame that was seeked to
+	 */
+	uint32_t frame_pos;
+	uint32_t skip_frames;
+
+	uint32_t sd_reads;
+	uint32_t sd_read_time_max_us;
+};
+
+struct ra_stream {
+	struct ra_file *file;
+	/* Sequence number of the next frame to return */
+	uint32_t next_seq;
+	/* Sequence number of the frame last returned, valid once started */
+	uint32_t held_seq;
+	/* A frame has been returned since the stream was registered or restarted */
+	bool started;
+	struct lc3_read_ahead_stats stats;
+};
+
+static struct ra_file files[CONFIG_LC3_READ_AHEAD_FILES];
+static struct ra_stream streams[CONFIG_LC3_READ_AHEAD_STREAMS];
+
+/* Protects the cache indexes and the stream states */
+static K_MUTEX_DEFINE(lock);
+/* Serializes the SD card access of this module, and opening/closing of files. Taken before
+ * lock. The file system calls themselves are made with the lock of the SD card index held, see
+ * sd_card_index_fs_lock(), as the index is built and read from other threads.
+ */
+static K_MUTEX_DEFINE(io_lock);
+static K_SEM_DEFINE(refill_sem, 0, 1);
+
+static struct k_thread refill_thread_data;
+static K_THREAD_STACK_DEFINE(refill_thread_stack, CONFIG_LC3_READ_AHEAD_STACK_SIZE);
+
+/* The frame last returned to a stream is still in use until the next frame is requested */
+static uint32_t stream_in_use_seq(const struct ra_stream *stream)
+{
+	return stream->started ? stream->held_seq : stream->next_seq;
+}
+
+/**
+ * @brief	Free the cache slots no longer used by any stream of a file.
+ *
+ * If the cache is full and the fastest stream has consumed all of it, the frames slower streams
+ * sharing the file have not requested yet are skipped, and counted as underruns for them, so that
+ * they do not starve the fastest one. The frame a stream is using stays in the cache until it
+ * requests the next one, after which its slots are freed.
+ *
+ * @note	Must be called with lock held.
+ */
+static void file_release_consumed(struct ra_file *file)
+{
+	uint32_t min_seq = UINT32_MAX;
+	uint32_t max_next_seq = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		if (streams[i].file == file) {
+			min_seq = MIN(min_seq, stream_in_use_seq(&streams[i]));
+			max_next_seq = MAX(max_next_seq, streams[i].next_seq);
+		}
+	}
+
+	if (min_seq == UINT32_MAX) {
+		return;
+	}
+
+	if (min_seq > file->head_seq) {
+		file->head_seq = min_seq;
+	} else if ((file->tail_seq - file->head_seq) == NUM_FRAMES &&
+		   max_next_seq == file->tail_seq && max_next_seq > 0) {
+		/* The frame the fastest stream is using is the next one for the slower streams */
+		const uint32_t skip_to = max_next_seq - 1;
+
+		for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+			if (streams[i].file == file && streams[i].next_seq < skip_to) {
+				streams[i].stats.underruns += skip_to - streams[i].next_seq;
+				streams[i].next_seq = skip_to;
+			}
+		}
+	}
+}
+
+/**
+ * @brief	Read the next chunk from the file into the chunk buffer.
+ *
+ * Unparsed data is kept at the start of the chunk buffer.
+ *
+ * @note	Must be called with io_lock held.
+ *
+ * @return	Number of octets read, 0 on end of file, negative error code otherwise.
+ */
+static int file_chunk_read(struct ra_file *file)
+{
+	const size_t remaining = file->chunk_len - file->chunk_pos;
+	size_t size = sizeof(file->chunk) - remaining;
+	uint32_t start;
+	uint32_t time_us;
+	int ret;
+
+	memmove(file->chunk, &file->chunk[file->chunk_pos], remaining);
+	file->chunk_len = remaining;
+	file->chunk_pos = 0;
+
+	sd_card_index_fs_lock();
+	start = k_cycle_get_32();
+	ret = sd_card_read((char *)&file->chunk[remaining], &size, &file->file);
+	time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	sd_card_index_fs_unlock();
+	if (ret) {
+		LOG_ERR("Failed to read %s: %d", file->path, ret);
+		return ret;
+	}
+
+	file->sd_reads++;
+	file->sd_read_time_max_us = MAX(file->sd_read_time_max_us, time_us);
+	file->chunk_len += size;
+
+	return size;
+}
+
+/**
+ * @brief	Parse the next frame of the chunk buffer into a cache slot.
+ *
+ * @note	Must be called with io_lock held.
+ *
+ * @param[in]	file	The file to parse the frame of.
+ * @param[out]	frame	Cache slot for the frame, or NULL to skip the frame.
+ * @param[out]	len	Size of the frame.
+ *
+ * @retval	0		Frame parsed.
+ * @retval	-EAGAIN		More data needed.
+ * @retval	-EBADMSG	Invalid frame size.
+ */
+static int file_frame_parse(struct ra_file *file, uint8_t *frame, uint16_t *len)
+{
+	const size_t avail = file->chunk_len - file->chunk_pos;
+	uint16_t frame_len;
+
+	if (avail < LC3_FRAME_HDR_SIZE) {
+		return -EAGAIN;
+	}
+
+	frame_len = sys_get_le16(&file->chunk[file->chunk_pos]);
+	if (frame_len == 0 || frame_len > CONFIG_LC3_READ_AHEAD_MAX_FRAME_SIZE) {
+		LOG_ERR("Invalid frame size %d in %s", frame_len, file->path);
+		return -EBADMSG;
+	}
+
+	if (avail < (LC3_FRAME_HDR_SIZE + frame_len)) {
+		return -EAGAIN;
+	}
+
+	if (frame != NULL) {
+		memcpy(frame, &file->chunk[file->chunk_pos + LC3_FRAME_HDR_SIZE], frame_len);
+		*len = frame_len;
+	}
+
+	file->chunk_pos += LC3_FRAME_HDR_SIZE + frame_len;
+	file->frame_pos++;
+
+	return 0;
+}
+
+/**
+ * @brief	Look up a file in the SD card index again, after the index has been rebuilt.
+ *
+ * @note	Must be called with io_lock held.
+ *
+ * @retval	-ESTALE	The file has changed since it was opened.
+ */
+static int file_index_update(struct ra_file *file)
+{
+	/* Taken first, so that a rebuild during the lookup makes the next seek fail */
+	const uint32_t index_gen = sd_card_index_generation_get();
+	struct sd_card_index_file_info info;
+	uint32_t index_idx;
+	int ret;
+
+	ret = sd_card_index_find(file->path, &index_idx);
+	if (ret == 0) {
+		ret = sd_card_index_info_get(index_idx, &info);
+	}
+
+	if (ret == 0 &&
+	    (info.file_size != file->file_size || info.frame_count != file->frame_count)) {
+		ret = -ESTALE;
+	}
+
+	if (ret) {
+		LOG_ERR("%s changed or was removed since it was opened: %d", file->path, ret);
+		return ret;
+	}
+
+	file->index_idx = index_idx;
+	file->index_gen = index_gen;
+
+	return 0;
+}
+
+/**
+ * @brief	Move the read position of a file to a frame, using the seek table of the SD card
+ *		index.
+ *
+ * Frames already in the cache are not affected.
+ *
+ * @note	Must be called with io_lock held.
+ */
+static int file_frame_seek(struct ra_file *file, uint32_t frame)
+{
+	uint32_t offset;
+	uint32_t skip;
+	int ret;
+
+	ret = sd_card_index_frame_seek(file->index_idx, file->index_gen, frame, &offset, &skip);
+	if (ret == -ESTALE) {
+		ret = file_index_update(file);
+		if (ret == 0) {
+			ret = sd_card_index_frame_seek(file->index_idx, file->index_gen, frame,
+						       &offset, &skip);
+		}
+	}
+	if (ret) {
+		LOG_ERR("Failed to find frame %d of %s: %d", frame, file->path, ret);
+		return ret;
+	}
+
+	sd_card_index_fs_lock();
+	ret = fs_seek(&file->file, offset, FS_SEEK_SET);
+	sd_card_index_fs_unlock();
+	if (ret) {
+		LOG_ERR("Failed to seek in %s: %d", file->path, ret);
+		return ret;
+	}
+
+	file->chunk_len = 0;
+	file->chunk_pos = 0;
+	file->frame_pos = frame - skip;
+	file->skip_frames = skip;
+
+	return 0;
+}
+
+/**
+ * @brief	Fill the free slots of the cache of a file, doing at most one SD card read.
+ *
+ * @note	Must be called with io_lock held.
+ *
+ * @return	True if more work is pending for the file.
+ */
+static bool file_refill(struct ra_file *file)
+{
+	uint32_t free_slots;
+	uint32_t produced = 0;
+	bool did_read = false;
+	bool more = false;
+	bool eof = false;
+	bool error = false;
+	int ret;
+
+	k_mutex_lock(&lock, K_FOREVER);
+	file_release_consumed(file);
+	free_slots = NUM_FRAMES - (file->tail_seq - file->head_seq);
+	k_mutex_unlock(&lock);
+
+	if (file->eof || file->error || free_slots == 0) {
+		return false;
+	}
+
+	while (produced < free_slots) {
+		const size_t slot = (file->tail_seq + produced) % NUM_FRAMES;
+
+		if (file->frame_pos == file->frame_count) {
+			if (!file->loop) {
+				eof = true;
+				break;
+			}
+
+			/* The end of the file is known from the index, so the first frame is read
+			 * right after the last one without waiting for the end of file
+			 */
+			if (file_frame_seek(file, 0)) {
+				error = true;
+				break;
+			}
+
+			continue;
+		}
+
+		if (file->skip_frames > 0) {
+			ret = file_frame_parse(file, NULL, NULL);
+			if (ret == 0) {
+				file->skip_frames--;
+				continue;
+			}
+		} else {
+			ret = file_frame_parse(file, file->frames[slot], &file->frame_len[slot]);
+			if (ret == 0) {
+				produced++;
+				continue;
+			}
+		}
+
+		if (ret != -EAGAIN) {
+			error = true;
+			break;
+		}
+
+		if (did_read) {
+			/* Let other files get their share of the SD card before reading more */
+			more = true;
+			break;
+		}
+
+		ret = file_chunk_read(file);
+		did_read = true;
+		if (ret <= 0) {
+			if (ret == 0) {
+				LOG_ERR("%s is shorter than when it was indexed", file->path);
+			}
+
+			error = true;
+			break;
+		}
+	}
+
+	/* Publish the new frames and the end of file together, so that a stream never sees the
+	 * end of file before it has seen the last frames
+	 */
+	k_mutex_lock(&lock, K_FOREVER);
+	file->tail_seq += produced;
+	file->eof = eof;
+	file->error = error;
+	k_mutex_unlock(&lock);
+
+	return more;
+}
+
+static void refill_thread(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	while (1) {
+		bool more = false;
+
+		k_mutex_lock(&io_lock, K_FOREVER);
+
+		for (size_t i = 0; i < ARRAY_SIZE(files); i++) {
+			if (files[i].in_use) {
+				more |= file_refill(&files[i]);
+			}
+		}
+
+		k_mutex_unlock(&io_lock);
+
+		if (!more) {
+			k_sem_take(&refill_sem, K_FOREVER);
+		}
+	}
+}
+
+/* Must be called with io_lock held */
+static int file_open(struct ra_file *file, uint32_t index_idx, uint32_t index_gen,
+		     const char *path, uint32_t start_frame, bool loop)
+{
+	struct sd_card_index_file_info info;
+	int ret;
+
+	memset(file, 0, offsetof(struct ra_file, frame_len));
+	file->chunk_len = 0;
+	file->chunk_pos = 0;
+	file->sd_reads = 0;
+	file->sd_read_time_max_us = 0;
+	strcpy(file->path, path);
+
+	/* The header and frames were validated when the file was indexed */
+	ret = sd_card_index_info_get(index_idx, &info);
+	if (ret) {
+		return ret;
+	}
+
+	if (!info.valid || info.frame_size_max > CONFIG_LC3_READ_AHEAD_MAX_FRAME_SIZE) {
+		LOG_ERR("%s is not a valid LC3 file, or has frames larger than %d octets",
+			file->path, CONFIG_LC3_READ_AHEAD_MAX_FRAME_SIZE);
+		return -EINVAL;
+	}
+
+	if (start_frame >= info.frame_count) {
+		LOG_ERR("Start frame %d is beyond the %d frames of %s", start_frame,
+			info.frame_count, file->path);
+		return -EINVAL;
+	}
+
+	fs_file_t_init(&file->file);
+
+	sd_card_index_fs_lock();
+	ret = sd_card_open(file->path, &file->file);
+	sd_card_index_fs_unlock();
+	if (ret) {
+		LOG_ERR("Failed to open %s: %d", file->path, ret);
+		return ret;
+	}
+
+	file->index_idx = index_idx;
+	file->index_gen = index_gen;
+	file->file_size = info.file_size;
+	file->start_frame = start_frame;
+	file->frame_count = info.frame_count;
+	file->frame_duration_us = info.frame_duration_us;
+	file->loop = loop;
+
+	ret = file_frame_seek(file, start_frame);
+	if (ret) {
+		sd_card_index_fs_lock();
+		(void)sd_card_close(&file->file);
+		sd_card_index_fs_unlock();
+		return ret;
+	}
+
+	file->in_use = true;
+
+	return 0;
+}
+
+/* Must be called with lock held. Files are compared by path, as rebuilding the index renumbers
+ * them
+ */
+static struct ra_file *file_shareable_find(const char *path, uint32_t start_frame, bool loop,
+					   const struct ra_file *exclude)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(files); i++) {
+		struct ra_file *file = &files[i];
+		bool started = false;
+
+		if (!file->in_use || file == exclude || file->loop != loop ||
+		    file->start_frame != start_frame || strcmp(file->path, path) != 0) {
+			continue;
+		}
+
+		for (size_t j = 0; j < ARRAY_SIZE(streams); j++) {
+			if (streams[j].file == file && streams[j].started) {
+				started = true;
+				break;
+			}
+		}
+
+		/* Only streams that start at the same position can share the cache */
+		if (!started) {
+			return file;
+		}
+	}
+
+	return NULL;
+}
+
+int lc3_read_ahead_next_frame_get(uint8_t stream_idx, const uint8_t **frame, size_t *frame_size)
+{
+	struct ra_stream *stream;
+	struct ra_file *file;
+	uint32_t lead;
+	int ret;
+
+	if (stream_idx >= ARRAY_SIZE(streams)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	stream = &streams[stream_idx];
+	file = stream->file;
+	if (file == NULL) {
+		k_mutex_unlock(&lock);
+		return -EINVAL;
+	}
+
+	lead = file->tail_seq - stream->next_seq;
+	if (lead == 0) {
+		if (file->eof) {
+			ret = -ENODATA;
+		} else if (file->error) {
+			ret = -EIO;
+		} else {
+			stream->stats.underruns++;
+			ret = -ENOMSG;
+		}
+	} else {
+		const size_t slot = stream->next_seq % NUM_FRAMES;
+
+		*frame = file->frames[slot];
+		*frame_size = file->frame_len[slot];
+		stream->held_seq = stream->next_seq;
+		stream->next_seq++;
+		stream->started = true;
+
+		stream->stats.frames_served++;
+		stream->stats.lead_min = MIN(stream->stats.lead_min, lead);
+		stream->stats.lead_max = MAX(stream->stats.lead_max, lead);
+		stream->stats.lead_sum += lead;
+		ret = 0;
+	}
+
+	k_mutex_unlock(&lock);
+
+	k_sem_give(&refill_sem);
+
+	return ret;
+}
+
+int lc3_read_ahead_stream_register(uint32_t index_idx, uint32_t start_frame, uint8_t *stream_idx,
+				   bool loop)
+{
+	/* Only used with io_lock held */
+	static char path[CONFIG_FS_FATFS_MAX_LFN + 1];
+	struct ra_stream *stream = NULL;
+	struct ra_file *file;
+	uint32_t index_gen;
+	int ret;
+
+	if (stream_idx == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&io_lock, K_FOREVER);
+
+	/* Taken first, so that a rebuild after the path lookup makes the first seek fail */
+	index_gen = sd_card_index_generation_get();
+	ret = sd_card_index_path_get(index_idx, path, sizeof(path));
+	if (ret) {
+		k_mutex_unlock(&io_lock);
+		return ret;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		if (streams[i].file == NULL) {
+			stream = &streams[i];
+			*stream_idx = i;
+			break;
+		}
+	}
+
+	if (stream == NULL) {
+		LOG_ERR("No free streams");
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	file = file_shareable_find(path, start_frame, loop, NULL);
+	if (file == NULL) {
+		for (size_t i = 0; i < ARRAY_SIZE(files); i++) {
+			if (!files[i].in_use) {
+				file = &files[i];
+				break;
+			}
+		}
+
+		if (file == NULL) {
+			LOG_ERR("No free files, max %d", CONFIG_LC3_READ_AHEAD_FILES);
+			ret = -ENOMEM;
+			goto unlock;
+		}
+
+		ret = file_open(file, index_idx, index_gen, path, start_frame, loop);
+		if (ret) {
+			goto unlock;
+		}
+	}
+
+	memset(stream, 0, sizeof(*stream));
+	stream->file = file;
+	stream->next_seq = file->head_seq;
+	stream->stats.lead_min = UINT32_MAX;
+	file->users++;
+
+	LOG_DBG("Stream %d reading %s from frame %d (%d users)", *stream_idx, file->path,
+		start_frame, file->users);
+	ret = 0;
+
+unlock:
+	k_mutex_unlock(&lock);
+	k_mutex_unlock(&io_lock);
+
+	if (ret == 0) {
+		k_sem_give(&refill_sem);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief	Remove a user of a file, and close the file when it was the last one.
+ *
+ * @note	Must be called with io_lock and lock held.
+ */
+static int file_user_remove(struct ra_file *file)
+{
+	int ret = 0;
+
+	file->users--;
+
+	if (file->users == 0) {
+		sd_card_index_fs_lock();
+		ret = sd_card_close(&file->file);
+		sd_card_index_fs_unlock();
+		if (ret) {
+			LOG_ERR("Failed to close %s: %d", file->path, ret);
+		}
+
+		file->in_use = false;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief	Move a stream to another file at the start frame, leaving the streams it shared its
+ *		file with where they are.
+ *
+ * A file that other streams restarted from the same frame have moved to, and have not read from
+ * yet, is shared, so that the streams restarted together stay in sync. Otherwise a new file is
+ * opened.
+ *
+ * @note	Must be called with io_lock and lock held.
+ */
+static int stream_unshare(struct ra_stream *stream)
+{
+	struct ra_file *old_file = stream->file;
+	struct ra_file *file;
+	uint32_t index_gen;
+	uint32_t index_idx;
+	int ret;
+
+	file = file_shareable_find(old_file->path, old_file->start_frame, old_file->loop, old_file);
+	if (file == NULL) {
+		for (size_t i = 0; i < ARRAY_SIZE(files); i++) {
+			if (!files[i].in_use) {
+				file = &files[i];
+				break;
+			}
+		}
+
+		if (file == NULL) {
+			LOG_ERR("No free files to restart %s, max %d", old_file->path,
+				CONFIG_LC3_READ_AHEAD_FILES);
+			return -ENOMEM;
+		}
+
+		/* Taken first, so that a rebuild during the lookup makes the first seek fail */
+		index_gen = sd_card_index_generation_get();
+		ret = sd_card_index_find(old_file->path, &index_idx);
+		if (ret == 0) {
+			ret = file_open(file, index_idx, index_gen, old_file->path,
+					old_file->start_frame, old_file->loop);
+		}
+
+		if (ret) {
+			return ret;
+		}
+	}
+
+	file->users++;
+	stream->file = file;
+	stream->next_seq = file->head_seq;
+	stream->started = false;
+
+	/* The stream has moved, so a failure to close the file it left is only logged */
+	(void)file_user_remove(old_file);
+
+	return 0;
+}
+
+int lc3_read_ahead_stream_restart(uint8_t stream_idx)
+{
+	struct ra_stream *stream;
+	struct ra_file *file;
+	bool shared = false;
+	int ret;
+
+	if (stream_idx >= ARRAY_SIZE(streams)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&io_lock, K_FOREVER);
+
+	/* Only the streams change the file of a stream, and they take io_lock */
+	stream = &streams[stream_idx];
+	file = stream->file;
+	if (file == NULL) {
+		k_mutex_unlock(&io_lock);
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	/* Rewinding the file would also rewind the other streams that have read from it. Streams
+	 * restarted together with this one may also have moved to another file already.
+	 */
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		if (&streams[i] != stream && streams[i].file == file && streams[i].started) {
+			shared = true;
+			break;
+		}
+	}
+
+	if (shared || file_shareable_find(file->path, file->start_frame, file->loop, file)) {
+		ret = stream_unshare(stream);
+
+		k_mutex_unlock(&lock);
+		k_mutex_unlock(&io_lock);
+
+		if (ret == 0) {
+			k_sem_give(&refill_sem);
+		}
+
+		return ret;
+	}
+
+	k_mutex_unlock(&lock);
+
+	ret = file_frame_seek(file, file->start_frame);
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	/* Drop the cache. Sequence numbers keep increasing, so no slot is reused while in use */
+	file->head_seq = file->tail_seq;
+	file->eof = false;
+	file->error = (ret != 0);
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		if (streams[i].file == file) {
+			streams[i].next_seq = file->tail_seq;
+			streams[i].started = false;
+		}
+	}
+
+	k_mutex_unlock(&lock);
+	k_mutex_unlock(&io_lock);
+
+	k_sem_give(&refill_sem);
+
+	return ret;
+}
+
+int lc3_read_ahead_stream_close(uint8_t stream_idx)
+{
+	struct ra_file *file;
+	int ret;
+
+	if (stream_idx >= ARRAY_SIZE(streams)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&io_lock, K_FOREVER);
+	k_mutex_lock(&lock, K_FOREVER);
+
+	file = streams[stream_idx].file;
+	if (file == NULL) {
+		k_mutex_unlock(&lock);
+		k_mutex_unlock(&io_lock);
+		return -EINVAL;
+	}
+
+	streams[stream_idx].file = NULL;
+	ret = file_user_remove(file);
+
+	k_mutex_unlock(&lock);
+	k_mutex_unlock(&io_lock);
+
+	return ret;
+}
+
+int lc3_read_ahead_close_all_streams(void)
+{
+	int ret = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		if (streams[i].file != NULL) {
+			int err = lc3_read_ahead_stream_close(i);
+
+			if (err) {
+				ret = err;
+			}
+		}
+	}
+
+	return ret;
+}
+
+int lc3_read_ahead_file_path_get(uint8_t stream_idx, char *path, size_t path_len)
+{
+	int ret = -EINVAL;
+
+	if (stream_idx >= ARRAY_SIZE(streams) || path == NULL || path_len == 0) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	if (streams[stream_idx].file != NULL) {
+		strncpy(path, streams[stream_idx].file->path, path_len - 1);
+		path[path_len - 1] = '\0';
+		ret = 0;
+	}
+
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+bool lc3_read_ahead_is_looping(uint8_t stream_idx)
+{
+	bool looping = false;
+
+	if (stream_idx >= ARRAY_SIZE(streams)) {
+		return false;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	if (streams[stream_idx].file != NULL) {
+		looping = streams[stream_idx].file->loop;
+	}
+
+	k_mutex_unlock(&lock);
+
+	return looping;
+}
+
+int lc3_read_ahead_stats_get(uint8_t stream_idx, struct lc3_read_ahead_stats *stats)
+{
+	const struct ra_file *file;
+
+	if (stream_idx >= ARRAY_SIZE(streams) || stats == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	file = streams[stream_idx].file;
+	if (file == NULL) {
+		k_mutex_unlock(&lock);
+		return -EINVAL;
+	}
+
+	*stats = streams[stream_idx].stats;
+	if (stats->frames_served == 0) {
+		stats->lead_min = 0;
+	}
+
+	stats->frame_duration_us = file->frame_duration_us;
+	stats->sd_reads = file->sd_reads;
+	stats->sd_read_time_max_us = file->sd_read_time_max_us;
+	stats->file_users = file->users;
+
+	k_mutex_unlock(&lock);
+
+	return 0;
+}
+
+void lc3_read_ahead_stats_reset(void)
+{
+	k_mutex_lock(&io_lock, K_FOREVER);
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		memset(&streams[i].stats, 0, sizeof(streams[i].stats));
+		streams[i].stats.lead_min = UINT32_MAX;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(files); i++) {
+		files[i].sd_reads = 0;
+		files[i].sd_read_time_max_us = 0;
+	}
+
+	k_mutex_unlock(&lock);
+	k_mutex_unlock(&io_lock);
+}
+
+int lc3_read_ahead_init(void)
+{
+	static bool initialized;
+	k_tid_t thread_id;
+
+	if (initialized) {
+		return -EALREADY;
+	}
+
+	thread_id = k_thread_create(&refill_thread_data, refill_thread_stack,
+				    K_THREAD_STACK_SIZEOF(refill_thread_stack), refill_thread, NULL,
+				    NULL, NULL, K_PRIO_PREEMPT(CONFIG_LC3_READ_AHEAD_THREAD_PRIO), 0,
+				    K_NO_WAIT);
+	k_thread_name_set(thread_id, "LC3 read-ahead");
+
+	initialized = true;
+
+	return 0;
+}
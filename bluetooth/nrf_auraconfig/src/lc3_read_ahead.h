@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _LC3_READ_AHEAD_H_
+#define _LC3_READ_AHEAD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup lc3_read_ahead LC3 read-ahead streamer
+ * @brief Streams LC3 frames from files on the SD card through a read-ahead frame cache.
+ *
+ * Each open file has a cache of CONFIG_LC3_READ_AHEAD_FRAMES frames that is refilled by a
+ * separate thread with reads of CONFIG_LC3_READ_AHEAD_READ_SIZE octets, so that SD card latency
+ * spikes are absorbed by the cache instead of causing dropouts. Streams that register the same
+ * file at the same start frame, before any of them has started consuming frames, share the same
+ * cache and file handle.
+ *
+ * Files are identified by their index in the SD card index, and frames are located with its seek
+ * table, so streams can start at any frame and loop without waiting for the end of the file.
+ *
+ * @{
+ */
+
+/** Index value used for a stream that is not registered */
+#define LC3_READ_AHEAD_IDX_UNUSED 0xFF
+
+/**
+ * @brief	Read-ahead statistics for a single stream.
+ *
+ * The lead is the number of frames available in the cache for a stream when it requests a
+ * frame, i.e. how far the SD card reading is ahead of the stream.
+ */
+struct lc3_read_ahead_stats {
+	/* Number of frames returned to the stream */
+	uint32_t frames_served;
+	/* Number of times a frame was requested before it was read from the SD card, plus frames
+	 * skipped so that a faster stream sharing the file could continue
+	 */
+	uint32_t underruns;
+	/* Smallest lead seen, in frames */
+	uint32_t lead_min;
+	/* Largest lead seen, in frames */
+	uint32_t lead_max;
+	/* Sum of the leads, used to calculate the average lead */
+	uint64_t lead_sum;
+	/* Frame duration of the file in microseconds, used to convert leads to time */
+	uint32_t frame_duration_us;
+	/* Number of SD card reads done for the file of the stream */
+	uint32_t sd_reads;
+	/* Longest time spent in a single SD card read for the file of the stream */
+	uint32_t sd_read_time_max_us;
+	/* Number of streams sharing the file of the stream */
+	uint8_t file_users;
+};
+
+/**
+ * @brief	Get the next frame of a stream.
+ *
+ * @note	The frame is valid until the next call to this function for the same stream, or
+ *		until the stream is closed.
+ *
+ * @param[in]	stream_idx	Index of the stream.
+ * @param[out]	frame		Pointer to the frame.
+ * @param[out]	frame_size	Size of the frame in octets.
+ *
+ * @retval	0		Success.
+ * @retval	-ENOMSG		The next frame has not been read from the SD card yet.
+ * @retval	-ENODATA	End of file reached for a stream that is not looping.
+ * @retval	-EINVAL		Invalid stream index.
+ */
+int lc3_read_ahead_next_frame_get(uint8_t stream_idx, const uint8_t **frame, size_t *frame_size);
+
+/**
+ * @brief	Register a stream reading an LC3 file.
+ *
+ * The cache starts filling immediately, so that it is full when streaming starts.
+ *
+ * @param[in]	index_idx	Index of the file in the SD card index.
+ * @param[in]	start_frame	Frame to start streaming from.
+ * @param[out]	stream_idx	Index of the registered stream.
+ * @param[in]	loop		Continue from the first frame when the end of the file is reached.
+ *
+ * @retval	0		Success.
+ * @retval	-ENOMEM		No free stream or file slot.
+ * @retval	-EINVAL		Invalid LC3 file, or @p start_frame is beyond the end of the file.
+ * @return	Other negative error codes from the SD card module.
+ */
+int lc3_read_ahead_stream_register(uint32_t index_idx, uint32_t start_frame, uint8_t *stream_idx,
+				   bool loop);
+
+/**
+ * @brief	Move a stream back to the frame it was registered with.
+ *
+ * The cache of the file is dropped and refilled from the start frame, so that streams started
+ * together begin at their start frames, independent of how far they were streamed before.
+ * Streams sharing the file that have not read from it yet are restarted as well. If another
+ * stream sharing the file has, the stream is moved to a file of its own instead, so that the
+ * other stream is not rewound. Streams restarted from the same frame share that file again.
+ *
+ * @note	The stream shall not be streaming.
+ *
+ * @param[in]	stream_idx	Index of the stream.
+ *
+ * @retval	0		Success.
+ * @retval	-EINVAL		Invalid stream index.
+ * @retval	-ENOMEM		No free file slot to move the stream to.
+ * @return	Other negative error codes from the SD card module.
+ */
+int lc3_read_ahead_stream_restart(uint8_t stream_idx);
+
+/**
+ * @brief	Close a stream.
+ *
+ * The file is closed when the last stream using it is closed.
+ *
+ * @param[in]	stream_idx	Index of the stream.
+ *
+ * @retval	0		Success.
+ * @retval	-EINVAL		Invalid stream index.
+ */
+int lc3_read_ahead_stream_close(uint8_t stream_idx);
+
+/**
+ * @brief	Close all streams.
+ *
+ * @return	0 on success, error from the last failing close otherwise.
+ */
+int lc3_read_ahead_close_all_streams(void);
+
+/**
+ * @brief	Get the path of the file read by a stream.
+ *
+ * @param[in]	stream_idx	Index of the stream.
+ * @param[out]	path		Buffer for the path.
+ * @param[in]	path_len	Size of @p path.
+ *
+ * @return	0 on success, -EINVAL on invalid stream index.
+ */
+int lc3_read_ahead_file_path_get(uint8_t stream_idx, char *path, size_t path_len);
+
+/**
+ * @brief	Check if a stream is looping.
+ *
+ * @param[in]	stream_idx	Index of the stream.
+ *
+ * @return	True if the stream is valid and looping.
+ */
+bool lc3_read_ahead_is_looping(uint8_t stream_idx);
+
+/**
+ * @brief	Get the read-ahead statistics of a stream.
+ *
+ * @param[in]	stream_idx	Index of the stream.
+ * @param[out]	stats		Statistics.
+ *
+ * @return	0 on success, -EINVAL on invalid stream index.
+ */
+int lc3_read_ahead_stats_get(uint8_t stream_idx, struct lc3_read_ahead_stats *stats);
+
+/**
+ * @brief	Reset the read-ahead statistics of all streams.
+ */
+void lc3_read_ahead_stats_reset(void);
+
+/**
+ * @brief	Initialize the read-ahead streamer and start the refill thread.
+ *
+ * @note	The SD card shall be initialized before calling this function.
+ *
+ * @return	0 on success, -EALREADY if already initialized.
+ */
+int lc3_read_ahead_init(void);
+
+/** @} */
+
+#endif /* _LC3_READ_AHEAD_H_ */
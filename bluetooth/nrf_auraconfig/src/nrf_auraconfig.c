@@ -20,10 +20,11 @@
 #include "zbus_common.h"
 #include "macros_common.h"
 #include "bt_mgmt.h"
-#include "lc3_streamer.h"
+#include "lc3_read_ahead.h"
 #include "led_assignments.h"
 #include "led.h"
 #include "sd_card.h"
+#include "sd_card_index.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(main, CONFIG_MAIN_LOG_LEVEL);
@@ -104,7 +105,7 @@ static enum bt_audio_location stream_location[CONFIG_BT_ISO_MAX_BIG]
 					     [CONFIG_BT_BAP_BROADCAST_SRC_STREAM_COUNT] = {
 						     {{BT_AUDIO_LOCATION_MONO_AUDIO}}};
 
-#define LC3_STREAMER_INDEX_UNUSED 0xFF
+#define LC3_STREAMER_INDEX_UNUSED LC3_READ_AHEAD_IDX_UNUSED
 
 struct subgroup_lc3_stream_info {
 	size_t frame_size;
@@ -308,6 +309,7 @@ static void stream_frame_get_and_send(struct stream_index stream_idx)
 
 	uint8_t num_bis = subgroups[stream_idx.lvl1][stream_idx.lvl2].num_bises;
 	uint8_t stream_file_idx = bis_info->lc3_streamer_idx[stream_idx.lvl3];
+	size_t frame_size;
 
 	if (stream_file_idx == LC3_STREAMER_INDEX_UNUSED) {
 		LOG_ERR("Stream index for stream big %d sub: %d bis: %d is unused", stream_idx.lvl1,
@@ -315,11 +317,12 @@ static void stream_frame_get_and_send(struct stream_index stream_idx)
 		return;
 	}
 
-	ret = lc3_streamer_next_frame_get(
-		stream_file_idx, (const uint8_t **const)&(bis_info->frame_ptrs[stream_idx.lvl3]));
+	ret = lc3_read_ahead_next_frame_get(
+		stream_file_idx, (const uint8_t **)&(bis_info->frame_ptrs[stream_idx.lvl3]),
+		&frame_size);
 	if (ret == -ENODATA) {
 		LOG_WRN("No more frames to read");
-		ret = lc3_streamer_stream_close(stream_file_idx);
+		ret = lc3_read_ahead_stream_close(stream_file_idx);
 		if (ret) {
 			LOG_ERR("Failed to close stream: %d", ret);
 		}
@@ -334,6 +337,9 @@ static void stream_frame_get_and_send(struct stream_index stream_idx)
 	} else if (ret) {
 		LOG_ERR("Failed to get next frame: %d", ret);
 		return;
+	} else if (frame_size != bis_info->frame_size) {
+		LOG_DBG("Frame size %d for stream %d does not match SDU size %d", frame_size,
+			stream_idx.lvl3, bis_info->frame_size);
 	}
 
 	bis_info->frame_loaded[stream_idx.lvl3] = true;
@@ -653,7 +659,7 @@ static void nrf_auraconfig_clear(void)
 	int ret;
 
 	if (sd_card_present) {
-		ret = lc3_streamer_close_all_streams();
+		ret = lc3_read_ahead_close_all_streams();
 		if (ret) {
 			LOG_ERR("Failed to close all LC3 streams: %d", ret);
 		}
@@ -672,30 +678,6 @@ static void nrf_auraconfig_clear(void)
 	}
 }
 
-#define SD_FILECOUNT_MAX 420
-#define SD_PATHLEN_MAX	 190
-static char sd_paths_and_files[SD_FILECOUNT_MAX][SD_PATHLEN_MAX];
-static uint32_t num_files_added;
-
-static int sd_card_toc_gen(void)
-{
-
-	/* Traverse SD tree */
-	int ret;
-
-	ret = sd_card_list_files_match(SD_FILECOUNT_MAX, SD_PATHLEN_MAX, sd_paths_and_files, NULL,
-				       ".lc3");
-	if (ret < 0) {
-		return ret;
-	}
-
-	num_files_added = ret;
-
-	LOG_INF("Number of *.lc3 files on SD card: %d", num_files_added);
-
-	return 0;
-}
-
 void nrf_auraconfig_main(void)
 {
 	int ret;
@@ -718,12 +700,17 @@ void nrf_auraconfig_main(void)
 	ret = zbus_link_producers_observers();
 	ERR_CHK_MSG(ret, "Failed to link zbus producers and observers");
 
-	ret = lc3_streamer_init();
+	ret = sd_card_init();
 	if (ret) {
-		LOG_WRN("Failed to initialize LC3 streamer. Transmitting fixed buffers");
+		LOG_WRN("Failed to initialize SD card. Transmitting fixed buffers");
 		sd_card_present = false;
 	}
 
+	if (sd_card_present) {
+		ret = lc3_read_ahead_init();
+		ERR_CHK_MSG(ret, "Failed to initialize LC3 read-ahead");
+	}
+
 	for (int i = 0; i < CONFIG_BT_ISO_MAX_BIG; i++) {
 		for (int j = 0; j < CONFIG_BT_BAP_BROADCAST_SRC_SUBGROUP_COUNT; j++) {
 			for (int k = 0; k < CONFIG_BT_BAP_BROADCAST_SRC_STREAM_COUNT; k++) {
@@ -735,11 +722,6 @@ void nrf_auraconfig_main(void)
 
 	ret = zbus_subscribers_create();
 	ERR_CHK_MSG(ret, "Failed to create zbus subscriber threads");
-
-	if (sd_card_present) {
-		ret = sd_card_toc_gen();
-		ERR_CHK_MSG(ret, "Failed to generate SD card table");
-	}
 }
 
 static void context_print(const struct shell *shell)
@@ -905,10 +887,10 @@ static void nrf_auraconfig_print(const struct shell *shell, uint8_t group_index)
 				shell_print(shell, "\t\t\tBIS %d: Not set", j);
 			} else {
 				char file_name[CONFIG_FS_FATFS_MAX_LFN];
-				bool looping = lc3_streamer_is_looping(streamer_idx);
+				bool looping = lc3_read_ahead_is_looping(streamer_idx);
 
-				lc3_streamer_file_path_get(streamer_idx, file_name,
-							   sizeof(file_name));
+				lc3_read_ahead_file_path_get(streamer_idx, file_name,
+							     sizeof(file_name));
 				shell_print(shell, "\t\t\tBIS %d: %s %s", j, file_name,
 					    looping ? "(looping)" : "");
 			}
@@ -1089,6 +1071,26 @@ static int big_enable(const struct shell *shell, uint8_t big_index)
 		return 0;
 	}
 
+	if (sd_card_present) {
+		/* Start all BISes at their selected start points, so that e.g. the languages of a
+		 * multi-language broadcast are in sync, also when the BIG has been streamed before
+		 */
+		for (size_t i = 0; i < broadcast_param[big_index].num_subgroups; i++) {
+			for (size_t j = 0; j < CONFIG_BT_BAP_BROADCAST_SRC_STREAM_COUNT; j++) {
+				uint8_t streamer_idx = lc3_stream_infos[big_index][i].lc3_streamer_idx[j];
+
+				if (streamer_idx == LC3_STREAMER_INDEX_UNUSED) {
+					continue;
+				}
+
+				ret = lc3_read_ahead_stream_restart(streamer_idx);
+				if (ret) {
+					LOG_WRN("Failed to restart stream %d: %d", streamer_idx, ret);
+				}
+			}
+		}
+	}
+
 	ret = broadcast_source_enable(&broadcast_param[big_index], big_index);
 	if (ret) {
 		shell_error(shell, "Failed to enable broadcaster: %d", ret);
@@ -1708,15 +1710,13 @@ static int cmd_program_info(const struct shell *shell, size_t argc, char **argv)
 	return 0;
 }
 
-#define FILE_LIST_BUF_SIZE 1024
-
 static int cmd_file_list(const struct shell *shell, size_t argc, char **argv)
 {
-
 	int ret;
-	char buf[FILE_LIST_BUF_SIZE];
-	size_t buf_size = FILE_LIST_BUF_SIZE;
+	int num_files;
+	size_t dir_path_len = 0;
 	char *dir_path = NULL;
+	static char path[SD_CARD_INDEX_PATH_LEN_MAX];
 
 	if (!sd_card_present) {
 		shell_error(shell, "No SD card present: files cannot be listed");
@@ -1730,15 +1730,66 @@ static int cmd_file_list(const struct shell *shell, size_t argc, char **argv)
 
 	if (argc == 2) {
 		dir_path = argv[1];
+
+		/* Paths in the index are relative to the root of the SD card */
+		while (*dir_path == '/') {
+			dir_path++;
+		}
+
+		dir_path_len = strlen(dir_path);
 	}
 
-	ret = sd_card_list_files(dir_path, buf, &buf_size, true);
-	if (ret) {
-		shell_error(shell, "List files err: %d", ret);
+	num_files = sd_card_index_count();
+	if (num_files < 0) {
+		shell_error(shell, "Failed to load SD card index: %d", num_files);
+		return num_files;
+	}
+
+	for (uint32_t i = 0; i < num_files; i++) {
+		struct sd_card_index_file_info info;
+
+		ret = sd_card_index_path_get(i, path, sizeof(path));
+		if (ret) {
+			shell_error(shell, "Failed to get path of file %d: %d", i, ret);
+			return ret;
+		}
+
+		if (dir_path_len && (strncmp(path, dir_path, dir_path_len) != 0 ||
+				     (path[dir_path_len] != '/' && dir_path[dir_path_len - 1] != '/'))) {
+			continue;
+		}
+
+		ret = sd_card_index_info_get(i, &info);
+		if (ret) {
+			shell_error(shell, "Failed to get info of file %d: %d", i, ret);
+			return ret;
+		}
+
+		shell_print(shell, "%s: %d Hz, %d bps, %d us, %d ch, %d.%03d s", path,
+			    info.sample_rate_hz, info.bit_rate_bps, info.frame_duration_us,
+			    info.channels, info.duration_ms / MSEC_PER_SEC,
+			    info.duration_ms % MSEC_PER_SEC);
+	}
+
+	return 0;
+}
+
+static int cmd_file_index(const struct shell *shell, size_t argc, char **argv)
+{
+	int ret;
+
+	if (!sd_card_present) {
+		shell_error(shell, "No SD card present: no index to rebuild");
+		return -EFAULT;
+	}
+
+	ret = sd_card_index_rebuild();
+	if (ret < 0) {
+		shell_error(shell, "Failed to rebuild SD card index: %d", ret);
 		return ret;
 	}
 
-	shell_print(shell, "%s", buf);
+	shell_print(shell, "Indexed %d LC3 files", ret);
 
 	return 0;
 }
@@ -1755,10 +1806,10 @@ static int cmd_file_select(const struct shell *shell, size_t argc, char **argv)
 		return -EFAULT;
 	}
 
-	if (argc != 5) {
+	if (argc != 5 && argc != 6) {
 		shell_error(shell,
 			    "Usage: nac file select <file path> <BIG index> <subgroup index> "
-			    "<BIS index>");
+			    "<BIS index> [start ms]");
 		return -EINVAL;
 	}
 
@@ -1813,25 +1864,140 @@ static int cmd_file_select(const struct shell *shell, size_t argc, char **argv)
 		shell_error(shell, "Failed to get bit rate: %d", ret);
 	}
 
-	/* Verify that the file header matches the stream configurationn */
-	/* NOTE: This will not abort the streamer if the file is not valid, only give a warning */
-	bool header_valid = lc3_streamer_file_compatible_check(file_name, &cfg);
+	uint32_t file_idx;
+	struct sd_card_index_file_info info;
+
+	ret = sd_card_index_find(file_name, &file_idx);
+	if (ret == 0) {
+		ret = sd_card_index_file_validate(file_idx);
+	}
+
+	if (ret == -ESTALE) {
+		/* Rebuilt on the next lookup */
+		ret = sd_card_index_find(file_name, &file_idx);
+	}
 
-	if (!header_valid) {
+	if (ret == -ENOENT) {
+		shell_error(shell, "File %s not found on SD card", file_name);
+		return ret;
+	} else if (ret) {
+		shell_error(shell, "Failed to look up %s in SD card index: %d", file_name, ret);
+		return ret;
+	}
+
+	ret = sd_card_index_info_get(file_idx, &info);
+	if (ret) {
+		shell_error(shell, "Failed to get file info: %d", ret);
+		return ret;
+	}
+
+	if (!info.valid) {
+		shell_error(shell, "%s is not a valid LC3 file", file_name);
+		return -EINVAL;
+	}
+
+	uint16_t sdu = broadcast_param[big_index].subgroups[sub_index].group_lc3_preset.qos.sdu;
+	uint32_t start_frame = 0;
+
+	if (argc == 6) {
+		if (!is_number(argv[5])) {
+			shell_error(shell, "Start time must be a number of milliseconds");
+			return -EINVAL;
+		}
+
+		start_frame = (uint64_t)strtoul(argv[5], NULL, 10) * USEC_PER_MSEC /
+			      info.frame_duration_us;
+		if (start_frame >= info.frame_count) {
+			shell_error(shell, "Start time is beyond the end of the file (%d ms)",
+				    info.duration_ms);
+			return -EINVAL;
+		}
+	}
+
+	/* Verify that the file header matches the stream configuration */
+	/* NOTE: This will not abort the streamer if the file is not valid, only give a warning */
+	if (info.sample_rate_hz != cfg.sample_rate_hz ||
+	    info.frame_duration_us != cfg.frame_duration_us ||
+	    info.bit_rate_bps != cfg.bit_rate_bps) {
 		shell_warn(shell, "File header verification failed. File may not be compatible "
 				  "with stream config.");
 	}
 
-	ret = lc3_streamer_stream_register(
-		file_name, &lc3_stream_infos[big_index][sub_index].lc3_streamer_idx[bis_index],
-		true);
+	if (info.frame_size_min != sdu || info.frame_size_max != sdu) {
+		shell_warn(shell, "Frame sizes %d-%d do not match SDU size %d", info.frame_size_min,
+			   info.frame_size_max, sdu);
+	}
+
+	uint8_t *streamer_idx = &lc3_stream_infos[big_index][sub_index].lc3_streamer_idx[bis_index];
+
+	if (*streamer_idx != LC3_STREAMER_INDEX_UNUSED) {
+		(void)lc3_read_ahead_stream_close(*streamer_idx);
+		*streamer_idx = LC3_STREAMER_INDEX_UNUSED;
+	}
+
+	ret = lc3_read_ahead_stream_register(file_idx, start_frame, streamer_idx, true);
 	if (ret) {
 		shell_error(shell, "Failed to register stream: %d", ret);
+		*streamer_idx = LC3_STREAMER_INDEX_UNUSED;
 		return ret;
 	}
 
-	lc3_stream_infos[big_index][sub_index].frame_size =
-		broadcast_param[big_index].subgroups[sub_index].group_lc3_preset.qos.sdu;
+	lc3_stream_infos[big_index][sub_index].frame_size = sdu;
+
+	return 0;
+}
+
+static int cmd_file_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	int ret;
+
+	if (!sd_card_present) {
+		shell_error(shell, "No SD card present: no file statistics");
+		return -EFAULT;
+	}
+
+	if ((argc == 2) && (strcmp(argv[1], "reset") == 0)) {
+		lc3_read_ahead_stats_reset();
+		return 0;
+	} else if (argc != 1) {
+		shell_error(shell, "Usage: nac file stats [reset]");
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < CONFIG_BT_ISO_MAX_BIG; i++) {
+		for (size_t j = 0; j < CONFIG_BT_BAP_BROADCAST_SRC_SUBGROUP_COUNT; j++) {
+			for (size_t k = 0; k < CONFIG_BT_BAP_BROADCAST_SRC_STREAM_COUNT; k++) {
+				uint8_t streamer_idx = lc3_stream_infos[i][j].lc3_streamer_idx[k];
+				struct lc3_read_ahead_stats stats;
+				uint32_t lead_avg;
+
+				if (streamer_idx == LC3_STREAMER_INDEX_UNUSED) {
+					continue;
+				}
+
+				ret = lc3_read_ahead_stats_get(streamer_idx, &stats);
+				if (ret) {
+					continue;
+				}
+
+				lead_avg = stats.frames_served
+						   ? (uint32_t)(stats.lead_sum / stats.frames_served)
+						   : 0;
+
+				shell_print(shell,
+					    "BIG %d sub %d BIS %d: frames %d, underruns %d, "
+					    "lead min/avg/max %d/%d/%d ms",
+					    i, j, k, stats.frames_served, stats.underruns,
+					    stats.lead_min * stats.frame_duration_us / USEC_PER_MSEC,
+					    lead_avg * stats.frame_duration_us / USEC_PER_MSEC,
+					    stats.lead_max * stats.frame_duration_us / USEC_PER_MSEC);
+				shell_print(shell,
+					    "\tSD reads %d, max read time %d us, file shared by %d "
+					    "stream(s)",
+					    stats.sd_reads, stats.sd_read_time_max_us, stats.file_users);
+			}
+		}
+	}
 
 	return 0;
 }
@@ -2629,12 +2795,18 @@ static void file_paths_get(size_t idx, struct shell_static_entry *entry);
 
 SHELL_DYNAMIC_CMD_CREATE(folder_names, file_paths_get);
 
+/* The shell may hold on to a few entries while completing a command */
+#define FILE_PATH_ENTRIES 4
+
 static void file_paths_get(size_t idx, struct shell_static_entry *entry)
 {
-	if (idx < num_files_added) {
-		entry->syntax = sd_paths_and_files[idx];
-	} else {
-		entry->syntax = NULL;
+	static char paths[FILE_PATH_ENTRIES][SD_CARD_INDEX_PATH_LEN_MAX];
+	char *path = paths[idx % FILE_PATH_ENTRIES];
+
+	entry->syntax = NULL;
+
+	if (sd_card_present && sd_card_index_path_get(idx, path, SD_CARD_INDEX_PATH_LEN_MAX) == 0) {
+		entry->syntax = path;
 	}
 
 	entry->handler = NULL;
@@ -2645,9 +2817,13 @@ static void file_paths_get(size_t idx, struct shell_static_entry *entry)
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_file_cmd,
 			       SHELL_COND_CMD(CONFIG_SHELL, list, NULL, "List files on SD card",
 					      cmd_file_list),
+			       SHELL_COND_CMD(CONFIG_SHELL, index, NULL, "Rebuild SD card index",
+					      cmd_file_index),
+			       SHELL_COND_CMD(CONFIG_SHELL, stats, NULL,
+					      "Show SD card read-ahead statistics", cmd_file_stats),
 			       /* 5 required arguments */
 			       SHELL_CMD_ARG(select, &folder_names, "Select file on SD card",
-					     cmd_file_select, 5, 0),
+					     cmd_file_select, 5, 1),
 			       SHELL_SUBCMD_SET_END);
 
 SHELL_STATIC_SUBCMD_SET_CREATE(
@@ -0,0 +1,1115 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sd_card_index.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sd_card_index, CONFIG_SD_CARD_INDEX_LOG_LEVEL);
+
+/* Mount point of the SD card, as used by the SD card module */
+#define SD_ROOT_PATH	  "/SD:"
+#define INDEX_FILE_PATH	  SD_ROOT_PATH "/nac_index.bin"
+#define STRTAB_FILE_PATH  SD_ROOT_PATH "/nac_strings.bin"
+#define SEEK_FILE_PATH	  SD_ROOT_PATH "/nac_frames.bin"
+/* A new index is built into these files, and then replaces the loaded one */
+#define INDEX_BUILD_PATH  SD_ROOT_PATH "/nac_index.tmp"
+#define STRTAB_BUILD_PATH SD_ROOT_PATH "/nac_strings.tmp"
+#define SEEK_BUILD_PATH	  SD_ROOT_PATH "/nac_frames.tmp"
+#define LC3_FILE_EXT	  ".lc3"
+
+#define INDEX_MAGIC	  0x5843414E /* "NACX" */
+#define INDEX_VERSION	  2
+#define INDEX_DIR_ROOT	  UINT32_MAX
+#define INDEX_READ_BLOCK  16
+
+#define ENTRY_FLAG_VALID BIT(0)
+/* All frames have the same size, so frame offsets are calculated instead of read */
+#define ENTRY_FLAG_CBR	 BIT(1)
+
+#define SEEK_INTERVAL	CONFIG_SD_CARD_INDEX_SEEK_INTERVAL
+#define SEEK_BATCH_SIZE 32
+
+/* LC3 file header, see lc3_file.h */
+#define LC3_FILE_ID		    0xCC1C
+#define LC3_FILE_HDR_SIZE_MIN	    18
+#define LC3_FILE_HDR_SIZE_POS	    2
+#define LC3_FILE_HDR_SAMPLE_RATE_POS 4
+#define LC3_FILE_HDR_BIT_RATE_POS    6
+#define LC3_FILE_HDR_CHANNELS_POS    8
+#define LC3_FILE_HDR_FRAME_DUR_POS   10
+
+/* Each frame in an LC3 file is preceded by its size as a 16-bit little endian value */
+#define LC3_FRAME_HDR_SIZE 2
+/* Largest LC3 frame allowed by the LC3 specification */
+#define LC3_FRAME_SIZE_MAX 400
+
+struct index_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t entry_size;
+	uint32_t entry_count;
+	uint32_t strtab_size;
+	/* Signature of the SD card contents when the index was built */
+	uint32_t card_blocks;
+	uint32_t card_free_blocks;
+	/* Number of frames between seek points in the seek table */
+	uint32_t seek_interval;
+} __packed;
+
+struct index_entry {
+	/* Hash of the path relative to the root of the SD card */
+	uint32_t path_hash;
+	/* Offset of the directory path in the string table, or INDEX_DIR_ROOT */
+	uint32_t dir_off;
+	/* Offset of the file name in the string table */
+	uint32_t name_off;
+	uint32_t file_size;
+	uint32_t sample_rate_hz;
+	uint32_t bit_rate_bps;
+	/* Number of complete frames in the file */
+	uint32_t frame_count;
+	/* Index of the first seek point of the file in the seek table */
+	uint32_t seek_off;
+	uint16_t frame_duration_us;
+	/* Offset of the first frame in the file */
+	uint16_t data_offset;
+	uint16_t frame_size_min;
+	uint16_t frame_size_max;
+	uint8_t channels;
+	uint8_t flags;
+	uint8_t rfu[2];
+} __packed;
+
+struct index_builder {
+	struct fs_file_t index;
+	struct fs_file_t strtab;
+	struct fs_file_t seek;
+	uint32_t entry_count;
+	uint32_t strtab_size;
+	uint32_t seek_count;
+	/* Seek points not yet written to the seek table */
+	uint32_t seek_batch[SEEK_BATCH_SIZE];
+	size_t seek_batch_len;
+	/* Data read from the LC3 file being indexed */
+	uint8_t chunk[CONFIG_SD_CARD_INDEX_READ_SIZE];
+	/* Offset of the current directory in the string table, if dir_written */
+	uint32_t dir_off;
+	bool dir_written;
+	/* Path of the current directory, relative to the root of the SD card */
+	char path[SD_CARD_INDEX_PATH_LEN_MAX];
+	char abs_path[sizeof(SD_ROOT_PATH) + SD_CARD_INDEX_PATH_LEN_MAX];
+	struct fs_dirent dirent;
+};
+
+/* FatFs is built without CONFIG_FS_FATFS_REENTRANT, so no two threads may be in it at once.
+ * fs_lock serializes every file system call on the SD card, made here or by the LC3 read-ahead.
+ * It is only held around single calls, and no other lock is taken with it held, so it can be
+ * taken with any of the other locks held.
+ */
+static K_MUTEX_DEFINE(fs_lock);
+/* Protects the loaded index */
+static K_MUTEX_DEFINE(index_lock);
+/* Serializes index builds, and protects the builder. Taken before index_lock */
+static K_MUTEX_DEFINE(build_lock);
+static bool index_loaded;
+static bool index_stale;
+/* Incremented every time a new index replaces the loaded one */
+static uint32_t index_generation;
+static struct index_header header;
+static struct fs_file_t index_file;
+static struct fs_file_t strtab_file;
+static struct fs_file_t seek_file;
+static struct index_builder builder;
+
+BUILD_ASSERT(CONFIG_SD_CARD_INDEX_READ_SIZE >= LC3_FILE_HDR_SIZE_MIN,
+	     "A read must be able to hold the file header");
+
+/* Make a file system call with fs_lock held, and evaluate to its result */
+#define FS_LOCKED(call)                                                                            \
+	({                                                                                         \
+		k_mutex_lock(&fs_lock, K_FOREVER);                                                 \
+		__auto_type _ret = (call);                                                         \
+		k_mutex_unlock(&fs_lock);                                                          \
+		_ret;                                                                              \
+	})
+
+void sd_card_index_fs_lock(void)
+{
+	k_mutex_lock(&fs_lock, K_FOREVER);
+}
+
+void sd_card_index_fs_unlock(void)
+{
+	k_mutex_unlock(&fs_lock);
+}
+
+/* FNV-1a hash, continued from @p hash */
+static uint32_t hash_add(uint32_t hash, const char *str)
+{
+	while (*str != '\0') {
+		hash ^= (uint8_t)*str++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static uint32_t path_hash(const char *dir, const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	if (dir != NULL && dir[0] != '\0') {
+		hash = hash_add(hash, dir);
+		hash = hash_add(hash, "/");
+	}
+
+	return hash_add(hash, name);
+}
+
+static bool has_lc3_ext(const char *name)
+{
+	const size_t name_len = strlen(name);
+	const size_t ext_len = strlen(LC3_FILE_EXT);
+
+	return name_len > ext_len && strcasecmp(&name[name_len - ext_len], LC3_FILE_EXT) == 0;
+}
+
+static int card_signature_get(uint32_t *blocks, uint32_t *free_blocks)
+{
+	struct fs_statvfs stat;
+	int ret;
+
+	ret = FS_LOCKED(fs_statvfs(SD_ROOT_PATH, &stat));
+	if (ret) {
+		LOG_ERR("Failed to get SD card status: %d", ret);
+		return ret;
+	}
+
+	*blocks = stat.f_blocks;
+	*free_blocks = stat.f_bfree;
+
+	return 0;
+}
+
+static int file_write(struct fs_file_t *file, const void *data, size_t size)
+{
+	ssize_t ret = FS_LOCKED(fs_write(file, data, size));
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	return (ret == size) ? 0 : -ENOSPC;
+}
+
+static int file_read(struct fs_file_t *file, off_t off, void *data, size_t size)
+{
+	ssize_t ret;
+
+	ret = FS_LOCKED(fs_seek(file, off, FS_SEEK_SET));
+	if (ret) {
+		return ret;
+	}
+
+	ret = FS_LOCKED(fs_read(file, data, size));
+	if (ret < 0) {
+		return ret;
+	}
+
+	return (ret == size) ? 0 : -EIO;
+}
+
+/* Must be called with build_lock held */
+static int strtab_append(struct index_builder *b, const char *str, uint32_t *off)
+{
+	const size_t size = strlen(str) + 1;
+	int ret;
+
+	ret = file_write(&b->strtab, str, size);
+	if (ret) {
+		return ret;
+	}
+
+	*off = b->strtab_size;
+	b->strtab_size += size;
+
+	return 0;
+}
+
+/* Must be called with build_lock held */
+static int seek_points_flush(struct index_builder *b)
+{
+	const size_t size = b->seek_batch_len * sizeof(b->seek_batch[0]);
+
+	b->seek_batch_len = 0;
+
+	return file_write(&b->seek, b->seek_batch, size);
+}
+
+/* Must be called with build_lock held */
+static int seek_point_add(struct index_builder *b, uint32_t offset)
+{
+	b->seek_batch[b->seek_batch_len++] = offset;
+	b->seek_count++;
+
+	if (b->seek_batch_len < ARRAY_SIZE(b->seek_batch)) {
+		return 0;
+	}
+
+	return seek_points_flush(b);
+}
+
+/**
+ * @brief	Walk the frames of an LC3 file, validating their sizes and adding a seek point
+ *		every SEEK_INTERVAL frames.
+ *
+ * The first chunk of the file shall already be in the chunk buffer. A truncated last frame is
+ * not counted, so that it is never streamed.
+ *
+ * @note	Must be called with build_lock held.
+ *
+ * @return	0 on success, also for invalid files, negative error code otherwise.
+ */
+static int index_frames_walk(struct index_builder *b, struct fs_file_t *file, size_t chunk_len,
+			     struct index_entry *entry)
+{
+	uint32_t chunk_start = 0;
+	uint32_t pos = entry->data_offset;
+	uint16_t frame_size;
+	ssize_t size;
+	int ret;
+
+	entry->seek_off = b->seek_count;
+	entry->frame_size_min = UINT16_MAX;
+
+	while (1) {
+		if (pos + LC3_FRAME_HDR_SIZE > chunk_start + chunk_len) {
+			/* Read from the start of the frame, so a frame size is never split */
+			ret = FS_LOCKED(fs_seek(file, pos, FS_SEEK_SET));
+			if (ret) {
+				return ret;
+			}
+
+			size = FS_LOCKED(fs_read(file, b->chunk, sizeof(b->chunk)));
+			if (size < 0) {
+				return size;
+			}
+
+			chunk_start = pos;
+			chunk_len = size;
+
+			if (chunk_len < LC3_FRAME_HDR_SIZE) {
+				break;
+			}
+		}
+
+		frame_size = sys_get_le16(&b->chunk[pos - chunk_start]);
+		if (frame_size == 0 || frame_size > LC3_FRAME_SIZE_MAX) {
+			LOG_WRN("Invalid frame size %d at offset %d in %s", frame_size, pos,
+				b->abs_path);
+			return 0;
+		}
+
+		if (pos + LC3_FRAME_HDR_SIZE + frame_size > entry->file_size) {
+			LOG_WRN("Truncated last frame in %s", b->abs_path);
+			break;
+		}
+
+		if ((entry->frame_count % SEEK_INTERVAL) == 0) {
+			ret = seek_point_add(b, pos);
+			if (ret) {
+				return ret;
+			}
+		}
+
+		entry->frame_size_min = MIN(entry->frame_size_min, frame_size);
+		entry->frame_size_max = MAX(entry->frame_size_max, frame_size);
+		entry->frame_count++;
+		pos += LC3_FRAME_HDR_SIZE + frame_size;
+	}
+
+	if (entry->frame_count == 0) {
+		LOG_WRN("No frames in %s", b->abs_path);
+		entry->frame_size_min = 0;
+		return 0;
+	}
+
+	entry->flags |= ENTRY_FLAG_VALID;
+	if (entry->frame_size_min == entry->frame_size_max) {
+		entry->flags |= ENTRY_FLAG_CBR;
+	}
+
+	return 0;
+}
+
+/* Must be called with build_lock held */
+static int index_file_add(struct index_builder *b, const char *name, uint32_t file_size)
+{
+	struct index_entry entry = {0};
+	struct fs_file_t file;
+	uint16_t hdr_size;
+	ssize_t size;
+	int ret;
+
+	if (b->path[0] == '\0') {
+		snprintf(b->abs_path, sizeof(b->abs_path), "%s/%s", SD_ROOT_PATH, name);
+	} else {
+		snprintf(b->abs_path, sizeof(b->abs_path), "%s/%s/%s", SD_ROOT_PATH, b->path, name);
+	}
+
+	fs_file_t_init(&file);
+
+	ret = FS_LOCKED(fs_open(&file, b->abs_path, FS_O_READ));
+	if (ret) {
+		LOG_WRN("Failed to open %s: %d", b->abs_path, ret);
+		return 0;
+	}
+
+	size = FS_LOCKED(fs_read(&file, b->chunk, sizeof(b->chunk)));
+	if (size < LC3_FILE_HDR_SIZE_MIN || sys_get_le16(&b->chunk[0]) != LC3_FILE_ID) {
+		LOG_WRN("Skipping %s: not a valid LC3 file", b->abs_path);
+		(void)FS_LOCKED(fs_close(&file));
+		return 0;
+	}
+
+	hdr_size = sys_get_le16(&b->chunk[LC3_FILE_HDR_SIZE_POS]);
+
+	entry.file_size = file_size;
+	entry.data_offset = hdr_size;
+	entry.sample_rate_hz = sys_get_le16(&b->chunk[LC3_FILE_HDR_SAMPLE_RATE_POS]) * 100U;
+	entry.bit_rate_bps = sys_get_le16(&b->chunk[LC3_FILE_HDR_BIT_RATE_POS]) * 100U;
+	entry.channels = sys_get_le16(&b->chunk[LC3_FILE_HDR_CHANNELS_POS]);
+	/* Frame duration is stored as ms * 100 */
+	entry.frame_duration_us = sys_get_le16(&b->chunk[LC3_FILE_HDR_FRAME_DUR_POS]) * 10U;
+
+	if (hdr_size < LC3_FILE_HDR_SIZE_MIN || entry.frame_duration_us == 0) {
+		/* Listed, but never streamed */
+		LOG_WRN("Invalid LC3 file header in %s", b->abs_path);
+		ret = 0;
+	} else {
+		ret = index_frames_walk(b, &file, size, &entry);
+	}
+
+	(void)FS_LOCKED(fs_close(&file));
+
+	if (ret) {
+		return ret;
+	}
+
+	if (!b->dir_written) {
+		if (b->path[0] == '\0') {
+			b->dir_off = INDEX_DIR_ROOT;
+		} else {
+			ret = strtab_append(b, b->path, &b->dir_off);
+			if (ret) {
+				return ret;
+			}
+		}
+
+		b->dir_written = true;
+	}
+
+	ret = strtab_append(b, name, &entry.name_off);
+	if (ret) {
+		return ret;
+	}
+
+	entry.path_hash = path_hash(b->path, name);
+	entry.dir_off = b->dir_off;
+
+	ret = file_write(&b->index, &entry, sizeof(entry));
+	if (ret) {
+		return ret;
+	}
+
+	b->entry_count++;
+
+	return 0;
+}
+
+/* Must be called with build_lock held */
+static int index_dir_walk(struct index_builder *b, size_t path_len, uint8_t depth)
+{
+	struct fs_dir_t dir;
+	int ret;
+
+	snprintf(b->abs_path, sizeof(b->abs_path), "%s/%s", SD_ROOT_PATH, b->path);
+
+	fs_dir_t_init(&dir);
+
+	ret = FS_LOCKED(fs_opendir(&dir, b->abs_path));
+	if (ret) {
+		LOG_ERR("Failed to open directory %s: %d", b->abs_path, ret);
+		return ret;
+	}
+
+	b->dir_written = false;
+
+	while (1) {
+		size_t name_len;
+
+		ret = FS_LOCKED(fs_readdir(&dir, &b->dirent));
+		if (ret || b->dirent.name[0] == '\0') {
+			/* Error or end of directory */
+			break;
+		}
+
+		name_len = strlen(b->dirent.name);
+		if (path_len + 1 + name_len + 1 > sizeof(b->path)) {
+			LOG_WRN("Path too long, skipping %s", b->dirent.name);
+			continue;
+		}
+
+		if (b->dirent.type == FS_DIR_ENTRY_DIR) {
+			const uint32_t dir_off = b->dir_off;
+			const bool dir_written = b->dir_written;
+			size_t sub_path_len;
+
+			if (depth >= CONFIG_SD_CARD_INDEX_DIR_DEPTH_MAX ||
+			    b->dirent.name[0] == '.') {
+				continue;
+			}
+
+			if (path_len == 0) {
+				memcpy(b->path, b->dirent.name, name_len + 1);
+				sub_path_len = name_len;
+			} else {
+				b->path[path_len] = '/';
+				memcpy(&b->path[path_len + 1], b->dirent.name, name_len + 1);
+				sub_path_len = path_len + 1 + name_len;
+			}
+
+			ret = index_dir_walk(b, sub_path_len, depth + 1);
+
+			b->path[path_len] = '\0';
+			b->dir_off = dir_off;
+			b->dir_written = dir_written;
+
+			if (ret) {
+				break;
+			}
+		} else if (has_lc3_ext(b->dirent.name)) {
+			ret = index_file_add(b, b->dirent.name, b->dirent.size);
+			if (ret) {
+				break;
+			}
+		}
+	}
+
+	(void)FS_LOCKED(fs_closedir(&dir));
+
+	return ret;
+}
+
+/**
+ * @brief	Build a new index into the build files.
+ *
+ * The header is written with an invalid magic, and is only completed by index_swap().
+ *
+ * @note	Must be called with build_lock held.
+ */
+static int index_build(struct index_builder *b)
+{
+	const struct index_header new_header = {0};
+	int ret;
+
+	LOG_INF("Building SD card index");
+
+	memset(b, 0, sizeof(*b));
+	fs_file_t_init(&b->index);
+	fs_file_t_init(&b->strtab);
+	fs_file_t_init(&b->seek);
+
+	(void)FS_LOCKED(fs_unlink(INDEX_BUILD_PATH));
+	(void)FS_LOCKED(fs_unlink(STRTAB_BUILD_PATH));
+	(void)FS_LOCKED(fs_unlink(SEEK_BUILD_PATH));
+
+	ret = FS_LOCKED(fs_open(&b->index, INDEX_BUILD_PATH, FS_O_CREATE | FS_O_WRITE));
+	if (ret) {
+		LOG_ERR("Failed to create %s: %d", INDEX_BUILD_PATH, ret);
+		return ret;
+	}
+
+	ret = FS_LOCKED(fs_open(&b->strtab, STRTAB_BUILD_PATH, FS_O_CREATE | FS_O_WRITE));
+	if (ret) {
+		LOG_ERR("Failed to create %s: %d", STRTAB_BUILD_PATH, ret);
+		(void)FS_LOCKED(fs_close(&b->index));
+		return ret;
+	}
+
+	ret = FS_LOCKED(fs_open(&b->seek, SEEK_BUILD_PATH, FS_O_CREATE | FS_O_WRITE));
+	if (ret) {
+		LOG_ERR("Failed to create %s: %d", SEEK_BUILD_PATH, ret);
+		(void)FS_LOCKED(fs_close(&b->strtab));
+		(void)FS_LOCKED(fs_close(&b->index));
+		return ret;
+	}
+
+	/* Written with an invalid magic, so that an interrupted build is never used */
+	ret = file_write(&b->index, &new_header, sizeof(new_header));
+	if (ret == 0) {
+		ret = index_dir_walk(b, 0, 0);
+	}
+
+	if (ret == 0) {
+		ret = seek_points_flush(b);
+	}
+
+	if (ret == 0) {
+		ret = FS_LOCKED(fs_close(&b->seek));
+	} else {
+		(void)FS_LOCKED(fs_close(&b->seek));
+	}
+
+	if (ret == 0) {
+		ret = FS_LOCKED(fs_close(&b->strtab));
+	} else {
+		(void)FS_LOCKED(fs_close(&b->strtab));
+	}
+
+	if (ret == 0) {
+		ret = FS_LOCKED(fs_close(&b->index));
+	} else {
+		(void)FS_LOCKED(fs_close(&b->index));
+	}
+
+	if (ret) {
+		LOG_ERR("Failed to build SD card index: %d", ret);
+		/* Left over files would change the card signature of the loaded index */
+		(void)FS_LOCKED(fs_unlink(INDEX_BUILD_PATH));
+		(void)FS_LOCKED(fs_unlink(STRTAB_BUILD_PATH));
+		(void)FS_LOCKED(fs_unlink(SEEK_BUILD_PATH));
+		return ret;
+	}
+
+	LOG_INF("Indexed %d LC3 files (%d octets of strings, %d seek points)", b->entry_count,
+		b->strtab_size, b->seek_count);
+
+	return 0;
+}
+
+/* Must be called with index_lock held */
+static void index_close(void)
+{
+	if (index_loaded) {
+		(void)FS_LOCKED(fs_close(&index_file));
+		(void)FS_LOCKED(fs_close(&strtab_file));
+		(void)FS_LOCKED(fs_close(&seek_file));
+		index_loaded = false;
+	}
+}
+
+static int file_replace(const char *from, const char *to)
+{
+	int ret;
+
+	(void)FS_LOCKED(fs_unlink(to));
+
+	ret = FS_LOCKED(fs_rename(from, to));
+	if (ret) {
+		LOG_ERR("Failed to rename %s to %s: %d", from, to, ret);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief	Replace the loaded index with the one in the build files, and complete its header.
+ *
+ * @note	Must be called with build_lock and index_lock held.
+ */
+static int index_swap(const struct index_builder *b)
+{
+	struct index_header new_header = {
+		.magic = INDEX_MAGIC,
+		.version = INDEX_VERSION,
+		.entry_size = sizeof(struct index_entry),
+		.entry_count = b->entry_count,
+		.strtab_size = b->strtab_size,
+		.seek_interval = SEEK_INTERVAL,
+	};
+	struct fs_file_t file;
+	int ret;
+
+	index_close();
+	index_generation++;
+
+	ret = file_replace(INDEX_BUILD_PATH, INDEX_FILE_PATH);
+	if (ret == 0) {
+		ret = file_replace(STRTAB_BUILD_PATH, STRTAB_FILE_PATH);
+	}
+
+	if (ret == 0) {
+		ret = file_replace(SEEK_BUILD_PATH, SEEK_FILE_PATH);
+	}
+
+	/* The signature is taken after the old index has been removed, as that changes the number
+	 * of free blocks. Writing the header in place doesn't change it.
+	 */
+	if (ret == 0) {
+		ret = card_signature_get(&new_header.card_blocks, &new_header.card_free_blocks);
+	}
+
+	if (ret) {
+		return ret;
+	}
+
+	fs_file_t_init(&file);
+
+	ret = FS_LOCKED(fs_open(&file, INDEX_FILE_PATH, FS_O_WRITE));
+	if (ret) {
+		LOG_ERR("Failed to open %s: %d", INDEX_FILE_PATH, ret);
+		return ret;
+	}
+
+	ret = file_write(&file, &new_header, sizeof(new_header));
+	if (ret == 0) {
+		ret = FS_LOCKED(fs_close(&file));
+	} else {
+		(void)FS_LOCKED(fs_close(&file));
+	}
+
+	return ret;
+}
+
+/* Must be called with index_lock held */
+static int index_open_and_validate(void)
+{
+	uint32_t card_blocks;
+	uint32_t card_free_blocks;
+	int ret;
+
+	fs_file_t_init(&index_file);
+	fs_file_t_init(&strtab_file);
+	fs_file_t_init(&seek_file);
+
+	ret = FS_LOCKED(fs_open(&index_file, INDEX_FILE_PATH, FS_O_READ));
+	if (ret) {
+		return ret;
+	}
+
+	ret = file_read(&index_file, 0, &header, sizeof(header));
+	if (ret == 0 && (header.magic != INDEX_MAGIC || header.version != INDEX_VERSION ||
+			 header.entry_size != sizeof(struct index_entry) ||
+			 header.seek_interval != SEEK_INTERVAL)) {
+		LOG_INF("SD card index has an unknown format");
+		ret = -EBADMSG;
+	}
+
+	if (ret == 0) {
+		ret = card_signature_get(&card_blocks, &card_free_blocks);
+	}
+
+	if (ret == 0 &&
+	    (card_blocks != header.card_blocks || card_free_blocks != header.card_free_blocks)) {
+		LOG_INF("SD card contents changed since the index was built");
+		ret = -ESTALE;
+	}
+
+	if (ret == 0) {
+		ret = FS_LOCKED(fs_open(&strtab_file, STRTAB_FILE_PATH, FS_O_READ));
+	}
+
+	if (ret == 0) {
+		ret = FS_LOCKED(fs_open(&seek_file, SEEK_FILE_PATH, FS_O_READ));
+		if (ret) {
+			(void)FS_LOCKED(fs_close(&strtab_file));
+		}
+	}
+
+	if (ret) {
+		(void)FS_LOCKED(fs_close(&index_file));
+		return ret;
+	}
+
+	index_loaded = true;
+	index_stale = false;
+
+	return 0;
+}
+
+/**
+ * @brief	Load the index from the SD card if needed, without building it.
+ *
+ * A stale index stays loaded, so that it can still be used to seek in unchanged files.
+ *
+ * @note	Must be called with index_lock held.
+ *
+ * @retval	-ESTALE	The index is outdated, and shall be rebuilt.
+ */
+static int index_load(void)
+{
+	if (index_loaded) {
+		return index_stale ? -ESTALE : 0;
+	}
+
+	return index_open_and_validate();
+}
+
+/**
+ * @brief	Build a new index and swap it in.
+ *
+ * The SD card is walked without index_lock held, so that the loaded index can still be used,
+ * e.g. to seek in the files being streamed, until the new one replaces it.
+ *
+ * @param[in]	force	Also build if a valid index is loaded.
+ *
+ * @return	Number of files indexed, negative error code otherwise.
+ */
+static int index_rebuild(bool force)
+{
+	int ret = 0;
+
+	k_mutex_lock(&build_lock, K_FOREVER);
+
+	if (!force) {
+		/* Another thread may have built the index while this one was waiting */
+		k_mutex_lock(&index_lock, K_FOREVER);
+		ret = index_load();
+		if (ret == 0) {
+			ret = header.entry_count;
+		}
+		k_mutex_unlock(&index_lock);
+	}
+
+	if (force || ret < 0) {
+		ret = index_build(&builder);
+		if (ret == 0) {
+			k_mutex_lock(&index_lock, K_FOREVER);
+
+			ret = index_swap(&builder);
+			if (ret == 0) {
+				ret = index_open_and_validate();
+			}
+
+			if (ret == 0) {
+				ret = header.entry_count;
+			}
+
+			k_mutex_unlock(&index_lock);
+		}
+	}
+
+	k_mutex_unlock(&build_lock);
+
+	return ret;
+}
+
+/**
+ * @brief	Take index_lock with the index loaded, building the index first if needed.
+ *
+ * @return	0 with index_lock held, negative error code without it otherwise.
+ */
+static int index_acquire(void)
+{
+	int ret;
+
+	k_mutex_lock(&index_lock, K_FOREVER);
+
+	ret = index_load();
+	if (ret == 0) {
+		return 0;
+	}
+
+	k_mutex_unlock(&index_lock);
+
+	ret = index_rebuild(false);
+	if (ret < 0) {
+		return ret;
+	}
+
+	k_mutex_lock(&index_lock, K_FOREVER);
+
+	ret = index_load();
+	if (ret) {
+		k_mutex_unlock(&index_lock);
+	}
+
+	return ret;
+}
+
+/* Must be called with index_lock held and the index loaded */
+static int entry_read(uint32_t idx, struct index_entry *entry)
+{
+	if (idx >= header.entry_count) {
+		return -EINVAL;
+	}
+
+	return file_read(&index_file, sizeof(header) + idx * sizeof(*entry), entry,
+			 sizeof(*entry));
+}
+
+/* Must be called with index_lock held and the index loaded */
+static int string_read(uint32_t off, char *buf, size_t buf_len)
+{
+	ssize_t size;
+	int ret;
+
+	if (off >= header.strtab_size || buf_len == 0) {
+		return -EINVAL;
+	}
+
+	ret = FS_LOCKED(fs_seek(&strtab_file, off, FS_SEEK_SET));
+	if (ret) {
+		return ret;
+	}
+
+	size = FS_LOCKED(fs_read(&strtab_file, buf, MIN(buf_len, header.strtab_size - off)));
+	if (size < 0) {
+		return size;
+	}
+
+	if (memchr(buf, '\0', size) == NULL) {
+		return -ENAMETOOLONG;
+	}
+
+	return 0;
+}
+
+/* Must be called with index_lock held and the index loaded */
+static int entry_path_get(const struct index_entry *entry, char *path, size_t path_len)
+{
+	size_t dir_len = 0;
+	int ret;
+
+	if (entry->dir_off != INDEX_DIR_ROOT) {
+		ret = string_read(entry->dir_off, path, path_len);
+		if (ret) {
+			return ret;
+		}
+
+		dir_len = strlen(path);
+		if (dir_len + 2 > path_len) {
+			return -ENAMETOOLONG;
+		}
+
+		path[dir_len++] = '/';
+	}
+
+	return string_read(entry->name_off, &path[dir_len], path_len - dir_len);
+}
+
+int sd_card_index_count(void)
+{
+	int ret;
+
+	ret = index_acquire();
+	if (ret) {
+		return ret;
+	}
+
+	ret = header.entry_count;
+
+	k_mutex_unlock(&index_lock);
+
+	return ret;
+}
+
+uint32_t sd_card_index_generation_get(void)
+{
+	uint32_t generation;
+
+	k_mutex_lock(&index_lock, K_FOREVER);
+	generation = index_generation;
+	k_mutex_unlock(&index_lock);
+
+	return generation;
+}
+
+int sd_card_index_path_get(uint32_t idx, char *path, size_t path_len)
+{
+	struct index_entry entry;
+	int ret;
+
+	ret = index_acquire();
+	if (ret) {
+		return ret;
+	}
+
+	ret = entry_read(idx, &entry);
+	if (ret == 0) {
+		ret = entry_path_get(&entry, path, path_len);
+	}
+
+	k_mutex_unlock(&index_lock);
+
+	return ret;
+}
+
+int sd_card_index_info_get(uint32_t idx, struct sd_card_index_file_info *info)
+{
+	struct index_entry entry;
+	int ret;
+
+	ret = index_acquire();
+	if (ret) {
+		return ret;
+	}
+
+	ret = entry_read(idx, &entry);
+
+	k_mutex_unlock(&index_lock);
+
+	if (ret) {
+		return ret;
+	}
+
+	info->file_size = entry.file_size;
+	info->sample_rate_hz = entry.sample_rate_hz;
+	info->bit_rate_bps = entry.bit_rate_bps;
+	info->frame_duration_us = entry.frame_duration_us;
+	info->frame_count = entry.frame_count;
+	info->frame_size_min = entry.frame_size_min;
+	info->frame_size_max = entry.frame_size_max;
+	info->duration_ms = (uint64_t)entry.frame_count * entry.frame_duration_us / USEC_PER_MSEC;
+	info->channels = entry.channels;
+	info->valid = (entry.flags & ENTRY_FLAG_VALID) != 0;
+
+	return 0;
+}
+
+int sd_card_index_frame_seek(uint32_t idx, uint32_t generation, uint32_t frame, uint32_t *offset,
+			     uint32_t *skip)
+{
+	struct index_entry entry;
+	uint32_t seek_point;
+	int ret;
+
+	k_mutex_lock(&index_lock, K_FOREVER);
+
+	/* Never loads or builds the index, so that streams are not held up by an SD card walk */
+	if (!index_loaded || generation != index_generation) {
+		ret = -ESTALE;
+	} else {
+		ret = entry_read(idx, &entry);
+	}
+
+	if (ret) {
+		goto unlock;
+	}
+
+	if (!(entry.flags & ENTRY_FLAG_VALID)) {
+		ret = -EBADMSG;
+	} else if (frame >= entry.frame_count) {
+		ret = -ERANGE;
+	} else if (entry.flags & ENTRY_FLAG_CBR) {
+		*offset = entry.data_offset + frame * (LC3_FRAME_HDR_SIZE + entry.frame_size_max);
+		*skip = 0;
+	} else {
+		ret = file_read(&seek_file,
+				(entry.seek_off + frame / SEEK_INTERVAL) * sizeof(seek_point),
+				&seek_point, sizeof(seek_point));
+		if (ret == 0) {
+			*offset = seek_point;
+			*skip = frame % SEEK_INTERVAL;
+		}
+	}
+
+unlock:
+	k_mutex_unlock(&index_lock);
+
+	return ret;
+}
+
+int sd_card_index_find(const char *path, uint32_t *idx)
+{
+	/* Only used with index_lock held, static to keep them off the caller's stack */
+	static char entry_path[SD_CARD_INDEX_PATH_LEN_MAX];
+	static struct index_entry entries[INDEX_READ_BLOCK];
+	uint32_t hash;
+	int ret;
+
+	/* Paths in the index are relative to the root */
+	while (*path == '/') {
+		path++;
+	}
+
+	hash = path_hash(NULL, path);
+
+	ret = index_acquire();
+	if (ret) {
+		return ret;
+	}
+
+	ret = -ENOENT;
+
+	for (uint32_t i = 0; i < header.entry_count; i += INDEX_READ_BLOCK) {
+		const uint32_t num = MIN(INDEX_READ_BLOCK, header.entry_count - i);
+		int err;
+
+		err = file_read(&index_file, sizeof(header) + i * sizeof(entries[0]), entries,
+				num * sizeof(entries[0]));
+		if (err) {
+			ret = err;
+			break;
+		}
+
+		for (uint32_t j = 0; j < num; j++) {
+			if (entries[j].path_hash != hash) {
+				continue;
+			}
+
+			err = entry_path_get(&entries[j], entry_path, sizeof(entry_path));
+			if (err == 0 && strcmp(entry_path, path) == 0) {
+				*idx = i + j;
+				ret = 0;
+				goto unlock;
+			}
+		}
+	}
+
+unlock:
+	k_mutex_unlock(&index_lock);
+
+	return ret;
+}
+
+int sd_card_index_file_validate(uint32_t idx)
+{
+	static char abs_path[sizeof(SD_ROOT_PATH) + SD_CARD_INDEX_PATH_LEN_MAX];
+	struct fs_dirent dirent;
+	struct index_entry entry;
+	int ret;
+
+	ret = index_acquire();
+	if (ret) {
+		return ret;
+	}
+
+	ret = entry_read(idx, &entry);
+	if (ret == 0) {
+		strcpy(abs_path, SD_ROOT_PATH "/");
+		ret = entry_path_get(&entry, &abs_path[strlen(abs_path)],
+				     sizeof(abs_path) - strlen(abs_path));
+	}
+
+	if (ret == 0) {
+		ret = FS_LOCKED(fs_stat(abs_path, &dirent));
+		if (ret == -ENOENT || (ret == 0 && dirent.size != entry.file_size)) {
+			LOG_WRN("%s changed since the index was built", abs_path);
+			index_stale = true;
+			ret = -ESTALE;
+		}
+	}
+
+	k_mutex_unlock(&index_lock);
+
+	return ret;
+}
+
+int sd_card_index_rebuild(void)
+{
+	return index_rebuild(true);
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _SD_CARD_INDEX_H_
+#define _SD_CARD_INDEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup sd_card_index SD card LC3 file index
+ * @brief Persistent index of the LC3 files on the SD card.
+ *
+ * The index is stored on the SD card itself, as a file with a header and fixed size entries, a
+ * string table where each directory path is only stored once, and a seek table with the offset of
+ * every CONFIG_SD_CARD_INDEX_SEEK_INTERVAL frames of each file. The frames of each file are
+ * validated when the index is built, so that invalid files are rejected before streaming. It is
+ * built the first time it is needed, and is then only rebuilt if the contents of the SD card have
+ * changed. Entries are read from the SD card when queried, so neither boot time nor RAM usage
+ * depend on the number of files on the SD card.
+ *
+ * @{
+ */
+
+/** Max length of a path on the SD card, including the terminating NUL character */
+#define SD_CARD_INDEX_PATH_LEN_MAX 260
+
+/**
+ * @brief	Metadata of an indexed LC3 file, read from its header when the index was built.
+ */
+struct sd_card_index_file_info {
+	/* Size of the file in octets */
+	uint32_t file_size;
+	uint32_t sample_rate_hz;
+	/* Total bit rate of all channels */
+	uint32_t bit_rate_bps;
+	uint32_t frame_duration_us;
+	/* Number of complete frames in the file */
+	uint32_t frame_count;
+	uint32_t duration_ms;
+	/* Size of the smallest and largest frame in octets */
+	uint16_t frame_size_min;
+	uint16_t frame_size_max;
+	uint8_t channels;
+	/* The header and all frame sizes are valid */
+	bool valid;
+};
+
+/**
+ * @brief	Get the number of LC3 files in the index.
+ *
+ * Loads the index, or builds it if missing or outdated, on first use.
+ *
+ * @return	Number of files, negative error code otherwise.
+ */
+int sd_card_index_count(void);
+
+/**
+ * @brief	Get the generation of the index.
+ *
+ * The generation changes every time a new index replaces the loaded one, which can renumber the
+ * files. An index of a file is only valid in the generation it was obtained in.
+ *
+ * @return	Generation of the loaded index.
+ */
+uint32_t sd_card_index_generation_get(void);
+
+/**
+ * @brief	Get the path of an indexed file.
+ *
+ * @param[in]	idx		Index of the file.
+ * @param[out]	path		Buffer for the path, relative to the root of the SD card.
+ * @param[in]	path_len	Size of @p path.
+ *
+ * @return	0 on success, negative error code otherwise.
+ */
+int sd_card_index_path_get(uint32_t idx, char *path, size_t path_len);
+
+/**
+ * @brief	Get the metadata of an indexed file.
+ *
+ * @param[in]	idx	Index of the file.
+ * @param[out]	info	Metadata of the file.
+ *
+ * @return	0 on success, negative error code otherwise.
+ */
+int sd_card_index_info_get(uint32_t idx, struct sd_card_index_file_info *info);
+
+/**
+ * @brief	Get the position of a frame in an indexed file.
+ *
+ * The frame is found by seeking to @p offset, and then skipping @p skip frames. @p skip is always
+ * less than CONFIG_SD_CARD_INDEX_SEEK_INTERVAL, and is 0 for files where all frames have the
+ * same size. The index is never loaded or built by this function, so it does not block for long.
+ *
+ * @param[in]	idx		Index of the file.
+ * @param[in]	generation	Generation of the index @p idx was obtained in.
+ * @param[in]	frame		Number of the frame, starting at 0.
+ * @param[out]	offset		Offset in the file of the size of a frame at or before @p frame.
+ * @param[out]	skip		Number of frames to skip after @p offset to get to @p frame.
+ *
+ * @retval	0		Success.
+ * @retval	-ESTALE		The index has been rebuilt or is not loaded, so @p idx shall be
+ *				looked up again.
+ * @retval	-EBADMSG	The file is not a valid LC3 file.
+ * @retval	-ERANGE		@p frame is beyond the end of the file.
+ * @return	Other negative error codes on SD card errors.
+ */
+int sd_card_index_frame_seek(uint32_t idx, uint32_t generation, uint32_t frame, uint32_t *offset,
+			     uint32_t *skip);
+
+/**
+ * @brief	Find a file in the index by its path.
+ *
+ * @param[in]	path	Path relative to the root of the SD card.
+ * @param[out]	idx	Index of the file.
+ *
+ * @retval	0		Success.
+ * @retval	-ENOENT		The file is not in the index.
+ * @return	Other negative error codes on SD card errors.
+ */
+int sd_card_index_find(const char *path, uint32_t *idx);
+
+/**
+ * @brief	Check that an indexed file has not changed since the index was built.
+ *
+ * If the file has changed, the index is marked as outdated and is rebuilt on next use.
+ *
+ * @param[in]	idx	Index of the file.
+ *
+ * @retval	0		The file is unchanged.
+ * @retval	-ESTALE		The file has changed or been removed.
+ * @return	Other negative error codes on SD card errors.
+ */
+int sd_card_index_file_validate(uint32_t idx);
+
+/**
+ * @brief	Rebuild the index by walking the SD card.
+ *
+ * The new index is built into separate files while the current one stays usable, and then
+ * replaces it.
+ *
+ * @return	Number of files indexed, negative error code otherwise.
+ */
+int sd_card_index_rebuild(void);
+
+/**
+ * @brief	Take the lock that serializes the file system calls on the SD card.
+ *
+ * FatFs is not reentrant, so other users of the SD card shall hold this lock around each of
+ * their file system calls, as this module does around its own. No other lock shall be taken,
+ * and no other function of this module called, with it held.
+ */
+void sd_card_index_fs_lock(void);
+
+/**
+ * @brief	Release the lock taken by sd_card_index_fs_lock().
+ */
+void sd_card_index_fs_unlock(void);
+
+/** @} */
+
+#endif /* _SD_CARD_INDEX_H_ */
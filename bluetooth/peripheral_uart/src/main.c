@@ -9,6 +9,9 @@
  */
 #include <uart_async_adapter.h>
 
+#include "nus_packer.h"
+#include "uart_handler.h"
+
 #include <zephyr/types.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/uart.h>
@@ -20,6 +23,7 @@
 
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/att.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/hci.h>
 
@@ -51,9 +55,11 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #define KEY_PASSKEY_ACCEPT DK_BTN1_MSK
 #define KEY_PASSKEY_REJECT DK_BTN2_MSK
 
-#define UART_BUF_SIZE CONFIG_BT_NUS_UART_BUFFER_SIZE
-#define UART_WAIT_FOR_BUF_DELAY K_MSEC(50)
-#define UART_WAIT_FOR_RX CONFIG_BT_NUS_UART_RX_WAIT_TIME
+#define NUS_TX_CREDITS CONFIG_BT_NUS_TX_CREDITS
+#define NUS_TX_IDLE_TIMEOUT K_MSEC(CONFIG_BT_NUS_TX_IDLE_TIMEOUT)
+
+/* Largest notification payload, the ATT MTU less the opcode and handle. */
+#define NUS_PACKET_SIZE(mtu) ((mtu) - 3)
 
 static K_SEM_DEFINE(ble_init_ok, 0, 1);
 
@@ -62,16 +68,14 @@ static struct bt_conn *auth_conn;
 static struct k_work adv_work;
 
 static const struct device *uart = DEVICE_DT_GET(DT_CHOSEN(nordic_nus_uart));
-static struct k_work_delayable uart_work;
 
-struct uart_data_t {
-	void *fifo_reserved;
-	uint8_t data[UART_BUF_SIZE];
-	uint16_t len;
-};
+/* Notifications that can be queued before the previous ones were sent. */
+static K_SEM_DEFINE(nus_tx_credits, NUS_TX_CREDITS, NUS_TX_CREDITS);
+
+static atomic_t uart_tx_dropped;
 
-static K_FIFO_DEFINE(fifo_uart_tx_data);
-static K_FIFO_DEFINE(fifo_uart_rx_data);
+/* Data received over UART is packed here by nus_packer, up to the payload limit. */
+static uint8_t nus_packet[NUS_PACKET_SIZE(CONFIG_BT_L2CAP_TX_MTU)];
 
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
@@ -88,140 +92,34 @@ UART_ASYNC_ADAPTER_INST_DEFINE(async_adapter);
 #define async_adapter NULL
 #endif
 
-static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+static void uart_buf_stats_log(void)
 {
-	ARG_UNUSED(dev);
-
-	static size_t aborted_len;
-	struct uart_data_t *buf;
-	static uint8_t *aborted_buf;
-	static bool disable_req;
-
-	switch (evt->type) {
-	case UART_TX_DONE:
-		LOG_DBG("UART_TX_DONE");
-		if ((evt->data.tx.len == 0) ||
-		    (!evt->data.tx.buf)) {
-			return;
-		}
-
-		if (aborted_buf) {
-			buf = CONTAINER_OF(aborted_buf, struct uart_data_t,
-					   data[0]);
-			aborted_buf = NULL;
-			aborted_len = 0;
-		} else {
-			buf = CONTAINER_OF(evt->data.tx.buf, struct uart_data_t,
-					   data[0]);
-		}
-
-		k_free(buf);
-
-		buf = k_fifo_get(&fifo_uart_tx_data, K_NO_WAIT);
-		if (!buf) {
-			return;
-		}
-
-		if (uart_tx(uart, buf->data, buf->len, SYS_FOREVER_MS)) {
-			LOG_WRN("Failed to send data over UART");
-		}
-
-		break;
+	struct uart_handler_stats stats;
+	struct nus_packer_stats tx_stats;
 
-	case UART_RX_RDY:
-		LOG_DBG("UART_RX_RDY");
-		buf = CONTAINER_OF(evt->data.rx.buf, struct uart_data_t, data[0]);
-		buf->len += evt->data.rx.len;
-
-		if (disable_req) {
-			return;
-		}
+	uart_handler_stats_get(&stats);
+	nus_packer_stats_get(&tx_stats);
 
-		if ((evt->data.rx.buf[buf->len - 1] == '\n') ||
-		    (evt->data.rx.buf[buf->len - 1] == '\r')) {
-			disable_req = true;
-			uart_rx_disable(uart);
-		}
-
-		break;
-
-	case UART_RX_DISABLED:
-		LOG_DBG("UART_RX_DISABLED");
-		disable_req = false;
-
-		buf = k_malloc(sizeof(*buf));
-		if (buf) {
-			buf->len = 0;
-		} else {
-			LOG_WRN("Not able to allocate UART receive buffer");
-			k_work_reschedule(&uart_work, UART_WAIT_FOR_BUF_DELAY);
-			return;
-		}
-
-		uart_rx_enable(uart, buf->data, sizeof(buf->data),
-			       UART_WAIT_FOR_RX);
-
-		break;
-
-	case UART_RX_BUF_REQUEST:
-		LOG_DBG("UART_RX_BUF_REQUEST");
-		buf = k_malloc(sizeof(*buf));
-		if (buf) {
-			buf->len = 0;
-			uart_rx_buf_rsp(uart, buf->data, sizeof(buf->data));
-		} else {
-			LOG_WRN("Not able to allocate UART receive buffer");
-		}
-
-		break;
-
-	case UART_RX_BUF_RELEASED:
-		LOG_DBG("UART_RX_BUF_RELEASED");
-		buf = CONTAINER_OF(evt->data.rx_buf.buf, struct uart_data_t,
-				   data[0]);
-
-		if (buf->len > 0) {
-			k_fifo_put(&fifo_uart_rx_data, buf);
-		} else {
-			k_free(buf);
-		}
-
-		break;
-
-	case UART_TX_ABORTED:
-		LOG_DBG("UART_TX_ABORTED");
-		if (!aborted_buf) {
-			aborted_buf = (uint8_t *)evt->data.tx.buf;
-		}
-
-		aborted_len += evt->data.tx.len;
-		buf = CONTAINER_OF((void *)aborted_buf, struct uart_data_t,
-				   data);
-
-		uart_tx(uart, &buf->data[aborted_len],
-			buf->len - aborted_len, SYS_FOREVER_MS);
-
-		break;
-
-	default:
-		break;
-	}
+	LOG_INF("UART buffers: %u of %u used at most, UART RX paused %u times",
+		stats.max_used, CONFIG_BT_NUS_UART_BUF_COUNT, stats.rx_pauses);
+	LOG_INF("Dropped %ld bytes to UART, %u bytes to Bluetooth",
+		atomic_get(&uart_tx_dropped), tx_stats.dropped);
 }
 
-static void uart_work_handler(struct k_work *item)
+/* UART to Bluetooth throughput, from the first to the last notification of the connection. */
+static void ble_tx_stats_log(void)
 {
-	struct uart_data_t *buf;
+	struct nus_packer_stats stats;
 
-	buf = k_malloc(sizeof(*buf));
-	if (buf) {
-		buf->len = 0;
-	} else {
-		LOG_WRN("Not able to allocate UART receive buffer");
-		k_work_reschedule(&uart_work, UART_WAIT_FOR_BUF_DELAY);
+	nus_packer_stats_get(&stats);
+	nus_packer_stats_reset();
+
+	if (stats.packets == 0) {
 		return;
 	}
 
-	uart_rx_enable(uart, buf->data, sizeof(buf->data), UART_WAIT_FOR_RX);
+	LOG_INF("Sent %u bytes in %u notifications, %lld bytes/s", stats.bytes, stats.packets,
+		(stats.duration > 0) ? ((int64_t)stats.bytes * MSEC_PER_SEC / stats.duration) : 0);
 }
 
 static bool uart_test_async_api(const struct device *dev)
@@ -236,7 +134,6 @@ static int uart_init(void)
 {
 	int err;
 	int pos;
-	struct uart_data_t *rx;
 	struct uart_data_t *tx;
 
 	if (!device_is_ready(uart)) {
@@ -251,25 +148,14 @@ static int uart_init(void)
 		}
 	}
 
-	rx = k_malloc(sizeof(*rx));
-	if (rx) {
-		rx->len = 0;
-	} else {
-		return -ENOMEM;
-	}
-
-	k_work_init_delayable(&uart_work, uart_work_handler);
-
-
 	if (IS_ENABLED(CONFIG_UART_ASYNC_ADAPTER) && !uart_test_async_api(uart)) {
 		/* Implement API adapter */
 		uart_async_adapter_init(async_adapter, uart);
 		uart = async_adapter;
 	}
 
-	err = uart_callback_set(uart, uart_cb, NULL);
+	err = uart_handler_init(uart);
 	if (err) {
-		k_free(rx);
 		LOG_ERR("Cannot initialize UART callback");
 		return err;
 	}
@@ -297,38 +183,29 @@ static int uart_init(void)
 		}
 	}
 
-	tx = k_malloc(sizeof(*tx));
+	tx = uart_buf_alloc();
 
 	if (tx) {
 		pos = snprintf(tx->data, sizeof(tx->data),
 			       "Starting Nordic UART service sample\r\n");
 
 		if ((pos < 0) || (pos >= sizeof(tx->data))) {
-			k_free(rx);
-			k_free(tx);
+			uart_buf_free(tx);
 			LOG_ERR("snprintf returned %d", pos);
 			return -ENOMEM;
 		}
 
 		tx->len = pos;
 	} else {
-		k_free(rx);
 		return -ENOMEM;
 	}
 
-	err = uart_tx(uart, tx->data, tx->len, SYS_FOREVER_MS);
-	if (err) {
-		k_free(rx);
-		k_free(tx);
-		LOG_ERR("Cannot display welcome message (err: %d)", err);
-		return err;
-	}
+	/* The buffer is freed once sent. */
+	uart_buf_send(tx);
 
-	err = uart_rx_enable(uart, rx->data, sizeof(rx->data), UART_WAIT_FOR_RX);
+	err = uart_handler_rx_enable();
 	if (err) {
 		LOG_ERR("Cannot enable uart reception (err: %d)", err);
-		/* Free the rx buffer only because the tx buffer will be handled in the callback */
-		k_free(rx);
 	}
 
 	return err;
@@ -351,6 +228,23 @@ static void advertising_start(void)
 	k_work_submit(&adv_work);
 }
 
+/* Notifications pending at a disconnection or unsubscription may never report being sent. */
+static void nus_tx_credits_reset(void)
+{
+	k_sem_reset(&nus_tx_credits);
+
+	for (int i = 0; i < NUS_TX_CREDITS; i++) {
+		k_sem_give(&nus_tx_credits);
+	}
+}
+
+static void nus_packet_len_update(struct bt_conn *conn)
+{
+	uint16_t len = nus_packer_len_set(bt_nus_get_mtu(conn));
+
+	LOG_INF("Notifications of up to %u bytes", len);
+}
+
 static void connected(struct bt_conn *conn, uint8_t err)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
@@ -364,6 +258,7 @@ static void connected(struct bt_conn *conn, uint8_t err)
 	LOG_INF("Connected %s", addr);
 
 	current_conn = bt_conn_ref(conn);
+	nus_packet_len_update(conn);
 
 	dk_set_led_on(CON_STATUS_LED);
 }
@@ -386,8 +281,23 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 		current_conn = NULL;
 		dk_set_led_off(CON_STATUS_LED);
 	}
+
+	nus_tx_credits_reset();
+	uart_buf_stats_log();
+	ble_tx_stats_log();
 }
 
+static void mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+	LOG_INF("ATT MTU updated, TX %u RX %u", tx, rx);
+
+	nus_packet_len_update(conn);
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+	.att_mtu_updated = mtu_updated,
+};
+
 static void recycled_cb(void)
 {
 	LOG_INF("Connection object available from previous conn. Disconnect is complete!");
@@ -496,7 +406,6 @@ static struct bt_conn_auth_info_cb conn_auth_info_callbacks;
 static void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data,
 			  uint16_t len)
 {
-	int err;
 	char addr[BT_ADDR_LE_STR_LEN] = {0};
 
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, ARRAY_SIZE(addr));
@@ -504,10 +413,11 @@ static void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data,
 	LOG_INF("Received data from: %s", addr);
 
 	for (uint16_t pos = 0; pos != len;) {
-		struct uart_data_t *tx = k_malloc(sizeof(*tx));
+		struct uart_data_t *tx = uart_buf_alloc();
 
 		if (!tx) {
 			LOG_WRN("Not able to allocate UART send data buffer");
+			atomic_add(&uart_tx_dropped, len - pos);
 			return;
 		}
 
@@ -532,17 +442,51 @@ static void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data,
 			tx->len++;
 		}
 
-		err = uart_tx(uart, tx->data, tx->len, SYS_FOREVER_MS);
-		if (err) {
-			k_fifo_put(&fifo_uart_tx_data, tx);
-		}
+		uart_buf_send(tx);
 	}
 }
 
+static void bt_sent_cb(struct bt_conn *conn)
+{
+	ARG_UNUSED(conn);
+
+	k_sem_give(&nus_tx_credits);
+}
+
+static void bt_send_enabled_cb(enum bt_nus_send_status status)
+{
+	ARG_UNUSED(status);
+
+	nus_tx_credits_reset();
+}
+
 static struct bt_nus_cb nus_cb = {
 	.received = bt_receive_cb,
+	.sent = bt_sent_cb,
+	.send_enabled = bt_send_enabled_cb,
 };
 
+/* Wait for a credit, so that a slow link holds the data in the UART buffers and pauses
+ * UART RX, instead of failing once the Bluetooth buffers are full.
+ */
+static int nus_send(const uint8_t *data, uint16_t len)
+{
+	int err;
+
+	err = k_sem_take(&nus_tx_credits, K_FOREVER);
+	if (err) {
+		/* Credits were reset. */
+		return err;
+	}
+
+	err = bt_nus_send(NULL, data, len);
+	if (err) {
+		k_sem_give(&nus_tx_credits);
+	}
+
+	return err;
+}
+
 void error(void)
 {
 	dk_set_leds_state(DK_ALL_LEDS_MSK, DK_NO_LEDS_MSK);
@@ -613,6 +557,9 @@ int main(void)
 		error();
 	}
 
+	nus_packer_init(nus_packet, sizeof(nus_packet), nus_send);
+	nus_packer_len_set(NUS_PACKET_SIZE(BT_ATT_DEFAULT_LE_MTU));
+
 	if (IS_ENABLED(CONFIG_BT_NUS_SECURITY_ENABLED)) {
 		err = bt_conn_auth_cb_register(&conn_auth_callbacks);
 		if (err) {
@@ -640,6 +587,8 @@ int main(void)
 		settings_load();
 	}
 
+	bt_gatt_cb_register(&gatt_callbacks);
+
 	err = bt_nus_init(&nus_cb);
 	if (err) {
 		LOG_ERR("Failed to initialize UART service (err: %d)", err);
@@ -659,36 +608,21 @@ void ble_write_thread(void)
 {
 	/* Don't go any further until BLE is initialized */
 	k_sem_take(&ble_init_ok, K_FOREVER);
-	struct uart_data_t nus_data = {
-		.len = 0,
-	};
 
 	for (;;) {
-		/* Wait indefinitely for data to be sent over bluetooth */
-		struct uart_data_t *buf = k_fifo_get(&fifo_uart_rx_data,
-						     K_FOREVER);
-
-		int plen = MIN(sizeof(nus_data.data) - nus_data.len, buf->len);
-		int loc = 0;
-
-		while (plen > 0) {
-			memcpy(&nus_data.data[nus_data.len], &buf->data[loc], plen);
-			nus_data.len += plen;
-			loc += plen;
-
-			if (nus_data.len >= sizeof(nus_data.data) ||
-			   (nus_data.data[nus_data.len - 1] == '\n') ||
-			   (nus_data.data[nus_data.len - 1] == '\r')) {
-				if (bt_nus_send(NULL, nus_data.data, nus_data.len)) {
-					LOG_WRN("Failed to send data over BLE connection");
-				}
-				nus_data.len = 0;
-			}
+		/* Wait indefinitely for data to be sent over bluetooth. A partly filled
+		 * packet is sent when no more data comes within the idle timeout.
+		 */
+		struct uart_data_t *buf = uart_rx_get(nus_packer_pending() ? NUS_TX_IDLE_TIMEOUT :
+									     K_FOREVER);
 
-			plen = MIN(sizeof(nus_data.data), buf->len - loc);
+		if (!buf) {
+			nus_packer_flush();
+			continue;
 		}
 
-		k_free(buf);
+		nus_packer_add(buf->data, buf->len);
+		uart_buf_free(buf);
 	}
 }
 
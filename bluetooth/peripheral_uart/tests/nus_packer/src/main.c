@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2018 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "nus_packer.h"
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+/* Largest payload of the sample, for an ATT MTU of 247 */
+#define PACKET_SIZE 244
+
+/* About 1 Mbaud, handed over in UART buffers of the default size */
+#define UART_RATE     100
+#define UART_BUF_SIZE 40
+
+/* Defaults of CONFIG_BT_NUS_TX_CREDITS and CONFIG_BT_NUS_TX_IDLE_TIMEOUT */
+#define TX_CREDITS      4
+#define IDLE_TIMEOUT_MS 5
+
+/* Every connection event sends the packets queued, up to TX_CREDITS */
+#define CONN_INTERVAL_US 7500
+
+/* Not a multiple of a packet size, so that streams end in a partly filled packet */
+#define STREAM_BYTES    49999
+#define RECEIVE_TIME_MS 20000
+
+/* Measured throughput within this percentage of the expected one */
+#define RATE_TOLERANCE 10
+
+struct uart_buf {
+	uint8_t data[UART_BUF_SIZE];
+	uint16_t len;
+};
+
+K_MSGQ_DEFINE(uart_msgq, sizeof(struct uart_buf), 8, 4);
+
+static K_SEM_DEFINE(tx_credits, TX_CREDITS, TX_CREDITS);
+static atomic_t tx_in_flight;
+
+/* Sender and receiver of the same pseudo random byte stream */
+struct stream {
+	uint32_t state;
+	uint32_t bytes;
+};
+
+static struct stream tx_stream = {.state = 0x2545F491};
+static struct stream rx_stream = {.state = 0x2545F491};
+
+/* Bytes the UART has yet to receive, and the end of the stream once it did */
+static atomic_t uart_pending;
+static uint32_t stream_end;
+static int64_t uart_time;
+
+/* Payload limit set last, and the link state */
+static atomic_t packet_limit;
+static atomic_t link_down;
+
+/* Bytes received or dropped over the link */
+static atomic_t rx_bytes;
+static atomic_t rx_errors;
+static atomic_t rx_oversized;
+static atomic_t rx_short;
+static uint16_t rx_last_len;
+static int64_t rx_time;
+
+/* Guarded, the packer must not write past its packet buffer */
+static struct {
+	uint8_t packet[PACKET_SIZE];
+	uint8_t guard[UART_BUF_SIZE];
+} packer_buf;
+
+static uint8_t stream_next(struct stream *stream)
+{
+	/* xorshift32, the same sequence on every run */
+	stream->state ^= stream->state << 13;
+	stream->state ^= stream->state >> 17;
+	stream->state ^= stream->state << 5;
+	stream->bytes++;
+
+	return stream->state >> 24;
+}
+
+/* Hands the stream over in UART buffers at the UART rate, waiting while the queue is full */
+static void uart_thread(void)
+{
+	for (;;) {
+		uint32_t bytes = MIN(UART_RATE, atomic_get(&uart_pending));
+
+		for (uint32_t sent = 0; sent < bytes;) {
+			struct uart_buf buf = {.len = MIN(UART_BUF_SIZE, bytes - sent)};
+
+			for (uint16_t i = 0; i < buf.len; i++) {
+				buf.data[i] = stream_next(&tx_stream);
+			}
+
+			k_msgq_put(&uart_msgq, &buf, K_FOREVER);
+			uart_time = k_uptime_get();
+			sent += buf.len;
+		}
+
+		atomic_sub(&uart_pending, bytes);
+		k_sleep(K_MSEC(1));
+	}
+}
+
+/* Packs the UART buffers as the Bluetooth write thread of the sample does */
+static void writer_thread(void)
+{
+	for (;;) {
+		struct uart_buf buf;
+
+		if (k_msgq_get(&uart_msgq, &buf,
+			       nus_packer_pending() ? K_MSEC(IDLE_TIMEOUT_MS) : K_FOREVER)) {
+			nus_packer_flush();
+			continue;
+		}
+
+		nus_packer_add(buf.data, buf.len);
+	}
+}
+
+/* Completes the packets in flight at every connection event, returning their credits */
+static void link_thread(void)
+{
+	for (;;) {
+		k_sleep(K_USEC(CONN_INTERVAL_US));
+
+		for (int i = 0; i < TX_CREDITS && atomic_get(&tx_in_flight) > 0; i++) {
+			atomic_dec(&tx_in_flight);
+			k_sem_give(&tx_credits);
+		}
+	}
+}
+
+K_THREAD_DEFINE(link_thread_id, 1024, link_thread, NULL, NULL, NULL, 5, 0, 0);
+K_THREAD_DEFINE(uart_thread_id, 1024, uart_thread, NULL, NULL, NULL, 6, 0, 0);
+K_THREAD_DEFINE(writer_thread_id, 1024, writer_thread, NULL, NULL, NULL, 7, 0, 0);
+
+/* Queues a packet on the link as nus_send() of the sample does, waiting for a credit */
+static int link_send(const uint8_t *data, uint16_t len)
+{
+	if (atomic_get(&link_down)) {
+		for (uint16_t i = 0; i < len; i++) {
+			stream_next(&rx_stream);
+		}
+
+		atomic_add(&rx_bytes, len);
+		return -ENOTCONN;
+	}
+
+	k_sem_take(&tx_credits, K_FOREVER);
+	atomic_inc(&tx_in_flight);
+
+	for (uint16_t i = 0; i < len; i++) {
+		if (data[i] != stream_next(&rx_stream)) {
+			atomic_inc(&rx_errors);
+		}
+	}
+
+	if (len > atomic_get(&packet_limit)) {
+		atomic_inc(&rx_oversized);
+	} else if (len < atomic_get(&packet_limit)) {
+		atomic_inc(&rx_short);
+	}
+
+	rx_last_len = len;
+	rx_time = k_uptime_get();
+	atomic_add(&rx_bytes, len);
+
+	return 0;
+}
+
+static void limit_set(uint16_t len)
+{
+	atomic_set(&packet_limit, nus_packer_len_set(len));
+}
+
+static void uart_receive(uint32_t bytes)
+{
+	stream_end += bytes;
+	atomic_add(&uart_pending, bytes);
+}
+
+static void wait_received(const char *name)
+{
+	for (int ms = 0; ms < RECEIVE_TIME_MS; ms++) {
+		if (atomic_get(&rx_bytes) == stream_end) {
+			return;
+		}
+
+		k_sleep(K_MSEC(1));
+	}
+
+	zassert_unreachable("%s: %ld of %u bytes received", name, atomic_get(&rx_bytes),
+			    stream_end);
+}
+
+static void phase_start(void)
+{
+	nus_packer_stats_reset();
+	atomic_clear(&rx_errors);
+	atomic_clear(&rx_oversized);
+	atomic_clear(&rx_short);
+}
+
+static void check_packets(const char *name, uint32_t max_short)
+{
+	zassert_equal(atomic_get(&rx_errors), 0, "%s: %ld bytes corrupted", name,
+		      atomic_get(&rx_errors));
+	zassert_equal(atomic_get(&rx_oversized), 0, "%s: %ld packets above the payload limit",
+		      name, atomic_get(&rx_oversized));
+	zassert_true(atomic_get(&rx_short) <= max_short,
+		     "%s: %ld partly filled packets, expected at most %u", name,
+		     atomic_get(&rx_short), max_short);
+}
+
+/*
+ * Streams data at the UART rate, packed up to a payload limit. The packets are full but
+ * the last one, and the throughput is that of the UART or of the link, whichever is lower.
+ */
+static void stream_run(const char *name, uint16_t len, uint32_t *rate)
+{
+	struct nus_packer_stats stats;
+	uint32_t link_rate = (uint32_t)len * TX_CREDITS * USEC_PER_SEC / CONN_INTERVAL_US;
+	uint32_t expected = MIN(UART_RATE * MSEC_PER_SEC, link_rate);
+
+	*rate = 0;
+
+	limit_set(len);
+	phase_start();
+
+	uart_receive(STREAM_BYTES);
+	wait_received(name);
+
+	check_packets(name, 1);
+	nus_packer_stats_get(&stats);
+
+	if (stats.duration > 0) {
+		*rate = (uint64_t)stats.bytes * MSEC_PER_SEC / stats.duration;
+	}
+
+	printk("%-8s %3u byte packets: %5u bytes in %4u packets, %6u bytes/s, expected %6u\n",
+	       name, len, stats.bytes, stats.packets, *rate, expected);
+
+	zassert_equal(stats.bytes, STREAM_BYTES, "%s: %u bytes sent", name, stats.bytes);
+	zassert_between_inclusive(*rate * 100, expected * (100 - RATE_TOLERANCE),
+				  expected * (100 + RATE_TOLERANCE),
+				  "%s: throughput outside of %u%% of the expected", name,
+				  RATE_TOLERANCE);
+}
+
+/* Data that does not fill a packet is sent once the UART was idle for the timeout */
+static void idle_run(void)
+{
+	int64_t delay;
+
+	limit_set(PACKET_SIZE);
+	phase_start();
+
+	uart_receive(10);
+	wait_received("idle");
+
+	delay = rx_time - uart_time;
+
+	zassert_equal(rx_last_len, 10, "idle: %u bytes sent, expected 10", rx_last_len);
+	zassert_between_inclusive(delay, IDLE_TIMEOUT_MS, IDLE_TIMEOUT_MS + 2,
+				  "idle: sent %lld ms after the UART, expected %u", delay,
+				  IDLE_TIMEOUT_MS);
+
+	check_packets("idle", 1);
+}
+
+ZTEST(nus_packer, test_idle)
+{
+	idle_run();
+}
+
+/*
+ * A packet filled for a larger limit than the next connection has is split, also when more
+ * data is added to it before it was sent.
+ */
+ZTEST(nus_packer, test_mtu_shrink)
+{
+	struct nus_packer_stats stats;
+
+	limit_set(PACKET_SIZE);
+	phase_start();
+
+	uart_receive(200);
+
+	/* The data was packed, and the idle timeout has not expired */
+	k_sleep(K_MSEC(4));
+	limit_set(20);
+	uart_receive(100);
+	wait_received("shrink");
+
+	check_packets("shrink", 0);
+	nus_packer_stats_get(&stats);
+
+	zassert_equal(stats.packets, 15, "shrink: 300 bytes sent in %u packets, expected 15",
+		      stats.packets);
+
+	/* The payload limit stays within the packet buffer */
+	limit_set(PACKET_SIZE);
+	zassert_equal(atomic_get(&packet_limit), PACKET_SIZE);
+	zassert_equal(nus_packer_len_set(PACKET_SIZE + 1), PACKET_SIZE);
+}
+
+/* Data that cannot be sent is counted as dropped, and the packer carries on */
+ZTEST(nus_packer, test_dropped)
+{
+	struct nus_packer_stats before;
+	struct nus_packer_stats after;
+
+	limit_set(PACKET_SIZE);
+	phase_start();
+	nus_packer_stats_get(&before);
+
+	atomic_set(&link_down, 1);
+	uart_receive(1000);
+	wait_received("dropped");
+	atomic_set(&link_down, 0);
+
+	nus_packer_stats_get(&after);
+
+	zassert_equal(after.dropped - before.dropped, 1000, "%u bytes dropped, expected 1000",
+		      after.dropped - before.dropped);
+	zassert_equal(after.packets, 0, "%u packets sent while the link was down",
+		      after.packets);
+
+	/* The packer carries on once the link is back */
+	idle_run();
+}
+
+/* The default ATT MTU, one packet per UART buffer, and the largest ATT MTU */
+ZTEST(nus_packer, test_stream)
+{
+	uint32_t buffer_rate;
+	uint32_t packed_rate;
+	uint32_t rate;
+
+	stream_run("MTU 23", 20, &rate);
+	stream_run("buffer", UART_BUF_SIZE, &buffer_rate);
+	stream_run("MTU 247", PACKET_SIZE, &packed_rate);
+
+	if (buffer_rate != 0) {
+		printk("Packing to the MTU: %u.%u times the throughput of a packet per buffer\n",
+		       packed_rate / buffer_rate, (packed_rate * 10 / buffer_rate) % 10);
+	}
+}
+
+static void *packer_setup(void)
+{
+	printk("NUS packer test: UART %u bytes/s, %u packets every %u us\n",
+	       UART_RATE * MSEC_PER_SEC, TX_CREDITS, CONN_INTERVAL_US);
+
+	nus_packer_init(packer_buf.packet, sizeof(packer_buf.packet), link_send);
+
+	return NULL;
+}
+
+static void packer_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	atomic_set(&link_down, 0);
+
+	for (size_t i = 0; i < sizeof(packer_buf.guard); i++) {
+		zassert_equal(packer_buf.guard[i], 0, "written past the packet buffer");
+	}
+}
+
+ZTEST_SUITE(nus_packer, NULL, packer_setup, NULL, packer_after, NULL);
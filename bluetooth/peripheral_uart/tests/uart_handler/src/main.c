@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2018 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "uart_handler.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/serial/uart_emul.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#define BUF_COUNT  CONFIG_BT_NUS_UART_BUF_COUNT
+#define RX_RESERVE CONFIG_BT_NUS_UART_RX_RESERVE
+
+/* Bytes the wire moves from UART TX to UART RX every millisecond, about 1 Mbaud */
+#define WIRE_RATE 100
+
+/* Bytes sent and not yet received, at most the FIFO sizes of app.overlay */
+#define WINDOW 1024
+
+/* Not a multiple of the buffer size, so that streams end in a partly filled buffer */
+#define STREAM_BYTES    49999
+#define RECEIVE_TIME_MS 10000
+
+static const struct device *uart = DEVICE_DT_GET(DT_CHOSEN(nordic_nus_uart));
+
+/* Sender and receiver of the same pseudo random byte stream */
+struct stream {
+	uint32_t state;
+	uint32_t bytes;
+};
+
+static struct stream tx_stream = {.state = 0x2545F491};
+static struct stream rx_stream = {.state = 0x2545F491};
+
+static atomic_t rx_bytes;
+static atomic_t rx_errors;
+static atomic_t wire_overruns;
+
+/* Milliseconds the receiver spends on every buffer, and set to stop taking buffers */
+static atomic_t consumer_delay;
+static atomic_t consumer_held;
+
+static uint8_t stream_next(struct stream *stream)
+{
+	/* xorshift32, the same sequence on every run */
+	stream->state ^= stream->state << 13;
+	stream->state ^= stream->state >> 17;
+	stream->state ^= stream->state << 5;
+	stream->bytes++;
+
+	return stream->state >> 24;
+}
+
+/* Moves what the handler sent into its receiver, as a loopback cable would */
+static void wire_thread(void)
+{
+	static uint8_t wire[WIRE_RATE];
+
+	for (;;) {
+		uint32_t len = uart_emul_get_tx_data(uart, wire, sizeof(wire));
+
+		/* Called when empty too, so that data held while RX was paused resumes */
+		if (uart_emul_put_rx_data(uart, wire, len) != len) {
+			atomic_inc(&wire_overruns);
+		}
+
+		k_sleep(K_MSEC(1));
+	}
+}
+
+/* Takes the received buffers as the Bluetooth write thread of the sample does */
+static void consumer_thread(void)
+{
+	for (;;) {
+		struct uart_data_t *buf;
+		uint32_t delay;
+
+		if (atomic_get(&consumer_held)) {
+			k_sleep(K_MSEC(1));
+			continue;
+		}
+
+		buf = uart_rx_get(K_FOREVER);
+
+		for (uint16_t i = 0; i < buf->len; i++) {
+			if (buf->data[i] != stream_next(&rx_stream)) {
+				atomic_inc(&rx_errors);
+			}
+		}
+
+		atomic_add(&rx_bytes, buf->len);
+		uart_buf_free(buf);
+
+		delay = atomic_get(&consumer_delay);
+		if (delay != 0) {
+			k_sleep(K_MSEC(delay));
+		}
+	}
+}
+
+K_THREAD_DEFINE(wire_thread_id, 1024, wire_thread, NULL, NULL, NULL, 6, 0, 0);
+K_THREAD_DEFINE(consumer_thread_id, 1024, consumer_thread, NULL, NULL, NULL, 7, 0, 0);
+
+/* Send bytes of the stream in chunks of random size, as data received over Bluetooth */
+static void send(const char *name, uint32_t bytes)
+{
+	uint32_t end = tx_stream.bytes + bytes;
+	int64_t sent_time = k_uptime_get();
+
+	while (tx_stream.bytes < end) {
+		struct uart_data_t *buf = NULL;
+		uint16_t len;
+
+		if (tx_stream.bytes - atomic_get(&rx_bytes) < WINDOW - UART_BUF_SIZE) {
+			buf = uart_buf_alloc();
+		}
+
+		if (!buf) {
+			zassert_true(k_uptime_get() - sent_time <= RECEIVE_TIME_MS,
+				     "%s: sending stalled, %ld of %u bytes received", name,
+				     atomic_get(&rx_bytes), tx_stream.bytes);
+			k_sleep(K_MSEC(1));
+			continue;
+		}
+
+		len = 1 + (tx_stream.state % UART_BUF_SIZE);
+		len = MIN(len, end - tx_stream.bytes);
+
+		for (uint16_t i = 0; i < len; i++) {
+			buf->data[i] = stream_next(&tx_stream);
+		}
+
+		buf->len = len;
+		uart_buf_send(buf);
+		sent_time = k_uptime_get();
+	}
+}
+
+static void wait_received(const char *name)
+{
+	for (int ms = 0; ms < RECEIVE_TIME_MS; ms += 10) {
+		if (atomic_get(&rx_bytes) == tx_stream.bytes) {
+			return;
+		}
+
+		k_sleep(K_MSEC(10));
+	}
+
+	zassert_unreachable("%s: %ld of %u bytes received", name, atomic_get(&rx_bytes),
+			    tx_stream.bytes);
+}
+
+static void check_stream(const char *name, uint32_t bytes, uint32_t pauses_before,
+			 bool pauses_expected)
+{
+	struct uart_handler_stats stats;
+
+	uart_handler_stats_get(&stats);
+
+	printk("%-8s %6u bytes, UART RX paused %4u times, %2u of %u buffers used at most\n",
+	       name, bytes, stats.rx_pauses - pauses_before, stats.max_used,
+	       BUF_COUNT);
+
+	zassert_equal(atomic_get(&rx_errors), 0, "%s: %ld bytes corrupted", name,
+		      atomic_get(&rx_errors));
+	zassert_equal(atomic_get(&wire_overruns), 0, "%s: %ld wire overruns", name,
+		      atomic_get(&wire_overruns));
+	zassert_true(!pauses_expected || stats.rx_pauses != pauses_before,
+		     "%s: UART RX never paused", name);
+}
+
+static void stream_run(const char *name, uint32_t delay, bool pauses_expected)
+{
+	struct uart_handler_stats stats;
+
+	uart_handler_stats_get(&stats);
+	atomic_set(&consumer_delay, delay);
+
+	send(name, STREAM_BYTES);
+	wait_received(name);
+
+	check_stream(name, STREAM_BYTES, stats.rx_pauses, pauses_expected);
+}
+
+/*
+ * With the receiver stopped, UART RX takes buffers until only the reserve is left, and
+ * stays paused. The reserve can then be allocated, and nothing is lost once the
+ * receiver runs again.
+ */
+ZTEST(nus_uart_handler, test_reserve)
+{
+	struct uart_data_t *reserve[RX_RESERVE];
+	struct uart_handler_stats stats;
+	uint32_t bytes = (BUF_COUNT - RX_RESERVE + 2) * UART_BUF_SIZE + 1;
+	uint32_t pauses_before;
+	int allocated = 0;
+
+	uart_handler_stats_get(&stats);
+	pauses_before = stats.rx_pauses;
+
+	atomic_set(&consumer_held, 1);
+
+	send("reserve", bytes);
+
+	/* Longer than the RX timeout, so that partly filled buffers are released too */
+	k_sleep(K_MSEC(100 + UART_RX_TIMEOUT / USEC_PER_MSEC));
+
+	uart_handler_stats_get(&stats);
+
+	zassert_equal(stats.num_free, RX_RESERVE,
+		      "%u buffers free with UART RX held up, expected %u", stats.num_free,
+		      RX_RESERVE);
+
+	for (int i = 0; i < RX_RESERVE; i++) {
+		reserve[i] = uart_buf_alloc();
+		allocated += (reserve[i] != NULL);
+	}
+
+	for (int i = 0; i < RX_RESERVE; i++) {
+		if (reserve[i] != NULL) {
+			uart_buf_free(reserve[i]);
+		}
+	}
+
+	zassert_equal(allocated, RX_RESERVE, "%d of %u reserved buffers allocated", allocated,
+		      RX_RESERVE);
+
+	atomic_set(&consumer_held, 0);
+	wait_received("reserve");
+
+	check_stream("reserve", bytes, pauses_before, true);
+}
+
+/* The receiver keeps up */
+ZTEST(nus_uart_handler, test_fast)
+{
+	stream_run("fast", 0, false);
+}
+
+/* The receiver takes 2 ms per buffer, slower than the wire */
+ZTEST(nus_uart_handler, test_slow)
+{
+	stream_run("slow", 2, true);
+}
+
+static void *uart_handler_setup(void)
+{
+	printk("NUS UART handler test: %u buffers of %u bytes, %u reserved\n", BUF_COUNT,
+	       UART_BUF_SIZE, RX_RESERVE);
+
+	zassert_ok(uart_handler_init(uart), "UART init failed");
+	zassert_ok(uart_handler_rx_enable(), "UART RX enable failed");
+
+	return NULL;
+}
+
+static void uart_handler_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	atomic_clear(&consumer_delay);
+	atomic_clear(&consumer_held);
+}
+
+static void uart_handler_after(void *fixture)
+{
+	struct uart_handler_stats stats;
+
+	ARG_UNUSED(fixture);
+
+	/* Whatever a failed test left behind is received first */
+	atomic_clear(&consumer_held);
+	wait_received("after");
+
+	/* UART RX holds the buffer it receives into and the next one, no other is in use */
+	k_sleep(K_MSEC(100 + UART_RX_TIMEOUT / USEC_PER_MSEC));
+	uart_handler_stats_get(&stats);
+
+	zassert_true(stats.num_free >= BUF_COUNT - 2, "%u of %u buffers free after the test",
+		     stats.num_free, BUF_COUNT);
+}
+
+ZTEST_SUITE(nus_uart_handler, NULL, uart_handler_setup, uart_handler_before,
+	    uart_handler_after, NULL);
@@ -18,6 +18,10 @@
 #include <bluetooth/scan.h>
 #include <bluetooth/gatt_dm.h>
 
+#include <string.h>
+
+#include "latency_hist.h"
+
 #define INTERVAL_UNITS 0x8		 /* 8 units,  10 ms */
 #define CONN_TIMEOUT   ((5 * 1000) / 10) /* 5 seconds, 10ms units */
 
@@ -27,7 +31,16 @@
 #define SUBRATE_INITIATOR_ROLE BT_CONN_ROLE_PERIPHERAL
 
 /* Number of latency service writes to perform after each subrate change. */
-#define DATA_BURST_COUNT 10
+#define DATA_BURST_COUNT 50
+#define RESPONSE_TIMEOUT K_MSEC(500)
+
+/* Written to the peer. The peer sends nothing back: once the write is acknowledged, the
+ * latency client hands this same buffer to the response callback.
+ */
+struct latency_payload {
+	uint32_t seq;
+	uint32_t stamp;
+} __packed;
 
 static K_SEM_DEFINE(test_ready_sem, 0, 1);
 static K_SEM_DEFINE(latency_received_sem, 0, 1);
@@ -39,6 +52,10 @@ static struct bt_conn *default_conn;
 static struct bt_latency latency;
 static struct bt_latency_client latency_client;
 
+static K_MUTEX_DEFINE(stats_lock);
+static struct latency_ring latency_ring;
+static struct latency_hist latency_rtt;
+
 static struct bt_le_conn_param *conn_param =
 	BT_LE_CONN_PARAM(INTERVAL_UNITS, INTERVAL_UNITS, 0, CONN_TIMEOUT);
 static struct bt_conn_info conn_info = {0};
@@ -305,12 +322,23 @@ static void subrate_changed(struct bt_conn *conn, const struct bt_conn_le_subrat
 
 static void latency_response_handler(const void *buf, uint16_t len)
 {
-	uint32_t latency_time;
+	struct latency_payload payload;
+	struct latency_ring_entry request;
+	uint32_t cycles_spent;
+	int err;
+
+	if (len != sizeof(payload)) {
+		return;
+	}
+
+	cycles_spent = k_cycle_get_32();
+	memcpy(&payload, buf, sizeof(payload));
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
 
-	if (len == sizeof(latency_time)) {
-		latency_time = *((uint32_t *)buf);
-		uint32_t cycles_spent = k_cycle_get_32() - latency_time;
-		uint32_t total_latency_us = (uint32_t)k_cyc_to_us_floor64(cycles_spent);
+	err = latency_ring_pop(&latency_ring, payload.seq, &request);
+	if (!err) {
+		cycles_spent -= request.stamp;
 
 		/* The latency service uses ATT Write Requests.
 		 * The ATT Write Response is sent in the next connection event.
@@ -318,38 +346,85 @@ static void latency_response_handler(const void *buf, uint16_t len)
 		 * the next connection event, plus an additional connection interval
 		 * to receive the response.
 		 */
+		latency_hist_record(&latency_rtt, (uint32_t)k_cyc_to_us_floor64(cycles_spent));
+	}
 
-		printk("Response round-trip time: %d us\n", total_latency_us);
+	k_mutex_unlock(&stats_lock);
 
-		k_sem_give(&latency_received_sem);
-	}
+	k_sem_give(&latency_received_sem);
 }
 
 static const struct bt_latency_client_cb latency_client_cb = {
 	.latency_response = latency_response_handler
 };
 
+static void latency_stats_print(void)
+{
+	struct latency_hist_summary rtt;
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+
+	latency_hist_summarize(&latency_rtt, &rtt);
+
+	printk("Response round-trip time (us) of %u samples: "
+	       "p50 %u, p99 %u, p99.9 %u, max %u\n",
+	       rtt.count, rtt.p50, rtt.p99, rtt.p99_9, rtt.max);
+	printk("  lost %u, unmatched %u\n", latency_ring.lost, latency_ring.unmatched);
+
+	k_mutex_unlock(&stats_lock);
+}
+
 static void exchange_data_burst(void)
 {
+	/* Kept by the latency client until the write completes */
+	static struct latency_payload payload;
 	int err;
 	int counter = 0;
 
 	printk("Simulating burst of data.\n");
 
-	while (default_conn && counter < DATA_BURST_COUNT) {
-		uint32_t time = k_cycle_get_32();
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	latency_ring_reset(&latency_ring);
+	latency_hist_reset(&latency_rtt);
+	k_mutex_unlock(&stats_lock);
 
-		err = bt_latency_request(&latency_client, &time, sizeof(time));
-		if (err && err != -EALREADY) {
-			printk("Latency failed (err %d)\n", err);
+	k_sem_reset(&latency_received_sem);
+
+	/* A single ATT Write Request is in flight, the next one is sent as soon as the
+	 * response came in.
+	 */
+	while (default_conn && counter < DATA_BURST_COUNT) {
+		k_mutex_lock(&stats_lock, K_FOREVER);
+		payload.stamp = k_cycle_get_32();
+		payload.seq = latency_ring_push(&latency_ring, payload.stamp, 0);
+		k_mutex_unlock(&stats_lock);
+
+		err = bt_latency_request(&latency_client, &payload, sizeof(payload));
+		if (err) {
+			k_mutex_lock(&stats_lock, K_FOREVER);
+			latency_ring_cancel(&latency_ring, payload.seq);
+			k_mutex_unlock(&stats_lock);
+
+			if (err != -EALREADY) {
+				printk("Latency failed (err %d)\n", err);
+			}
 		}
 
-		if (k_sem_take(&latency_received_sem, K_MSEC(500)) != 0) {
+		/* A late response still carries the payload written, so the next request
+		 * is not pushed before it came in.
+		 */
+		while (k_sem_take(&latency_received_sem, RESPONSE_TIMEOUT) != 0) {
 			printk("Did not receive a latency response in time.\n");
+
+			if (!default_conn) {
+				break;
+			}
 		}
 
 		counter++;
 	}
+
+	latency_stats_print();
 }
 
 static void test_run(void)
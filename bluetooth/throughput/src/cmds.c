@@ -5,6 +5,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/bluetooth/conn.h>
 
@@ -22,6 +23,9 @@
 #define MAX_CONN_INTERVAL   3200
 #define SUPERVISION_TIMEOUT 1000
 
+/* Marks the CSV rows of a sweep among the other shell output. */
+#define SWEEP_CSV_PREFIX "sweep"
+
 static struct test_params {
 	struct bt_le_conn_param *conn_param;
 	struct bt_conn_le_phy_param *phy;
@@ -62,6 +66,20 @@ static const char *phy_str(const struct bt_conn_le_phy_param *phy)
 	}
 }
 
+static const char *gap_phy_str(uint8_t phy)
+{
+	switch (phy) {
+	case BT_GAP_LE_PHY_1M:
+		return "1M";
+	case BT_GAP_LE_PHY_2M:
+		return "2M";
+	case BT_GAP_LE_PHY_CODED:
+		return "coded";
+	default:
+		return "none";
+	}
+}
+
 static int default_cmd(const struct shell *shell, size_t argc,
 		       char **argv)
 {
@@ -251,11 +269,183 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_config,
 );
 
 
+static void metrics_print(const struct shell *shell, const struct test_metrics *metrics)
+{
+	shell_print(shell, "\nDone");
+	shell_print(shell, "[local] sent %u bytes (%u KB) in %u ms at %u kbps",
+		    metrics->local_bytes, metrics->local_bytes / 1024, metrics->duration,
+		    metrics->local_kbps);
+	shell_print(shell, "[peer] received %u bytes (%u KB) in %u GATT writes at %u bps",
+		    metrics->remote_bytes, metrics->remote_bytes / 1024, metrics->remote_writes,
+		    metrics->remote_rate);
+}
+
 static int test_run_cmd(const struct shell *shell, size_t argc,
 			char **argv)
 {
-	return test_run(shell, test_params.conn_param, test_params.phy,
-			test_params.data_len);
+	struct test_metrics metrics;
+	int err;
+
+	shell_print(shell, "\n==== Starting throughput test ====");
+	shell_print(shell, "The test is in progress and will require around %d seconds "
+		    "to complete.", CONFIG_BT_THROUGHPUT_DURATION / 1000);
+
+	err = test_run(shell, test_params.conn_param, test_params.phy,
+		       test_params.data_len, 0, CONFIG_BT_THROUGHPUT_DURATION, &metrics);
+	if (!err) {
+		metrics_print(shell, &metrics);
+	}
+
+	instruction_print();
+
+	return err;
+}
+
+static const struct bt_conn_le_phy_param sweep_phys[] = {
+	{
+		.options = BT_CONN_LE_PHY_OPT_NONE,
+		.pref_tx_phy = BT_GAP_LE_PHY_1M,
+		.pref_rx_phy = BT_GAP_LE_PHY_1M,
+	},
+	{
+		.options = BT_CONN_LE_PHY_OPT_NONE,
+		.pref_tx_phy = BT_GAP_LE_PHY_2M,
+		.pref_rx_phy = BT_GAP_LE_PHY_2M,
+	},
+#if defined(RADIO_MODE_MODE_Ble_LR500Kbit) || defined(NRF5340_XXAA_APPLICATION)
+	{
+		.options = BT_CONN_LE_PHY_OPT_CODED_S2,
+		.pref_tx_phy = BT_GAP_LE_PHY_CODED,
+		.pref_rx_phy = BT_GAP_LE_PHY_CODED,
+	},
+#endif
+#if defined(RADIO_MODE_MODE_Ble_LR125Kbit) || defined(NRF5340_XXAA_APPLICATION)
+	{
+		.options = BT_CONN_LE_PHY_OPT_CODED_S8,
+		.pref_tx_phy = BT_GAP_LE_PHY_CODED,
+		.pref_rx_phy = BT_GAP_LE_PHY_CODED,
+	},
+#endif
+};
+
+/* 7.5 ms, 50 ms and 400 ms in 1.25 ms units. */
+static const uint16_t sweep_intervals[] = { 6, 40, 320 };
+
+static const uint16_t sweep_data_lens[] = { BT_GAP_DATA_LEN_DEFAULT, BT_GAP_DATA_LEN_MAX };
+
+/* Payload of the default ATT MTU, of a single 251 byte PDU, and the largest one the
+ * negotiated ATT MTU allows.
+ */
+static const uint16_t sweep_write_lens[] = { 20, 244, 0 };
+
+static void sweep_row_print(const struct shell *shell, bool json, int err,
+			    const struct bt_conn_le_phy_param *phy, uint16_t interval,
+			    uint16_t data_len, const struct test_metrics *m)
+{
+	if (json) {
+		shell_print(shell,
+			    "{\"phy\":\"%s\",\"interval\":%u,\"data_len\":%u,"
+			    "\"write_len\":%u,\"err\":%d,"
+			    "\"local_bytes\":%u,\"duration_ms\":%u,\"local_kbps\":%u,"
+			    "\"remote_bytes\":%u,\"remote_writes\":%u,\"remote_kbps\":%u,"
+			    "\"write_errors\":%u,\"read_errors\":%u,"
+			    "\"tx_phy\":\"%s\",\"rx_phy\":\"%s\",\"conn_interval\":%u,"
+			    "\"tx_data_len\":%u,\"rx_data_len\":%u,\"mtu\":%u}",
+			    phy_str(phy), interval, data_len, m->write_len, err,
+			    m->local_bytes, m->duration, m->local_kbps,
+			    m->remote_bytes, m->remote_writes, m->remote_rate / 1000,
+			    m->write_errors, m->read_errors,
+			    gap_phy_str(m->tx_phy), gap_phy_str(m->rx_phy), m->interval,
+			    m->tx_data_len, m->rx_data_len, m->mtu);
+	} else {
+		shell_print(shell,
+			    SWEEP_CSV_PREFIX ",%s,%u,%u,%u,%d,%u,%u,%u,%u,%u,%u,%u,%u,"
+			    "%s,%s,%u,%u,%u,%u",
+			    phy_str(phy), interval, data_len, m->write_len, err,
+			    m->local_bytes, m->duration, m->local_kbps,
+			    m->remote_bytes, m->remote_writes, m->remote_rate / 1000,
+			    m->write_errors, m->read_errors,
+			    gap_phy_str(m->tx_phy), gap_phy_str(m->rx_phy), m->interval,
+			    m->tx_data_len, m->rx_data_len, m->mtu);
+	}
+}
+
+static int test_sweep_cmd(const struct shell *shell, size_t argc,
+			  char **argv)
+{
+	struct bt_le_conn_param conn_param = {
+		.latency = 0,
+		.timeout = SUPERVISION_TIMEOUT,
+	};
+	struct bt_conn_le_data_len_param data_len = {
+		.tx_max_time = BT_GAP_DATA_TIME_MAX,
+	};
+	struct test_metrics metrics;
+	bool json = false;
+	int err;
+
+	if (argc > 2) {
+		shell_error(shell, "%s: bad parameters count", argv[0]);
+		return -EINVAL;
+	}
+
+	if (argc == 2) {
+		if (!strcmp(argv[1], "json")) {
+			json = true;
+		} else if (strcmp(argv[1], "csv")) {
+			shell_error(shell, "Unknown format: %s", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+	shell_print(shell, "\n==== Starting throughput sweep ====");
+	shell_print(shell, "%zu points of %d seconds each",
+		    ARRAY_SIZE(sweep_phys) * ARRAY_SIZE(sweep_intervals) *
+		    ARRAY_SIZE(sweep_data_lens) * ARRAY_SIZE(sweep_write_lens),
+		    CONFIG_BT_THROUGHPUT_SWEEP_DURATION / 1000);
+
+	if (!json) {
+		shell_print(shell, SWEEP_CSV_PREFIX ",phy,interval,data_len,write_len,err,"
+			    "local_bytes,duration_ms,local_kbps,"
+			    "remote_bytes,remote_writes,remote_kbps,"
+			    "write_errors,read_errors,"
+			    "tx_phy,rx_phy,conn_interval,tx_data_len,rx_data_len,mtu");
+	}
+
+	for (size_t p = 0; p < ARRAY_SIZE(sweep_phys); p++) {
+		const struct bt_conn_le_phy_param *phy = &sweep_phys[p];
+
+		for (size_t i = 0; i < ARRAY_SIZE(sweep_intervals); i++) {
+			conn_param.interval_min = sweep_intervals[i];
+			conn_param.interval_max = sweep_intervals[i];
+
+			for (size_t d = 0; d < ARRAY_SIZE(sweep_data_lens); d++) {
+				data_len.tx_max_len = sweep_data_lens[d];
+
+				for (size_t w = 0; w < ARRAY_SIZE(sweep_write_lens); w++) {
+					err = test_run(shell, &conn_param, phy, &data_len,
+						       sweep_write_lens[w],
+						       CONFIG_BT_THROUGHPUT_SWEEP_DURATION,
+						       &metrics);
+
+					sweep_row_print(shell, json, err, phy, sweep_intervals[i],
+							sweep_data_lens[d], &metrics);
+
+					/* Points left can't run without the connection. */
+					if ((err == -EFAULT) || (err == -EBUSY) ||
+					    (err == -ENOTCONN)) {
+						return err;
+					}
+				}
+			}
+		}
+	}
+
+	shell_print(shell, "\n==== Throughput sweep done ====");
+
+	instruction_print();
+
+	return 0;
 }
 
 static int test_central_cmd(const struct shell *shell, size_t argc,
@@ -274,5 +464,9 @@ static int test_peripheral_cmd(const struct shell *shell, size_t argc,
 
 SHELL_CMD_REGISTER(config, &sub_config, "Configure the example", default_cmd);
 SHELL_CMD_REGISTER(run, NULL, "Run the test", test_run_cmd);
+SHELL_CMD_REGISTER(sweep, NULL,
+		   "Run the test for every PHY, connection interval, data length "
+		   "and write length, print the results as rows <csv|json>",
+		   test_sweep_cmd);
 SHELL_CMD_REGISTER(central, NULL, "Select central role", test_central_cmd);
 SHELL_CMD_REGISTER(peripheral, NULL, "Select peripheral role", test_peripheral_cmd);
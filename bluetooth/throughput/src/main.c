@@ -44,6 +44,7 @@ static const struct bt_uuid *uuid128 = BT_UUID_THROUGHPUT;
 static struct bt_gatt_exchange_params exchange_params;
 static struct bt_le_conn_param *conn_param =
 	BT_LE_CONN_PARAM(INTERVAL_MIN, INTERVAL_MAX, 0, 400);
+static struct bt_throughput_metrics peer_metrics;
 
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
@@ -69,7 +70,7 @@ static const char *phy2str(uint8_t phy)
 	}
 }
 
-static void instruction_print(void)
+void instruction_print(void)
 {
 	printk("\nType 'config' to change the configuration parameters.\n");
 	printk("You can use the Tab key to autocomplete your input.\n");
@@ -368,10 +369,7 @@ static void le_data_length_updated(struct bt_conn *conn,
 
 static uint8_t throughput_read(const struct bt_throughput_metrics *met)
 {
-	printk("[peer] received %u bytes (%u KB)"
-	       " in %u GATT writes at %u bps\n",
-	       met->write_len, met->write_len / 1024, met->write_count,
-	       met->write_rate);
+	peer_metrics = *met;
 
 	k_sem_give(&throughput_sem);
 
@@ -536,10 +534,30 @@ static int connection_configuration_set(const struct shell *shell,
 	return 0;
 }
 
+static void conn_metrics_get(struct test_metrics *metrics)
+{
+	struct bt_conn_info info = {0};
+	int err;
+
+	err = bt_conn_get_info(default_conn, &info);
+	if (err) {
+		return;
+	}
+
+	metrics->tx_phy = info.le.phy->tx_phy;
+	metrics->rx_phy = info.le.phy->rx_phy;
+	metrics->interval = info.le.interval;
+	metrics->tx_data_len = info.le.data_len->tx_max_len;
+	metrics->rx_data_len = info.le.data_len->rx_max_len;
+	metrics->mtu = bt_gatt_get_mtu(default_conn);
+}
+
 int test_run(const struct shell *shell,
 	     const struct bt_le_conn_param *conn_param,
 	     const struct bt_conn_le_phy_param *phy,
-	     const struct bt_conn_le_data_len_param *data_len)
+	     const struct bt_conn_le_data_len_param *data_len,
+	     uint16_t write_len, uint32_t duration,
+	     struct test_metrics *metrics)
 {
 	int err;
 	uint64_t stamp;
@@ -549,6 +567,8 @@ int test_run(const struct shell *shell,
 	/* a dummy data buffer */
 	static char dummy[CONFIG_BT_L2CAP_TX_MTU - 3];
 
+	memset(metrics, 0, sizeof(*metrics));
+
 	if (!default_conn) {
 		shell_error(shell, "Device is disconnected %s",
 			    "Connect to the peer device before running test");
@@ -558,19 +578,19 @@ int test_run(const struct shell *shell,
 	if (!test_ready) {
 		shell_error(shell, "Device is not ready."
 			"Please wait for the service discovery and MTU exchange end");
-		return 0;
+		return -EBUSY;
 	}
 
-	shell_print(shell, "\n==== Starting throughput test ====");
+	/* The ATT MTU is exchanged once per connection, shorter writes use a part of it. */
+	if ((write_len == 0) || (write_len > bt_gatt_get_mtu(default_conn) - 3)) {
+		write_len = MIN(bt_gatt_get_mtu(default_conn) - 3, sizeof(dummy));
+	}
 
 	err = connection_configuration_set(shell, conn_param, phy, data_len);
 	if (err) {
 		return err;
 	}
 
-	shell_print(shell, "The test is in progress and will require around %d seconds "
-		"to complete.", CONFIG_BT_THROUGHPUT_DURATION / 1000);
-
 	/* Make sure that all BLE procedures are finished. */
 	k_sleep(K_MSEC(500));
 
@@ -578,6 +598,7 @@ int test_run(const struct shell *shell,
 	err = bt_throughput_write(&throughput, dummy, 1);
 	if (err) {
 		shell_error(shell, "Reset peer metrics failed.");
+		metrics->write_errors++;
 		return err;
 	}
 
@@ -585,33 +606,46 @@ int test_run(const struct shell *shell,
 	stamp = k_uptime_get_32();
 
 	while (true) {
-		err = bt_throughput_write(&throughput, dummy, sizeof(dummy));
+		err = bt_throughput_write(&throughput, dummy, write_len);
 		if (err) {
 			shell_error(shell, "GATT write failed (err %d)", err);
+			metrics->write_errors++;
 			break;
 		}
-		data += sizeof(dummy);
-		if (k_uptime_get_32() - stamp > CONFIG_BT_THROUGHPUT_DURATION) {
+		data += write_len;
+		if (k_uptime_get_32() - stamp > duration) {
 			break;
 		}
 	}
 
 	delta = k_uptime_delta(&stamp);
 
-	printk("\nDone\n");
-	printk("[local] sent %u bytes (%u KB) in %lld ms at %llu kbps\n",
-	       data, data / 1024, delta, ((uint64_t)data * 8 / delta));
+	metrics->write_len = write_len;
+	metrics->local_bytes = data;
+	metrics->duration = delta;
+	metrics->local_kbps = (delta > 0) ? ((uint64_t)data * 8 / delta) : 0;
 
 	/* read back char from peer */
+	k_sem_reset(&throughput_sem);
 	err = bt_throughput_read(&throughput);
 	if (err) {
 		shell_error(shell, "GATT read failed (err %d)", err);
+		metrics->read_errors++;
+		return err;
+	}
+
+	err = k_sem_take(&throughput_sem, THROUGHPUT_CONFIG_TIMEOUT);
+	if (err) {
+		shell_error(shell, "GATT read timeout");
+		metrics->read_errors++;
 		return err;
 	}
 
-	k_sem_take(&throughput_sem, THROUGHPUT_CONFIG_TIMEOUT);
+	metrics->remote_bytes = peer_metrics.write_len;
+	metrics->remote_writes = peer_metrics.write_count;
+	metrics->remote_rate = peer_metrics.write_rate;
 
-	instruction_print();
+	conn_metrics_get(metrics);
 
 	return 0;
 }
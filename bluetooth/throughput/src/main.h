@@ -7,18 +7,68 @@
 #ifndef THROUGHPUT_MAIN_H_
 #define THROUGHPUT_MAIN_H_
 
+/** @brief Results of a test run. */
+struct test_metrics {
+	/** Length of each GATT write. */
+	uint16_t write_len;
+
+	/** Bytes sent by the local board. */
+	uint32_t local_bytes;
+
+	/** Duration of the transfer in milliseconds. */
+	uint32_t duration;
+
+	/** Local throughput in kbps. */
+	uint32_t local_kbps;
+
+	/** Bytes received by the peer. */
+	uint32_t remote_bytes;
+
+	/** GATT writes received by the peer. */
+	uint32_t remote_writes;
+
+	/** Throughput measured by the peer in bps. */
+	uint32_t remote_rate;
+
+	/** Failed GATT writes. */
+	uint32_t write_errors;
+
+	/** Failed reads of the peer metrics. */
+	uint32_t read_errors;
+
+	/** Negotiated parameters at the end of the run. */
+	uint8_t tx_phy;
+	uint8_t rx_phy;
+	uint16_t interval;
+	uint16_t tx_data_len;
+	uint16_t rx_data_len;
+	uint16_t mtu;
+};
+
 /**
  * @brief Run the test
  *
- * @param shell       Shell instance where output will be printed.
+ * @param shell       Shell instance where errors will be printed.
  * @param conn_param  Connection parameters.
  * @param phy         Phy parameters.
  * @param data_len    Maximum transmission payload.
+ * @param write_len   Length of each GATT write, 0 for the largest the ATT MTU allows.
+ * @param duration    Transfer duration in milliseconds.
+ * @param metrics     Results of the run, filled as far as the run got.
+ *
+ * @return 0 on success, negative error code otherwise.
  */
 int test_run(const struct shell *shell,
 	     const struct bt_le_conn_param *conn_param,
 	     const struct bt_conn_le_phy_param *phy,
-	     const struct bt_conn_le_data_len_param *data_len);
+	     const struct bt_conn_le_data_len_param *data_len,
+	     uint16_t write_len, uint32_t duration,
+	     struct test_metrics *metrics);
+
+/**
+ * @brief Print the instructions for configuring and running the test.
+ */
+void instruction_print(void);
 
 /**
  * @brief Set the board into a specific role.
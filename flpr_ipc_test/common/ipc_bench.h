@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef IPC_BENCH_H_
+#define IPC_BENCH_H_
+
+#include <stdint.h>
+#include <zephyr/devicetree.h>
+
+/*
+ * Benchmark protocol shared by the app core and the FLPR. Messages go through two
+ * shm_ring in the sram_ring region: requests from the app to the FLPR, and replies back.
+ * ipc_service only carries a struct ipc_doorbell when one side added messages.
+ */
+
+#define SHM_RING_NODE DT_NODELABEL(sram_ring)
+#define SHM_RING_BASE DT_REG_ADDR(SHM_RING_NODE)
+#define SHM_RING_SIZE DT_REG_SIZE(SHM_RING_NODE)
+
+/* Requests carry the payload, replies are small */
+#define REQUEST_RING_SIZE (SHM_RING_SIZE * 3 / 4)
+#define REPLY_RING_SIZE   (SHM_RING_SIZE - REQUEST_RING_SIZE)
+
+#define IPC_DOORBELL_REQUEST 0x52455131 /* "REQ1", requests were added */
+#define IPC_DOORBELL_REPLY   0x52504C31 /* "RPL1", replies were added */
+
+struct ipc_doorbell {
+	uint32_t type;
+};
+
+struct bench_request {
+	uint32_t seq;
+	uint32_t t_send;        /* App timing counter, echoed back */
+	uint8_t data[];
+};
+
+struct bench_reply {
+	uint32_t seq;
+	uint32_t t_send;
+	uint32_t checksum;      /* Sum of the request data bytes */
+	uint32_t flpr_ns;       /* FLPR time from the doorbell wakeup to this reply */
+	uint16_t batch;         /* Position of the request in its doorbell batch, from 1 */
+};
+
+#endif /* IPC_BENCH_H_ */
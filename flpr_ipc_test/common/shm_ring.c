@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "shm_ring.h"
+#include <errno.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/sys/barrier.h>
+
+/* Slot header, the payload follows */
+struct slot_hdr {
+	uint32_t len;
+};
+
+static inline uint8_t *slot_at(const struct shm_ring *ring, uint32_t index)
+{
+	return ring->slots + (index & (ring->ctrl->slot_count - 1)) * ring->ctrl->slot_size;
+}
+
+int shm_ring_init(struct shm_ring *ring, void *mem, size_t size)
+{
+	if (((uintptr_t)mem % SHM_RING_ALIGN) != 0 || size < 2 * sizeof(struct shm_ring_ctrl)) {
+		return -EINVAL;
+	}
+
+	ring->ctrl = mem;
+	ring->slots = (uint8_t *)mem + sizeof(struct shm_ring_ctrl);
+	ring->slots_size = size - sizeof(struct shm_ring_ctrl);
+
+	return 0;
+}
+
+int shm_ring_reset(struct shm_ring *ring, size_t max_len)
+{
+	size_t slot_size = ROUND_UP(sizeof(struct slot_hdr) + max_len, SHM_RING_ALIGN);
+	size_t count = ring->slots_size / slot_size;
+
+	if (count == 0 || slot_size > UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	/* Largest power of 2, so free running indexes wrap correctly */
+	while ((count & (count - 1)) != 0) {
+		count &= count - 1;
+	}
+
+	count = MIN(count, 1U << 15);
+
+	ring->ctrl->slot_size = slot_size;
+	ring->ctrl->slot_count = count;
+	ring->ctrl->tail = 0;
+	ring->ctrl->head = 0;
+	barrier_dmem_fence_full();
+
+	return count;
+}
+
+void *shm_ring_reserve(struct shm_ring *ring, size_t len)
+{
+	struct shm_ring_ctrl *ctrl = ring->ctrl;
+	struct slot_hdr *hdr;
+
+	if (ctrl->head - ctrl->tail >= ctrl->slot_count ||
+	    sizeof(struct slot_hdr) + len > ctrl->slot_size) {
+		return NULL;
+	}
+
+	/* The consumer is done with the slot once tail moved past it */
+	barrier_dmem_fence_full();
+
+	hdr = (struct slot_hdr *)slot_at(ring, ctrl->head);
+	hdr->len = len;
+
+	return hdr + 1;
+}
+
+void shm_ring_commit(struct shm_ring *ring)
+{
+	/* The message must be visible before the new head */
+	barrier_dmem_fence_full();
+	ring->ctrl->head = ring->ctrl->head + 1;
+}
+
+const void *shm_ring_peek(struct shm_ring *ring, size_t *len)
+{
+	struct shm_ring_ctrl *ctrl = ring->ctrl;
+	const struct slot_hdr *hdr;
+
+	if (ctrl->head == ctrl->tail) {
+		return NULL;
+	}
+
+	/* Don't read the message before head */
+	barrier_dmem_fence_full();
+
+	hdr = (const struct slot_hdr *)slot_at(ring, ctrl->tail);
+	*len = hdr->len;
+
+	return hdr + 1;
+}
+
+void shm_ring_release(struct shm_ring *ring)
+{
+	/* Reads of the message must be done before the slot is given back */
+	barrier_dmem_fence_full();
+	ring->ctrl->tail = ring->ctrl->tail + 1;
+}
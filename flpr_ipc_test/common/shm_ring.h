@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SHM_RING_H_
+#define SHM_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <zephyr/toolchain.h>
+
+/*
+ * Lock-free single producer, single consumer message ring in SRAM shared by the app core
+ * and the FLPR. Messages are written and read in place in fixed size slots aligned to
+ * SHM_RING_ALIGN, so no copy is needed on either side. The producer only writes head and
+ * the consumer only writes tail, each in its own aligned block, so no lock is needed. Only
+ * a doorbell has to go through ipc_service_send() to wake up the other side.
+ */
+
+#define SHM_RING_ALIGN 32
+
+/* Shared control block, at the start of the ring memory */
+struct shm_ring_ctrl {
+	/* Written by the producer */
+	volatile uint32_t head __aligned(SHM_RING_ALIGN);
+	volatile uint16_t slot_size;
+	volatile uint16_t slot_count;
+
+	/* Written by the consumer */
+	volatile uint32_t tail __aligned(SHM_RING_ALIGN);
+} __aligned(SHM_RING_ALIGN);
+
+/* Local view of a ring, one per side */
+struct shm_ring {
+	struct shm_ring_ctrl *ctrl;
+	uint8_t *slots;
+	size_t slots_size;
+};
+
+/**
+ * @brief Map a ring on shared memory, without changing its content
+ * @param ring Local ring
+ * @param mem Shared memory, aligned to SHM_RING_ALIGN
+ * @param size Size of the shared memory
+ * @return 0 on success, -EINVAL if the memory is misaligned or too small
+ */
+int shm_ring_init(struct shm_ring *ring, void *mem, size_t size);
+
+/**
+ * @brief Set the slot size and empty the ring, producer only
+ *
+ * The consumer must not be reading the ring, for example because it is empty. The slot
+ * count is the largest power of 2 that fits.
+ *
+ * @param ring Local ring
+ * @param max_len Largest message length
+ * @return Number of slots, -EINVAL if not even one message fits
+ */
+int shm_ring_reset(struct shm_ring *ring, size_t max_len);
+
+/**
+ * @brief Get the payload of the next free slot, producer only
+ * @param ring Local ring
+ * @param len Message length
+ * @return Payload to write the message to, NULL if the ring is full or len is too long
+ */
+void *shm_ring_reserve(struct shm_ring *ring, size_t len);
+
+/**
+ * @brief Publish the message of the reserved slot to the consumer, producer only
+ * @param ring Local ring
+ */
+void shm_ring_commit(struct shm_ring *ring);
+
+/**
+ * @brief Get the next message, consumer only
+ * @param ring Local ring
+ * @param len Message length
+ * @return Message, valid until shm_ring_release(), NULL if the ring is empty
+ */
+const void *shm_ring_peek(struct shm_ring *ring, size_t *len);
+
+/**
+ * @brief Give the slot of the message back to the producer, consumer only
+ * @param ring Local ring
+ */
+void shm_ring_release(struct shm_ring *ring);
+
+/**
+ * @brief Number of messages in the ring
+ * @param ring Local ring
+ */
+static inline uint32_t shm_ring_count(const struct shm_ring *ring)
+{
+	return ring->ctrl->head - ring->ctrl->tail;
+}
+
+#endif /* SHM_RING_H_ */
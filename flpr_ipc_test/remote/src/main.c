@@ -6,6 +6,10 @@
 #include <zephyr/kernel.h>
 #include <zephyr/ipc/ipc_service.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/timing/timing.h>
+
+#include "shm_ring.h"
+#include "ipc_bench.h"
 
 LOG_MODULE_REGISTER(flpr_remote, LOG_LEVEL_INF);
 
@@ -21,6 +25,11 @@ struct ipc_data_packet {
 static struct ipc_ept ep;
 static volatile bool ep_bound = false;
 
+/* Benchmark rings, requests are consumed in batches by the main loop */
+static struct shm_ring requests;
+static struct shm_ring replies;
+static K_SEM_DEFINE(doorbell_sem, 0, 1);
+
 /* Callback when endpoint is bound */
 static void ep_bound_cb(void *priv)
 {
@@ -35,6 +44,16 @@ static void ep_recv_cb(const void *data, size_t len, void *priv)
 	struct ipc_data_packet send_packet;
 	int ret;
 
+	/* Benchmark doorbell, the requests are in shared memory */
+	if (len == sizeof(struct ipc_doorbell)) {
+		const struct ipc_doorbell *doorbell = data;
+
+		if (doorbell->type == IPC_DOORBELL_REQUEST) {
+			k_sem_give(&doorbell_sem);
+		}
+		return;
+	}
+
 	if (len != sizeof(struct ipc_data_packet)) {
 		LOG_ERR("FLPR: Invalid data size received: %d", len);
 		return;
@@ -61,6 +80,49 @@ static void ep_recv_cb(const void *data, size_t len, void *priv)
 	}
 }
 
+/* Process all pending requests in place, and ring the app once for all replies */
+static void serve_requests(void)
+{
+	static const struct ipc_doorbell doorbell = {.type = IPC_DOORBELL_REPLY};
+	timing_t start = timing_counter_get();
+	const struct bench_request *request;
+	uint16_t batch = 0;
+	size_t len;
+	int ret;
+
+	while ((request = shm_ring_peek(&requests, &len)) != NULL) {
+		struct bench_reply *reply = shm_ring_reserve(&replies, sizeof(*reply));
+		uint32_t checksum = 0;
+		timing_t now;
+
+		/* The app never has more requests in flight than reply slots */
+		if (reply == NULL) {
+			break;
+		}
+
+		for (size_t i = 0; i < len - sizeof(*request); i++) {
+			checksum += request->data[i];
+		}
+
+		now = timing_counter_get();
+		reply->seq = request->seq;
+		reply->t_send = request->t_send;
+		reply->checksum = checksum;
+		reply->batch = ++batch;
+		reply->flpr_ns = timing_cycles_to_ns(timing_cycles_get(&start, &now));
+
+		shm_ring_release(&requests);
+		shm_ring_commit(&replies);
+	}
+
+	if (batch != 0) {
+		ret = ipc_service_send(&ep, &doorbell, sizeof(doorbell));
+		if (ret < 0) {
+			LOG_ERR("FLPR: Failed to ring the app (err %d)", ret);
+		}
+	}
+}
+
 static struct ipc_ept_cfg ep_cfg = {
 	.name = "flpr_ep",
 	.cb = {
@@ -76,6 +138,18 @@ int main(void)
 
 	LOG_INF("FLPR core IPC test application started");
 
+	timing_init();
+	timing_start();
+
+	/* The FLPR produces the replies, so it sets their ring up */
+	if (shm_ring_init(&requests, (void *)SHM_RING_BASE, REQUEST_RING_SIZE) < 0 ||
+	    shm_ring_init(&replies, (void *)(SHM_RING_BASE + REQUEST_RING_SIZE),
+			  REPLY_RING_SIZE) < 0 ||
+	    shm_ring_reset(&replies, sizeof(struct bench_reply)) < 0) {
+		LOG_ERR("FLPR: Invalid shared ring memory");
+		return -EINVAL;
+	}
+
 	/* Get IPC instance */
 	ipc_instance = DEVICE_DT_GET(DT_NODELABEL(ipc0));
 	if (!device_is_ready(ipc_instance)) {
@@ -105,9 +179,12 @@ int main(void)
 
 	LOG_INF("FLPR: Ready and waiting for data from CPU app");
 
-	/* Main loop - just sleep, IPC callbacks handle everything */
+	/* Main loop - IPC callbacks handle the test packets, benchmark requests are
+	 * consumed here in batches, one doorbell wakes up the loop for all pending requests.
+	 */
 	while (1) {
-		k_msleep(1000);
+		k_sem_take(&doorbell_sem, K_FOREVER);
+		serve_requests();
 	}
 
 	return 0;
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/timing/timing.h>
+
+#include "benchmark.h"
+#include "shm_ring.h"
+#include "ipc_bench.h"
+
+LOG_MODULE_REGISTER(benchmark, LOG_LEVEL_INF);
+
+#define BENCH_MESSAGES   CONFIG_FLPR_IPC_BENCHMARK_MESSAGES
+#define REPLY_TIMEOUT    K_MSEC(100)
+
+static const uint16_t msg_sizes[] = {16, 64, 256, 1024};
+static const uint16_t batch_depths[] = {1, 8, 32};
+
+static struct shm_ring requests;
+static struct shm_ring replies;
+static K_SEM_DEFINE(reply_sem, 0, 1);
+
+/* Round-trip times of one sweep point */
+static uint32_t rtt_ns[BENCH_MESSAGES];
+
+struct bench_result {
+	uint32_t messages;
+	uint64_t elapsed_ns;
+	uint32_t errors;
+	uint32_t flpr_batch_ns;  /* Longest FLPR processing time of a batch */
+};
+
+bool benchmark_doorbell(const void *data, size_t len)
+{
+	const struct ipc_doorbell *doorbell = data;
+
+	if (len != sizeof(*doorbell) || doorbell->type != IPC_DOORBELL_REPLY) {
+		return false;
+	}
+
+	k_sem_give(&reply_sem);
+	return true;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t count, uint32_t pct)
+{
+	return sorted[MIN((count * pct) / 100, count - 1)];
+}
+
+/* Read the replies in place, returns the number read */
+static uint32_t drain_replies(struct bench_result *result, uint16_t size)
+{
+	const struct bench_reply *reply;
+	uint32_t count = 0;
+	size_t len;
+
+	while ((reply = shm_ring_peek(&replies, &len)) != NULL) {
+		timing_t now = timing_counter_get();
+		/* 32-bit counter differences are enough for round trips */
+		timing_t sent = reply->t_send;
+
+		if (result->messages < BENCH_MESSAGES) {
+			rtt_ns[result->messages] = timing_cycles_to_ns(timing_cycles_get(&sent, &now));
+		}
+		result->messages++;
+		result->flpr_batch_ns = MAX(result->flpr_batch_ns, reply->flpr_ns);
+
+		/* Request data bytes are all (seq & 0xff), check the FLPR read them all */
+		if (reply->checksum != size * (reply->seq & 0xff)) {
+			result->errors++;
+		}
+
+		shm_ring_release(&replies);
+		count++;
+	}
+
+	return count;
+}
+
+static int run_point(struct ipc_ept *ep, uint16_t size, uint16_t batch,
+		     struct bench_result *result)
+{
+	static const struct ipc_doorbell doorbell = {.type = IPC_DOORBELL_REQUEST};
+	uint32_t seq = 0;
+	timing_t start;
+	timing_t end;
+	int ret;
+
+	memset(result, 0, sizeof(*result));
+	start = timing_counter_get();
+
+	while (seq < BENCH_MESSAGES) {
+		uint32_t sent = 0;
+		uint32_t received = 0;
+
+		/* Write the batch in place, then a single doorbell */
+		while (sent < batch && seq < BENCH_MESSAGES) {
+			struct bench_request *request =
+				shm_ring_reserve(&requests, sizeof(*request) + size);
+
+			if (request == NULL) {
+				return -ENOMEM;
+			}
+
+			request->seq = seq;
+			memset(request->data, seq & 0xff, size);
+			request->t_send = timing_counter_get();
+			shm_ring_commit(&requests);
+			seq++;
+			sent++;
+		}
+
+		ret = ipc_service_send(ep, &doorbell, sizeof(doorbell));
+		if (ret < 0) {
+			return ret;
+		}
+
+		while (received < sent) {
+			received += drain_replies(result, size);
+
+			if (received < sent && k_sem_take(&reply_sem, REPLY_TIMEOUT) != 0 &&
+			    shm_ring_count(&replies) == 0) {
+				return -ETIMEDOUT;
+			}
+		}
+	}
+
+	end = timing_counter_get();
+	result->elapsed_ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+	return 0;
+}
+
+int benchmark_run(struct ipc_ept *ep)
+{
+	uint32_t reply_slots;
+	int ret;
+
+	timing_init();
+	timing_start();
+
+	/* The app produces the requests, the FLPR set the reply ring up at boot */
+	if (shm_ring_init(&requests, (void *)SHM_RING_BASE, REQUEST_RING_SIZE) < 0 ||
+	    shm_ring_init(&replies, (void *)(SHM_RING_BASE + REQUEST_RING_SIZE),
+			  REPLY_RING_SIZE) < 0) {
+		LOG_ERR("Invalid shared ring memory");
+		return -EINVAL;
+	}
+
+	reply_slots = replies.ctrl->slot_count;
+
+	LOG_INF("Shared memory ring benchmark, %d messages per point", BENCH_MESSAGES);
+	LOG_INF(" size batch   msg/s   MB/s  p50 us  p90 us  p99 us  max us  FLPR us  err");
+
+	for (size_t i = 0; i < ARRAY_SIZE(msg_sizes); i++) {
+		/* The previous point drained the ring, the FLPR is idle */
+		int slots = shm_ring_reset(&requests, sizeof(struct bench_request) + msg_sizes[i]);
+
+		if (slots < 0) {
+			LOG_ERR("%u byte messages don't fit in the ring", msg_sizes[i]);
+			continue;
+		}
+
+		for (size_t j = 0; j < ARRAY_SIZE(batch_depths); j++) {
+			/* Never more requests in flight than slots in either ring */
+			uint16_t batch = MIN(batch_depths[j], MIN((uint32_t)slots, reply_slots));
+			struct bench_result result;
+			uint32_t count;
+			uint32_t kbps;
+
+			ret = run_point(ep, msg_sizes[i], batch, &result);
+			if (ret < 0) {
+				LOG_ERR("Size %u batch %u failed (err %d)", msg_sizes[i], batch, ret);
+				return ret;
+			}
+
+			count = MIN(result.messages, BENCH_MESSAGES);
+			qsort(rtt_ns, count, sizeof(rtt_ns[0]), compare_u32);
+
+			/* Bytes per ns * 10^6 is kB/s */
+			kbps = (uint64_t)result.messages * msg_sizes[i] * 1000000 /
+			       result.elapsed_ns;
+
+			LOG_INF("%5u %5u %7u %3u.%02u %7u %7u %7u %7u %8u %4u", msg_sizes[i], batch,
+				(uint32_t)(result.messages * 1000000000ULL / result.elapsed_ns),
+				kbps / 1000, (kbps % 1000) / 10,
+				percentile(rtt_ns, count, 50) / 1000,
+				percentile(rtt_ns, count, 90) / 1000,
+				percentile(rtt_ns, count, 99) / 1000, rtt_ns[count - 1] / 1000,
+				result.flpr_batch_ns / 1000, result.errors);
+		}
+	}
+
+	timing_stop();
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <zephyr/ipc/ipc_service.h>
+
+/**
+ * @brief Run the shared memory ring benchmark, sweeping message size and batch depth
+ * @param ep Bound IPC endpoint, only used for doorbells
+ * @return 0 on success, negative error code otherwise
+ */
+int benchmark_run(struct ipc_ept *ep);
+
+/**
+ * @brief Handle a doorbell from the FLPR, called from the IPC receive callback
+ * @param data Received data
+ * @param len Received length
+ * @return true if it was a benchmark doorbell
+ */
+bool benchmark_doorbell(const void *data, size_t len);
+
+#endif /* BENCHMARK_H_ */
@@ -8,6 +8,8 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/drivers/gpio.h>
 
+#include "benchmark.h"
+
 LOG_MODULE_REGISTER(cpuapp_main, LOG_LEVEL_INF);
 
 #define IPC_DATA_SIZE 32
@@ -38,6 +40,10 @@ static void ep_bound_cb(void *priv)
 /* Callback when data is received from FLPR */
 static void ep_recv_cb(const void *data, size_t len, void *priv)
 {
+	if (IS_ENABLED(CONFIG_FLPR_IPC_BENCHMARK) && benchmark_doorbell(data, len)) {
+		return;
+	}
+
 	if (len != sizeof(struct ipc_data_packet)) {
 		LOG_ERR("CPU APP: Invalid data size received: %d", len);
 		return;
@@ -106,6 +112,10 @@ int main(void)
 		k_msleep(10);
 	}
 
+	if (IS_ENABLED(CONFIG_FLPR_IPC_BENCHMARK)) {
+		return benchmark_run(&ep);
+	}
+
 	LOG_INF("CPU APP: IPC ready! Starting data exchange...");
 	LOG_INF("==========================================");
 
@@ -6,6 +6,7 @@
 
 #include "./backend/backend.h"
 #include "./hrt/hrt.h"
+#include "./sequence.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
@@ -13,18 +14,27 @@
 #include <drivers/gpio/hpf_gpio.h>
 #include <hal/nrf_vpr_csr.h>
 #include <hal/nrf_vpr_csr_vio.h>
+#include <hal/nrf_vpr_csr_vtim.h>
 #include <haly/nrfy_gpio.h>
 
 #define HRT_IRQ_PRIORITY          2
 #define HRT_VEVIF_IDX_GPIO_CLEAR  17
 #define HRT_VEVIF_IDX_GPIO_SET    18
 #define HRT_VEVIF_IDX_GPIO_TOGGLE 19
+#define HRT_VEVIF_IDX_SEQUENCE    20
+
+/* VPR counter used as time base of sequences. */
+#define SEQUENCE_COUNTER 1
 
 #define VEVIF_IRQN(vevif) VEVIF_IRQN_1(vevif)
 #define VEVIF_IRQN_1(vevif) VPRCLIC_##vevif##_IRQn
 
 volatile uint16_t irq_arg;
 
+#if defined(CONFIG_HPF_GPIO_SEQUENCE)
+static const hpf_gpio_seq_t *volatile seq_arg;
+#endif
+
 static nrf_gpio_pin_pull_t get_pull(gpio_flags_t flags)
 {
 	if (flags & GPIO_PULL_UP) {
@@ -131,6 +141,13 @@ void process_packet(hpf_gpio_data_packet_t *packet)
 		nrf_vpr_clic_int_pending_set(NRF_VPRCLIC, VEVIF_IRQN(HRT_VEVIF_IDX_GPIO_TOGGLE));
 		break;
 	}
+#if defined(CONFIG_HPF_GPIO_SEQUENCE)
+	case HPF_GPIO_SEQUENCE: {
+		seq_arg = (const hpf_gpio_seq_t *)(uintptr_t)packet->flags;
+		nrf_vpr_clic_int_pending_set(NRF_VPRCLIC, VEVIF_IRQN(HRT_VEVIF_IDX_SEQUENCE));
+		break;
+	}
+#endif
 	default: {
 		break;
 	}
@@ -157,6 +174,37 @@ __attribute__ ((interrupt)) void hrt_handler_toggle_bits(void)
 	hrt_toggle_bits();
 }
 
+#if defined(CONFIG_HPF_GPIO_SEQUENCE)
+static uint16_t sequence_counter_get(void)
+{
+	return nrf_vpr_csr_vtim_simple_counter_get(SEQUENCE_COUNTER);
+}
+
+static void sequence_out_write(uint16_t pin_mask, uint16_t value)
+{
+	uint16_t outs = nrf_vpr_csr_vio_out_get();
+
+	nrf_vpr_csr_vio_out_set((outs & ~pin_mask) | (value & pin_mask));
+}
+
+static const struct sequence_io sequence_vio = {
+	.counter_get = sequence_counter_get,
+	.out_write = sequence_out_write,
+};
+
+__attribute__ ((interrupt)) void hrt_handler_sequence(void)
+{
+	/* Free running counter, reloaded every 2^16 cycles. */
+	nrf_vpr_csr_vtim_count_mode_set(SEQUENCE_COUNTER, NRF_VPR_CSR_VTIM_COUNT_RELOAD);
+	nrf_vpr_csr_vtim_simple_counter_top_set(SEQUENCE_COUNTER, UINT16_MAX);
+	nrf_vpr_csr_vtim_simple_counter_set(SEQUENCE_COUNTER, UINT16_MAX);
+
+	sequence_run(seq_arg, &sequence_vio);
+
+	nrf_vpr_csr_vtim_count_mode_set(SEQUENCE_COUNTER, NRF_VPR_CSR_VTIM_COUNT_STOP);
+}
+#endif
+
 int main(void)
 {
 	int ret = 0;
@@ -169,6 +217,9 @@ int main(void)
 	HRT_CONNECT(HRT_VEVIF_IDX_GPIO_CLEAR, hrt_handler_clear_bits);
 	HRT_CONNECT(HRT_VEVIF_IDX_GPIO_SET, hrt_handler_set_bits);
 	HRT_CONNECT(HRT_VEVIF_IDX_GPIO_TOGGLE, hrt_handler_toggle_bits);
+#if defined(CONFIG_HPF_GPIO_SEQUENCE)
+	HRT_CONNECT(HRT_VEVIF_IDX_SEQUENCE, hrt_handler_sequence);
+#endif
 
 	nrf_vpr_csr_rtperiph_enable_set(true);
 
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sequence.h"
+
+static void wait_until(const struct sequence_io *io, uint16_t *prev, uint64_t *elapsed,
+		       uint64_t deadline)
+{
+	/* The counter wraps every 2^16 cycles, it is polled more often than that,
+	 * so the difference of two reads is the time between them.
+	 */
+	while (*elapsed < deadline) {
+		uint16_t now = io->counter_get();
+
+		*elapsed += (uint16_t)(*prev - now);
+		*prev = now;
+	}
+}
+
+uint64_t sequence_run(const hpf_gpio_seq_t *seq, const struct sequence_io *io)
+{
+	uint16_t prev = io->counter_get();
+	uint64_t elapsed = 0;
+	uint64_t deadline = 0;
+
+	for (uint32_t r = 0; r < seq->repeat; r++) {
+		for (uint32_t i = 0; i < seq->step_count; i++) {
+			const hpf_gpio_seq_step_t *step = &seq->steps[i];
+
+			wait_until(io, &prev, &elapsed, deadline);
+			io->out_write(step->pin_mask, step->value);
+			deadline += step->delay;
+		}
+	}
+
+	/* Let the last step last its delay. */
+	wait_until(io, &prev, &elapsed, deadline);
+
+	return deadline;
+}
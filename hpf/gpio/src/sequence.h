@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _SEQUENCE_H__
+#define _SEQUENCE_H__
+
+#include <stdint.h>
+#include <drivers/gpio/hpf_gpio.h>
+
+/** @brief Opcode of the sequence packet.
+ *
+ *  Follows the opcodes of drivers/gpio/hpf_gpio.h, the APP driver has to use the same value.
+ *  The packet port has to be 2 and flags holds the address of a hpf_gpio_seq_t table, which
+ *  has to stay valid until the sequence ends.
+ */
+#define HPF_GPIO_SEQUENCE (HPF_GPIO_PIN_TOGGLE + 1)
+
+/** @brief Single step of a sequence. */
+typedef struct {
+	/** @brief VIO pins changed by the step. */
+	uint16_t pin_mask;
+
+	/** @brief Levels of the pins in pin_mask, other bits are ignored. */
+	uint16_t value;
+
+	/** @brief Time to the next step in FLPR clock cycles. */
+	uint32_t delay;
+} hpf_gpio_seq_step_t;
+
+/** @brief Sequence table. */
+typedef struct {
+	/** @brief Number of times the steps are replayed, at least 1. */
+	uint32_t repeat;
+
+	uint32_t step_count;
+	hpf_gpio_seq_step_t steps[];
+} hpf_gpio_seq_t;
+
+/** @brief Hardware access of the sequencer. */
+struct sequence_io {
+	/** @brief Read a free running counter, decremented every FLPR clock cycle. */
+	uint16_t (*counter_get)(void);
+
+	/** @brief Set the pins in @p pin_mask to @p value. */
+	void (*out_write)(uint16_t pin_mask, uint16_t value);
+};
+
+/** @brief Replay a sequence.
+ *
+ *  Steps are scheduled on absolute times from the start of the sequence, so the time spent
+ *  applying a step doesn't add up over the steps. A step is applied within a few counter
+ *  polls of its time, a delay shorter than that delays the next step only.
+ *
+ *  @param[in] seq Sequence table.
+ *  @param[in] io  Hardware access.
+ *
+ *  @return Total sequence time in FLPR clock cycles.
+ */
+uint64_t sequence_run(const hpf_gpio_seq_t *seq, const struct sequence_io *io);
+
+#endif /* _SEQUENCE_H__ */
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sequence.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+/* Cycles spent in a counter read and in a pin write of the simulated FLPR */
+#define POLL_CYCLES_MIN 3
+#define POLL_CYCLES_MAX 22
+#define WRITE_CYCLES    5
+
+/* Enough for the FLPR to catch up with its schedule after a late step */
+#define CATCH_UP_CYCLES (WRITE_CYCLES + 2 * POLL_CYCLES_MAX)
+
+#define MAX_STEPS  8
+#define MAX_WRITES 4000
+
+static union {
+	hpf_gpio_seq_t seq;
+	uint8_t raw[sizeof(hpf_gpio_seq_t) + MAX_STEPS * sizeof(hpf_gpio_seq_step_t)];
+} table;
+
+/* Simulated time in FLPR cycles, and the down counter it drives */
+static uint64_t now;
+static uint16_t counter_start;
+static uint64_t start_time;
+static bool started;
+
+static uint16_t pins;
+static uint64_t write_times[MAX_WRITES];
+static uint16_t write_pins[MAX_WRITES];
+static uint32_t writes;
+
+#define RAND_SEED 0x1B873593
+
+static uint32_t rand_state = RAND_SEED;
+
+static uint32_t rand32(void)
+{
+	/* xorshift32, the same sequence on every run */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+static uint16_t sim_counter_get(void)
+{
+	now += POLL_CYCLES_MIN + rand32() % (POLL_CYCLES_MAX - POLL_CYCLES_MIN + 1);
+
+	/* The schedule starts from the first read */
+	if (!started) {
+		start_time = now;
+		started = true;
+	}
+
+	return counter_start - (uint16_t)now;
+}
+
+static void sim_out_write(uint16_t pin_mask, uint16_t value)
+{
+	pins = (pins & ~pin_mask) | (value & pin_mask);
+
+	if (writes < MAX_WRITES) {
+		write_times[writes] = now;
+		write_pins[writes] = pins;
+	}
+
+	writes++;
+	now += WRITE_CYCLES;
+}
+
+static const struct sequence_io sim_io = {
+	.counter_get = sim_counter_get,
+	.out_write = sim_out_write,
+};
+
+/*
+ * Replay the table from counter value counter and check every step: pins, never early,
+ * within a poll of its time when the step before it was long enough to catch up, and the
+ * last step lasting its delay.
+ */
+static void check_sequence(const char *name, uint16_t counter)
+{
+	const hpf_gpio_seq_t *seq = &table.seq;
+	uint64_t deadline = 0;
+	uint64_t total;
+	uint16_t expected_pins = 0;
+	uint32_t late_steps = 0;
+	int64_t max_late = 0;
+	bool caught_up = true;
+
+	now = 0;
+	counter_start = counter;
+	started = false;
+	pins = 0;
+	writes = 0;
+
+	total = sequence_run(seq, &sim_io);
+
+	zassert_equal(writes, seq->repeat * seq->step_count, "%s: %u steps applied, expected %u",
+		      name, writes, seq->repeat * seq->step_count);
+	zassert_true(writes <= MAX_WRITES, "%s: %u steps applied", name, writes);
+
+	for (uint32_t i = 0; i < writes; i++) {
+		const hpf_gpio_seq_step_t *step = &seq->steps[i % seq->step_count];
+		int64_t late = (int64_t)(write_times[i] - start_time) - (int64_t)deadline;
+
+		expected_pins = (expected_pins & ~step->pin_mask) | (step->value & step->pin_mask);
+
+		if (write_pins[i] != expected_pins || late < 0 ||
+		    (caught_up && late > POLL_CYCLES_MAX)) {
+			late_steps++;
+		}
+
+		max_late = MAX(max_late, late);
+		caught_up = (step->delay >= CATCH_UP_CYCLES);
+		deadline += step->delay;
+	}
+
+	zassert_true(total == deadline && now - start_time >= deadline &&
+		     now - start_time <= deadline + POLL_CYCLES_MAX,
+		     "%s: total %llu cycles, ran %llu, expected %llu", name,
+		     (unsigned long long)total, (unsigned long long)(now - start_time),
+		     (unsigned long long)deadline);
+	zassert_equal(late_steps, 0,
+		      "%s: %u of %u steps early, late or wrong, up to %lld cycles late", name,
+		      late_steps, writes, (long long)max_late);
+
+	printk("%-14s %4u steps, %8llu cycles, up to %2lld cycles late\n", name, writes,
+	       (unsigned long long)total, (long long)max_late);
+}
+
+static void set_steps(uint32_t repeat, uint32_t step_count, const hpf_gpio_seq_step_t *steps)
+{
+	table.seq.repeat = repeat;
+	table.seq.step_count = step_count;
+	memcpy(table.seq.steps, steps, step_count * sizeof(steps[0]));
+}
+
+ZTEST(hpf_gpio_sequence, test_carrier)
+{
+	/* A 38 kHz IR carrier at 128 MHz, then a pause on an other pin longer than the
+	 * counter period.
+	 */
+	static const hpf_gpio_seq_step_t carrier[] = {
+		{BIT(0), BIT(0), 1684},
+		{BIT(0), 0, 1684},
+		{BIT(1), BIT(1), 70000},
+	};
+
+	set_steps(1000, ARRAY_SIZE(carrier), carrier);
+	check_sequence("carrier", 0x1234);
+	check_sequence("carrier wrap", 0x0003);
+}
+
+ZTEST(hpf_gpio_sequence, test_burst)
+{
+	/* Steps shorter than a pin write delay the next ones, until a long step */
+	static const hpf_gpio_seq_step_t burst[] = {
+		{BIT(2), BIT(2), 0},
+		{BIT(3), BIT(3), 1},
+		{BIT(2) | BIT(3), 0, 2},
+		{BIT(4), BIT(4), 200},
+		{BIT(4), 0, 300},
+	};
+
+	set_steps(200, ARRAY_SIZE(burst), burst);
+	check_sequence("burst", 0x8000);
+}
+
+ZTEST(hpf_gpio_sequence, test_long)
+{
+	static const hpf_gpio_seq_step_t single[] = {
+		{0xFFFF, 0xA5A5, 200000},
+	};
+
+	set_steps(3, ARRAY_SIZE(single), single);
+	check_sequence("long", 0xFFFF);
+}
+
+static void random_steps(uint32_t repeat)
+{
+	hpf_gpio_seq_step_t steps[MAX_STEPS];
+
+	/* Random pins and delays from 0 to about two counter periods */
+	for (int i = 0; i < MAX_STEPS; i++) {
+		steps[i].pin_mask = rand32();
+		steps[i].value = rand32();
+		steps[i].delay = (i % 2) ? rand32() % 140000 : rand32() % 100;
+	}
+
+	set_steps(repeat, MAX_STEPS, steps);
+}
+
+ZTEST(hpf_gpio_sequence, test_random)
+{
+	random_steps(50);
+	check_sequence("random", rand32());
+}
+
+ZTEST(hpf_gpio_sequence, test_no_repeat)
+{
+	random_steps(0);
+	check_sequence("no repeat", 0);
+}
+
+static void sequence_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	/* The same steps whatever the order the tests run in */
+	rand_state = RAND_SEED;
+}
+
+ZTEST_SUITE(hpf_gpio_sequence, NULL, NULL, sequence_before, NULL, NULL);
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _HPF_MSPI_CHAIN_H__
+#define _HPF_MSPI_CHAIN_H__
+
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+#include <drivers/mspi/hpf_mspi.h>
+
+/** @brief Opcodes of the descriptor chain protocol.
+ *
+ *  Continues hpf_mspi_opcode_t of drivers/mspi/hpf_mspi.h. That header comes with the nRF
+ *  Connect SDK and not with this sample, so the chain opcode is kept here until it is added
+ *  to that enum, after HPF_MSPI_WRONG_OPCODE. The APP driver has to use the same value.
+ */
+typedef enum {
+	/** @brief Descriptor chain message, see hpf_mspi_xfer_chain_msg_t. */
+	HPF_MSPI_XFER_CHAIN = HPF_MSPI_WRONG_OPCODE + 1,
+} hpf_mspi_chain_opcode_t;
+
+/* The opcode is sent as the first byte of the message and of the response. */
+BUILD_ASSERT(HPF_MSPI_XFER_CHAIN <= UINT8_MAX, "Chain opcode does not fit in a byte");
+
+/** @brief Single transfer of a descriptor chain. */
+typedef struct {
+	/** @brief HPF_MSPI_TX or HPF_MSPI_TXRX. */
+	hpf_mspi_opcode_t opcode;
+
+	/** @brief Transfer configuration: device, command and address lengths, dummy cycles
+	 *         and CE hold. Descriptors of the same configuration should point to the same
+	 *         structure, the FLPR only reconfigures when the pointer changes.
+	 */
+	const hpf_mspi_xfer_config_t *xfer_config;
+
+	uint32_t command;
+	uint32_t address;
+	uint32_t num_bytes;
+
+	/** @brief Data to send, or buffer for received data. */
+	uint8_t *data;
+} __packed hpf_mspi_xfer_desc_t;
+
+/** @brief Descriptor chain message.
+ *
+ *  Transfers are executed in order, the response is a single HPF_MSPI_XFER_CHAIN opcode
+ *  sent once the last one is done. Descriptors and data are passed by reference.
+ */
+typedef struct {
+	hpf_mspi_opcode_t opcode;
+	uint32_t desc_count;
+	const hpf_mspi_xfer_desc_t *desc;
+} __packed hpf_mspi_xfer_chain_msg_t;
+
+#endif /* _HPF_MSPI_CHAIN_H__ */
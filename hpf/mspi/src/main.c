@@ -5,6 +5,8 @@
  */
 
 #include "hrt/hrt.h"
+#include "hpf_mspi_chain.h"
+#include "xfer_frame.h"
 
 #include <zephyr/drivers/mspi.h>
 #include <zephyr/ipc/ipc_service.h>
@@ -35,10 +37,9 @@
 
 #define PAD_BIAS_VALUE 1
 
-#define MAX_SHIFT_COUNT 63
-
 #define DATA_PIN_UNUSED UINT8_MAX
 #define CE_PIN_UNUSED   UINT8_MAX
+#define CPP_MODE_UNSET  UINT8_MAX
 
 #define HRT_IRQ_PRIORITY    2
 #define HRT_VEVIF_IDX_READ  17
@@ -84,9 +85,11 @@ static volatile uint8_t ce_vios[DEVICES_MAX];
 static volatile uint8_t data_vios_count;
 static volatile uint8_t data_vios[DATA_PINS_MAX];
 static volatile uint8_t clk_vio;
+/* SPI mode the clock pin was last configured for by configure_clock(). */
+static uint8_t clock_cpp_mode = CPP_MODE_UNSET;
 static volatile hpf_mspi_dev_config_t hpf_mspi_devices[DEVICES_MAX];
 static volatile hpf_mspi_xfer_config_t hpf_mspi_xfer_config;
-static volatile hpf_mspi_xfer_config_t *hpf_mspi_xfer_config_ptr = &hpf_mspi_xfer_config;
+static const volatile hpf_mspi_xfer_config_t *hpf_mspi_xfer_config_ptr = &hpf_mspi_xfer_config;
 
 static volatile hrt_xfer_t xfer_params;
 
@@ -100,87 +103,18 @@ static NRF_TIMER_Type *fault_timer;
 static volatile uint32_t *cpuflpr_error_ctx_ptr =
 	(uint32_t *)DT_REG_ADDR(DT_NODELABEL(cpuflpr_error_code));
 
-static void distribute_last_word_bits(void)
-{
-	uint32_t *rx_data = (uint32_t *)xfer_params.xfer_data[HRT_FE_DATA].data;
-	uint32_t last_word = xfer_params.xfer_data[HRT_FE_DATA].last_word;
-	uint32_t word_count = xfer_params.xfer_data[HRT_FE_DATA].word_count;
-	uint32_t penultimate_word_bits =
-		xfer_params.xfer_data[HRT_FE_DATA].penultimate_word_clocks *
-		xfer_params.bus_widths.data;
-	uint32_t last_word_bits =
-		xfer_params.xfer_data[HRT_FE_DATA].last_word_clocks * xfer_params.bus_widths.data;
-	uint32_t penultimate_word_shift = BITS_IN_WORD - penultimate_word_bits;
-	/* In case when last word is too short, penultimate word has to give it 1 byte.
-	 * this is here to pass this byte back to penultimate word to avoid holes.
-	 */
-	if ((penultimate_word_shift != 0) && (word_count > 1)) {
-		rx_data[word_count - 2] = (rx_data[word_count - 2] >> penultimate_word_shift) |
-					  (last_word << penultimate_word_bits);
-		last_word = last_word >> penultimate_word_shift;
-	}
-
-	/* This is to avoid writing outside of data buffer in case when buffer_length%4 !=
-	 * 0.
-	 */
-	for (uint8_t byte = 0;
-	     byte < NRFX_CEIL_DIV(last_word_bits - penultimate_word_shift, BITS_IN_BYTE); byte++) {
-		((uint8_t *)&(rx_data[word_count - 1]))[byte] = ((uint8_t *)&last_word)[byte];
-	}
-}
-
-static void adjust_tail(volatile hrt_xfer_data_t *xfer_data, uint16_t frame_width,
-			uint32_t data_length)
+/* All lines of the bus width of an element that is sent have to be configured. */
+static void check_bus_width(volatile hrt_xfer_t *xfer, hrt_frame_element_t elem)
 {
-	if (data_length == 0) {
-		return;
-	}
-
-	/* Due to hardware limitation, it is not possible to send only 1
-	 * clock pulse.
-	 */
-	NRFX_ASSERT(data_length / frame_width >= 1);
-	NRFX_ASSERT(data_vios_count >= frame_width);
-	NRFX_ASSERT(data_length % frame_width == 0);
-
-	uint8_t last_word_length = data_length % BITS_IN_WORD;
-	uint8_t penultimate_word_length = BITS_IN_WORD;
-
-	xfer_data->word_count = NRFX_CEIL_DIV(data_length, BITS_IN_WORD);
-
-	/* Due to hardware limitations it is not possible to send only 1
-	 * clock cycle. Therefore when data_length%32==FRAME_WIDTH  last
-	 * word is sent shorter (24bits) and the remaining byte and
-	 * FRAME_WIDTH number of bits are bit is sent together.
-	 */
-	if (last_word_length == 0) {
-
-		last_word_length = BITS_IN_WORD;
-		if (xfer_data->data != NULL) {
-			xfer_data->last_word =
-				((uint32_t *)xfer_data->data)[xfer_data->word_count - 1];
-		}
-
-	} else if ((last_word_length / frame_width == 1) && (xfer_data->word_count > 1)) {
-
-		penultimate_word_length -= BITS_IN_BYTE;
-		last_word_length += BITS_IN_BYTE;
-
-		if (xfer_data->data != NULL) {
-			xfer_data->last_word =
-				((uint32_t *)xfer_data->data)[xfer_data->word_count - 2] >>
-					(BITS_IN_WORD - BITS_IN_BYTE) |
-				((uint32_t *)xfer_data->data)[xfer_data->word_count - 1]
-					<< BITS_IN_BYTE;
-		}
-	} else if (xfer_data->data == NULL) {
-		xfer_data->last_word = 0;
-	} else {
-		xfer_data->last_word = ((uint32_t *)xfer_data->data)[xfer_data->word_count - 1];
-	}
+	const uint8_t frame_widths[HRT_FE_MAX] = {
+		xfer->bus_widths.command,
+		xfer->bus_widths.address,
+		xfer->bus_widths.dummy_cycles,
+		xfer->bus_widths.data,
+	};
 
-	xfer_data->last_word_clocks = last_word_length / frame_width;
-	xfer_data->penultimate_word_clocks = penultimate_word_length / frame_width;
+	NRFX_ASSERT((xfer->xfer_data[elem].word_count == 0) ||
+		    (data_vios_count >= frame_widths[elem]));
 }
 
 static void configure_clock(enum mspi_cpp_mode cpp_mode)
@@ -216,6 +150,30 @@ static void configure_clock(enum mspi_cpp_mode cpp_mode)
 
 	nrf_vpr_csr_vio_out_set(out);
 	nrf_vpr_csr_vio_config_set(&vio_config);
+	clock_cpp_mode = cpp_mode;
+}
+
+static void xfer_config_apply(const hpf_mspi_xfer_config_t *xfer_config)
+{
+	NRFX_ASSERT(xfer_config->device_index < DEVICES_MAX);
+	/* Check if device was configured. */
+	NRFX_ASSERT(hpf_mspi_devices[xfer_config->device_index].ce_index < ce_vios_count);
+	NRFX_ASSERT(xfer_config->command_length <= sizeof(uint32_t));
+	NRFX_ASSERT(xfer_config->address_length <= sizeof(uint32_t));
+	NRFX_ASSERT(xfer_config->tx_dummy == 0 || xfer_config->command_length != 0 ||
+		    xfer_config->address_length != 0);
+
+#ifdef CONFIG_HPF_MSPI_IPC_NO_COPY
+	hpf_mspi_xfer_config_ptr = xfer_config;
+#else
+	hpf_mspi_xfer_config = *xfer_config;
+#endif
+
+	/* Tune up pad bias for frequencies above 32MHz */
+	if (hpf_mspi_devices[hpf_mspi_xfer_config_ptr->device_index].cnt0_value <=
+	    STD_PAD_BIAS_CNT0_THRESHOLD) {
+		NRF_GPIOHSPADCTRL->BIAS = PAD_BIAS_VALUE;
+	}
 }
 
 static void xfer_execute(hpf_mspi_xfer_packet_msg_t *xfer_packet, volatile uint8_t *rx_buffer)
@@ -244,66 +202,14 @@ static void xfer_execute(hpf_mspi_xfer_packet_msg_t *xfer_packet, volatile uint8
 	xfer_params.ce_polarity = device->ce_polarity;
 	xfer_params.bus_widths = io_modes[device->io_mode];
 
-	/* Fix position of command and address if command/address length is < BITS_IN_WORD,
-	 * so that leading zeros would not be printed instead of data bits.
-	 */
-	xfer_packet->command =
-		xfer_packet->command
-		<< (BITS_IN_WORD - hpf_mspi_xfer_config_ptr->command_length * BITS_IN_BYTE);
-	xfer_packet->address =
-		xfer_packet->address
-		<< (BITS_IN_WORD - hpf_mspi_xfer_config_ptr->address_length * BITS_IN_BYTE);
-
-	/* Configure command phase. */
-	xfer_params.xfer_data[HRT_FE_COMMAND].fun_out = HRT_FUN_OUT_WORD;
-	xfer_params.xfer_data[HRT_FE_COMMAND].data = (uint8_t *)&xfer_packet->command;
-	xfer_params.xfer_data[HRT_FE_COMMAND].word_count = 0;
-
-	adjust_tail(&xfer_params.xfer_data[HRT_FE_COMMAND], xfer_params.bus_widths.command,
-		    hpf_mspi_xfer_config_ptr->command_length * BITS_IN_BYTE);
-
-	/* Configure address phase. */
-	xfer_params.xfer_data[HRT_FE_ADDRESS].fun_out = HRT_FUN_OUT_WORD;
-	xfer_params.xfer_data[HRT_FE_ADDRESS].data = (uint8_t *)&xfer_packet->address;
-	xfer_params.xfer_data[HRT_FE_ADDRESS].word_count = 0;
-
-	adjust_tail(&xfer_params.xfer_data[HRT_FE_ADDRESS], xfer_params.bus_widths.address,
-		    hpf_mspi_xfer_config_ptr->address_length * BITS_IN_BYTE);
-
-	/* Configure dummy_cycles phase. */
-	xfer_params.xfer_data[HRT_FE_DUMMY_CYCLES].fun_out = HRT_FUN_OUT_WORD;
-	xfer_params.xfer_data[HRT_FE_DUMMY_CYCLES].data = NULL;
-	xfer_params.xfer_data[HRT_FE_DUMMY_CYCLES].word_count = 0;
-
-	hrt_frame_element_t elem =
-		hpf_mspi_xfer_config_ptr->address_length != 0 ? HRT_FE_ADDRESS : HRT_FE_COMMAND;
-
-	/* Up to 63 clock pulses (including data from previous part) can be sent by simply
-	 * increasing shift count of last word in the previous part.
-	 * Beyond that, dummy cycles have to be treated af different transfer part.
-	 */
-	if (xfer_params.xfer_data[elem].last_word_clocks + dummy_cycles <= MAX_SHIFT_COUNT) {
-		xfer_params.xfer_data[elem].last_word_clocks += dummy_cycles;
-	} else {
-		adjust_tail(&xfer_params.xfer_data[HRT_FE_DUMMY_CYCLES],
-			    xfer_params.bus_widths.dummy_cycles,
-			    dummy_cycles * xfer_params.bus_widths.dummy_cycles);
-	}
-
-	/* Configure data phase. */
-	xfer_params.xfer_data[HRT_FE_DATA].fun_out = HRT_FUN_OUT_BYTE;
-	xfer_params.xfer_data[HRT_FE_DATA].word_count = 0;
-	if (xfer_packet->opcode == HPF_MSPI_TXRX) {
-		xfer_params.xfer_data[HRT_FE_DATA].data = NULL;
+	xfer_frame_prepare(&xfer_params, &xfer_packet->command,
+			   hpf_mspi_xfer_config_ptr->command_length, &xfer_packet->address,
+			   hpf_mspi_xfer_config_ptr->address_length, dummy_cycles,
+			   xfer_packet->opcode == HPF_MSPI_TXRX ? rx_buffer : xfer_packet->data,
+			   xfer_packet->num_bytes, xfer_packet->opcode == HPF_MSPI_TXRX);
 
-		adjust_tail(&xfer_params.xfer_data[HRT_FE_DATA], xfer_params.bus_widths.data,
-			    xfer_packet->num_bytes * BITS_IN_BYTE);
-
-		xfer_params.xfer_data[HRT_FE_DATA].data = rx_buffer;
-	} else {
-		xfer_params.xfer_data[HRT_FE_DATA].data = xfer_packet->data;
-		adjust_tail(&xfer_params.xfer_data[HRT_FE_DATA], xfer_params.bus_widths.data,
-			    xfer_packet->num_bytes * BITS_IN_BYTE);
+	for (uint8_t elem = 0; elem < HRT_FE_MAX; elem++) {
+		check_bus_width(&xfer_params, elem);
 	}
 
 	/* Hardware issue: Additional clock edge when transmitting in modes other
@@ -334,13 +240,68 @@ static void xfer_execute(hpf_mspi_xfer_packet_msg_t *xfer_packet, volatile uint8
 	if (xfer_packet->opcode == HPF_MSPI_TXRX) {
 		nrf_vpr_clic_int_pending_set(NRF_VPRCLIC, VEVIF_IRQN(HRT_VEVIF_IDX_READ));
 
-		distribute_last_word_bits();
+		xfer_frame_distribute_last_word_bits(&xfer_params);
 
 	} else {
 		nrf_vpr_clic_int_pending_set(NRF_VPRCLIC, VEVIF_IRQN(HRT_VEVIF_IDX_WRITE));
 	}
 }
 
+#if defined(CONFIG_HPF_MSPI_XFER_CHAIN)
+static void xfer_chain_execute(hpf_mspi_xfer_chain_msg_t *chain)
+{
+	const hpf_mspi_xfer_config_t *xfer_config = NULL;
+	/* State of input selection left by a previous TXRX packet is not known. */
+	hpf_mspi_opcode_t prev_opcode = HPF_MSPI_TXRX;
+	nrf_vpr_csr_vio_config_t config;
+
+	for (uint32_t i = 0; i < chain->desc_count; i++) {
+		const hpf_mspi_xfer_desc_t *desc = &chain->desc[i];
+		hpf_mspi_xfer_packet_msg_t packet = {
+			.opcode = desc->opcode,
+			.command = desc->command,
+			.address = desc->address,
+			.num_bytes = desc->num_bytes,
+			.data = desc->data,
+		};
+		enum mspi_cpp_mode cpp;
+
+		NRFX_ASSERT((desc->opcode == HPF_MSPI_TX) || (desc->opcode == HPF_MSPI_TXRX));
+
+		if (desc->xfer_config != xfer_config) {
+			/* CE held by the previous transfer can only be released by the same
+			 * device.
+			 */
+			NRFX_ASSERT((xfer_config == NULL) || !xfer_config->hold_ce ||
+				    (xfer_config->device_index == desc->xfer_config->device_index));
+
+			xfer_config = desc->xfer_config;
+			xfer_config_apply(xfer_config);
+		}
+
+		cpp = hpf_mspi_devices[hpf_mspi_xfer_config_ptr->device_index].cpp;
+		if (cpp != clock_cpp_mode) {
+			configure_clock(cpp);
+		} else if ((prev_opcode == HPF_MSPI_TXRX) && (desc->opcode == HPF_MSPI_TX)) {
+			/* configure_clock() would clear input selection set by xfer_execute(). */
+			nrf_vpr_csr_vio_config_get(&config);
+			config.input_sel = false;
+			nrf_vpr_csr_vio_config_set(&config);
+		}
+
+		prev_opcode = desc->opcode;
+
+		if (desc->opcode == HPF_MSPI_TXRX) {
+			if (desc->num_bytes > 0) {
+				xfer_execute(&packet, desc->data);
+			}
+		} else {
+			xfer_execute(&packet, NULL);
+		}
+	}
+}
+#endif
+
 static void config_pins(hpf_mspi_pinctrl_soc_pin_msg_t *pins_cfg)
 {
 	ce_vios_count = 0;
@@ -392,6 +353,9 @@ static void config_pins(hpf_mspi_pinctrl_soc_pin_msg_t *pins_cfg)
 	}
 	nrf_vpr_csr_vio_dir_set(xfer_params.tx_direction_mask);
 
+	/* Clock pin may have changed. */
+	clock_cpp_mode = CPP_MODE_UNSET;
+
 	/* Set all devices as undefined. */
 	for (uint8_t i = 0; i < DEVICES_MAX; i++) {
 		hpf_mspi_devices[i].ce_index = CE_PIN_UNUSED;
@@ -477,29 +441,8 @@ static void ep_recv(const void *data, size_t len, void *priv)
 	case HPF_MSPI_CONFIG_XFER: {
 		hpf_mspi_xfer_config_msg_t *xfer_config = (hpf_mspi_xfer_config_msg_t *)data;
 
-		NRFX_ASSERT(xfer_config->xfer_config.device_index < DEVICES_MAX);
-		/* Check if device was configured. */
-		NRFX_ASSERT(hpf_mspi_devices[xfer_config->xfer_config.device_index].ce_index <
-			    ce_vios_count);
-		NRFX_ASSERT(xfer_config->xfer_config.command_length <= sizeof(uint32_t));
-		NRFX_ASSERT(xfer_config->xfer_config.address_length <= sizeof(uint32_t));
-		NRFX_ASSERT(xfer_config->xfer_config.tx_dummy == 0 ||
-			    xfer_config->xfer_config.command_length != 0 ||
-			    xfer_config->xfer_config.address_length != 0);
-
-#ifdef CONFIG_HPF_MSPI_IPC_NO_COPY
-		hpf_mspi_xfer_config_ptr = &xfer_config->xfer_config;
-#else
-		hpf_mspi_xfer_config = xfer_config->xfer_config;
-#endif
+		xfer_config_apply(&xfer_config->xfer_config);
 		configure_clock(hpf_mspi_devices[hpf_mspi_xfer_config_ptr->device_index].cpp);
-
-		/* Tune up pad bias for frequencies above 32MHz */
-		if (hpf_mspi_devices[hpf_mspi_xfer_config_ptr->device_index].cnt0_value <=
-		    STD_PAD_BIAS_CNT0_THRESHOLD) {
-			NRF_GPIOHSPADCTRL->BIAS = PAD_BIAS_VALUE;
-		}
-
 		break;
 	}
 	case HPF_MSPI_TX:
@@ -521,6 +464,14 @@ static void ep_recv(const void *data, size_t len, void *priv)
 		}
 		break;
 	}
+#if defined(CONFIG_HPF_MSPI_XFER_CHAIN)
+	case HPF_MSPI_XFER_CHAIN: {
+		hpf_mspi_xfer_chain_msg_t *chain = (hpf_mspi_xfer_chain_msg_t *)data;
+
+		xfer_chain_execute(chain);
+		break;
+	}
+#endif
 	default:
 		opcode = HPF_MSPI_WRONG_OPCODE;
 		break;
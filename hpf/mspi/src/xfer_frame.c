@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "xfer_frame.h"
+
+#include <stddef.h>
+#include <zephyr/sys/__assert.h>
+#include <zephyr/sys/util.h>
+
+/* Clocks of the longest word, see get_next_shift_count() in hrt.c. */
+#define MAX_SHIFT_COUNT 63
+
+uint32_t xfer_frame_align(uint32_t value, uint8_t length)
+{
+	__ASSERT_NO_MSG(length <= sizeof(uint32_t));
+
+	/* Shift by BITS_IN_WORD is undefined. */
+	if (length == 0) {
+		return value;
+	}
+
+	return value << (BITS_IN_WORD - length * BITS_IN_BYTE);
+}
+
+void xfer_frame_adjust_tail(volatile hrt_xfer_data_t *xfer_data, uint16_t frame_width,
+			    uint32_t data_length)
+{
+	if (data_length == 0) {
+		return;
+	}
+
+	/* Due to hardware limitation, it is not possible to send only 1
+	 * clock pulse.
+	 */
+	__ASSERT_NO_MSG(data_length / frame_width >= 1);
+	__ASSERT_NO_MSG(data_length % frame_width == 0);
+
+	uint8_t last_word_length = data_length % BITS_IN_WORD;
+	uint8_t penultimate_word_length = BITS_IN_WORD;
+
+	xfer_data->word_count = DIV_ROUND_UP(data_length, BITS_IN_WORD);
+
+	/* Due to hardware limitations it is not possible to send only 1
+	 * clock cycle. Therefore when data_length%32==FRAME_WIDTH  last
+	 * word is sent shorter (24bits) and the remaining byte and
+	 * FRAME_WIDTH number of bits are bit is sent together.
+	 */
+	if (last_word_length == 0) {
+
+		last_word_length = BITS_IN_WORD;
+		if (xfer_data->data != NULL) {
+			xfer_data->last_word =
+				((uint32_t *)xfer_data->data)[xfer_data->word_count - 1];
+		}
+
+	} else if ((last_word_length / frame_width == 1) && (xfer_data->word_count > 1)) {
+
+		penultimate_word_length -= BITS_IN_BYTE;
+		last_word_length += BITS_IN_BYTE;
+
+		if (xfer_data->data != NULL) {
+			xfer_data->last_word =
+				((uint32_t *)xfer_data->data)[xfer_data->word_count - 2] >>
+					(BITS_IN_WORD - BITS_IN_BYTE) |
+				((uint32_t *)xfer_data->data)[xfer_data->word_count - 1]
+					<< BITS_IN_BYTE;
+		}
+	} else if (xfer_data->data == NULL) {
+		xfer_data->last_word = 0;
+	} else {
+		xfer_data->last_word = ((uint32_t *)xfer_data->data)[xfer_data->word_count - 1];
+	}
+
+	xfer_data->last_word_clocks = last_word_length / frame_width;
+	xfer_data->penultimate_word_clocks = penultimate_word_length / frame_width;
+}
+
+void xfer_frame_prepare(volatile hrt_xfer_t *xfer, uint32_t *command, uint8_t command_length,
+			uint32_t *address, uint8_t address_length, uint16_t dummy_cycles,
+			volatile uint8_t *data, uint32_t num_bytes, bool rx)
+{
+	/* Fix position of command and address if command/address length is < BITS_IN_WORD,
+	 * so that leading zeros would not be printed instead of data bits.
+	 */
+	*command = xfer_frame_align(*command, command_length);
+	*address = xfer_frame_align(*address, address_length);
+
+	/* Configure command phase. */
+	xfer->xfer_data[HRT_FE_COMMAND].fun_out = HRT_FUN_OUT_WORD;
+	xfer->xfer_data[HRT_FE_COMMAND].data = (uint8_t *)command;
+	xfer->xfer_data[HRT_FE_COMMAND].word_count = 0;
+
+	xfer_frame_adjust_tail(&xfer->xfer_data[HRT_FE_COMMAND], xfer->bus_widths.command,
+			       command_length * BITS_IN_BYTE);
+
+	/* Configure address phase. */
+	xfer->xfer_data[HRT_FE_ADDRESS].fun_out = HRT_FUN_OUT_WORD;
+	xfer->xfer_data[HRT_FE_ADDRESS].data = (uint8_t *)address;
+	xfer->xfer_data[HRT_FE_ADDRESS].word_count = 0;
+
+	xfer_frame_adjust_tail(&xfer->xfer_data[HRT_FE_ADDRESS], xfer->bus_widths.address,
+			       address_length * BITS_IN_BYTE);
+
+	/* Configure dummy_cycles phase. */
+	xfer->xfer_data[HRT_FE_DUMMY_CYCLES].fun_out = HRT_FUN_OUT_WORD;
+	xfer->xfer_data[HRT_FE_DUMMY_CYCLES].data = NULL;
+	xfer->xfer_data[HRT_FE_DUMMY_CYCLES].word_count = 0;
+
+	hrt_frame_element_t elem = address_length != 0 ? HRT_FE_ADDRESS : HRT_FE_COMMAND;
+
+	/* Up to 63 clock pulses (including data from previous part) can be sent by simply
+	 * increasing shift count of last word in the previous part.
+	 * Beyond that, dummy cycles have to be treated af different transfer part.
+	 */
+	if (xfer->xfer_data[elem].last_word_clocks + dummy_cycles <= MAX_SHIFT_COUNT) {
+		xfer->xfer_data[elem].last_word_clocks += dummy_cycles;
+	} else {
+		xfer_frame_adjust_tail(&xfer->xfer_data[HRT_FE_DUMMY_CYCLES],
+				       xfer->bus_widths.dummy_cycles,
+				       dummy_cycles * xfer->bus_widths.dummy_cycles);
+	}
+
+	/* Configure data phase. The RX buffer is only filled in by hrt_read(). */
+	xfer->xfer_data[HRT_FE_DATA].fun_out = HRT_FUN_OUT_BYTE;
+	xfer->xfer_data[HRT_FE_DATA].word_count = 0;
+	xfer->xfer_data[HRT_FE_DATA].data = rx ? NULL : data;
+
+	xfer_frame_adjust_tail(&xfer->xfer_data[HRT_FE_DATA], xfer->bus_widths.data,
+			       num_bytes * BITS_IN_BYTE);
+
+	xfer->xfer_data[HRT_FE_DATA].data = data;
+}
+
+void xfer_frame_distribute_last_word_bits(volatile hrt_xfer_t *xfer)
+{
+	uint32_t *rx_data = (uint32_t *)xfer->xfer_data[HRT_FE_DATA].data;
+	uint32_t last_word = xfer->xfer_data[HRT_FE_DATA].last_word;
+	uint32_t word_count = xfer->xfer_data[HRT_FE_DATA].word_count;
+	uint32_t penultimate_word_bits =
+		xfer->xfer_data[HRT_FE_DATA].penultimate_word_clocks * xfer->bus_widths.data;
+	uint32_t last_word_bits =
+		xfer->xfer_data[HRT_FE_DATA].last_word_clocks * xfer->bus_widths.data;
+	uint32_t penultimate_word_shift = BITS_IN_WORD - penultimate_word_bits;
+	/* In case when last word is too short, penultimate word has to give it 1 byte.
+	 * this is here to pass this byte back to penultimate word to avoid holes.
+	 */
+	if ((penultimate_word_shift != 0) && (word_count > 1)) {
+		rx_data[word_count - 2] = (rx_data[word_count - 2] >> penultimate_word_shift) |
+					  (last_word << penultimate_word_bits);
+		last_word = last_word >> penultimate_word_shift;
+	}
+
+	/* This is to avoid writing outside of data buffer in case when buffer_length%4 !=
+	 * 0.
+	 */
+	for (uint8_t byte = 0;
+	     byte < DIV_ROUND_UP(last_word_bits - penultimate_word_shift, BITS_IN_BYTE); byte++) {
+		((uint8_t *)&(rx_data[word_count - 1]))[byte] = ((uint8_t *)&last_word)[byte];
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _XFER_FRAME_H__
+#define _XFER_FRAME_H__
+
+#include "hrt/hrt.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Align command or address to the MSB of a word.
+ *
+ *  Command and address are sent MSB first from a whole word, so a value shorter than
+ *  BITS_IN_WORD is moved up to avoid sending leading zeros instead of its bits.
+ *
+ *  @param[in] value  Command or address.
+ *  @param[in] length Length of the value in bytes, up to 4.
+ *
+ *  @return Aligned value, or @p value unchanged if @p length is 0.
+ */
+uint32_t xfer_frame_align(uint32_t value, uint8_t length);
+
+/** @brief Compute word count and clocks of the last two words of a frame element.
+ *
+ *  Due to hardware limitation the last word can not be shifted out in a single clock.
+ *  In that case the last byte of the penultimate word is moved to the last word.
+ *
+ *  @param[in,out] xfer_data   Frame element, data pointer (or NULL) has to be set.
+ *  @param[in]     frame_width Bus width of the element.
+ *  @param[in]     data_length Length of the element in bits, multiple of @p frame_width.
+ */
+void xfer_frame_adjust_tail(volatile hrt_xfer_data_t *xfer_data, uint16_t frame_width,
+			    uint32_t data_length);
+
+/** @brief Pack a packet into the frame elements of a transfer.
+ *
+ *  Aligns command and address in place, and sets the words and clocks of the command,
+ *  address, dummy cycles and data elements for the bus widths set in @p xfer. Dummy cycles
+ *  are added to the last word of the address, or of the command without address, as long as
+ *  it stays within the shift counter. Otherwise they are a separate element.
+ *
+ *  @param[in,out] xfer           Transfer, bus_widths has to be set.
+ *  @param[in,out] command        Command, has to stay valid until the transfer is done.
+ *  @param[in]     command_length Length of the command in bytes, up to 4.
+ *  @param[in,out] address        Address, has to stay valid until the transfer is done.
+ *  @param[in]     address_length Length of the address in bytes, up to 4.
+ *  @param[in]     dummy_cycles   Clocks between address and data.
+ *  @param[in]     data           Data to send, or buffer for the received data.
+ *  @param[in]     num_bytes      Length of the data in bytes.
+ *  @param[in]     rx             Data is received.
+ */
+void xfer_frame_prepare(volatile hrt_xfer_t *xfer, uint32_t *command, uint8_t command_length,
+			uint32_t *address, uint8_t address_length, uint16_t dummy_cycles,
+			volatile uint8_t *data, uint32_t num_bytes, bool rx);
+
+/** @brief Merge the received last word into the data buffer.
+ *
+ *  Undoes the split of xfer_frame_adjust_tail() for the data element of a read,
+ *  without writing past the end of the data buffer.
+ *
+ *  @param[in,out] xfer Transfer after hrt_read().
+ */
+void xfer_frame_distribute_last_word_bits(volatile hrt_xfer_t *xfer);
+
+#endif /* _XFER_FRAME_H__ */
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "xfer_frame_model.h"
+
+#include <stddef.h>
+#include <zephyr/sys/util.h>
+
+static uint8_t element_width(const volatile hrt_xfer_t *xfer, hrt_frame_element_t element)
+{
+	switch (element) {
+	case HRT_FE_COMMAND:
+		return xfer->bus_widths.command;
+	case HRT_FE_ADDRESS:
+		return xfer->bus_widths.address;
+	case HRT_FE_DUMMY_CYCLES:
+		return xfer->bus_widths.dummy_cycles;
+	default:
+		return xfer->bus_widths.data;
+	}
+}
+
+/* Clocks of word index, see hrt_tx() and get_next_shift_count(). */
+static uint8_t word_clocks(const volatile hrt_xfer_data_t *xfer_data, uint32_t index,
+			   uint8_t frame_width)
+{
+	switch (xfer_data->word_count - index) {
+	case 1:
+		return xfer_data->last_word_clocks;
+	case 2:
+		return xfer_data->penultimate_word_clocks;
+	default:
+		return BITS_IN_WORD / frame_width;
+	}
+}
+
+static uint32_t reverse_byte_bits(uint32_t word)
+{
+	word = ((word >> 1) & 0x55555555) | ((word & 0x55555555) << 1);
+	word = ((word >> 2) & 0x33333333) | ((word & 0x33333333) << 2);
+	word = ((word >> 4) & 0x0F0F0F0F) | ((word & 0x0F0F0F0F) << 4);
+
+	return word;
+}
+
+static uint32_t reverse_word_bits(uint32_t word)
+{
+	word = reverse_byte_bits(word);
+
+	return (word >> 24) | ((word >> 8) & 0xFF00) | ((word << 8) & 0xFF0000) | (word << 24);
+}
+
+static uint32_t element_write(const volatile hrt_xfer_t *xfer, hrt_frame_element_t element,
+			      xfer_frame_model_clock_t clock, void *user_data)
+{
+	const volatile hrt_xfer_data_t *xfer_data = &xfer->xfer_data[element];
+	uint8_t frame_width = element_width(xfer, element);
+	uint8_t frame_mask = BIT_MASK(frame_width);
+	uint32_t clocks = 0;
+
+	for (uint32_t i = 0; i < xfer_data->word_count; i++) {
+		uint8_t count = word_clocks(xfer_data, i, frame_width);
+		uint32_t data;
+
+		if (xfer_data->word_count - i == 1) {
+			data = xfer_data->last_word;
+		} else if (xfer_data->data == NULL) {
+			data = 0;
+		} else {
+			data = ((uint32_t *)xfer_data->data)[i];
+		}
+
+		data = (xfer_data->fun_out == HRT_FUN_OUT_WORD) ? reverse_word_bits(data)
+								  : reverse_byte_bits(data);
+
+		for (uint8_t frame = 0; frame < count; frame++) {
+			uint32_t shift = frame * frame_width;
+
+			clock(user_data, element, frame_width,
+			      (shift < BITS_IN_WORD) ? (data >> shift) & frame_mask : 0);
+		}
+
+		clocks += count;
+	}
+
+	return clocks;
+}
+
+uint32_t xfer_frame_model_write(const volatile hrt_xfer_t *xfer, xfer_frame_model_clock_t clock,
+				void *user_data)
+{
+	uint32_t clocks = 0;
+
+	for (uint8_t element = 0; element < HRT_FE_MAX; element++) {
+		clocks += element_write(xfer, element, clock, user_data);
+	}
+
+	return clocks;
+}
+
+uint32_t xfer_frame_model_read(volatile hrt_xfer_t *xfer, xfer_frame_model_clock_t clock,
+			       xfer_frame_model_sample_t sample, void *user_data)
+{
+	volatile hrt_xfer_data_t *xfer_data = &xfer->xfer_data[HRT_FE_DATA];
+	uint8_t frame_width = xfer->bus_widths.data;
+	uint8_t frame_mask = BIT_MASK(frame_width);
+	uint32_t clocks = 0;
+
+	for (uint8_t element = 0; element < HRT_FE_DATA; element++) {
+		clocks += element_write(xfer, element, clock, user_data);
+	}
+
+	for (uint32_t i = 0; i < xfer_data->word_count; i++) {
+		uint8_t count = word_clocks(xfer_data, i, frame_width);
+		uint32_t in = 0;
+
+		/* Input is shifted in from the top, a word with less clocks ends up in its
+		 * upper bits.
+		 */
+		for (uint8_t frame = 0; frame < count; frame++) {
+			clock(user_data, HRT_FE_DATA, frame_width, 0);
+			in = (in >> frame_width) |
+			     ((uint32_t)(sample(user_data, frame_width) & frame_mask)
+			      << (BITS_IN_WORD - frame_width));
+		}
+
+		clocks += count;
+		in = reverse_byte_bits(in);
+
+		if (xfer_data->word_count - i == 1) {
+			/* As read from INBRB at the end of hrt_read(). */
+			xfer_data->last_word =
+				(count * frame_width < BITS_IN_WORD)
+					? in >> (BITS_IN_WORD - count * frame_width)
+					: in;
+		} else {
+			((uint32_t *)xfer_data->data)[i] = in;
+		}
+	}
+
+	return clocks;
+}
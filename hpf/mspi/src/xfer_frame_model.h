@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _XFER_FRAME_MODEL_H__
+#define _XFER_FRAME_MODEL_H__
+
+#include "hrt/hrt.h"
+
+#include <stdint.h>
+
+/* Software model of the VIO shifter as driven by hrt_write() and hrt_read().
+ *
+ * It is not part of the FLPR image. It runs on any host, for example native_sim, to check
+ * what xfer_frame.c packs for each bus width without hardware.
+ *
+ * Every clock carries one frame of frame_width bits, and bit n of the frame is VIO line n
+ * of the bus. Out of a written word, frames are taken from bit 0 up after the reversal done
+ * by the buffered output register: bits of the whole word for HRT_FUN_OUT_WORD (MSB
+ * first), bits within each byte for HRT_FUN_OUT_BYTE (byte 0 first, MSB first). Bits
+ * beyond the word, shifted when dummy cycles were added to the last word, are 0.
+ *
+ * The CPP mode 2 and 3 workarounds of the HRT are not modelled: the clock count is the
+ * one given in xfer_data, and a read returns the same words in every mode.
+ */
+
+/** @brief Called for every clock that is driven.
+ *
+ *  @param[in] user_data   User data of the model call.
+ *  @param[in] element     Frame element the clock belongs to.
+ *  @param[in] frame_width Bus width of the element.
+ *  @param[in] frame       Bits driven on the bus lines, line n in bit n.
+ */
+typedef void (*xfer_frame_model_clock_t)(void *user_data, hrt_frame_element_t element,
+					 uint8_t frame_width, uint8_t frame);
+
+/** @brief Called for every clock of the data element of a read.
+ *
+ *  @param[in] user_data   User data of the model call.
+ *  @param[in] frame_width Bus width of the data element.
+ *
+ *  @return Bits sampled on the bus lines, line n in bit n.
+ */
+typedef uint8_t (*xfer_frame_model_sample_t)(void *user_data, uint8_t frame_width);
+
+/** @brief Model of hrt_write().
+ *
+ *  Shift out all frame elements with a non-zero word count.
+ *
+ *  @param[in] xfer      Transfer as prepared by xfer_execute().
+ *  @param[in] clock     Called for every clock.
+ *  @param[in] user_data Passed to @p clock.
+ *
+ *  @return Number of clocks.
+ */
+uint32_t xfer_frame_model_write(const volatile hrt_xfer_t *xfer, xfer_frame_model_clock_t clock,
+				void *user_data);
+
+/** @brief Model of hrt_read().
+ *
+ *  Shift out command, address and dummy cycles, then shift in the data element. Words
+ *  are stored to the data buffer and the last word to last_word as hrt_read() leaves them,
+ *  so xfer_frame_distribute_last_word_bits() has to be called afterwards.
+ *
+ *  @param[in,out] xfer      Transfer as prepared by xfer_execute().
+ *  @param[in]     clock     Called for every clock, including the data clocks.
+ *  @param[in]     sample    Called for every data clock, after @p clock.
+ *  @param[in]     user_data Passed to @p clock and @p sample.
+ *
+ *  @return Number of clocks.
+ */
+uint32_t xfer_frame_model_read(volatile hrt_xfer_t *xfer, xfer_frame_model_clock_t clock,
+			       xfer_frame_model_sample_t sample, void *user_data);
+
+#endif /* _XFER_FRAME_MODEL_H__ */
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "xfer_frame.h"
+#include "xfer_frame_model.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+/* Same as in the FLPR application. */
+static const hrt_xfer_bus_widths_t io_modes[] = {
+	{1, 1, 1, 1}, /* MSPI_IO_MODE_SINGLE */
+	{2, 2, 2, 2}, /* MSPI_IO_MODE_DUAL */
+	{1, 1, 1, 2}, /* MSPI_IO_MODE_DUAL_1_1_2 */
+	{1, 2, 2, 2}, /* MSPI_IO_MODE_DUAL_1_2_2 */
+	{4, 4, 4, 4}, /* MSPI_IO_MODE_QUAD */
+	{1, 1, 1, 4}, /* MSPI_IO_MODE_QUAD_1_1_4 */
+	{1, 4, 4, 4}, /* MSPI_IO_MODE_QUAD_1_4_4 */
+};
+
+/* Folded into the command or address, at both sides of the limit of the shift counter (8
+ * clocks of a single line command and 55 or 56), a separate element ending with a single
+ * clock on one line, or with several.
+ */
+static const uint16_t dummy_cycles_list[] = {0, 1, 8, 55, 56, 65, 100};
+
+/* Whole words, and 1 to 3 bytes in the last word. */
+static const uint32_t num_bytes_list[] = {1, 2, 3, 4, 5, 7, 8, 9, 12, 31, 32, 33, 64, 65};
+
+#define DATA_MAX_BYTES 68
+#define CLOCKS_MAX     (2 * (4 * BITS_IN_BYTE) + 100 + DATA_MAX_BYTES * BITS_IN_BYTE)
+#define GUARD_BYTE     0xEE
+
+/* Frame driven or sampled on every clock, and its bus width (0 for dummy cycles). */
+struct bus_trace {
+	uint8_t frames[CLOCKS_MAX];
+	uint8_t widths[CLOCKS_MAX];
+	uint32_t count;
+	uint32_t sampled;
+};
+
+static struct bus_trace expected;
+static struct bus_trace actual;
+static uint32_t tx_data[DATA_MAX_BYTES / sizeof(uint32_t)];
+static uint32_t rx_data[DATA_MAX_BYTES / sizeof(uint32_t)];
+
+static uint32_t rand_state = 0x2545F491;
+
+static uint8_t rand8(void)
+{
+	/* xorshift32, the same sequence on every run */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state >> 24;
+}
+
+/* Bits are sent MSB first, bit n of a clock on line n. */
+static void expect_bits(const uint8_t *bytes, uint32_t length, uint8_t frame_width)
+{
+	for (uint32_t bit = 0; bit < length * BITS_IN_BYTE; bit += frame_width) {
+		uint8_t frame = 0;
+
+		for (uint8_t line = 0; line < frame_width; line++) {
+			uint32_t n = bit + line;
+
+			frame |= ((bytes[n / BITS_IN_BYTE] >> (7 - n % BITS_IN_BYTE)) & 1) << line;
+		}
+
+		expected.frames[expected.count] = frame;
+		expected.widths[expected.count] = frame_width;
+		expected.count++;
+	}
+}
+
+static void expect_value(uint32_t value, uint8_t length, uint8_t frame_width)
+{
+	uint8_t bytes[sizeof(uint32_t)];
+
+	for (uint8_t i = 0; i < length; i++) {
+		bytes[i] = value >> ((length - 1 - i) * BITS_IN_BYTE);
+	}
+
+	expect_bits(bytes, length, frame_width);
+}
+
+static void model_clock(void *user_data, hrt_frame_element_t element, uint8_t frame_width,
+			uint8_t frame)
+{
+	struct bus_trace *trace = user_data;
+
+	if (trace->count < CLOCKS_MAX) {
+		trace->frames[trace->count] = frame;
+		trace->widths[trace->count] = frame_width;
+	}
+
+	trace->count++;
+}
+
+static uint8_t model_sample(void *user_data, uint8_t frame_width)
+{
+	struct bus_trace *trace = user_data;
+
+	/* The device drives the expected data on the clock that was just recorded. */
+	trace->frames[trace->count - 1] = expected.frames[trace->count - 1];
+	trace->sampled++;
+
+	return expected.frames[trace->count - 1];
+}
+
+/* Every word has to be at least 2 clocks, and at most what the shift counter holds. */
+static bool words_valid(const hrt_xfer_t *xfer)
+{
+	for (uint8_t element = 0; element < HRT_FE_MAX; element++) {
+		const hrt_xfer_data_t *xfer_data = &xfer->xfer_data[element];
+
+		if (xfer_data->word_count == 0) {
+			continue;
+		}
+
+		if (xfer_data->last_word_clocks < 2 || xfer_data->last_word_clocks > 63 ||
+		    (xfer_data->word_count > 1 && xfer_data->penultimate_word_clocks < 2)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool traces_match(void)
+{
+	if (actual.count != expected.count) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < expected.count; i++) {
+		if (actual.frames[i] != expected.frames[i] ||
+		    (expected.widths[i] != 0 && actual.widths[i] != expected.widths[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void check_xfer(size_t mode, uint8_t command_length, uint8_t address_length,
+		       uint16_t dummy_cycles, uint32_t num_bytes, bool rx)
+{
+	const hrt_xfer_bus_widths_t *widths = &io_modes[mode];
+	uint32_t command = 0xA5C3E10F & BIT64_MASK(command_length * BITS_IN_BYTE);
+	uint32_t address = 0x1F2E3D4C & BIT64_MASK(address_length * BITS_IN_BYTE);
+	uint8_t *rx_bytes = (uint8_t *)rx_data;
+	uint8_t *data = (uint8_t *)tx_data;
+	hrt_xfer_t xfer = {.bus_widths = *widths};
+	uint32_t clocks;
+	bool ok;
+
+	for (uint32_t i = 0; i < num_bytes; i++) {
+		data[i] = rand8();
+	}
+
+	memset(rx_data, GUARD_BYTE, sizeof(rx_data));
+	memset(&expected, 0, sizeof(expected));
+	memset(&actual, 0, sizeof(actual));
+
+	expect_value(command, command_length, widths->command);
+	expect_value(address, address_length, widths->address);
+
+	for (uint16_t i = 0; i < dummy_cycles; i++) {
+		expected.frames[expected.count] = 0;
+		expected.widths[expected.count] = 0;
+		expected.count++;
+	}
+
+	expect_bits(data, num_bytes, widths->data);
+
+	xfer_frame_prepare(&xfer, &command, command_length, &address, address_length,
+			   dummy_cycles, rx ? rx_bytes : data, num_bytes, rx);
+
+	if (rx) {
+		clocks = xfer_frame_model_read(&xfer, model_clock, model_sample, &actual);
+		xfer_frame_distribute_last_word_bits(&xfer);
+	} else {
+		clocks = xfer_frame_model_write(&xfer, model_clock, &actual);
+	}
+
+	ok = words_valid(&xfer) && clocks == actual.count && traces_match();
+
+	if (rx) {
+		/* Received bytes in order, and nothing written past the end of the buffer. */
+		ok = ok && actual.sampled == num_bytes * BITS_IN_BYTE / widths->data &&
+		     memcmp(rx_bytes, data, num_bytes) == 0;
+
+		for (uint32_t i = num_bytes; i < sizeof(rx_data); i++) {
+			ok = ok && rx_bytes[i] == GUARD_BYTE;
+		}
+	}
+
+	zassert_true(ok,
+		     "%s mode %zu, command %u, address %u, %u dummy cycles, %u bytes: "
+		     "%u clocks, expected %u",
+		     rx ? "read" : "write", mode, command_length, address_length, dummy_cycles,
+		     num_bytes, actual.count, expected.count);
+}
+
+static void check_xfers(bool rx)
+{
+	for (size_t mode = 0; mode < ARRAY_SIZE(io_modes); mode++) {
+		for (uint8_t command_length = 0; command_length <= 4; command_length++) {
+			for (uint8_t address_length = 0; address_length <= 4; address_length++) {
+				ARRAY_FOR_EACH(dummy_cycles_list, d) {
+					/* Dummy cycles need a command or an address. */
+					if (command_length == 0 && address_length == 0 &&
+					    dummy_cycles_list[d] != 0) {
+						continue;
+					}
+
+					ARRAY_FOR_EACH(num_bytes_list, n) {
+						check_xfer(mode, command_length, address_length,
+							   dummy_cycles_list[d], num_bytes_list[n],
+							   rx);
+					}
+				}
+			}
+		}
+	}
+}
+
+ZTEST(hpf_mspi_frame, test_align)
+{
+	zassert_equal(xfer_frame_align(0xAB, 1), 0xAB000000);
+	zassert_equal(xfer_frame_align(0x123456, 3), 0x12345600);
+	zassert_equal(xfer_frame_align(0x12345678, 4), 0x12345678);
+	zassert_equal(xfer_frame_align(5, 0), 5);
+}
+
+ZTEST(hpf_mspi_frame, test_write)
+{
+	check_xfers(false);
+}
+
+ZTEST(hpf_mspi_frame, test_read)
+{
+	check_xfers(true);
+}
+
+ZTEST_SUITE(hpf_mspi_frame, NULL, NULL, NULL, NULL, NULL);
@@ -12,6 +12,9 @@
 #define STRIP_NODE DT_ALIAS(led_strip)
 #define STRIP_NUM_LEDS DT_PROP(STRIP_NODE, chain_length)
 
+/* Full scale, the strip brightness is set in devicetree */
+#define RAINBOW_LEVEL 255
+
 static const struct device *strip = DEVICE_DT_GET(STRIP_NODE);
 
 int main(void)
@@ -32,11 +35,11 @@ int main(void)
 			/* Simple HSV to RGB conversion */
 			uint8_t r, g, b;
 			if (led_hue < 21845) {  /* Red to Yellow */
-				r = 32; g = (led_hue * 32) / 21845; b = 0;
+				r = RAINBOW_LEVEL; g = (led_hue * RAINBOW_LEVEL) / 21845; b = 0;
 			} else if (led_hue < 43690) {  /* Yellow to Green */
-				r = 32 - ((led_hue - 21845) * 32) / 21845; g = 32; b = 0;
+				r = RAINBOW_LEVEL - ((led_hue - 21845) * RAINBOW_LEVEL) / 21845; g = RAINBOW_LEVEL; b = 0;
 			} else {  /* Green to Blue to Red */
-				r = 0; g = 32; b = ((led_hue - 43690) * 32) / 21846;
+				r = 0; g = RAINBOW_LEVEL; b = ((led_hue - 43690) * RAINBOW_LEVEL) / 21846;
 			}
 			
 			pixels[i].r = r;
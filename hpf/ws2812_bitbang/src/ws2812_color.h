@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _WS2812_COLOR_H__
+#define _WS2812_COLOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/drivers/led_strip.h>
+
+/*
+ * Color pipeline of the FLPR WS2812 driver, from the caller's pixels to on-wire bytes in a
+ * separate buffer. Channel levels are 8.8 fixed point from the gamma LUTs to the dithering,
+ * integer only, so the output is bit-exact on every target (native_sim included).
+ */
+
+/** @brief Gamma 2.2 LUT, 8-bit level to 8.8 fixed point. */
+extern const uint16_t ws2812_color_gamma_2_2[256];
+
+/** @brief Color conversion settings of a strip. */
+struct ws2812_color {
+	/** @brief Red, green and blue LUTs from 8-bit levels to 8.8 fixed point,
+	 *         NULL for linear.
+	 */
+	const uint16_t *gamma[3];
+
+	/** @brief Global brightness, 255 for full scale, 0 for off. */
+	uint8_t brightness;
+
+	/** @brief Move the white part of red, green and blue to the white channel. */
+	bool white_extraction;
+
+	/** @brief Carry the rounding error of each channel to the next frame. */
+	bool dithering;
+};
+
+/** @brief Convert pixels to on-wire bytes.
+ *
+ *  Each channel goes through its gamma LUT and is scaled by the brightness. With
+ *  white_extraction, the smallest of red, green and blue is sent on LED_COLOR_ID_WHITE and
+ *  removed from the three others, otherwise white is 0. With dithering, the fraction lost
+ *  when rounding to 8 bits is kept in residual and added to the next frame, so levels below
+ *  one step average out over a few frames instead of being lost.
+ *
+ *  @param[in] color        Conversion settings.
+ *  @param[in] mapping      On-wire color order, LED_COLOR_ID_* values.
+ *  @param[in] num_colors   Number of channels per LED.
+ *  @param[in] pixels       Pixels, not modified.
+ *  @param[in] num_pixels   Number of pixels.
+ *  @param[in,out] residual Dithering fractions, num_pixels * num_colors bytes.
+ *  @param[out] wire        On-wire bytes, num_pixels * num_colors bytes.
+ *
+ *  @retval 0 on success.
+ *  @retval -EINVAL if the mapping holds an unknown color.
+ */
+int ws2812_color_convert(const struct ws2812_color *color, const uint8_t *mapping,
+			 uint8_t num_colors, const struct led_rgb *pixels, size_t num_pixels,
+			 uint8_t *residual, uint8_t *wire);
+
+#endif /* _WS2812_COLOR_H__ */
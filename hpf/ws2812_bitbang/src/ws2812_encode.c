@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ws2812_encode.h"
+#include "ws2812_transpose.h"
+
+uint32_t ws2812_encode(uint32_t *words, const uint8_t *buf, size_t len, size_t lane_len,
+		       uint8_t vio_pin, uint8_t lanes)
+{
+	const uint8_t frame_width = WS2812_ENCODE_FRAME_WIDTH(vio_pin, lanes);
+	const uint8_t symbol_bits = WS2812_HRT_SLOTS_PER_SYMBOL * frame_width;
+	const uint8_t word_symbols = WS2812_ENCODE_WORD_SYMBOLS(vio_pin, lanes);
+	const size_t lane0_len = (len < lane_len) ? len : lane_len;
+	uint32_t *out = words;
+	uint32_t word = 0;
+	uint8_t count = 0;
+
+	/* Lane 0 is the longest */
+	for (size_t i = 0; i < lane0_len; i++) {
+		uint8_t lane_bytes[WS2812_ENCODE_MAX_LANES] = {0};
+		uint8_t slices[8];
+		uint32_t active = 0;
+
+		for (uint8_t lane = 0; lane < lanes; lane++) {
+			size_t pos = lane * lane_len + i;
+
+			if (pos < len) {
+				lane_bytes[lane] = buf[pos];
+				active |= 1U << lane;
+			}
+		}
+
+		ws2812_transpose8(lane_bytes, slices);
+
+		for (int k = 0; k < 8; k++) {
+			uint32_t symbol = active | ((uint32_t)slices[k] << frame_width);
+
+			symbol <<= vio_pin;
+			word |= symbol << (count * symbol_bits);
+
+			if (++count == word_symbols) {
+				*out++ = word;
+				word = 0;
+				count = 0;
+			}
+		}
+	}
+
+	/* Remaining slots of the last word stay low */
+	if (count != 0) {
+		*out++ = word;
+	}
+
+	return out - words;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _WS2812_ENCODE_H__
+#define _WS2812_ENCODE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ws2812_hrt.h"
+
+/* Strips sent in parallel, one per VIO pin */
+#define WS2812_ENCODE_MAX_LANES 8
+
+/*
+ * A slot is a frame of (vio_pin + lanes) bits driving VIO 0 to the last lane, only the lane
+ * pins are configured as outputs. Low VIO pins fit more symbols in a word: one lane on
+ * VIO 0 fits 10, 8 lanes on VIO 0-7 fit 1.
+ */
+#define WS2812_ENCODE_FRAME_WIDTH(vio_pin, lanes) ((vio_pin) + (lanes))
+#define WS2812_ENCODE_WORD_SYMBOLS(vio_pin, lanes)                                                 \
+	WS2812_HRT_WORD_SYMBOLS(WS2812_ENCODE_FRAME_WIDTH(vio_pin, lanes))
+
+/** @brief Encode wire bytes into words of whole symbols.
+ *
+ *  Lane l sends bytes [l * lane_len, (l + 1) * lane_len) of buf. Every bit is one symbol
+ *  for all lanes: a high slot, the bit-slice of the lanes, a low slot. Lanes past the end
+ *  of buf don't get the high slot, so their LEDs keep their colors. Plain C, so it also
+ *  runs on native_sim or a host.
+ *
+ *  @param[out] words   Encoded words, DIV_ROUND_UP(lane_len * 8, word symbols) at most.
+ *  @param[in] buf      Wire bytes of all lanes.
+ *  @param[in] len      Size of buf, up to lanes * lane_len.
+ *  @param[in] lane_len Bytes per lane.
+ *  @param[in] vio_pin  VIO pin of the first lane.
+ *  @param[in] lanes    Number of lanes (1-8).
+ *
+ *  @return Number of words.
+ */
+uint32_t ws2812_encode(uint32_t *words, const uint8_t *buf, size_t len, size_t lane_len,
+		       uint8_t vio_pin, uint8_t lanes);
+
+#endif /* _WS2812_ENCODE_H__ */
@@ -14,105 +14,130 @@
 #include <zephyr/dt-bindings/led/led.h>
 #include <hal/nrf_vpr_csr.h>
 #include <hal/nrf_vpr_csr_vio.h>
+#include "ws2812_flpr.h"
+#include "ws2812_color.h"
+#include "ws2812_hrt.h"
+#include "ws2812_encode.h"
+#include "ws2812_wave.h"
 
 #define LOG_LEVEL CONFIG_LED_STRIP_LOG_LEVEL
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ws2812_flpr);
 
-/* 
- * WS2812 Timing Requirements (nanoseconds):
- * T0H (0 bit high): 200-500 ns (target: 350 ns)
- * T1H (1 bit high): 550-850 ns (target: 700 ns)
- * T0L (0 bit low):  650-950 ns (target: 800 ns)
- * T1L (1 bit low):  450-750 ns (target: 600 ns)
- * 
- * FLPR Core: 128 MHz RISC-V (7.8125 ns per cycle)
- * Timing in cycles:
- * T0H: 350ns / 7.8125ns = ~45 cycles
- * T1H: 700ns / 7.8125ns = ~90 cycles
- * T0L: 800ns / 7.8125ns = ~102 cycles
- * T1L: 600ns / 7.8125ns = ~77 cycles
+/*
+ * WS2812 Timing Requirements (nanoseconds, WS2812B datasheet, +-150 ns):
+ * T0H (0 bit high): 400 ns
+ * T1H (1 bit high): 800 ns
+ * T0L (0 bit low):  850 ns
+ * T1L (1 bit low):  450 ns
+ *
+ * Every bit is sent as a symbol of 3 slots of SLOT_NS, shifted out of VIO buffered output
+ * by the VPR counter (see ws2812_hrt.c): '0' is high, low, low and '1' is high, high, low.
+ * FLPR Core: 128 MHz RISC-V (7.8125 ns per cycle), a slot is 51 cycles (398 ns):
+ * T0H: 1 slot  = 398 ns
+ * T1H: 2 slots = 797 ns
+ * T0L: 2 slots = 797 ns
+ * T1L: 1 slot  = 398 ns
+ * The timing only depends on the FLPR clock, not on the compiler.
  */
 
 #define FLPR_FREQ_MHZ 128
 #define NS_TO_CYCLES(ns) (((ns) * FLPR_FREQ_MHZ) / 1000)
 
-#define CYCLES_T0H NS_TO_CYCLES(350)  /* ~45 cycles */
-#define CYCLES_T1H NS_TO_CYCLES(700)  /* ~90 cycles */
-#define CYCLES_T0L NS_TO_CYCLES(800)  /* ~102 cycles */
-#define CYCLES_T1L NS_TO_CYCLES(600)  /* ~77 cycles */
+#define SLOT_NS 400
+#define SLOT_CYCLES NS_TO_CYCLES(SLOT_NS)  /* 51 cycles */
+
+#define T0H_SLOTS 1
+#define T1H_SLOTS 2
+#define T0L_SLOTS (WS2812_HRT_SLOTS_PER_SYMBOL - T0H_SLOTS)
+#define T1L_SLOTS (WS2812_HRT_SLOTS_PER_SYMBOL - T1H_SLOTS)
+
+/* WS2812 latch time: >50us low, longer for newer WS2812B revisions */
+#define RESET_US 80
+
+/* A clock or slot change can't silently leave the datasheet windows */
+#define SLOTS_NS(slots) ((slots) * SLOT_CYCLES * 1000 / FLPR_FREQ_MHZ)
+
+BUILD_ASSERT(IN_RANGE(SLOTS_NS(T0H_SLOTS), WS2812_T0H_MIN_NS, WS2812_T0H_MAX_NS), "T0H");
+BUILD_ASSERT(IN_RANGE(SLOTS_NS(T1H_SLOTS), WS2812_T1H_MIN_NS, WS2812_T1H_MAX_NS), "T1H");
+BUILD_ASSERT(IN_RANGE(SLOTS_NS(T0L_SLOTS), WS2812_T0L_MIN_NS, WS2812_T0L_MAX_NS), "T0L");
+BUILD_ASSERT(IN_RANGE(SLOTS_NS(T1L_SLOTS), WS2812_T1L_MIN_NS, WS2812_T1L_MAX_NS), "T1L");
+BUILD_ASSERT(RESET_US >= WS2812_RESET_MIN_US, "reset latch");
 
 struct ws2812_flpr_cfg {
-	uint8_t vio_pin;        /* VIO pin number (0-15) */
+	uint8_t vio_pin;        /* VIO pin of the first lane */
+	uint8_t lanes;          /* Strips sent in parallel, on consecutive VIO pins (1-8) */
 	uint8_t num_colors;     /* Number of color channels (3 for RGB, 4 for RGBW) */
 	const uint8_t *color_mapping;
-	size_t length;          /* Number of LEDs in strip */
+	size_t length;          /* Number of LEDs in all lanes */
+	uint8_t *wire;          /* On-wire bytes, length * num_colors */
+	uint8_t *residual;      /* Dithering fractions, length * num_colors */
+	uint32_t *words;        /* Encoded strip, length / lanes * num_colors * 8 symbols */
 };
 
-/* Inline cycle-accurate delay for RISC-V */
-static inline void delay_cycles(uint32_t cycles)
-{
-	/* Simple loop: each iteration ~4 cycles (load, compare, branch, decrement) */
-	cycles = cycles / 4;
-	while (cycles--) {
-		__asm__ volatile("nop");
-	}
-}
+struct ws2812_flpr_data {
+	struct ws2812_color color;
+};
 
-/* Set VIO pin high */
-static inline void vio_pin_set(uint8_t pin)
+#if defined(CONFIG_WS2812_FLPR_WAVEFORM_CHECK)
+/* Replay the encoded words of every lane through the waveform model, and check that they
+ * decode back to the lane bytes within the datasheet windows.
+ */
+static void check_waveform(const struct ws2812_flpr_cfg *config, const ws2812_hrt_xfer_t *xfer,
+			   const uint8_t *buf, size_t len)
 {
-	nrf_vpr_csr_vio_out_set(1U << pin);
-}
+	const size_t lane_len = config->length / config->lanes * config->num_colors;
 
-/* Set VIO pin low */
-static inline void vio_pin_clear(uint8_t pin)
-{
-	uint32_t current = nrf_vpr_csr_vio_out_get();
-	nrf_vpr_csr_vio_out_set(current & ~(1U << pin));
-}
+	for (uint8_t lane = 0; lane < config->lanes; lane++) {
+		struct ws2812_wave_checker checker;
+		size_t start = MIN(lane * lane_len, len);
+		uint32_t end;
+		uint32_t errors;
 
-/* Send a single bit to WS2812 */
-static inline void send_bit(uint8_t pin, bool bit_value)
-{
-	if (bit_value) {
-		/* Send '1' bit: long high pulse, short low pulse */
-		vio_pin_set(pin);
-		delay_cycles(CYCLES_T1H);
-		vio_pin_clear(pin);
-		delay_cycles(CYCLES_T1L);
-	} else {
-		/* Send '0' bit: short high pulse, long low pulse */
-		vio_pin_set(pin);
-		delay_cycles(CYCLES_T0H);
-		vio_pin_clear(pin);
-		delay_cycles(CYCLES_T0L);
+		ws2812_wave_checker_init(&checker, FLPR_FREQ_MHZ, NULL, &buf[start],
+					 MIN(len - start, lane_len));
+
+		end = ws2812_wave_replay(xfer->words, xfer->word_count, xfer->word_slots,
+					 xfer->frame_width, config->vio_pin + lane,
+					 xfer->counter_value + 1, NULL, &checker.sink);
+
+		errors = ws2812_wave_checker_end(&checker, end, RESET_US);
+		if (errors != 0) {
+			LOG_ERR("Lane %d: %u timing, %u data errors", lane,
+				checker.timing_errors, checker.data_errors);
+		} else {
+			LOG_DBG("Lane %d: %zu bits", lane, checker.bits);
+		}
 	}
 }
+#endif
 
 /* Send buffer to WS2812 LEDs */
 static int send_buf(const struct device *dev, uint8_t *buf, size_t len)
 {
 	const struct ws2812_flpr_cfg *config = dev->config;
-	uint8_t pin = config->vio_pin;
-	unsigned int key;
-
-	/* Disable interrupts for precise timing */
-	key = irq_lock();
-
-	/* Send each byte MSB first */
-	while (len--) {
-		uint8_t byte = *buf++;
-		
-		/* Send 8 bits, MSB first */
-		for (int i = 7; i >= 0; i--) {
-			send_bit(pin, byte & (1 << i));
-		}
-	}
+	ws2812_hrt_xfer_t xfer = {
+		.words = config->words,
+		.word_slots = WS2812_ENCODE_WORD_SYMBOLS(config->vio_pin, config->lanes) *
+			      WS2812_HRT_SLOTS_PER_SYMBOL,
+		.frame_width = WS2812_ENCODE_FRAME_WIDTH(config->vio_pin, config->lanes),
+		.dir_mask = BIT_MASK(config->lanes) << config->vio_pin,
+		.counter_value = SLOT_CYCLES - 1,
+	};
+
+	xfer.word_count = ws2812_encode(config->words, buf, len,
+					config->length / config->lanes * config->num_colors,
+					config->vio_pin, config->lanes);
+
+#if defined(CONFIG_WS2812_FLPR_WAVEFORM_CHECK)
+	check_waveform(config, &xfer, buf, len);
+#endif
 
-	irq_unlock(key);
+	/* Interrupts are only locked while the transfer starts */
+	ws2812_hrt_write(&xfer);
+
+	k_busy_wait(RESET_US);
 
-	/* WS2812 latch time: >50us low - already satisfied by function return */
 	return 0;
 }
 
@@ -122,34 +147,52 @@ static int ws2812_flpr_update_rgb(const struct device *dev,
                                    size_t num_pixels)
 {
 	const struct ws2812_flpr_cfg *config = dev->config;
-	uint8_t *ptr = (uint8_t *)pixels;
-	size_t i;
-
-	/* Convert from RGB to on-wire format (e.g. GRB, GRBW, RGB, etc) */
-	for (i = 0; i < num_pixels; i++) {
-		uint8_t j;
-
-		for (j = 0; j < config->num_colors; j++) {
-			switch (config->color_mapping[j]) {
-			case LED_COLOR_ID_WHITE:
-				*ptr++ = 0;  /* White channel not supported */
-				break;
-			case LED_COLOR_ID_RED:
-				*ptr++ = pixels[i].r;
-				break;
-			case LED_COLOR_ID_GREEN:
-				*ptr++ = pixels[i].g;
-				break;
-			case LED_COLOR_ID_BLUE:
-				*ptr++ = pixels[i].b;
-				break;
-			default:
-				return -EINVAL;
-			}
-		}
+	struct ws2812_flpr_data *data = dev->data;
+	int ret;
+
+	/* The wire and encoded word buffers are sized for the chain */
+	if (num_pixels > config->length) {
+		return -EINVAL;
 	}
 
-	return send_buf(dev, (uint8_t *)pixels, num_pixels * config->num_colors);
+	/* Convert to on-wire format (e.g. GRB, GRBW, RGB, etc), pixels are left unchanged */
+	ret = ws2812_color_convert(&data->color, config->color_mapping, config->num_colors,
+				   pixels, num_pixels, config->residual, config->wire);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return send_buf(dev, config->wire, num_pixels * config->num_colors);
+}
+
+int ws2812_flpr_set_brightness(const struct device *dev, uint8_t brightness)
+{
+	struct ws2812_flpr_data *data = dev->data;
+
+	data->color.brightness = brightness;
+
+	return 0;
+}
+
+int ws2812_flpr_set_gamma(const struct device *dev, uint8_t color_id, const uint16_t *lut)
+{
+	struct ws2812_flpr_data *data = dev->data;
+
+	switch (color_id) {
+	case LED_COLOR_ID_RED:
+		data->color.gamma[0] = lut;
+		break;
+	case LED_COLOR_ID_GREEN:
+		data->color.gamma[1] = lut;
+		break;
+	case LED_COLOR_ID_BLUE:
+		data->color.gamma[2] = lut;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
 }
 
 /* Get LED strip length - LED strip API function */
@@ -171,12 +214,16 @@ static DEVICE_API(led_strip, ws2812_flpr_api) = {
 static int ws2812_flpr_##idx##_init(const struct device *dev)           \
 {                                                                       \
 	const struct ws2812_flpr_cfg *cfg = dev->config;                \
+	const struct ws2812_flpr_data *data = dev->data;                \
+	bool white = false;                                             \
 	uint8_t i;                                                      \
                                                                         \
 	/* Validate color mapping */                                    \
 	for (i = 0; i < cfg->num_colors; i++) {                         \
 		switch (cfg->color_mapping[i]) {                        \
 		case LED_COLOR_ID_WHITE:                                \
+			white = true;                                   \
+			break;                                          \
 		case LED_COLOR_ID_RED:                                  \
 		case LED_COLOR_ID_GREEN:                                \
 		case LED_COLOR_ID_BLUE:                                 \
@@ -187,28 +234,80 @@ static int ws2812_flpr_##idx##_init(const struct device *dev)           \
 		}                                                       \
 	}                                                               \
                                                                         \
-	/* Configure VIO pin as output */                               \
-	nrf_vpr_csr_vio_dir_set(1U << cfg->vio_pin);                    \
-	vio_pin_clear(cfg->vio_pin);                                    \
+	/* Extracted white would be removed from RGB and never sent */  \
+	if (data->color.white_extraction && !white) {                   \
+		LOG_ERR("%s: white extraction without a white channel", \
+			dev->name);                                     \
+		return -EINVAL;                                         \
+	}                                                               \
+                                                                        \
+	/* Configure lane VIO pins as outputs */                        \
+	nrf_vpr_csr_vio_dir_set(BIT_MASK(cfg->lanes) << cfg->vio_pin);  \
+	nrf_vpr_csr_vio_out_clear_set(BIT_MASK(cfg->lanes) << cfg->vio_pin); \
                                                                         \
-	LOG_INF("WS2812 FLPR initialized on VIO pin %d", cfg->vio_pin); \
+	LOG_INF("WS2812 FLPR initialized on VIO pin %d, %d lane(s)",    \
+		cfg->vio_pin, cfg->lanes);                              \
 	return 0;                                                       \
 }                                                                       \
                                                                         \
 static const uint8_t ws2812_flpr_##idx##_color_mapping[] =              \
 	DT_INST_PROP(idx, color_mapping);                               \
                                                                         \
+BUILD_ASSERT(IN_RANGE(DT_INST_PROP(idx, lanes), 1,                      \
+		      WS2812_ENCODE_MAX_LANES),                         \
+	     "lanes must be 1-8");                                      \
+BUILD_ASSERT(DT_INST_PROP(idx, chain_length) %                          \
+	     DT_INST_PROP(idx, lanes) == 0,                             \
+	     "chain-length must be a multiple of lanes");               \
+BUILD_ASSERT(WS2812_ENCODE_WORD_SYMBOLS(DT_INST_PROP(idx, vio_pin),     \
+					DT_INST_PROP(idx, lanes)) > 0,  \
+	     "vio-pin + lanes must be at most 10 to fit a symbol in a word"); \
+                                                                        \
+static uint8_t ws2812_flpr_##idx##_wire[                                \
+	DT_INST_PROP(idx, chain_length) *                               \
+	DT_INST_PROP_LEN(idx, color_mapping)];                          \
+                                                                        \
+static uint8_t ws2812_flpr_##idx##_residual[                            \
+	COND_CODE_1(DT_INST_PROP(idx, dithering),                       \
+		    (DT_INST_PROP(idx, chain_length) *                  \
+		     DT_INST_PROP_LEN(idx, color_mapping)), (1))];      \
+                                                                        \
+static struct ws2812_flpr_data ws2812_flpr_##idx##_data = {             \
+	.color = {                                                      \
+		.gamma = {                                              \
+			ws2812_color_gamma_2_2,                         \
+			ws2812_color_gamma_2_2,                         \
+			ws2812_color_gamma_2_2,                         \
+		},                                                      \
+		.brightness = DT_INST_PROP(idx, brightness),            \
+		.white_extraction = DT_INST_PROP(idx, white_extraction), \
+		.dithering = DT_INST_PROP(idx, dithering),              \
+	},                                                              \
+};                                                                      \
+                                                                        \
+static uint32_t ws2812_flpr_##idx##_words[                              \
+	DIV_ROUND_UP(DT_INST_PROP(idx, chain_length) /                  \
+		     DT_INST_PROP(idx, lanes) *                         \
+		     DT_INST_PROP_LEN(idx, color_mapping) * 8,          \
+		     WS2812_ENCODE_WORD_SYMBOLS(                        \
+			     DT_INST_PROP(idx, vio_pin),                \
+			     DT_INST_PROP(idx, lanes)))];               \
+                                                                        \
 static const struct ws2812_flpr_cfg ws2812_flpr_##idx##_cfg = {         \
 	.vio_pin = DT_INST_PROP(idx, vio_pin),                          \
+	.lanes = DT_INST_PROP(idx, lanes),                              \
 	.num_colors = DT_INST_PROP_LEN(idx, color_mapping),             \
 	.color_mapping = ws2812_flpr_##idx##_color_mapping,             \
 	.length = DT_INST_PROP(idx, chain_length),                      \
+	.wire = ws2812_flpr_##idx##_wire,                               \
+	.residual = ws2812_flpr_##idx##_residual,                       \
+	.words = ws2812_flpr_##idx##_words,                             \
 };                                                                      \
                                                                         \
 DEVICE_DT_INST_DEFINE(idx,                                              \
 		    ws2812_flpr_##idx##_init,                           \
 		    NULL,                                               \
-		    NULL,                                               \
+		    &ws2812_flpr_##idx##_data,                          \
 		    &ws2812_flpr_##idx##_cfg,                           \
 		    POST_KERNEL,                                        \
 		    CONFIG_LED_STRIP_INIT_PRIORITY,                     \
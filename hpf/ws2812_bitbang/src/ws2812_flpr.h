@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _WS2812_FLPR_H__
+#define _WS2812_FLPR_H__
+
+#include <stdint.h>
+#include <zephyr/device.h>
+
+/** @brief Set the global brightness of a strip.
+ *
+ *  Applied from the next led_strip_update_rgb(), after gamma correction.
+ *
+ *  @param[in] dev        WS2812 FLPR device.
+ *  @param[in] brightness Brightness, 255 for full scale.
+ *
+ *  @retval 0 on success.
+ */
+int ws2812_flpr_set_brightness(const struct device *dev, uint8_t brightness);
+
+/** @brief Set the gamma LUT of a color channel.
+ *
+ *  @param[in] dev      WS2812 FLPR device.
+ *  @param[in] color_id LED_COLOR_ID_RED, LED_COLOR_ID_GREEN or LED_COLOR_ID_BLUE.
+ *  @param[in] lut      256 entries from 8-bit levels to 8.8 fixed point (at most 255 << 8),
+ *                      NULL for linear. Must stay valid while the device is used.
+ *
+ *  @retval 0 on success.
+ *  @retval -EINVAL if color_id is not red, green or blue.
+ */
+int ws2812_flpr_set_gamma(const struct device *dev, uint8_t color_id, const uint16_t *lut);
+
+#endif /* _WS2812_FLPR_H__ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * WS2812 output engine for the nRF54L15 FLPR core, built like the hpf/mspi HRT write path:
+ * pre-encoded words are shifted out through VIO buffered output, clocked by VPR counter 0.
+ */
+
+#include "ws2812_hrt.h"
+#include <zephyr/kernel.h>
+#include <hal/nrf_vpr_csr_vio.h>
+#include <hal/nrf_vpr_csr_vtim.h>
+
+/* Hardware requirement, to get n shifts SHIFTCNTB register has to be set to n-1*/
+#define SHIFTCNTB_VALUE(shift_count) (shift_count - 1)
+
+void ws2812_hrt_write(const ws2812_hrt_xfer_t *xfer)
+{
+	nrf_vpr_csr_vio_shift_ctrl_t shift_ctrl = {
+		.shift_count = SHIFTCNTB_VALUE(xfer->word_slots),
+		.out_mode = NRF_VPR_CSR_VIO_SHIFT_OUTB,
+		.frame_width = xfer->frame_width,
+		.in_mode = NRF_VPR_CSR_VIO_MODE_IN_CONTINUOUS,
+	};
+	nrf_vpr_csr_vio_mode_out_t out_mode = {
+		.mode = NRF_VPR_CSR_VIO_SHIFT_OUTB,
+		.frame_width = xfer->frame_width,
+	};
+	uint16_t counter_value = xfer->counter_value;
+	unsigned int key;
+
+	if (xfer->word_count == 0) {
+		return;
+	}
+
+	/* Counter value 0 would not start the counter, see hrt_tx() in hpf/mspi. */
+	if (counter_value == 0) {
+		counter_value = 1;
+	}
+
+	nrf_vpr_csr_vio_dir_set(xfer->dir_mask);
+
+	nrf_vpr_csr_vtim_count_mode_set(0, NRF_VPR_CSR_VTIM_COUNT_RELOAD);
+	nrf_vpr_csr_vtim_simple_counter_top_set(0, counter_value);
+	nrf_vpr_csr_vio_mode_in_set(NRF_VPR_CSR_VIO_MODE_IN_CONTINUOUS);
+	nrf_vpr_csr_vio_mode_out_set(&out_mode);
+	nrf_vpr_csr_vio_shift_cnt_out_set(xfer->word_slots);
+	nrf_vpr_csr_vio_shift_ctrl_buffered_set(&shift_ctrl);
+
+	/* Load the first word and start the counter with the second one already in OUTB,
+	 * an interrupt here would stretch the first slot.
+	 */
+	key = irq_lock();
+
+	nrf_vpr_csr_vio_out_buffered_set(xfer->words[0]);
+	nrf_vpr_csr_vtim_simple_counter_set(0, counter_value);
+
+	if (xfer->word_count > 1) {
+		nrf_vpr_csr_vio_out_buffered_set(xfer->words[1]);
+	}
+
+	irq_unlock(key);
+
+	/* Writing OUTB stalls until the previous word was loaded into the shift register, so
+	 * from here on the core only has to write every word within one word time. Words only
+	 * hold whole symbols ending low: a late word stretches a low time, never a high one.
+	 */
+	for (uint32_t i = 2; i < xfer->word_count; i++) {
+		nrf_vpr_csr_vio_out_buffered_set(xfer->words[i]);
+	}
+
+	while (nrf_vpr_csr_vio_shift_cnt_out_get() != 0) {
+	}
+
+	nrf_vpr_csr_vtim_count_mode_set(0, NRF_VPR_CSR_VTIM_COUNT_STOP);
+
+	shift_ctrl.shift_count = SHIFTCNTB_VALUE(1);
+	shift_ctrl.out_mode = NRF_VPR_CSR_VIO_SHIFT_NONE;
+	nrf_vpr_csr_vio_shift_ctrl_buffered_set(&shift_ctrl);
+
+	/* Leave the data line low for the reset latch. */
+	nrf_vpr_csr_vio_out_clear_set(xfer->dir_mask);
+
+	/* Reset counter 0, Next transfer may be sent incorrectly if counter is not reset here. */
+	nrf_vpr_csr_vtim_simple_counter_set(0, 0);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _WS2812_HRT_H__
+#define _WS2812_HRT_H__
+
+#include <stdint.h>
+
+#define WS2812_HRT_BITS_IN_WORD 32
+
+/* Every WS2812 bit is sent as a symbol of 3 slots: high, data, low. */
+#define WS2812_HRT_SLOTS_PER_SYMBOL 3
+
+/** @brief Slots of frame_width VIO bits that fit in one output word. */
+#define WS2812_HRT_WORD_SLOTS(frame_width) (WS2812_HRT_BITS_IN_WORD / (frame_width))
+
+/** @brief Whole symbols that fit in one output word. */
+#define WS2812_HRT_WORD_SYMBOLS(frame_width)                                                       \
+	(WS2812_HRT_WORD_SLOTS(frame_width) / WS2812_HRT_SLOTS_PER_SYMBOL)
+
+/** @brief WS2812 HRT transfer parameters. */
+typedef struct {
+	/** @brief Encoded words, shifted out LSB first, frame_width bits per slot.
+	 *         A word only holds whole symbols, padded with low slots.
+	 */
+	const uint32_t *words;
+
+	/** @brief Number of words. */
+	uint32_t word_count;
+
+	/** @brief Slots shifted out of each word. */
+	uint8_t word_slots;
+
+	/** @brief Width of a slot in bits, slot bit n drives VIO n. */
+	uint8_t frame_width;
+
+	/** @brief Mask of the VIO pins driven by the transfer. */
+	uint16_t dir_mask;
+
+	/** @brief Timer value, a slot lasts counter_value + 1 FLPR cycles. */
+	uint16_t counter_value;
+} ws2812_hrt_xfer_t;
+
+/** @brief Write.
+ *
+ *  Shift encoded words out through VIO buffered output, one slot per VPR counter period.
+ *  OUTB holds the next word while the current one is shifted out, so interrupts shorter
+ *  than one word don't change the waveform. Returns once the last slot was shifted out.
+ *
+ *  @param[in] xfer Transfer parameters and data.
+ */
+void ws2812_hrt_write(const ws2812_hrt_xfer_t *xfer);
+
+#endif /* _WS2812_HRT_H__ */
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ws2812_wave.h"
+#include <stdint.h>
+
+static inline bool in_window(uint32_t ns, uint32_t min, uint32_t max)
+{
+	return (ns >= min) && (ns <= max);
+}
+
+uint32_t ws2812_wave_replay(const uint32_t *words, uint32_t word_count, uint8_t word_slots,
+			    uint8_t frame_width, uint8_t pin, uint16_t slot_cycles,
+			    const uint32_t *late_cycles, struct ws2812_wave_sink *sink)
+{
+	uint32_t cycles = 0;
+	bool level = false;
+
+	for (uint32_t i = 0; i < word_count; i++) {
+		/* The shift register waits for a late word, holding the last slot */
+		if (late_cycles != NULL && i >= 2) {
+			cycles += late_cycles[i];
+		}
+
+		/* Slots are shifted out LSB first, frame_width bits each */
+		for (uint8_t slot = 0; slot < word_slots; slot++) {
+			bool slot_level = (words[i] >> (slot * frame_width + pin)) & 1;
+
+			if (slot_level != level) {
+				level = slot_level;
+				sink->edge(sink, cycles, level);
+			}
+
+			cycles += slot_cycles;
+		}
+	}
+
+	/* The engine drives the line low after the last slot */
+	if (level) {
+		sink->edge(sink, cycles, false);
+	}
+
+	return cycles;
+}
+
+/* A bit ends: check its high and low times, decode it */
+static void check_bit(struct ws2812_wave_checker *checker, uint32_t high_ns, uint32_t low_ns,
+		      bool last)
+{
+	bool bit = high_ns > WS2812_BIT_THRESHOLD_NS;
+	size_t byte = checker->bits / 8;
+	uint8_t mask = 0x80 >> (checker->bits % 8);
+
+	if (bit) {
+		if (!in_window(high_ns, WS2812_T1H_MIN_NS, WS2812_T1H_MAX_NS) ||
+		    (!last && !in_window(low_ns, WS2812_T1L_MIN_NS, WS2812_T1L_MAX_NS))) {
+			checker->timing_errors++;
+		}
+	} else {
+		if (!in_window(high_ns, WS2812_T0H_MIN_NS, WS2812_T0H_MAX_NS) ||
+		    (!last && !in_window(low_ns, WS2812_T0L_MIN_NS, WS2812_T0L_MAX_NS))) {
+			checker->timing_errors++;
+		}
+	}
+
+	/* The low time of the last bit runs into the reset latch, it has no period */
+	if (!last) {
+		uint32_t period_ns = high_ns + low_ns;
+
+		if (period_ns < checker->min_period_ns) {
+			checker->min_period_ns = period_ns;
+		}
+		if (period_ns > checker->max_period_ns) {
+			checker->max_period_ns = period_ns;
+		}
+	}
+
+	if (byte >= checker->len) {
+		if (checker->bytes != NULL || checker->expected != NULL) {
+			checker->data_errors++;
+		}
+	} else {
+		if (checker->bytes != NULL) {
+			if (bit) {
+				checker->bytes[byte] |= mask;
+			} else {
+				checker->bytes[byte] &= ~mask;
+			}
+		}
+		if (checker->expected != NULL && (bool)(checker->expected[byte] & mask) != bit) {
+			checker->data_errors++;
+		}
+	}
+
+	checker->bits++;
+}
+
+static uint32_t cycles_to_ns(const struct ws2812_wave_checker *checker, uint32_t cycles)
+{
+	return (uint32_t)(((uint64_t)cycles * 1000) / checker->freq_mhz);
+}
+
+static void checker_edge(struct ws2812_wave_sink *sink, uint32_t cycles, bool level)
+{
+	struct ws2812_wave_checker *checker = (struct ws2812_wave_checker *)sink;
+
+	if (level == checker->level) {
+		return;
+	}
+
+	checker->level = level;
+
+	if (level) {
+		/* A rising edge ends the previous bit */
+		if (checker->started) {
+			check_bit(checker, cycles_to_ns(checker, checker->fall - checker->rise),
+				  cycles_to_ns(checker, cycles - checker->fall), false);
+		}
+		checker->started = true;
+		checker->rise = cycles;
+	} else {
+		checker->fall = cycles;
+	}
+}
+
+void ws2812_wave_checker_init(struct ws2812_wave_checker *checker, uint16_t freq_mhz,
+			      uint8_t *bytes, const uint8_t *expected, size_t len)
+{
+	*checker = (struct ws2812_wave_checker){
+		.sink = {.edge = checker_edge},
+		.freq_mhz = freq_mhz,
+		.bytes = bytes,
+		.expected = expected,
+		.len = len,
+		.min_period_ns = UINT32_MAX,
+	};
+}
+
+uint32_t ws2812_wave_checker_end(struct ws2812_wave_checker *checker, uint32_t cycles,
+				 uint32_t reset_us)
+{
+	/* A line left high never latches */
+	if (checker->level) {
+		checker->timing_errors++;
+		checker_edge(&checker->sink, cycles, false);
+	}
+
+	if (checker->started) {
+		check_bit(checker, cycles_to_ns(checker, checker->fall - checker->rise), 0, true);
+	}
+
+	if (reset_us < WS2812_RESET_MIN_US) {
+		checker->timing_errors++;
+	}
+
+	/* Every expected bit must have been sent */
+	if (checker->expected != NULL && checker->bits < checker->len * 8) {
+		checker->data_errors += checker->len * 8 - checker->bits;
+	}
+
+	return checker->timing_errors + checker->data_errors;
+}
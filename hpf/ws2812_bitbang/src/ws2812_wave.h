@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _WS2812_WAVE_H__
+#define _WS2812_WAVE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Waveform model of the WS2812 output engine and timing checker.
+ *
+ * ws2812_wave_replay() turns encoded words into the (timestamp, level) edges that the VIO
+ * buffered output would drive on one lane, and passes them to an edge sink in place of the
+ * pin. Words written late to OUTB stall the shift register with the line held, which is the
+ * only source of bit period jitter. The checker is such a sink: it decodes the edges back to
+ * bytes and checks every high and low time against the datasheet windows. Both are plain C
+ * with no hardware access, so they run on native_sim or on a host as well as on the FLPR.
+ */
+
+/* WS2812B datasheet windows, nanoseconds (nominal +-150 ns) */
+#define WS2812_T0H_MIN_NS 250
+#define WS2812_T0H_MAX_NS 550
+#define WS2812_T1H_MIN_NS 650
+#define WS2812_T1H_MAX_NS 950
+#define WS2812_T0L_MIN_NS 700
+#define WS2812_T0L_MAX_NS 1000
+#define WS2812_T1L_MIN_NS 300
+#define WS2812_T1L_MAX_NS 600
+#define WS2812_RESET_MIN_US 50
+
+/* High times above this are decoded as 1 */
+#define WS2812_BIT_THRESHOLD_NS ((WS2812_T0H_MAX_NS + WS2812_T1H_MIN_NS) / 2)
+
+/** @brief Edge sink, receives the level changes of a lane. */
+struct ws2812_wave_sink {
+	/** @brief Called for every level change.
+	 *
+	 *  @param sink   This sink.
+	 *  @param cycles Time of the edge in FLPR cycles from the start of the transfer.
+	 *  @param level  Level after the edge.
+	 */
+	void (*edge)(struct ws2812_wave_sink *sink, uint32_t cycles, bool level);
+};
+
+/** @brief Timing checker, an edge sink decoding one lane. */
+struct ws2812_wave_checker {
+	struct ws2812_wave_sink sink;
+
+	/** @brief FLPR clock in MHz, to convert edge times. */
+	uint16_t freq_mhz;
+
+	/** @brief Decoded bytes, NULL to only check the timing. */
+	uint8_t *bytes;
+
+	/** @brief Expected bytes, NULL to skip the comparison. */
+	const uint8_t *expected;
+
+	/** @brief Size of bytes and expected. */
+	size_t len;
+
+	/** @brief Decoded bits. */
+	size_t bits;
+
+	/** @brief High or low times outside their window, and a short reset latch. */
+	uint32_t timing_errors;
+
+	/** @brief Decoded bits different from expected, or past len. */
+	uint32_t data_errors;
+
+	/** @brief Shortest and longest bit period, the worst-case jitter is their difference. */
+	uint32_t min_period_ns;
+	uint32_t max_period_ns;
+
+	/* Decoder state */
+	bool level;
+	bool started;
+	uint32_t rise;
+	uint32_t fall;
+};
+
+/** @brief Replay encoded words as the edges of one lane.
+ *
+ *  The line is low before the transfer, edges are reported from the first slot. When word i
+ *  is written to OUTB late_cycles[i] cycles after word i - 1 was shifted out, the shift
+ *  register waits for it and the line keeps the level of the last slot.
+ *
+ *  @param[in] words       Encoded words, as passed to ws2812_hrt_write().
+ *  @param[in] word_count  Number of words.
+ *  @param[in] word_slots  Slots shifted out of each word.
+ *  @param[in] frame_width Width of a slot in bits.
+ *  @param[in] pin         VIO pin of the lane, bit of the slot frame.
+ *  @param[in] slot_cycles Slot length in FLPR cycles.
+ *  @param[in] late_cycles OUTB refill latency of every word in FLPR cycles, NULL if the core
+ *                         keeps up. The first two words are written before the counter
+ *                         starts, so late_cycles[0] and late_cycles[1] are ignored.
+ *  @param[in] sink        Edge sink.
+ *
+ *  @return Time in FLPR cycles at the end of the last slot.
+ */
+uint32_t ws2812_wave_replay(const uint32_t *words, uint32_t word_count, uint8_t word_slots,
+			    uint8_t frame_width, uint8_t pin, uint16_t slot_cycles,
+			    const uint32_t *late_cycles, struct ws2812_wave_sink *sink);
+
+/** @brief Reset a checker.
+ *
+ *  @param[out] checker  Checker.
+ *  @param[in] freq_mhz  FLPR clock in MHz.
+ *  @param[out] bytes    Decoded bytes, NULL to skip.
+ *  @param[in] expected  Expected bytes, NULL to skip.
+ *  @param[in] len       Size of bytes and expected.
+ */
+void ws2812_wave_checker_init(struct ws2812_wave_checker *checker, uint16_t freq_mhz,
+			      uint8_t *bytes, const uint8_t *expected, size_t len);
+
+/** @brief End the trace with the reset latch and check the last bit.
+ *
+ *  @param[in,out] checker Checker.
+ *  @param[in] cycles      Time of the end of the transfer in FLPR cycles.
+ *  @param[in] reset_us    Low time after the transfer, in microseconds.
+ *
+ *  @return Number of timing and data errors of the whole trace.
+ */
+uint32_t ws2812_wave_checker_end(struct ws2812_wave_checker *checker, uint32_t cycles,
+				 uint32_t reset_us);
+
+#endif /* _WS2812_WAVE_H__ */
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+#include <zephyr/dt-bindings/led/led.h>
+#include "ws2812_color.h"
+
+#define FULL_SCALE  (255 << 8)
+
+/* Frames over which dithering averages to the exact 8.8 level */
+#define DITHER_FRAMES 256
+
+#define NUM_PIXELS 64
+
+static const uint8_t grb[] = {LED_COLOR_ID_GREEN, LED_COLOR_ID_RED, LED_COLOR_ID_BLUE};
+static const uint8_t grbw[] = {LED_COLOR_ID_GREEN, LED_COLOR_ID_RED, LED_COLOR_ID_BLUE,
+			       LED_COLOR_ID_WHITE};
+
+static struct led_rgb pixels[NUM_PIXELS];
+static struct led_rgb pixels_copy[NUM_PIXELS];
+static uint8_t residual[NUM_PIXELS * ARRAY_SIZE(grbw)];
+static uint8_t wire[NUM_PIXELS * ARRAY_SIZE(grbw)];
+static uint32_t sums[NUM_PIXELS * ARRAY_SIZE(grbw)];
+
+static const uint8_t brightness_list[] = {0, 1, 32, 128, 254, 255};
+
+static uint32_t rand_state = 0xC0FFEE11;
+
+static uint8_t rand8(void)
+{
+	/* xorshift32, the same sequence on every run */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state >> 24;
+}
+
+static void random_pixels(void)
+{
+	for (size_t i = 0; i < NUM_PIXELS; i++) {
+		pixels[i].r = rand8();
+		pixels[i].g = rand8();
+		pixels[i].b = rand8();
+	}
+
+	memcpy(pixels_copy, pixels, sizeof(pixels));
+}
+
+static uint8_t channel(const struct led_rgb *pixel, uint8_t color)
+{
+	switch (color) {
+	case LED_COLOR_ID_RED:
+		return pixel->r;
+	case LED_COLOR_ID_GREEN:
+		return pixel->g;
+	default:
+		return pixel->b;
+	}
+}
+
+/* 8.8 levels of the gamma LUT scaled by the brightness, as the FLPR sends them */
+static void expected_levels(const struct ws2812_color *color, const struct led_rgb *pixel,
+			    const uint8_t *mapping, uint8_t num_colors, uint32_t *levels)
+{
+	uint32_t scale = color->brightness ? color->brightness + 1 : 0;
+	uint32_t rgb[3];
+	uint32_t w = 0;
+
+	for (int c = 0; c < 3; c++) {
+		uint8_t value = channel(pixel, LED_COLOR_ID_RED + c);
+		uint32_t level = (color->gamma[c] != NULL) ? color->gamma[c][value] : value << 8;
+
+		rgb[c] = level * scale / 256;
+	}
+
+	if (color->white_extraction) {
+		w = MIN(rgb[0], MIN(rgb[1], rgb[2]));
+	}
+
+	for (uint8_t j = 0; j < num_colors; j++) {
+		if (mapping[j] == LED_COLOR_ID_WHITE) {
+			levels[j] = w;
+		} else {
+			levels[j] = rgb[mapping[j] - LED_COLOR_ID_RED] - w;
+		}
+	}
+}
+
+static void convert(const struct ws2812_color *color, const uint8_t *mapping,
+		    uint8_t num_colors)
+{
+	zassert_ok(ws2812_color_convert(color, mapping, num_colors, pixels, NUM_PIXELS, residual,
+					wire));
+	zassert_mem_equal(pixels, pixels_copy, sizeof(pixels), "pixels modified");
+}
+
+/* The LUT is round(FULL_SCALE * (i / 255)^2.2), from 0 to full scale */
+ZTEST(ws2812_color, test_gamma_lut)
+{
+	for (int i = 0; i < 256; i++) {
+		long expected = lround(FULL_SCALE * pow(i / 255.0, 2.2));
+
+		zassert_equal(ws2812_color_gamma_2_2[i], expected, "gamma[%d] = %u, expected %ld",
+			      i, ws2812_color_gamma_2_2[i], expected);
+	}
+}
+
+/* Linear at full brightness sends the pixels as they are, in the mapping order */
+ZTEST(ws2812_color, test_identity)
+{
+	const struct ws2812_color color = {.brightness = 255};
+
+	for (int i = 0; i < 256; i += NUM_PIXELS) {
+		for (int p = 0; p < NUM_PIXELS; p++) {
+			pixels[p] = (struct led_rgb){.r = i + p, .g = 255 - i - p, .b = p * 4};
+		}
+
+		memcpy(pixels_copy, pixels, sizeof(pixels));
+		convert(&color, grb, ARRAY_SIZE(grb));
+
+		for (int p = 0; p < NUM_PIXELS; p++) {
+			zassert_true(wire[p * 3] == pixels[p].g && wire[p * 3 + 1] == pixels[p].r &&
+				     wire[p * 3 + 2] == pixels[p].b,
+				     "identity %u %u %u sent as %u %u %u", pixels[p].r, pixels[p].g,
+				     pixels[p].b, wire[p * 3 + 1], wire[p * 3], wire[p * 3 + 2]);
+		}
+	}
+}
+
+/* Without dithering every channel is its 8.8 level rounded to 8 bits */
+static void check_rounding(const struct ws2812_color *color, const uint8_t *mapping,
+			   uint8_t num_colors)
+{
+	random_pixels();
+	convert(color, mapping, num_colors);
+
+	for (int p = 0; p < NUM_PIXELS; p++) {
+		uint32_t levels[ARRAY_SIZE(grbw)];
+
+		expected_levels(color, &pixels[p], mapping, num_colors, levels);
+
+		for (uint8_t j = 0; j < num_colors; j++) {
+			zassert_equal(wire[p * num_colors + j], (levels[j] + 0x80) >> 8,
+				      "brightness %u, %u colors, pixel %u %u %u, channel %u: %u "
+				      "for level 0x%04x",
+				      color->brightness, num_colors, pixels[p].r, pixels[p].g,
+				      pixels[p].b, j, wire[p * num_colors + j], levels[j]);
+		}
+	}
+}
+
+/*
+ * With dithering every frame sends the level rounded down or up, and the sum of
+ * DITHER_FRAMES frames is exactly the 8.8 level: nothing is lost below one step.
+ */
+static void check_dithering(const struct ws2812_color *color, const uint8_t *mapping,
+			    uint8_t num_colors)
+{
+	const size_t count = NUM_PIXELS * num_colors;
+	uint32_t levels[NUM_PIXELS * ARRAY_SIZE(grbw)];
+
+	random_pixels();
+
+	for (int p = 0; p < NUM_PIXELS; p++) {
+		expected_levels(color, &pixels[p], mapping, num_colors, &levels[p * num_colors]);
+	}
+
+	memset(residual, 0, sizeof(residual));
+	memset(sums, 0, sizeof(sums));
+
+	for (int frame = 0; frame < DITHER_FRAMES; frame++) {
+		convert(color, mapping, num_colors);
+
+		for (size_t k = 0; k < count; k++) {
+			zassert_between_inclusive(wire[k], levels[k] >> 8, (levels[k] >> 8) + 1,
+						  "dithering, brightness %u, %u colors, channel "
+						  "%zu: %u for level 0x%04x",
+						  color->brightness, num_colors, k, wire[k],
+						  levels[k]);
+			sums[k] += wire[k];
+		}
+	}
+
+	for (size_t k = 0; k < count; k++) {
+		zassert_equal(sums[k], levels[k],
+			      "dithering, brightness %u, %u colors, channel %zu: sum %u for level "
+			      "0x%04x",
+			      color->brightness, num_colors, k, sums[k], levels[k]);
+	}
+}
+
+/*
+ * For every brightness, GRB and GRBW mappings with and without white extraction, and a
+ * linear red channel next to gamma corrected green and blue.
+ */
+ZTEST(ws2812_color, test_rounding)
+{
+	ARRAY_FOR_EACH(brightness_list, i) {
+		const uint16_t *gamma = ws2812_color_gamma_2_2;
+		struct ws2812_color color = {
+			.gamma = {gamma, gamma, gamma},
+			.brightness = brightness_list[i],
+		};
+
+		check_rounding(&color, grb, ARRAY_SIZE(grb));
+		check_rounding(&color, grbw, ARRAY_SIZE(grbw));
+		color.white_extraction = true;
+		check_rounding(&color, grbw, ARRAY_SIZE(grbw));
+
+		color.white_extraction = false;
+		color.gamma[0] = NULL;
+		check_rounding(&color, grb, ARRAY_SIZE(grb));
+	}
+}
+
+ZTEST(ws2812_color, test_dithering)
+{
+	ARRAY_FOR_EACH(brightness_list, i) {
+		const uint16_t *gamma = ws2812_color_gamma_2_2;
+		struct ws2812_color color = {
+			.gamma = {gamma, gamma, gamma},
+			.brightness = brightness_list[i],
+			.white_extraction = true,
+			.dithering = true,
+		};
+
+		check_dithering(&color, grbw, ARRAY_SIZE(grbw));
+		color.white_extraction = false;
+		check_dithering(&color, grb, ARRAY_SIZE(grb));
+
+		color.gamma[0] = NULL;
+		check_dithering(&color, grb, ARRAY_SIZE(grb));
+	}
+}
+
+/* Brightness 0 sends nothing, even for full white and with the dithering residual */
+ZTEST(ws2812_color, test_off)
+{
+	const uint16_t *gamma = ws2812_color_gamma_2_2;
+	const struct ws2812_color color = {
+		.gamma = {gamma, NULL, gamma},
+		.brightness = 0,
+		.dithering = true,
+	};
+	static const uint8_t off[NUM_PIXELS * ARRAY_SIZE(grbw)];
+
+	for (int p = 0; p < NUM_PIXELS; p++) {
+		pixels[p] = (struct led_rgb){.r = 255, .g = 255, .b = 255};
+	}
+
+	memcpy(pixels_copy, pixels, sizeof(pixels));
+	memset(residual, 0, sizeof(residual));
+
+	for (int frame = 0; frame < DITHER_FRAMES; frame++) {
+		convert(&color, grbw, ARRAY_SIZE(grbw));
+		zassert_mem_equal(wire, off, sizeof(off), "brightness 0 sent data in frame %d",
+				  frame);
+	}
+}
+
+ZTEST(ws2812_color, test_unknown_color)
+{
+	const struct ws2812_color color = {.brightness = 255};
+	const uint8_t mapping[] = {LED_COLOR_ID_GREEN, LED_COLOR_ID_RED, LED_COLOR_ID_BLUE + 1};
+
+	random_pixels();
+
+	zassert_equal(ws2812_color_convert(&color, mapping, ARRAY_SIZE(mapping), pixels,
+					   NUM_PIXELS, residual, wire),
+		      -EINVAL, "unknown color accepted");
+}
+
+ZTEST_SUITE(ws2812_color, NULL, NULL, NULL, NULL, NULL);
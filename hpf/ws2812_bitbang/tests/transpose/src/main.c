@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+#include "ws2812_encode.h"
+#include "ws2812_transpose.h"
+
+#define CHECKS     CONFIG_WS2812_TRANSPOSE_BENCH_CHECKS
+#define LANE_LEDS  CONFIG_WS2812_TRANSPOSE_BENCH_LANE_LEDS
+#define RUNS       CONFIG_WS2812_TRANSPOSE_BENCH_RUNS
+#define NUM_COLORS 3
+#define LANES      WS2812_ENCODE_MAX_LANES
+#define LANE_LEN   (LANE_LEDS * NUM_COLORS)
+
+static uint8_t buf[LANES * LANE_LEN];
+static uint32_t words[LANE_LEN * 8];
+
+static uint32_t rand_state = 0x9E3779B9;
+
+static uint32_t rand32(void)
+{
+	/* xorshift32, the same sequence on every run */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+/* Reference: bit l of out[k] is bit (7 - k) of in[l] */
+static void transpose8_naive(const uint8_t in[8], uint8_t out[8])
+{
+	for (int k = 0; k < 8; k++) {
+		out[k] = 0;
+
+		for (int lane = 0; lane < 8; lane++) {
+			out[k] |= ((in[lane] >> (7 - k)) & 1) << lane;
+		}
+	}
+}
+
+static void check_transpose(const uint8_t in[8])
+{
+	uint8_t out[8];
+	uint8_t ref[8];
+
+	ws2812_transpose8(in, out);
+	transpose8_naive(in, ref);
+
+	zassert_mem_equal(out, ref, sizeof(out),
+			  "Mismatch for %02x %02x %02x %02x %02x %02x %02x %02x", in[0], in[1],
+			  in[2], in[3], in[4], in[5], in[6], in[7]);
+}
+
+ZTEST(ws2812_transpose, test_patterns)
+{
+	static const uint8_t patterns[][8] = {
+		{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+		{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+		{0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01},
+		{0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80},
+		{0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00},
+		{0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55},
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(patterns); i++) {
+		check_transpose(patterns[i]);
+	}
+}
+
+ZTEST(ws2812_transpose, test_random)
+{
+	for (uint32_t i = 0; i < CHECKS; i++) {
+		uint32_t lo = rand32();
+		uint32_t hi = rand32();
+		uint8_t in[8];
+
+		memcpy(in, &lo, sizeof(lo));
+		memcpy(&in[4], &hi, sizeof(hi));
+		check_transpose(in);
+	}
+}
+
+static void bench_transpose(const char *name, void (*transpose)(const uint8_t *, uint8_t *))
+{
+	uint32_t best = UINT32_MAX;
+	uint8_t out[8];
+	uint32_t sum = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		uint32_t start = k_cycle_get_32();
+
+		for (size_t i = 0; i < LANE_LEN; i++) {
+			transpose(&buf[i * LANES], out);
+			sum += out[i % 8];
+		}
+
+		best = MIN(best, k_cycle_get_32() - start);
+	}
+
+	/* A transpose handles one byte of every lane, a pixel is NUM_COLORS bytes. The sum
+	 * keeps the results in use.
+	 */
+	printk("%-10s %4u cycles per %d-lane pixel (sum %u)\n", name,
+	       best * NUM_COLORS / LANE_LEN, LANES, sum);
+}
+
+static void bench_encode(void)
+{
+	uint32_t best = UINT32_MAX;
+	uint32_t word_count = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		uint32_t start = k_cycle_get_32();
+
+		word_count = ws2812_encode(words, buf, sizeof(buf), LANE_LEN, 0, LANES);
+
+		best = MIN(best, k_cycle_get_32() - start);
+	}
+
+	printk("%-10s %4u cycles per %d-lane pixel, %u cycles for %d LEDs (%u words)\n",
+	       "encode", best / LANE_LEDS, LANES, best, LANES * LANE_LEDS, word_count);
+
+	/* 8 symbols per byte of a lane, as many symbols per word as fit */
+	zassert_equal(word_count,
+		      DIV_ROUND_UP(LANE_LEN * 8, WS2812_ENCODE_WORD_SYMBOLS(0, LANES)),
+		      "%u words encoded", word_count);
+}
+
+/*
+ * Cycle counts, only meaningful on hardware: on native_sim the cycle counter only advances
+ * with simulated time.
+ */
+ZTEST(ws2812_transpose, test_bench)
+{
+	printk("%d LEDs per lane, %d runs\n", LANE_LEDS, RUNS);
+
+	for (size_t i = 0; i < sizeof(buf); i++) {
+		buf[i] = rand32();
+	}
+
+	bench_transpose("naive", transpose8_naive);
+	bench_transpose("transpose8", ws2812_transpose8);
+	bench_encode();
+}
+
+ZTEST_SUITE(ws2812_transpose, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+#include "ws2812_encode.h"
+#include "ws2812_wave.h"
+
+/* Same clock, slot and latch as ws2812_flpr.c */
+#define FLPR_FREQ_MHZ 128
+#define SLOT_CYCLES   51
+#define RESET_US      80
+
+/* 5 RGB LEDs per lane */
+#define LANE_LEN 15
+
+/* A word holds at least one symbol */
+#define MAX_WORDS (LANE_LEN * 8)
+
+static uint8_t buf[WS2812_ENCODE_MAX_LANES * LANE_LEN];
+static uint32_t words[MAX_WORDS];
+static uint32_t late[MAX_WORDS];
+
+static uint32_t rand_state = 0x12345678;
+
+static uint8_t rand8(void)
+{
+	/* xorshift32, the same sequence on every run */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state >> 24;
+}
+
+struct lane_result {
+	uint32_t timing_errors;
+	uint32_t data_errors;
+	uint32_t jitter_ns;
+};
+
+/* Replay one pin and check it against its lane bytes, an empty lane must stay low */
+static void replay_pin(uint32_t word_count, uint8_t vio_pin, uint8_t lanes, uint8_t pin,
+		       size_t len, const uint32_t *late_cycles, struct lane_result *result)
+{
+	const uint8_t frame_width = WS2812_ENCODE_FRAME_WIDTH(vio_pin, lanes);
+	const uint8_t word_slots =
+		WS2812_ENCODE_WORD_SYMBOLS(vio_pin, lanes) * WS2812_HRT_SLOTS_PER_SYMBOL;
+	struct ws2812_wave_checker checker;
+	uint8_t decoded[LANE_LEN];
+	size_t start = 0;
+	size_t lane_bytes = 0;
+	uint32_t end;
+
+	if (pin >= vio_pin) {
+		start = MIN((size_t)(pin - vio_pin) * LANE_LEN, len);
+		lane_bytes = MIN(len - start, LANE_LEN);
+	}
+
+	/* Decoding into a buffer counts any bit past lane_bytes as a data error */
+	ws2812_wave_checker_init(&checker, FLPR_FREQ_MHZ, decoded, &buf[start], lane_bytes);
+
+	end = ws2812_wave_replay(words, word_count, word_slots, frame_width, pin, SLOT_CYCLES,
+				 late_cycles, &checker.sink);
+
+	(void)ws2812_wave_checker_end(&checker, end, RESET_US);
+
+	result->timing_errors = checker.timing_errors;
+	result->data_errors = checker.data_errors;
+	result->jitter_ns = (checker.bits > 1) ? checker.max_period_ns - checker.min_period_ns : 0;
+}
+
+/* Every lane decodes to its bytes within the windows, pins below the lanes stay low */
+static void check_encode(uint8_t vio_pin, uint8_t lanes, size_t len)
+{
+	uint32_t word_count;
+
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = rand8();
+	}
+
+	word_count = ws2812_encode(words, buf, len, LANE_LEN, vio_pin, lanes);
+
+	zassert_true(word_count <= MAX_WORDS, "vio %u, %u lanes, %zu bytes: %u words", vio_pin,
+		     lanes, len, word_count);
+
+	for (uint8_t pin = 0; pin < vio_pin + lanes; pin++) {
+		struct lane_result result;
+
+		replay_pin(word_count, vio_pin, lanes, pin, len, NULL, &result);
+
+		zassert_true(result.timing_errors == 0 && result.data_errors == 0 &&
+			     result.jitter_ns == 0,
+			     "vio %u, %u lanes, %zu bytes, pin %u: %u timing, %u data errors, "
+			     "jitter %u ns",
+			     vio_pin, lanes, len, pin, result.timing_errors, result.data_errors,
+			     result.jitter_ns);
+	}
+}
+
+/* A late OUTB refill stretches the low time before the next word by exactly the delay */
+static void check_late_refill(uint32_t late_cycles, bool in_window)
+{
+	const uint32_t late_ns = late_cycles * 1000 / FLPR_FREQ_MHZ;
+	struct lane_result result;
+	uint32_t word_count;
+
+	for (size_t i = 0; i < LANE_LEN; i++) {
+		buf[i] = rand8();
+	}
+
+	word_count = ws2812_encode(words, buf, LANE_LEN, LANE_LEN, 0, 1);
+
+	memset(late, 0, sizeof(late));
+	late[word_count / 2] = late_cycles;
+
+	replay_pin(word_count, 0, 1, 0, LANE_LEN, late, &result);
+
+	zassert_equal(result.data_errors, 0, "%u cycles late refill: %u data errors",
+		      late_cycles, result.data_errors);
+	zassert_equal(result.timing_errors == 0, in_window,
+		      "%u cycles late refill: %u timing errors", late_cycles,
+		      result.timing_errors);
+	/* Periods are rounded to ns from both of their halves */
+	zassert_within(result.jitter_ns, late_ns, 2, "%u cycles late refill: jitter %u ns",
+		       late_cycles, result.jitter_ns);
+}
+
+ZTEST(ws2812_wave, test_encode)
+{
+	for (uint8_t lanes = 1; lanes <= WS2812_ENCODE_MAX_LANES; lanes++) {
+		for (uint8_t vio_pin = 0;
+		     WS2812_ENCODE_WORD_SYMBOLS(vio_pin, lanes) > 0; vio_pin++) {
+			const size_t full = lanes * LANE_LEN;
+
+			/* Full strip, last lane short, only the first lane, nothing */
+			check_encode(vio_pin, lanes, full);
+			check_encode(vio_pin, lanes, full - 1);
+			check_encode(vio_pin, lanes, LANE_LEN);
+			check_encode(vio_pin, lanes, LANE_LEN / 2);
+			check_encode(vio_pin, lanes, 0);
+		}
+	}
+}
+
+ZTEST(ws2812_wave, test_late_refill)
+{
+	/* Low times have about 200 ns of margin, 25 cycles */
+	check_late_refill(10, true);
+	check_late_refill(25, true);
+	check_late_refill(30, false);
+	check_late_refill(1000, false);
+}
+
+ZTEST_SUITE(ws2812_wave, NULL, NULL, NULL, NULL, NULL);
@@ -4,6 +4,8 @@
 
 #include "animations.h"
 #include "audio_viz.h"
+#include "fixed_point.h"
+#include "framebuffer.h"
 #include <string.h>
 #include <math.h>
 #include <zephyr/kernel.h>
@@ -11,15 +13,15 @@
 
 // Current state
 static animation_mode_t current_mode = ANIM_TEST_MODE;
-static int matrix_width = 40;
-static int matrix_height = 6;
+static int matrix_width = FB_WIDTH;
+static int matrix_height = FB_HEIGHT;
 static bool animations_ready = false;
 
 // Particle system (for gravity and rain effects)
 #define MAX_PARTICLES 40
 typedef struct {
-    float x, y;
-    float vx, vy;
+    phys_t x, y;
+    phys_t vx, vy;
     uint8_t life;
     struct led_rgb color;
 } particle_t;
@@ -28,80 +30,54 @@ static particle_t particles[MAX_PARTICLES];
 // Ripple system (for bass ripples)
 #define MAX_RIPPLES 4
 typedef struct {
-    float x, y;
-    float radius;
+    phys_t x, y;
+    phys_t radius;
     uint8_t intensity;
     bool active;
 } ripple_t;
 static ripple_t ripples[MAX_RIPPLES];
 
-// Peak hold for VU meter (now 40 columns instead of 8)
-static uint8_t peak_hold[40];
-static uint32_t peak_hold_time[40];
+// Peak hold for VU meter (one per column)
+static uint8_t peak_hold[FB_WIDTH];
+static uint32_t peak_hold_time[FB_WIDTH];
 
 // Waveform history
-#define WAVEFORM_HISTORY 40
+#define WAVEFORM_HISTORY FB_WIDTH
 static uint8_t waveform_buffer[WAVEFORM_HISTORY];
-static uint8_t waveform_idx = 0;
+static uint16_t waveform_idx = 0;
 
 // Shake detection
 static float prev_tilt_x = 0, prev_tilt_y = 0;
 static bool shake_active = false;
 static uint32_t shake_time = 0;
 
-// Helper: Convert x,y to linear index (same as main.c)
-static inline size_t xy_to_index(int x, int y) {
-    if (x < 0 || x >= matrix_width || y < 0 || y >= matrix_height) {
-        return matrix_width * matrix_height;
-    }
-    int matrix_num = x / 8;
-    int local_x = x % 8;
-    int local_y = y;
-    int matrix_offset = matrix_num * 48;
-    int pixel_in_matrix = local_y * 8 + local_x;
-    return matrix_offset + pixel_in_matrix;
-}
-
-// Helper: Set pixel with bounds checking
-static void set_pixel(struct led_rgb *pixels, int x, int y, struct led_rgb color) {
-    size_t idx = xy_to_index(x, y);
-    if (idx < (size_t)(matrix_width * matrix_height)) {
-        pixels[idx] = color;
-    }
-}
-
-// Helper: Clear all pixels
-static void clear_pixels(struct led_rgb *pixels) {
-    memset(pixels, 0, matrix_width * matrix_height * sizeof(struct led_rgb));
-}
-
 // ============================================================================
 // TEST MODE: Show column numbers and IMU tilt directions
 // ============================================================================
-static void anim_test_mode(struct led_rgb *pixels, float tilt_x, float tilt_y) {
-    clear_pixels(pixels);
+static void anim_test_mode(float tilt_x, float tilt_y) {
+    fb_clear();
     
     // Show column indicators every 5 columns (columns 0, 5, 10, 15, 20, 25, 30, 35)
     for (int x = 0; x < matrix_width; x += 5) {
         // Make column marker bright white (full 6 pixels tall)
         for (int y = 0; y < matrix_height; y++) {
-            set_pixel(pixels, x, y, (struct led_rgb){60, 60, 60});
+            fb_set_pixel(x, y, (struct led_rgb){60, 60, 60});
         }
     }
     
     // Column 0 is RED (far left)
     for (int y = 0; y < matrix_height; y++) {
-        set_pixel(pixels, 0, y, (struct led_rgb){60, 0, 0});
+        fb_set_pixel(0, y, (struct led_rgb){60, 0, 0});
     }
     
     // Column 39 is BLUE (far right)
     for (int y = 0; y < matrix_height; y++) {
-        set_pixel(pixels, matrix_width - 1, y, (struct led_rgb){0, 0, 60});
+        fb_set_pixel(matrix_width - 1, y, (struct led_rgb){0, 0, 60});
     }
     
     // Center column (20) is GREEN
     for (int y = 0; y < matrix_height; y++) {
-        set_pixel(pixels, matrix_width / 2, y, (struct led_rgb){0, 60, 0});
+        fb_set_pixel(matrix_width / 2, y, (struct led_rgb){0, 60, 0});
     }
     
     // IMU tilt_x indicator: positive tilt = cyan dot moves RIGHT
@@ -111,7 +87,7 @@ static void anim_test_mode(struct led_rgb *pixels, float tilt_x, float tilt_y) {
     if (tilt_x_clamped > 45.0f) tilt_x_clamped = 45.0f;
     int x_pos = (int)((tilt_x_clamped + 45.0f) * 30.0f / 90.0f) + 5;
     if (x_pos >= 0 && x_pos < matrix_width) {
-        set_pixel(pixels, x_pos, 2, (struct led_rgb){0, 60, 60});  // Cyan dot at row 2
+        fb_set_pixel(x_pos, 2, (struct led_rgb){0, 60, 60});  // Cyan dot at row 2
     }
     
     // IMU tilt_y indicator: positive tilt = magenta dot moves UP (toward row 0)
@@ -121,7 +97,7 @@ static void anim_test_mode(struct led_rgb *pixels, float tilt_x, float tilt_y) {
     if (tilt_y_clamped > 45.0f) tilt_y_clamped = 45.0f;
     int y_pos = (int)((45.0f - tilt_y_clamped) * 5.0f / 90.0f);
     if (y_pos >= 0 && y_pos < matrix_height) {
-        set_pixel(pixels, matrix_width / 2, y_pos, (struct led_rgb){60, 0, 60});  // Magenta at center column
+        fb_set_pixel(matrix_width / 2, y_pos, (struct led_rgb){60, 0, 60});  // Magenta at center column
     }
 }
 
@@ -159,8 +135,8 @@ static struct led_rgb hsv_to_rgb(uint8_t h, uint8_t s, uint8_t v) {
 // ============================================================================
 // ANIMATION: Spectrum Bars
 // ============================================================================
-static void anim_spectrum_bars(struct led_rgb *pixels) {
-    clear_pixels(pixels);
+static void anim_spectrum_bars(void) {
+    fb_clear();
     
     // Draw 40 frequency bars, one per column (1:1 mapping)
     for (int x = 0; x < matrix_width; x++) {
@@ -180,7 +156,7 @@ static void anim_spectrum_bars(struct led_rgb *pixels) {
         
         // Draw bar from bottom up
         for (int y = 0; y < height && y < matrix_height; y++) {
-            set_pixel(pixels, x, matrix_height - 1 - y, color);
+            fb_set_pixel(x, matrix_height - 1 - y, color);
         }
     }
 }
@@ -188,8 +164,8 @@ static void anim_spectrum_bars(struct led_rgb *pixels) {
 // ============================================================================
 // ANIMATION: VU Meter (40 columns with rainbow gradient and peak hold)
 // ============================================================================
-static void anim_vu_meter(struct led_rgb *pixels, uint32_t delta_time) {
-    clear_pixels(pixels);
+static void anim_vu_meter(uint32_t delta_time) {
+    fb_clear();
     
     // Draw 40 VU meters vertically, one per column with peak hold
     for (int x = 0; x < matrix_width; x++) {
@@ -220,12 +196,12 @@ static void anim_vu_meter(struct led_rgb *pixels, uint32_t delta_time) {
         
         // Draw bar from bottom up
         for (int y = matrix_height - height; y < matrix_height; y++) {
-            set_pixel(pixels, x, y, color);
+            fb_set_pixel(x, y, color);
         }
         
         // Peak indicator (white dot)
         if (peak_y >= 0 && peak_y < matrix_height) {
-            set_pixel(pixels, x, peak_y, (struct led_rgb){60, 60, 60});  // White peak dot
+            fb_set_pixel(x, peak_y, (struct led_rgb){60, 60, 60});  // White peak dot
         }
     }
 }
@@ -233,8 +209,8 @@ static void anim_vu_meter(struct led_rgb *pixels, uint32_t delta_time) {
 // ============================================================================
 // ANIMATION: Pulse (bass-driven expanding circle)
 // ============================================================================
-static void anim_pulse(struct led_rgb *pixels) {
-    clear_pixels(pixels);
+static void anim_pulse(void) {
+    fb_clear();
     
     uint8_t bass = audio_viz_get_bass();
     
@@ -261,7 +237,7 @@ static void anim_pulse(struct led_rgb *pixels) {
             if (dist < radius && dist > radius - 2.0f) {
                 uint8_t brightness = remapped_bass;
                 struct led_rgb color = hsv_to_rgb(160, 255, brightness); // Cyan
-                set_pixel(pixels, x, y, color);
+                fb_set_pixel(x, y, color);
             }
         }
     }
@@ -270,7 +246,7 @@ static void anim_pulse(struct led_rgb *pixels) {
     if (audio_viz_beat_detected()) {
         for (int y = cy - 1; y <= cy + 1; y++) {
             for (int x = cx - 1; x <= cx + 1; x++) {
-                set_pixel(pixels, x, y, (struct led_rgb){200, 200, 200});
+                fb_set_pixel(x, y, (struct led_rgb){200, 200, 200});
             }
         }
     }
@@ -279,8 +255,8 @@ static void anim_pulse(struct led_rgb *pixels) {
 // ============================================================================
 // ANIMATION: Waveform
 // ============================================================================
-static void anim_waveform(struct led_rgb *pixels) {
-    clear_pixels(pixels);
+static void anim_waveform(void) {
+    fb_clear();
     
     // Add new volume sample to buffer
     waveform_buffer[waveform_idx] = audio_viz_get_volume();
@@ -297,7 +273,7 @@ static void anim_waveform(struct led_rgb *pixels) {
         struct led_rgb color = hsv_to_rgb(hue, 255, 80);
         
         if (y < matrix_height) {
-            set_pixel(pixels, matrix_width - 1 - x, matrix_height - 1 - y, color);
+            fb_set_pixel(matrix_width - 1 - x, matrix_height - 1 - y, color);
         }
     }
 }
@@ -305,10 +281,8 @@ static void anim_waveform(struct led_rgb *pixels) {
 // ============================================================================
 // ANIMATION: Gravity Particles
 // ============================================================================
-static void anim_gravity_particles(struct led_rgb *pixels, float tilt_x, float tilt_y, uint32_t delta_time) {
-    clear_pixels(pixels);
-    
-    float dt = delta_time / 1000.0f;
+static void anim_gravity_particles(float tilt_x, float tilt_y, uint32_t delta_time) {
+    fb_clear();
     
     // Spawn new particles occasionally
     static uint32_t spawn_timer = 0;
@@ -319,10 +293,10 @@ static void anim_gravity_particles(struct led_rgb *pixels, float tilt_x, float t
         // Find inactive particle
         for (int i = 0; i < MAX_PARTICLES; i++) {
             if (particles[i].life == 0) {
-                particles[i].x = sys_rand32_get() % matrix_width;
-                particles[i].y = 0;
-                particles[i].vx = 0;
-                particles[i].vy = 0;
+                particles[i].x = PHYS_FROM_INT(sys_rand32_get() % matrix_width);
+                particles[i].y = PHYS(0.0f);
+                particles[i].vx = PHYS(0.0f);
+                particles[i].vy = PHYS(0.0f);
                 particles[i].life = 255;
                 uint8_t hue = sys_rand32_get() % 255;
                 particles[i].color = hsv_to_rgb(hue, 255, 40);  // Max 40 brightness
@@ -332,54 +306,54 @@ static void anim_gravity_particles(struct led_rgb *pixels, float tilt_x, float t
     }
     
     // Update and draw particles
-    float gravity_x = tilt_x * 0.3f;
-    float gravity_y = tilt_y * 0.3f;
+    phys_t gravity_x = PHYS_MUL(PHYS_FROM_FLOAT(tilt_x), PHYS(0.3f));
+    phys_t gravity_y = PHYS_MUL(PHYS_FROM_FLOAT(tilt_y), PHYS(0.3f));
     
     for (int i = 0; i < MAX_PARTICLES; i++) {
         if (particles[i].life == 0) continue;
         
-        // Apply gravity based on tilt
-        particles[i].vx += gravity_x * dt * 10.0f;
-        particles[i].vy += gravity_y * dt * 10.0f;
+        // Apply gravity based on tilt (10x gravity per second)
+        particles[i].vx = PHYS_ADD(particles[i].vx, PHYS_MUL_DIV(gravity_x, delta_time, 100));
+        particles[i].vy = PHYS_ADD(particles[i].vy, PHYS_MUL_DIV(gravity_y, delta_time, 100));
         
         // Update position
-        particles[i].x += particles[i].vx * dt;
-        particles[i].y += particles[i].vy * dt;
+        particles[i].x = PHYS_ADD(particles[i].x, PHYS_MUL_DIV(particles[i].vx, delta_time, 1000));
+        particles[i].y = PHYS_ADD(particles[i].y, PHYS_MUL_DIV(particles[i].vy, delta_time, 1000));
         
         // Bounce off edges
-        if (particles[i].x < 0) {
-            particles[i].x = 0;
-            particles[i].vx = -particles[i].vx * 0.7f;
+        if (particles[i].x < PHYS(0.0f)) {
+            particles[i].x = PHYS(0.0f);
+            particles[i].vx = PHYS_MUL(PHYS_NEG(particles[i].vx), PHYS(0.7f));
         }
-        if (particles[i].x >= matrix_width) {
-            particles[i].x = matrix_width - 1;
-            particles[i].vx = -particles[i].vx * 0.7f;
+        if (particles[i].x >= PHYS_FROM_INT(matrix_width)) {
+            particles[i].x = PHYS_FROM_INT(matrix_width - 1);
+            particles[i].vx = PHYS_MUL(PHYS_NEG(particles[i].vx), PHYS(0.7f));
         }
-        if (particles[i].y < 0) {
-            particles[i].y = 0;
-            particles[i].vy = -particles[i].vy * 0.7f;
+        if (particles[i].y < PHYS(0.0f)) {
+            particles[i].y = PHYS(0.0f);
+            particles[i].vy = PHYS_MUL(PHYS_NEG(particles[i].vy), PHYS(0.7f));
         }
-        if (particles[i].y >= matrix_height) {
-            particles[i].y = matrix_height - 1;
-            particles[i].vy = -particles[i].vy * 0.7f;
+        if (particles[i].y >= PHYS_FROM_INT(matrix_height)) {
+            particles[i].y = PHYS_FROM_INT(matrix_height - 1);
+            particles[i].vy = PHYS_MUL(PHYS_NEG(particles[i].vy), PHYS(0.7f));
         }
         
         // Friction
-        particles[i].vx *= 0.98f;
-        particles[i].vy *= 0.98f;
+        particles[i].vx = PHYS_MUL(particles[i].vx, PHYS(0.98f));
+        particles[i].vy = PHYS_MUL(particles[i].vy, PHYS(0.98f));
         
         // Draw particle
-        int px = (int)particles[i].x;
-        int py = (int)particles[i].y;
-        set_pixel(pixels, px, py, particles[i].color);
+        int px = PHYS_TRUNC(particles[i].x);
+        int py = PHYS_TRUNC(particles[i].y);
+        fb_set_pixel(px, py, particles[i].color);
     }
 }
 
 // ============================================================================
 // ANIMATION: Tilt Gradient
 // ============================================================================
-static void anim_tilt_gradient(struct led_rgb *pixels, float tilt_x, float tilt_y) {
-    clear_pixels(pixels);
+static void anim_tilt_gradient(float tilt_x, float tilt_y) {
+    fb_clear();
     
     // Create color gradient based on tilt direction
     float angle = atan2f(tilt_y, tilt_x);
@@ -400,7 +374,7 @@ static void anim_tilt_gradient(struct led_rgb *pixels, float tilt_x, float tilt_
             uint8_t hue = base_hue + (uint8_t)(angle_diff * 30.0f);
             
             struct led_rgb color = hsv_to_rgb(hue, 255, brightness / 3);
-            set_pixel(pixels, x, y, color);
+            fb_set_pixel(x, y, color);
         }
     }
 }
@@ -408,7 +382,7 @@ static void anim_tilt_gradient(struct led_rgb *pixels, float tilt_x, float tilt_
 // ============================================================================
 // ANIMATION: Shake Burst
 // ============================================================================
-static void anim_shake_burst(struct led_rgb *pixels, float tilt_x, float tilt_y, uint32_t delta_time) {
+static void anim_shake_burst(float tilt_x, float tilt_y, uint32_t delta_time) {
     // Detect shake (rapid tilt change)
     float delta_tilt = fabsf(tilt_x - prev_tilt_x) + fabsf(tilt_y - prev_tilt_y);
     prev_tilt_x = tilt_x;
@@ -420,12 +394,12 @@ static void anim_shake_burst(struct led_rgb *pixels, float tilt_x, float tilt_y,
         
         // Spawn particles in all directions
         for (int i = 0; i < MAX_PARTICLES; i++) {
-            particles[i].x = matrix_width / 2.0f;
-            particles[i].y = matrix_height / 2.0f;
-            float angle = (i * 6.28318f) / MAX_PARTICLES;
-            float speed = 5.0f + (sys_rand32_get() % 50) / 10.0f;
-            particles[i].vx = cosf(angle) * speed;
-            particles[i].vy = sinf(angle) * speed;
+            particles[i].x = PHYS_MUL_DIV(PHYS_FROM_INT(matrix_width), 1, 2);
+            particles[i].y = PHYS_MUL_DIV(PHYS_FROM_INT(matrix_height), 1, 2);
+            phys_angle_t angle = PHYS_ANGLE_TURN(i, MAX_PARTICLES);
+            phys_t speed = PHYS_ADD(PHYS(5.0f), PHYS_MUL_DIV(PHYS(1.0f), sys_rand32_get() % 50, 10));
+            particles[i].vx = PHYS_MUL(PHYS_COS(angle), speed);
+            particles[i].vy = PHYS_MUL(PHYS_SIN(angle), speed);
             particles[i].life = 255;
             uint8_t hue = (i * 255) / MAX_PARTICLES;
             particles[i].color = hsv_to_rgb(hue, 255, 50);  // Max 50 brightness
@@ -439,30 +413,28 @@ static void anim_shake_burst(struct led_rgb *pixels, float tilt_x, float tilt_y,
         }
     }
     
-    clear_pixels(pixels);
+    fb_clear();
     
     if (shake_active) {
-        float dt = delta_time / 1000.0f;
-        
         // Update particles
         for (int i = 0; i < MAX_PARTICLES; i++) {
-            particles[i].x += particles[i].vx * dt;
-            particles[i].y += particles[i].vy * dt;
+            particles[i].x = PHYS_ADD(particles[i].x, PHYS_MUL_DIV(particles[i].vx, delta_time, 1000));
+            particles[i].y = PHYS_ADD(particles[i].y, PHYS_MUL_DIV(particles[i].vy, delta_time, 1000));
             
             // Fade out
             if (particles[i].life > 5) {
                 particles[i].life -= 5;
             }
             
-            int px = (int)particles[i].x;
-            int py = (int)particles[i].y;
+            int px = PHYS_TRUNC(particles[i].x);
+            int py = PHYS_TRUNC(particles[i].y);
             
             if (px >= 0 && px < matrix_width && py >= 0 && py < matrix_height) {
                 struct led_rgb color = particles[i].color;
                 color.r = (color.r * particles[i].life) / 255;
                 color.g = (color.g * particles[i].life) / 255;
                 color.b = (color.b * particles[i].life) / 255;
-                set_pixel(pixels, px, py, color);
+                fb_set_pixel(px, py, color);
             }
         }
     }
@@ -471,16 +443,9 @@ static void anim_shake_burst(struct led_rgb *pixels, float tilt_x, float tilt_y,
 // ============================================================================
 // ANIMATION: Audio Rain
 // ============================================================================
-static void anim_audio_rain(struct led_rgb *pixels, uint32_t delta_time) {
+static void anim_audio_rain(uint32_t delta_time) {
     // Fade existing pixels
-    for (int i = 0; i < matrix_width * matrix_height; i++) {
-        if (pixels[i].r > 10) pixels[i].r -= 10;
-        else pixels[i].r = 0;
-        if (pixels[i].g > 10) pixels[i].g -= 10;
-        else pixels[i].g = 0;
-        if (pixels[i].b > 10) pixels[i].b -= 10;
-        else pixels[i].b = 0;
-    }
+    fb_fade(10);
     
     // Spawn new rain drops based on audio
     uint8_t volume = audio_viz_get_volume();
@@ -489,25 +454,23 @@ static void anim_audio_rain(struct led_rgb *pixels, uint32_t delta_time) {
         uint8_t hue = (x * 255) / matrix_width;
         uint8_t brightness = (volume > 60) ? 60 : volume;  // Cap to 60
         struct led_rgb color = hsv_to_rgb(hue, 255, brightness);
-        set_pixel(pixels, x, 0, color);
+        fb_set_pixel(x, 0, color);
     }
 }
 
 // ============================================================================
 // ANIMATION: Bass Ripple
 // ============================================================================
-static void anim_bass_ripple(struct led_rgb *pixels, uint32_t delta_time) {
-    clear_pixels(pixels);
-    
-    float dt = delta_time / 1000.0f;
+static void anim_bass_ripple(uint32_t delta_time) {
+    fb_clear();
     
     // Spawn new ripple on beat
     if (audio_viz_beat_detected()) {
         for (int i = 0; i < MAX_RIPPLES; i++) {
             if (!ripples[i].active) {
-                ripples[i].x = matrix_width / 2.0f;
-                ripples[i].y = matrix_height / 2.0f;
-                ripples[i].radius = 0;
+                ripples[i].x = PHYS_MUL_DIV(PHYS_FROM_INT(matrix_width), 1, 2);
+                ripples[i].y = PHYS_MUL_DIV(PHYS_FROM_INT(matrix_height), 1, 2);
+                ripples[i].radius = PHYS(0.0f);
                 ripples[i].intensity = 255;
                 ripples[i].active = true;
                 break;
@@ -519,7 +482,7 @@ static void anim_bass_ripple(struct led_rgb *pixels, uint32_t delta_time) {
     for (int i = 0; i < MAX_RIPPLES; i++) {
         if (!ripples[i].active) continue;
         
-        ripples[i].radius += 8.0f * dt;
+        ripples[i].radius = PHYS_ADD(ripples[i].radius, PHYS_MUL_DIV(PHYS(8.0f), delta_time, 1000));
         if (ripples[i].intensity > 5) {
             ripples[i].intensity -= 5;
         } else {
@@ -530,14 +493,14 @@ static void anim_bass_ripple(struct led_rgb *pixels, uint32_t delta_time) {
         // Draw ripple
         for (int y = 0; y < matrix_height; y++) {
             for (int x = 0; x < matrix_width; x++) {
-                float dx = x - ripples[i].x;
-                float dy = y - ripples[i].y;
-                float dist = sqrtf(dx * dx + dy * dy);
+                phys_t dx = PHYS_SUB(PHYS_FROM_INT(x), ripples[i].x);
+                phys_t dy = PHYS_SUB(PHYS_FROM_INT(y), ripples[i].y);
+                phys_t dist = PHYS_HYPOT(dx, dy);
                 
-                if (fabsf(dist - ripples[i].radius) < 1.5f) {
-                    uint8_t hue = (uint8_t)(ripples[i].radius * 10);
+                if (PHYS_ABS(PHYS_SUB(dist, ripples[i].radius)) < PHYS(1.5f)) {
+                    uint8_t hue = (uint8_t)PHYS_TRUNC_MUL(ripples[i].radius, 10);
                     struct led_rgb color = hsv_to_rgb(hue, 255, ripples[i].intensity);
-                    set_pixel(pixels, x, y, color);
+                    fb_set_pixel(x, y, color);
                 }
             }
         }
@@ -547,8 +510,8 @@ static void anim_bass_ripple(struct led_rgb *pixels, uint32_t delta_time) {
 // ============================================================================
 // ANIMATION: Reactive Spiral (audio + tilt)
 // ============================================================================
-static void anim_reactive_spiral(struct led_rgb *pixels, float tilt_x, float tilt_y) {
-    clear_pixels(pixels);
+static void anim_reactive_spiral(float tilt_x, float tilt_y) {
+    fb_clear();
     
     static float spiral_angle = 0;
     spiral_angle += 0.1f;
@@ -570,7 +533,7 @@ static void anim_reactive_spiral(struct led_rgb *pixels, float tilt_x, float til
         
         uint8_t hue = (uint8_t)(t * 12 + bass);
         struct led_rgb color = hsv_to_rgb(hue, 255, 80);
-        set_pixel(pixels, x, y, color);
+        fb_set_pixel(x, y, color);
     }
 }
 
@@ -579,8 +542,9 @@ static void anim_reactive_spiral(struct led_rgb *pixels, float tilt_x, float til
 // ============================================================================
 
 void animations_init(int width, int height) {
-    matrix_width = width;
-    matrix_height = height;
+    // Per-column state is sized for the framebuffer
+    matrix_width = MIN(width, FB_WIDTH);
+    matrix_height = MIN(height, FB_HEIGHT);
     
     // Initialize particle system
     memset(particles, 0, sizeof(particles));
@@ -592,49 +556,49 @@ void animations_init(int width, int height) {
     animations_ready = true;
 }
 
-void animations_update(struct led_rgb *pixels, float tilt_x, float tilt_y, uint32_t delta_time) {
+void animations_update(float tilt_x, float tilt_y, uint32_t delta_time) {
     // Safety check - don't run if not initialized
     if (!animations_ready) {
-        clear_pixels(pixels);
+        fb_clear();
         return;
     }
     
     switch (current_mode) {
         case ANIM_TEST_MODE:
-            anim_test_mode(pixels, tilt_x, tilt_y);
+            anim_test_mode(tilt_x, tilt_y);
             break;
         case ANIM_VU_METER:
-            anim_vu_meter(pixels, delta_time);
+            anim_vu_meter(delta_time);
             break;
         case ANIM_SPECTRUM_BARS:
-            anim_spectrum_bars(pixels);
+            anim_spectrum_bars();
             break;
         case ANIM_PULSE:
-            anim_pulse(pixels);
+            anim_pulse();
             break;
         case ANIM_WAVEFORM:
-            anim_waveform(pixels);
+            anim_waveform();
             break;
         case ANIM_GRAVITY_PARTICLES:
-            anim_gravity_particles(pixels, tilt_x, tilt_y, delta_time);
+            anim_gravity_particles(tilt_x, tilt_y, delta_time);
             break;
         case ANIM_TILT_GRADIENT:
-            anim_tilt_gradient(pixels, tilt_x, tilt_y);
+            anim_tilt_gradient(tilt_x, tilt_y);
             break;
         case ANIM_SHAKE_BURST:
-            anim_shake_burst(pixels, tilt_x, tilt_y, delta_time);
+            anim_shake_burst(tilt_x, tilt_y, delta_time);
             break;
         case ANIM_AUDIO_RAIN:
-            anim_audio_rain(pixels, delta_time);
+            anim_audio_rain(delta_time);
             break;
         case ANIM_BASS_RIPPLE:
-            anim_bass_ripple(pixels, delta_time);
+            anim_bass_ripple(delta_time);
             break;
         case ANIM_REACTIVE_SPIRAL:
-            anim_reactive_spiral(pixels, tilt_x, tilt_y);
+            anim_reactive_spiral(tilt_x, tilt_y);
             break;
         default:
-            clear_pixels(pixels);
+            fb_clear();
             break;
     }
 }
@@ -5,7 +5,7 @@
 #ifndef ANIMATIONS_H
 #define ANIMATIONS_H
 
-#include <zephyr/drivers/led_strip.h>
+#include "framebuffer.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -26,8 +26,8 @@ typedef enum {
 } animation_mode_t;
 
 // Matrix dimensions
-#define ANIM_WIDTH  40
-#define ANIM_HEIGHT 6
+#define ANIM_WIDTH  FB_WIDTH
+#define ANIM_HEIGHT FB_HEIGHT
 
 /**
  * @brief Initialize animations system
@@ -37,13 +37,12 @@ typedef enum {
 void animations_init(int width, int height);
 
 /**
- * @brief Update current animation
- * @param pixels Output pixel buffer
+ * @brief Update current animation, drawing into the framebuffer
  * @param tilt_x Roll angle (-90 to +90 degrees)
  * @param tilt_y Pitch angle (-90 to +90 degrees)
  * @param delta_time Time since last update in ms
  */
-void animations_update(struct led_rgb *pixels, float tilt_x, float tilt_y, uint32_t delta_time);
+void animations_update(float tilt_x, float tilt_y, uint32_t delta_time);
 
 /**
  * @brief Set current animation mode
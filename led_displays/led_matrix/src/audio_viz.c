@@ -4,12 +4,12 @@
  */
 
 #include "audio_viz.h"
+#include "mel_spectrum.h"
+#include "onset.h"
 #include <string.h>
-#include <math.h>
 #include <zephyr/kernel.h>
 #include <zephyr/audio/dmic.h>
 #include <zephyr/logging/log.h>
-#include <arm_math.h>
 
 LOG_MODULE_REGISTER(audio_viz, LOG_LEVEL_INF);
 
@@ -24,20 +24,17 @@ LOG_MODULE_REGISTER(audio_viz, LOG_LEVEL_INF);
 
 K_MEM_SLAB_DEFINE_STATIC(audio_mem_slab, MAX_BLOCK_SIZE, BLOCK_COUNT, 4);
 
-// FFT buffers
-static float32_t fft_input[AUDIO_FFT_SIZE * 2];
-static float32_t fft_output[AUDIO_FFT_SIZE];
-static arm_rfft_fast_instance_f32 fft_instance;
-
-// Mel filterbank
-static float mel_filterbank[AUDIO_MEL_BANDS][AUDIO_FFT_SIZE / 2];
+// Band levels
 static uint8_t mel_values[AUDIO_MEL_BANDS];
 static uint8_t mel_values_smoothed[AUDIO_MEL_BANDS];
 
 // Beat detection
-static uint8_t bass_history[8];
-static uint8_t bass_history_idx = 0;
+#define TEMPO_LOCK_CONFIDENCE 77  // 0.3, beats follow the tempo above, the onsets below
+
 static bool beat_detected = false;
+static bool onset_detected = false;   // Onset in the blocks processed since the last beat check
+static uint8_t last_beat_phase = 0;
+static uint32_t last_frame_time = 0;  // Uptime in ms when the last frame was processed
 
 // DMIC device
 static const struct device *dmic_dev;
@@ -47,65 +44,9 @@ static bool audio_running = false;
 // Smoothing factors
 #define SMOOTHING_FACTOR 0.2f  // 0.0 = no smoothing, 1.0 = full smoothing
 
-// Convert frequency to mel scale
-static float hz_to_mel(float hz) {
-    return 2595.0f * log10f(1.0f + hz / 700.0f);
-}
-
-// Convert mel scale to frequency
-static float mel_to_hz(float mel) {
-    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
-}
-
-// Initialize mel filterbank
-static void init_mel_filterbank(void) {
-    memset(mel_filterbank, 0, sizeof(mel_filterbank));
-    
-    float mel_min = hz_to_mel(0);
-    float mel_max = hz_to_mel(AUDIO_SAMPLE_RATE / 2.0f);
-    float mel_step = (mel_max - mel_min) / (AUDIO_MEL_BANDS + 1);
-    
+// Smooth band levels over time
+static void smooth_mel_values(void) {
     for (int i = 0; i < AUDIO_MEL_BANDS; i++) {
-        float mel_center = mel_min + (i + 1) * mel_step;
-        float mel_left = mel_min + i * mel_step;
-        float mel_right = mel_min + (i + 2) * mel_step;
-        
-        float hz_center = mel_to_hz(mel_center);
-        float hz_left = mel_to_hz(mel_left);
-        float hz_right = mel_to_hz(mel_right);
-        
-        int bin_left = (int)(hz_left * AUDIO_FFT_SIZE / AUDIO_SAMPLE_RATE);
-        int bin_center = (int)(hz_center * AUDIO_FFT_SIZE / AUDIO_SAMPLE_RATE);
-        int bin_right = (int)(hz_right * AUDIO_FFT_SIZE / AUDIO_SAMPLE_RATE);
-        
-        // Create triangular filter
-        for (int j = bin_left; j < bin_center && j < AUDIO_FFT_SIZE / 2; j++) {
-            mel_filterbank[i][j] = (float)(j - bin_left) / (bin_center - bin_left);
-        }
-        for (int j = bin_center; j < bin_right && j < AUDIO_FFT_SIZE / 2; j++) {
-            mel_filterbank[i][j] = (float)(bin_right - j) / (bin_right - bin_center);
-        }
-    }
-}
-
-// Apply mel filterbank and compute band energies
-static void compute_mel_spectrogram(float32_t *fft_mag) {
-    for (int i = 0; i < AUDIO_MEL_BANDS; i++) {
-        float energy = 0.0f;
-        for (int j = 0; j < AUDIO_FFT_SIZE / 2; j++) {
-            energy += fft_mag[j] * mel_filterbank[i][j];
-        }
-        
-        // Convert to dB scale and normalize to full 0-255 range
-        float db = 10.0f * log10f(energy + 1.0f);
-        db = (db - 27.0f) / 21.0f * 255.0f;  // Map 27-48dB range to 0-255
-        
-        if (db < 0) db = 0;
-        if (db > 255) db = 255;
-        
-        mel_values[i] = (uint8_t)db;
-        
-        // Apply smoothing
         mel_values_smoothed[i] = (uint8_t)(
             SMOOTHING_FACTOR * mel_values_smoothed[i] +
             (1.0f - SMOOTHING_FACTOR) * mel_values[i]
@@ -113,72 +54,60 @@ static void compute_mel_spectrogram(float32_t *fft_mag) {
     }
 }
 
-// Detect beats based on bass energy
+// Run onset detection on the bands of each FFT frame
+static void process_frame_bands(const uint8_t *bands, int num_bands) {
+    if (onset_process(bands, num_bands)) {
+        onset_detected = true;
+    }
+}
+
+// Detect beats, called once per render frame
 static void detect_beat(void) {
-    uint8_t current_bass = audio_viz_get_bass();
+    uint8_t phase = audio_viz_get_beat_phase();
     
-    // Calculate average of recent bass levels
-    uint32_t sum = 0;
-    for (int i = 0; i < 8; i++) {
-        sum += bass_history[i];
+    if (onset_get_confidence() >= TEMPO_LOCK_CONFIDENCE) {
+        // Beat when the phase wraps around, small backward phase corrections don't count
+        beat_detected = (phase < last_beat_phase) && (last_beat_phase - phase > 128);
+    } else {
+        beat_detected = onset_detected;
     }
-    uint8_t avg_bass = sum / 8;
     
-    // Beat detected if current bass significantly exceeds average
-    beat_detected = (current_bass > avg_bass + 40);
-    
-    // Update history
-    bass_history[bass_history_idx] = current_bass;
-    bass_history_idx = (bass_history_idx + 1) % 8;
+    onset_detected = false;
+    last_beat_phase = phase;
 }
 
-// Process audio buffer with FFT
+// Process audio buffer
 static void process_audio_buffer(int16_t *buffer, size_t sample_count) {
     if (!buffer || sample_count == 0) {
         return;
     }
     
-    // Copy samples to FFT input buffer (zero-pad if needed)
-    size_t copy_count = (sample_count < AUDIO_FFT_SIZE) ? sample_count : AUDIO_FFT_SIZE;
-    
-    for (size_t i = 0; i < copy_count; i++) {
-        fft_input[i] = (float32_t)buffer[i];
-    }
-    for (size_t i = copy_count; i < AUDIO_FFT_SIZE; i++) {
-        fft_input[i] = 0.0f;
-    }
-    
-    // Perform FFT
-    arm_rfft_fast_f32(&fft_instance, fft_input, fft_output, 0);
-    
-    // Compute magnitude spectrum
-    float32_t magnitudes[AUDIO_FFT_SIZE / 2];
-    for (int i = 0; i < AUDIO_FFT_SIZE / 2; i++) {
-        float real = fft_output[i * 2];
-        float imag = fft_output[i * 2 + 1];
-        magnitudes[i] = sqrtf(real * real + imag * imag);
+    // Bands are only updated once a whole FFT frame has been received
+    if (mel_spectrum_process(buffer, sample_count, mel_values) == 0) {
+        return;
     }
     
-    // Compute mel spectrogram
-    compute_mel_spectrogram(magnitudes);
-    
-    // Detect beats
-    detect_beat();
+    last_frame_time = k_uptime_get_32();
+    smooth_mel_values();
 }
 
 int audio_viz_init(void) {
     LOG_INF("Initializing audio visualizer...");
     
-    // Initialize FFT
-    arm_rfft_fast_init_f32(&fft_instance, AUDIO_FFT_SIZE);
+    // Initialize mel spectrum, band levels map 27-48 dB to 0-255
+    int ret = mel_spectrum_init(AUDIO_SAMPLE_RATE, AUDIO_MEL_BANDS, 27.0f, 48.0f);
+    if (ret < 0) {
+        LOG_ERR("Failed to initialize mel spectrum: %d", ret);
+        return ret;
+    }
     
-    // Initialize mel filterbank
-    init_mel_filterbank();
+    // Onsets and tempo from the bands of each FFT frame
+    onset_init(MEL_SPECTRUM_HOP_SIZE * 1000000ULL / AUDIO_SAMPLE_RATE);
+    mel_spectrum_set_frame_handler(process_frame_bands);
     
     // Clear buffers
     memset(mel_values, 0, sizeof(mel_values));
     memset(mel_values_smoothed, 0, sizeof(mel_values_smoothed));
-    memset(bass_history, 0, sizeof(bass_history));
     
     // Get DMIC device
     dmic_dev = DEVICE_DT_GET(DT_NODELABEL(dmic_dev));
@@ -254,11 +183,8 @@ bool audio_viz_available(void) {
     return audio_available && audio_running;
 }
 
-void audio_viz_process(void) {
-    if (!audio_viz_available()) {
-        return;
-    }
-    
+// Read and process the next audio block, if any
+static void read_audio_block(void) {
     void *buffer;
     uint32_t size;
     
@@ -277,16 +203,25 @@ void audio_viz_process(void) {
     // Log band values for tuning
     static uint32_t log_counter = 0;
     if (++log_counter % 10 == 0) {  // Log every 10th frame (~1 second)
-        LOG_INF("Bands: %3d %3d %3d %3d %3d %3d %3d %3d | Bass:%3d Mid:%3d High:%3d Vol:%3d Beat:%d",
+        LOG_INF("Bands: %3d %3d %3d %3d %3d %3d %3d %3d | Bass:%3d Mid:%3d High:%3d Vol:%3d BPM:%3d Conf:%3d",
                 mel_values_smoothed[0], mel_values_smoothed[1], mel_values_smoothed[2], mel_values_smoothed[3],
                 mel_values_smoothed[4], mel_values_smoothed[5], mel_values_smoothed[6], mel_values_smoothed[7],
                 audio_viz_get_bass(), audio_viz_get_mids(), audio_viz_get_highs(), 
-                audio_viz_get_volume(), beat_detected ? 1 : 0);
+                audio_viz_get_volume(), audio_viz_get_bpm(), audio_viz_get_tempo_confidence());
     }
     
     k_mem_slab_free(&audio_mem_slab, buffer);
 }
 
+void audio_viz_process(void) {
+    if (!audio_viz_available()) {
+        return;
+    }
+    
+    read_audio_block();
+    detect_beat();
+}
+
 uint8_t audio_viz_get_band(int band) {
     if (band < 0 || band >= AUDIO_MEL_BANDS) {
         return 0;
@@ -329,3 +264,16 @@ uint8_t audio_viz_get_volume(void) {
 bool audio_viz_beat_detected(void) {
     return beat_detected;
 }
+
+uint16_t audio_viz_get_bpm(void) {
+    return onset_get_bpm();
+}
+
+uint8_t audio_viz_get_beat_phase(void) {
+    // Extrapolated from the last frame, blocks are only processed every 100ms
+    return onset_get_phase((k_uptime_get_32() - last_frame_time) * 1000);
+}
+
+uint8_t audio_viz_get_tempo_confidence(void) {
+    return onset_get_confidence();
+}
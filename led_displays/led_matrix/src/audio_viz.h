@@ -78,9 +78,31 @@ uint8_t audio_viz_get_highs(void);
 uint8_t audio_viz_get_volume(void);
 
 /**
- * @brief Detect beat (sudden bass increase)
- * @return true if beat detected this frame
+ * @brief Detect beat
+ *
+ * Once the tempo is found with enough confidence, beats follow the beat phase. Otherwise
+ * every onset (sudden increase of any band, bass or hi-hat) is a beat.
+ *
+ * @return true if a beat occurred since the previous call to audio_viz_process()
  */
 bool audio_viz_beat_detected(void);
 
+/**
+ * @brief Get the estimated tempo
+ * @return Beats per minute (60-180), 0 if no tempo was found yet
+ */
+uint16_t audio_viz_get_bpm(void);
+
+/**
+ * @brief Get the position in the current beat, to animate in time with the music
+ * @return Phase 0-255, 0 being on the beat
+ */
+uint8_t audio_viz_get_beat_phase(void);
+
+/**
+ * @brief Get the confidence of the tempo estimate
+ * @return Confidence 0-255, how periodic the onsets are at the estimated tempo
+ */
+uint8_t audio_viz_get_tempo_confidence(void);
+
 #endif // AUDIO_VIZ_H
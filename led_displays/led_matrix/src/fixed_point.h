@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FIXED_POINT_H_
+#define FIXED_POINT_H_
+
+#include <stdint.h>
+#include <math.h>
+
+/*
+ * Q8.8 fixed point math, and the phys_t type used by the water physics and the animation
+ * particles.
+ *
+ * With CONFIG_LED_MATRIX_FIXED_POINT, phys_t is Q8.8 and all physics math is done with
+ * integer operations and lookup tables, so the result is the same on every core (including
+ * cores without an FPU) and with every compiler optimization level. Otherwise phys_t is float.
+ *
+ * Q8.8 covers -128.0 to 127.996, which is enough for velocities and for coordinates on
+ * matrices up to 127 pixels wide. Operations that can overflow saturate.
+ */
+
+typedef int16_t q8_8_t;
+
+#define Q8_8_FRAC_BITS  8
+#define Q8_8_ONE        (1 << Q8_8_FRAC_BITS)
+#define Q8_8_MAX        INT16_MAX
+#define Q8_8_MIN        INT16_MIN
+
+// Convert a constant to Q8.8, rounded to nearest (evaluated at compile time)
+#define Q8_8(c)         ((q8_8_t)((c) * Q8_8_ONE + (((c) >= 0) ? 0.5 : -0.5)))
+
+// Angles are in 1/256 of a turn, so that they wrap around with uint8_t arithmetic
+typedef uint8_t fx_angle_t;
+
+// sin() of the first quarter turn in Q8.8, in steps of 1/256 turn
+static const q8_8_t fx_sin_lut[65] = {
+	0, 6, 13, 19, 25, 31, 38, 44, 50, 56, 62, 68, 74, 80, 86, 92,
+	98, 104, 109, 115, 121, 126, 132, 137, 142, 147, 152, 157, 162, 167, 172, 177,
+	181, 185, 190, 194, 198, 202, 206, 209, 213, 216, 220, 223, 226, 229, 231, 234,
+	237, 239, 241, 243, 245, 247, 248, 250, 251, 252, 253, 254, 255, 255, 256, 256,
+	256,
+};
+
+static inline q8_8_t q8_8_sat(int32_t v)
+{
+	if (v > Q8_8_MAX) return Q8_8_MAX;
+	if (v < Q8_8_MIN) return Q8_8_MIN;
+	return (q8_8_t)v;
+}
+
+/**
+ * @brief Multiply two Q8.8 values, rounded to nearest
+ */
+static inline q8_8_t q8_8_mul(q8_8_t a, q8_8_t b)
+{
+	int32_t p = (int32_t)a * b;
+
+	return q8_8_sat((p + ((p >= 0) ? (Q8_8_ONE / 2) : (Q8_8_ONE / 2 - 1))) >> Q8_8_FRAC_BITS);
+}
+
+static inline q8_8_t q8_8_abs(q8_8_t a)
+{
+	return (a < 0) ? q8_8_sat(-(int32_t)a) : a;
+}
+
+/**
+ * @brief Round a Q8.8 value to the nearest integer, halfway cases away from zero (like roundf)
+ */
+static inline int q8_8_round(q8_8_t a)
+{
+	return (a >= 0) ? ((a + Q8_8_ONE / 2) >> Q8_8_FRAC_BITS) :
+			  -((-(int32_t)a + Q8_8_ONE / 2) >> Q8_8_FRAC_BITS);
+}
+
+/**
+ * @brief Convert to integer, rounding toward zero (like a cast from float)
+ */
+static inline int q8_8_trunc(q8_8_t a)
+{
+	return a / Q8_8_ONE;
+}
+
+/**
+ * @brief Convert a float to Q8.8, rounding toward zero
+ *
+ * Only used on API boundaries that take float (IMU angles), the multiplication by a power of
+ * two and the conversion are exact on every IEEE 754 implementation.
+ */
+static inline q8_8_t q8_8_from_float(float f)
+{
+	float v = f * (float)Q8_8_ONE;
+
+	if (v >= (float)Q8_8_MAX) return Q8_8_MAX;
+	if (v <= (float)Q8_8_MIN) return Q8_8_MIN;
+	return (q8_8_t)v;
+}
+
+/**
+ * @brief Square root of a Q8.8 value, rounded down
+ */
+static inline q8_8_t q8_8_sqrt(int32_t a)
+{
+	if (a <= 0) {
+		return 0;
+	}
+
+	// sqrt(a / 256) * 256 = sqrt(a * 256)
+	uint32_t v = (uint32_t)a << Q8_8_FRAC_BITS;
+	uint32_t res = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > v) {
+		bit >>= 2;
+	}
+
+	while (bit) {
+		if (v >= res + bit) {
+			v -= res + bit;
+			res = (res >> 1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return q8_8_sat((int32_t)res);
+}
+
+static inline q8_8_t fx_sin(fx_angle_t angle)
+{
+	uint8_t i = angle & 0x3F;
+	q8_8_t v;
+
+	switch (angle >> 6) {
+	case 0:  v = fx_sin_lut[i]; break;
+	case 1:  v = fx_sin_lut[64 - i]; break;
+	case 2:  v = -fx_sin_lut[i]; break;
+	default: v = -fx_sin_lut[64 - i]; break;
+	}
+
+	return v;
+}
+
+static inline q8_8_t fx_cos(fx_angle_t angle)
+{
+	return fx_sin((fx_angle_t)(angle + 64));
+}
+
+/**
+ * @brief Convert an angle in degrees to 1/256 turn, rounded to nearest
+ */
+static inline fx_angle_t fx_angle_from_deg(float deg)
+{
+	// Whole degrees plus 1/256 degree fraction, wrapped to one turn
+	int32_t deg_q8_8 = (int32_t)(deg * (float)Q8_8_ONE) % (360 * Q8_8_ONE);
+	int32_t turn_q8_8 = deg_q8_8 * 256 / 360;
+
+	return (fx_angle_t)((turn_q8_8 + Q8_8_ONE / 2) >> Q8_8_FRAC_BITS);
+}
+
+#ifdef CONFIG_LED_MATRIX_FIXED_POINT
+
+#include <zephyr/toolchain.h>
+
+#if defined(CONFIG_MATRIX_WIDTH)
+BUILD_ASSERT(CONFIG_MATRIX_WIDTH < 128 && CONFIG_MATRIX_HEIGHT < 128,
+	     "Q8.8 coordinates only cover matrices up to 127 pixels wide and high");
+#endif
+
+typedef q8_8_t phys_t;
+typedef fx_angle_t phys_angle_t;
+
+#define PHYS(c)                 Q8_8(c)
+#define PHYS_FROM_INT(i)        q8_8_sat((int32_t)(i) * Q8_8_ONE)
+#define PHYS_FROM_FLOAT(f)      q8_8_from_float(f)
+#define PHYS_ADD(a, b)          q8_8_sat((int32_t)(a) + (b))
+#define PHYS_SUB(a, b)          q8_8_sat((int32_t)(a) - (b))
+#define PHYS_NEG(a)             q8_8_sat(-(int32_t)(a))
+#define PHYS_MUL(a, b)          q8_8_mul(a, b)
+#define PHYS_MUL_INT(a, i)      q8_8_sat((int32_t)(a) * (int32_t)(i))
+#define PHYS_MUL_DIV(a, n, d)   q8_8_sat((int32_t)(a) * (int32_t)(n) / (int32_t)(d))
+#define PHYS_ABS(a)             q8_8_abs(a)
+#define PHYS_ROUND(a)           q8_8_round(a)
+#define PHYS_TRUNC(a)           q8_8_trunc(a)
+#define PHYS_TRUNC_MUL(a, n)    ((int)((int32_t)(a) * (n) / Q8_8_ONE))
+#define PHYS_HYPOT(x, y)        q8_8_sqrt((((int32_t)(x) * (x)) >> Q8_8_FRAC_BITS) + \
+					  (((int32_t)(y) * (y)) >> Q8_8_FRAC_BITS))
+#define PHYS_ANGLE_DEG(deg)     fx_angle_from_deg(deg)
+#define PHYS_ANGLE_TURN(n, d)   ((phys_angle_t)((n) * 256 / (d)))
+#define PHYS_SIN(angle)         fx_sin(angle)
+#define PHYS_COS(angle)         fx_cos(angle)
+
+#else
+
+typedef float phys_t;
+typedef float phys_angle_t;
+
+#define PHYS(c)                 ((float)(c))
+#define PHYS_FROM_INT(i)        ((float)(i))
+#define PHYS_FROM_FLOAT(f)      (f)
+#define PHYS_ADD(a, b)          ((a) + (b))
+#define PHYS_SUB(a, b)          ((a) - (b))
+#define PHYS_NEG(a)             (-(a))
+#define PHYS_MUL(a, b)          ((a) * (b))
+#define PHYS_MUL_INT(a, i)      ((float)(i) * (a))
+#define PHYS_MUL_DIV(a, n, d)   ((a) * (n) / (float)(d))
+#define PHYS_ABS(a)             fabsf(a)
+#define PHYS_ROUND(a)           ((int)roundf(a))
+#define PHYS_TRUNC(a)           ((int)(a))
+#define PHYS_TRUNC_MUL(a, n)    ((int)((a) * (n)))
+#define PHYS_HYPOT(x, y)        sqrtf((x) * (x) + (y) * (y))
+#define PHYS_ANGLE_DEG(deg)     ((deg) * 3.14159f / 180.0f)
+#define PHYS_ANGLE_TURN(n, d)   ((n) * 6.28318f / (d))
+#define PHYS_SIN(angle)         sinf(angle)
+#define PHYS_COS(angle)         cosf(angle)
+
+#endif /* CONFIG_LED_MATRIX_FIXED_POINT */
+
+#endif /* FIXED_POINT_H_ */
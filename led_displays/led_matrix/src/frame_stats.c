@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025 LED Matrix Adaptation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "frame_stats.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(frame_stats, LOG_LEVEL_INF);
+
+#define STATS_BINS      64      // 1 ms per bin, the last one counts all longer frames
+
+static uint32_t bins[STATS_BINS];
+static uint32_t frames;
+static uint64_t total_us;
+static uint64_t busy_total_us;
+static uint32_t max_us;
+static uint32_t late;
+
+/**
+ * @brief Get the upper bound in ms of the bin holding the given fraction of frames
+ */
+static uint32_t percentile_ms(uint32_t permille)
+{
+	uint32_t target = (uint64_t)frames * permille / 1000;
+	uint32_t count = 0;
+
+	for (int i = 0; i < STATS_BINS; i++) {
+		count += bins[i];
+		if (count > target) {
+			return i + 1;
+		}
+	}
+
+	return STATS_BINS;
+}
+
+static void stats_log(void)
+{
+	char hist[STATS_BINS * 10];
+	size_t pos = 0;
+
+	for (int i = 0; i < STATS_BINS && pos < sizeof(hist); i++) {
+		if (bins[i]) {
+			pos += snprintk(&hist[pos], sizeof(hist) - pos, " %d:%u", i, bins[i]);
+		}
+	}
+	hist[MIN(pos, sizeof(hist) - 1)] = '\0';
+
+	LOG_INF("%u frames, %u.%u fps, busy %u us avg, frame p50 <%u ms p99 <%u ms max %u us, %u late",
+		frames, (uint32_t)(frames * 10000000ULL / total_us) / 10,
+		(uint32_t)(frames * 10000000ULL / total_us) % 10,
+		(uint32_t)(busy_total_us / frames), percentile_ms(500), percentile_ms(990),
+		max_us, late);
+	LOG_INF("Frame time histogram (ms:frames):%s", hist);
+}
+
+void frame_stats_record(uint32_t frame_us, uint32_t busy_us)
+{
+	bins[MIN(frame_us / USEC_PER_MSEC, STATS_BINS - 1)]++;
+	frames++;
+	total_us += frame_us;
+	busy_total_us += busy_us;
+	max_us = MAX(max_us, frame_us);
+
+#if CONFIG_MATRIX_FRAME_RATE > 0
+	// Allow 10% jitter on the frame period
+	if (frame_us > USEC_PER_SEC / CONFIG_MATRIX_FRAME_RATE * 11 / 10) {
+		late++;
+	}
+#endif
+
+	if (total_us >= (uint64_t)CONFIG_MATRIX_FRAME_STATS_INTERVAL * USEC_PER_SEC) {
+		stats_log();
+
+		memset(bins, 0, sizeof(bins));
+		frames = 0;
+		total_us = 0;
+		busy_total_us = 0;
+		max_us = 0;
+		late = 0;
+	}
+}
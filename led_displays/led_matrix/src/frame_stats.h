@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2025 LED Matrix Adaptation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Frame time histogram, to check that the main loop holds the target frame rate.
+ *
+ * Frame times are counted in 1 ms bins. A summary (frame rate, median, 99th percentile and
+ * worst frame time, and the non-empty bins) is logged every
+ * CONFIG_MATRIX_FRAME_STATS_INTERVAL seconds, and the histogram is then cleared.
+ */
+
+/**
+ * @brief Record one frame
+ * @param frame_us Time from the start of the previous frame to the start of this one
+ * @param busy_us Time spent rendering and queuing the frame, without the pacing sleep
+ */
+void frame_stats_record(uint32_t frame_us, uint32_t busy_us);
+
+#endif /* FRAME_STATS_H */
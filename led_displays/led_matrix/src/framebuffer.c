@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2025 LED Matrix Adaptation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "framebuffer.h"
+#include "font_5x5.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(framebuffer, LOG_LEVEL_INF);
+
+#define PANEL_WIDTH     CONFIG_MATRIX_PANEL_WIDTH
+#define PANEL_HEIGHT    CONFIG_MATRIX_PANEL_HEIGHT
+#define PANEL_SIZE      (PANEL_WIDTH * PANEL_HEIGHT)
+#define PANELS_X        (FB_WIDTH / PANEL_WIDTH)
+
+// One buffer is sent while the next frame is copied to the other
+#define TX_BUFFERS      2
+
+BUILD_ASSERT(FB_WIDTH % PANEL_WIDTH == 0, "Matrix width must be a multiple of the panel width");
+BUILD_ASSERT(FB_HEIGHT % PANEL_HEIGHT == 0, "Matrix height must be a multiple of the panel height");
+BUILD_ASSERT(FB_NUM_PIXELS <= UINT16_MAX, "Too many pixels for the index map");
+
+#if defined(CONFIG_MATRIX_PANEL_ROTATION_90) || defined(CONFIG_MATRIX_PANEL_ROTATION_270)
+// Panel rows run along the matrix columns
+#define PANEL_ROW_LEN   PANEL_HEIGHT
+#else
+#define PANEL_ROW_LEN   PANEL_WIDTH
+#endif
+
+static struct led_rgb pixels[FB_NUM_PIXELS];    // Drawing buffer, in LED strip order
+static uint16_t index_map[FB_NUM_PIXELS];       // Matrix (y * FB_WIDTH + x) to LED strip index
+
+// Copies sent to the driver by the transmit thread, the driver may modify them
+static struct led_rgb tx_pixels[TX_BUFFERS][FB_NUM_PIXELS];
+static size_t tx_len[TX_BUFFERS];
+static uint8_t tx_next;
+static const struct device *tx_strip;
+static atomic_t tx_error;
+
+static K_SEM_DEFINE(tx_free, TX_BUFFERS, TX_BUFFERS);
+static K_MSGQ_DEFINE(tx_msgq, sizeof(uint8_t), TX_BUFFERS, 1);
+
+static struct fb_rect dirty;  // Changed since the last flush
+static struct fb_rect drawn;  // Possibly lit pixels, changed by the next clear
+
+static inline void rect_empty(struct fb_rect *rect)
+{
+	rect->x0 = FB_WIDTH;
+	rect->y0 = FB_HEIGHT;
+	rect->x1 = -1;
+	rect->y1 = -1;
+}
+
+static inline bool rect_is_empty(const struct fb_rect *rect)
+{
+	return rect->x0 > rect->x1;
+}
+
+static inline void rect_add(struct fb_rect *rect, int x0, int y0, int x1, int y1)
+{
+	rect->x0 = MIN(rect->x0, x0);
+	rect->y0 = MIN(rect->y0, y0);
+	rect->x1 = MAX(rect->x1, x1);
+	rect->y1 = MAX(rect->y1, y1);
+}
+
+static inline void rect_add_rect(struct fb_rect *rect, const struct fb_rect *other)
+{
+	if (!rect_is_empty(other)) {
+		rect_add(rect, other->x0, other->y0, other->x1, other->y1);
+	}
+}
+
+static inline void mark_changed(int x0, int y0, int x1, int y1)
+{
+	rect_add(&dirty, x0, y0, x1, y1);
+	rect_add(&drawn, x0, y0, x1, y1);
+}
+
+/**
+ * @brief Compute the LED strip index of a pixel from the panel layout
+ */
+static uint16_t layout_index(int x, int y)
+{
+	int panel_col = x / PANEL_WIDTH;
+	int panel_row = y / PANEL_HEIGHT;
+	int lx = x % PANEL_WIDTH;
+	int ly = y % PANEL_HEIGHT;
+	int px;
+	int py;
+
+	// Position in the physical raster of the panel
+#if defined(CONFIG_MATRIX_PANEL_ROTATION_90)
+	px = ly;
+	py = PANEL_WIDTH - 1 - lx;
+#elif defined(CONFIG_MATRIX_PANEL_ROTATION_180)
+	px = PANEL_WIDTH - 1 - lx;
+	py = PANEL_HEIGHT - 1 - ly;
+#elif defined(CONFIG_MATRIX_PANEL_ROTATION_270)
+	px = PANEL_HEIGHT - 1 - ly;
+	py = lx;
+#else
+	px = lx;
+	py = ly;
+#endif
+
+	if (IS_ENABLED(CONFIG_MATRIX_PANEL_SERPENTINE) && (py & 1)) {
+		px = PANEL_ROW_LEN - 1 - px;
+	}
+
+	if (IS_ENABLED(CONFIG_MATRIX_CHAIN_SERPENTINE) && (panel_row & 1)) {
+		panel_col = PANELS_X - 1 - panel_col;
+	}
+
+	int panel = panel_row * PANELS_X + panel_col;
+
+	return panel * PANEL_SIZE + py * PANEL_ROW_LEN + px;
+}
+
+int fb_init(void)
+{
+	for (int y = 0; y < FB_HEIGHT; y++) {
+		for (int x = 0; x < FB_WIDTH; x++) {
+			index_map[y * FB_WIDTH + x] = layout_index(x, y);
+		}
+	}
+
+	memset(pixels, 0, sizeof(pixels));
+	rect_empty(&drawn);
+
+	// Send the whole (black) framebuffer on the first flush
+	rect_empty(&dirty);
+	rect_add(&dirty, 0, 0, FB_WIDTH - 1, FB_HEIGHT - 1);
+
+	return 0;
+}
+
+size_t fb_index(int x, int y)
+{
+	if (x < 0 || x >= FB_WIDTH || y < 0 || y >= FB_HEIGHT) {
+		return FB_NUM_PIXELS;
+	}
+
+	return index_map[y * FB_WIDTH + x];
+}
+
+void fb_set_pixel(int x, int y, struct led_rgb color)
+{
+	if (x < 0 || x >= FB_WIDTH || y < 0 || y >= FB_HEIGHT) {
+		return;
+	}
+
+	pixels[index_map[y * FB_WIDTH + x]] = color;
+	mark_changed(x, y, x, y);
+}
+
+struct led_rgb fb_get_pixel(int x, int y)
+{
+	if (x < 0 || x >= FB_WIDTH || y < 0 || y >= FB_HEIGHT) {
+		return (struct led_rgb){0};
+	}
+
+	return pixels[index_map[y * FB_WIDTH + x]];
+}
+
+void fb_clear(void)
+{
+	// Only the pixels drawn since the last clear can be lit
+	if (rect_is_empty(&drawn)) {
+		return;
+	}
+
+	memset(pixels, 0, sizeof(pixels));
+	rect_add_rect(&dirty, &drawn);
+	rect_empty(&drawn);
+}
+
+void fb_fill(struct led_rgb color)
+{
+	for (size_t i = 0; i < FB_NUM_PIXELS; i++) {
+		pixels[i] = color;
+	}
+
+	mark_changed(0, 0, FB_WIDTH - 1, FB_HEIGHT - 1);
+}
+
+void fb_fill_rect(int x, int y, int w, int h, struct led_rgb color)
+{
+	int x0 = MAX(x, 0);
+	int y0 = MAX(y, 0);
+	int x1 = MIN(x + w, FB_WIDTH) - 1;
+	int y1 = MIN(y + h, FB_HEIGHT) - 1;
+
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+
+	for (int row = y0; row <= y1; row++) {
+		const uint16_t *map = &index_map[row * FB_WIDTH];
+
+		for (int col = x0; col <= x1; col++) {
+			pixels[map[col]] = color;
+		}
+	}
+
+	mark_changed(x0, y0, x1, y1);
+}
+
+void fb_draw_rect(int x, int y, int w, int h, struct led_rgb color)
+{
+	fb_fill_rect(x, y, w, 1, color);
+	fb_fill_rect(x, y + h - 1, w, 1, color);
+	fb_fill_rect(x, y, 1, h, color);
+	fb_fill_rect(x + w - 1, y, 1, h, color);
+}
+
+void fb_draw_char(int x, int y, char c, struct led_rgb color)
+{
+	// Convert lowercase to uppercase
+	if (c >= 'a' && c <= 'z') {
+		c = c - 'a' + 'A';
+	}
+
+	// Check if character is in our font range (space to 'Z')
+	if (c < ' ' || c > 'Z') {
+		c = ' '; // Default to space for unsupported chars
+	}
+
+	// Skip characters that are entirely off the matrix
+	if (x + 5 <= 0 || x >= FB_WIDTH || y + 5 <= 0 || y >= FB_HEIGHT) {
+		return;
+	}
+
+	const uint8_t *glyph = font_5x5[c - ' '];
+
+	for (int row = 0; row < 5; row++) {
+		for (int col = 0; col < 5; col++) {
+			if (glyph[row] & (1 << (4 - col))) {
+				fb_set_pixel(x + col, y + row, color);
+			}
+		}
+	}
+}
+
+void fb_draw_string(int x, int y, const char *str, struct led_rgb color)
+{
+	int cursor_x = x;
+
+	while (*str && cursor_x < FB_WIDTH) {
+		fb_draw_char(cursor_x, y, *str, color);
+		cursor_x += 6; // 5 pixels for char + 1 pixel spacing
+		str++;
+	}
+}
+
+int fb_string_width(const char *str)
+{
+	int len = strlen(str);
+
+	if (len == 0) {
+		return 0;
+	}
+
+	return len * 6 - 1; // 6 pixels per char, minus last space
+}
+
+void fb_fade(uint8_t amount)
+{
+	if (rect_is_empty(&drawn)) {
+		return;
+	}
+
+	for (size_t i = 0; i < FB_NUM_PIXELS; i++) {
+		pixels[i].r = (pixels[i].r > amount) ? pixels[i].r - amount : 0;
+		pixels[i].g = (pixels[i].g > amount) ? pixels[i].g - amount : 0;
+		pixels[i].b = (pixels[i].b > amount) ? pixels[i].b - amount : 0;
+	}
+
+	rect_add_rect(&dirty, &drawn);
+}
+
+bool fb_dirty_get(struct fb_rect *rect)
+{
+	*rect = dirty;
+
+	return !rect_is_empty(&dirty);
+}
+
+int fb_flush(const struct device *strip)
+{
+	size_t len = 0;
+	int ret = (int)atomic_clear(&tx_error);
+
+	if (ret != 0) {
+		// A transfer failed, send everything again
+		rect_add(&dirty, 0, 0, FB_WIDTH - 1, FB_HEIGHT - 1);
+	}
+
+	if (rect_is_empty(&dirty)) {
+		return ret;
+	}
+
+	// LEDs after the last changed one keep their state
+	for (int y = dirty.y0; y <= dirty.y1; y++) {
+		const uint16_t *map = &index_map[y * FB_WIDTH];
+
+		for (int x = dirty.x0; x <= dirty.x1; x++) {
+			len = MAX(len, (size_t)map[x] + 1);
+		}
+	}
+
+	// Only blocks if a frame is already waiting behind the one being sent
+	k_sem_take(&tx_free, K_FOREVER);
+
+	uint8_t buf = tx_next;
+
+	tx_next = (tx_next + 1) % TX_BUFFERS;
+	tx_strip = strip;
+	tx_len[buf] = len;
+	memcpy(tx_pixels[buf], pixels, len * sizeof(struct led_rgb));
+	rect_empty(&dirty);
+
+	// Can't fail, there is room in the queue for every buffer
+	(void)k_msgq_put(&tx_msgq, &buf, K_NO_WAIT);
+
+	return ret;
+}
+
+void fb_flush_wait(void)
+{
+	for (int i = 0; i < TX_BUFFERS; i++) {
+		k_sem_take(&tx_free, K_FOREVER);
+	}
+
+	for (int i = 0; i < TX_BUFFERS; i++) {
+		k_sem_give(&tx_free);
+	}
+}
+
+/**
+ * @brief Send the queued frames to the LED strip, in order
+ */
+static void tx_thread(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (1) {
+		uint8_t buf;
+
+		k_msgq_get(&tx_msgq, &buf, K_FOREVER);
+
+		int ret = led_strip_update_rgb(tx_strip, tx_pixels[buf], tx_len[buf]);
+
+		if (ret != 0) {
+			LOG_ERR("LED strip update failed: %d", ret);
+			atomic_set(&tx_error, ret);
+		}
+
+		k_sem_give(&tx_free);
+	}
+}
+
+K_THREAD_DEFINE(fb_tx_thread, CONFIG_MATRIX_DISPLAY_STACK_SIZE, tx_thread, NULL, NULL, NULL,
+		CONFIG_MATRIX_DISPLAY_THREAD_PRIORITY, 0, 0);
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2025 LED Matrix Adaptation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/led_strip.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Framebuffer for a matrix made of chained LED panels.
+ *
+ * Drawing is done in matrix coordinates, (0, 0) being the top left pixel. The LED strip
+ * index of each pixel is computed once at init, from the panel layout set in Kconfig
+ * (panel size, rotation, raster or serpentine wiring, and order of the panels in the chain),
+ * so drawing only costs a table lookup per pixel.
+ *
+ * The area changed since the last flush is tracked as a dirty rectangle, so that frames
+ * that don't change anything aren't sent to the LED strip, and only the part of the chain
+ * up to the last changed LED is sent otherwise. Frames are sent from a thread, with double
+ * buffering, so drawing doesn't wait for the LED strip.
+ */
+
+#define FB_WIDTH        CONFIG_MATRIX_WIDTH
+#define FB_HEIGHT       CONFIG_MATRIX_HEIGHT
+#define FB_NUM_PIXELS   (FB_WIDTH * FB_HEIGHT)
+
+/**
+ * @brief Rectangle in matrix coordinates, bounds included. Empty if x0 > x1.
+ */
+struct fb_rect {
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+};
+
+/**
+ * @brief Build the pixel index map and clear the framebuffer
+ * @return 0 on success, negative error code on failure
+ */
+int fb_init(void);
+
+/**
+ * @brief Get the LED strip index of a pixel
+ * @param x Column
+ * @param y Row
+ * @return Index in the LED strip, FB_NUM_PIXELS if out of bounds
+ */
+size_t fb_index(int x, int y);
+
+/**
+ * @brief Set a single pixel, ignored if out of bounds
+ * @param x Column
+ * @param y Row
+ * @param color RGB color value
+ */
+void fb_set_pixel(int x, int y, struct led_rgb color);
+
+/**
+ * @brief Get a single pixel
+ * @param x Column
+ * @param y Row
+ * @return Color of the pixel, black if out of bounds
+ */
+struct led_rgb fb_get_pixel(int x, int y);
+
+/**
+ * @brief Clear all pixels (set to black)
+ */
+void fb_clear(void);
+
+/**
+ * @brief Fill entire matrix with one color
+ * @param color RGB color value
+ */
+void fb_fill(struct led_rgb color);
+
+/**
+ * @brief Fill a rectangle, clipped to the matrix
+ * @param x Left column
+ * @param y Top row
+ * @param w Width in pixels
+ * @param h Height in pixels
+ * @param color RGB color value
+ */
+void fb_fill_rect(int x, int y, int w, int h, struct led_rgb color);
+
+/**
+ * @brief Draw a rectangle outline, clipped to the matrix
+ * @param x Left column
+ * @param y Top row
+ * @param w Width in pixels
+ * @param h Height in pixels
+ * @param color RGB color value
+ */
+void fb_draw_rect(int x, int y, int w, int h, struct led_rgb color);
+
+/**
+ * @brief Draw a character at position using 5x5 font
+ * @param x Left column
+ * @param y Top row
+ * @param c Character, lowercase is drawn as uppercase
+ * @param color RGB color value
+ */
+void fb_draw_char(int x, int y, char c, struct led_rgb color);
+
+/**
+ * @brief Draw a string with 6x5 character cells (5px char + 1px space)
+ * @param x Left column
+ * @param y Top row
+ * @param str String to draw
+ * @param color RGB color value
+ */
+void fb_draw_string(int x, int y, const char *str, struct led_rgb color);
+
+/**
+ * @brief Get pixel width of a string drawn with fb_draw_string()
+ * @param str String
+ * @return Width in pixels
+ */
+int fb_string_width(const char *str);
+
+/**
+ * @brief Decrease all color channels of all pixels, saturating at 0
+ * @param amount Value subtracted from each channel
+ */
+void fb_fade(uint8_t amount);
+
+/**
+ * @brief Get the area changed since the last flush
+ * @param rect Dirty rectangle, empty if nothing changed
+ * @return true if anything changed
+ */
+bool fb_dirty_get(struct fb_rect *rect);
+
+/**
+ * @brief Send the changed part of the framebuffer to the LED strip
+ *
+ * Does nothing if no pixel changed since the last flush. Otherwise the LED strip is updated
+ * up to the last LED of the dirty area, the LEDs after it keep their state.
+ *
+ * The frame is copied to a transmit buffer and sent by the display thread, so the next frame
+ * can be drawn while this one is sent. Only blocks if the previous frame is still waiting to
+ * be sent.
+ *
+ * @param strip LED strip device
+ * @return 0 on success, negative error code if sending a previous frame failed
+ */
+int fb_flush(const struct device *strip);
+
+/**
+ * @brief Wait until all flushed frames have been sent to the LED strip
+ */
+void fb_flush_wait(void);
+
+#endif /* FRAMEBUFFER_H */
@@ -25,10 +25,11 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 #include <zephyr/sys/util.h>
 #include <hal/nrf_comp.h>
 
-#include "font_5x5.h"
 #include "water_physics.h"
 #include "audio_viz.h"
 #include "animations.h"
+#include "framebuffer.h"
+#include "frame_stats.h"
 
 
 #define STRIP_NODE		DT_ALIAS(led_strip)
@@ -40,9 +41,9 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 #endif
 
 // Matrix dimensions from Kconfig
-#define MATRIX_WIDTH	40  // 5 matrices × 8 pixels wide
-#define MATRIX_HEIGHT	6
-#define MATRIX_SIZE	(MATRIX_WIDTH * MATRIX_HEIGHT)
+#define MATRIX_WIDTH	FB_WIDTH
+#define MATRIX_HEIGHT	FB_HEIGHT
+#define MATRIX_SIZE	FB_NUM_PIXELS
 
 #if STRIP_NUM_PIXELS != MATRIX_SIZE
 #error "LED strip chain length must match matrix size (WIDTH * HEIGHT)"
@@ -50,6 +51,10 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
 #define DELAY_TIME K_MSEC(CONFIG_SAMPLE_LED_UPDATE_DELAY)
 
+#if CONFIG_MATRIX_FRAME_RATE > 0
+#define FRAME_PERIOD_TICKS	k_us_to_ticks_ceil64(USEC_PER_SEC / CONFIG_MATRIX_FRAME_RATE)
+#endif
+
 #define RGB(_r, _g, _b) { .r = (_r), .g = (_g), .b = (_b) }
 
 // LSM6DSO I2C definitions
@@ -60,7 +65,6 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 #define LSM6DSO_REG_CTRL2_G  0x11
 #define LSM6DSO_REG_OUTX_L_XL 0x28
 
-static struct led_rgb pixels[STRIP_NUM_PIXELS];
 static const struct device *const strip = DEVICE_DT_GET(STRIP_NODE);
 static const struct device *i2c_dev;
 
@@ -80,112 +84,11 @@ static bool button_pressed = false;
 static const struct gpio_dt_spec button = GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios);
 
 /**
- * @brief Convert x,y matrix coordinates to linear pixel index
- * Each of 5 matrices is 8×6 pixels (48 LEDs) in its own raster format
- * Matrices are chained: Matrix 0 (pixels 0-47), Matrix 1 (48-95), etc.
- * @param x Column (0 to MATRIX_WIDTH-1, spans 5 matrices of 8 pixels each)
- * @param y Row (0 to MATRIX_HEIGHT-1, same for all matrices)
- * @return Linear index for the chained LED strip
- */
-static inline size_t xy_to_index(int x, int y)
-{
-	if (x < 0 || x >= MATRIX_WIDTH || y < 0 || y >= MATRIX_HEIGHT) {
-		return MATRIX_SIZE; // Out of bounds
-	}
-	
-	// Determine which 8×6 matrix this pixel belongs to
-	int matrix_num = x / 8;      // Which matrix (0-4)
-	int local_x = x % 8;         // X position within that matrix (0-7)
-	int local_y = y;             // Y position (0-5, same for all matrices)
-	
-	// Each matrix has 48 LEDs in raster format (row 0: 0-7, row 1: 8-15, etc.)
-	int matrix_offset = matrix_num * 48;
-	int pixel_in_matrix = local_y * 8 + local_x;
-	
-	return matrix_offset + pixel_in_matrix;
-}
-
-/**
- * @brief Set a single pixel in the matrix
- * @param x Column position
- * @param y Row position
- * @param color RGB color value
- */
-static void set_pixel(int x, int y, struct led_rgb color)
-{
-	size_t idx = xy_to_index(x, y);
-	if (idx < MATRIX_SIZE) {
-		memcpy(&pixels[idx], &color, sizeof(struct led_rgb));
-	}
-}
-
-/**
- * @brief Clear all pixels (set to black)
- */
-static void clear_matrix(void)
-{
-	memset(pixels, 0, sizeof(pixels));
-}
-
-/**
- * @brief Fill entire matrix with one color
- */
-static void fill_matrix(struct led_rgb color)
-{
-	for (size_t i = 0; i < MATRIX_SIZE; i++) {
-		memcpy(&pixels[i], &color, sizeof(struct led_rgb));
-	}
-}
-
-/**
- * @brief Draw a horizontal line
- */
-static void draw_hline(int x, int y, int width, struct led_rgb color)
-{
-	for (int i = 0; i < width; i++) {
-		set_pixel(x + i, y, color);
-	}
-}
-
-/**
- * @brief Draw a vertical line
- */
-static void draw_vline(int x, int y, int height, struct led_rgb color)
-{
-	for (int i = 0; i < height; i++) {
-		set_pixel(x, y + i, color);
-	}
-}
-
-/**
- * @brief Draw a rectangle outline
- */
-__attribute__((unused))
-static void draw_rect(int x, int y, int w, int h, struct led_rgb color)
-{
-	draw_hline(x, y, w, color);
-	draw_hline(x, y + h - 1, w, color);
-	draw_vline(x, y, h, color);
-	draw_vline(x + w - 1, y, h, color);
-}
-
-/**
- * @brief Fill a rectangle
- */
-__attribute__((unused))
-static void fill_rect(int x, int y, int w, int h, struct led_rgb color)
-{
-	for (int row = 0; row < h; row++) {
-		draw_hline(x, y + row, w, color);
-	}
-}
-
-/**
- * @brief Update the physical LED strip from the pixel buffer
+ * @brief Update the physical LED strip from the changed part of the framebuffer
  */
 static int update_display(void)
 {
-	return led_strip_update_rgb(strip, pixels, STRIP_NUM_PIXELS);
+	return fb_flush(strip);
 }
 
 /**
@@ -306,68 +209,17 @@ static void check_button(void)
 	}
 }
 
-/**
- * @brief Draw a character at position using 5x5 font
- */
-static void draw_char(int x, int y, char c, struct led_rgb color)
-{
-	// Convert lowercase to uppercase
-	if (c >= 'a' && c <= 'z') {
-		c = c - 'a' + 'A';
-	}
-	
-	// Check if character is in our font range (space to 'Z')
-	if (c < ' ' || c > 'Z') {
-		c = ' '; // Default to space for unsupported chars
-	}
-	
-	const uint8_t *glyph = font_5x5[c - ' '];
-	
-	for (int row = 0; row < 5; row++) {
-		for (int col = 0; col < 5; col++) {
-			if (glyph[row] & (1 << (4 - col))) {
-				set_pixel(x + col, y + row, color);
-			}
-		}
-	}
-}
-
-/**
- * @brief Draw a string with 6x5 character cells (5px char + 1px space)
- */
-static void draw_string(int x, int y, const char *str, struct led_rgb color)
-{
-	int cursor_x = x;
-	while (*str) {
-		draw_char(cursor_x, y, *str, color);
-		cursor_x += 6; // 5 pixels for char + 1 pixel spacing
-		str++;
-	}
-}
-
-/**
- * @brief Get pixel width of a string
- */
-__attribute__((unused))
-static int string_width(const char *str)
-{
-	int len = 0;
-	while (*str++) len++;
-	if (len == 0) return 0;
-	return len * 6 - 1; // 6 pixels per char, minus last space
-}
-
 /**
  * @brief Demo: Scrolling text
  */
 __attribute__((unused))
 static void demo_scrolling_text(int offset, const char *text, struct led_rgb color)
 {
-	clear_matrix();
+	fb_clear();
 	int x = MATRIX_WIDTH - offset;
 	
 	// Draw text centered vertically
-	draw_string(x, 1, text, color);
+	fb_draw_string(x, 1, text, color);
 }
 
 /**
@@ -375,12 +227,12 @@ static void demo_scrolling_text(int offset, const char *text, struct led_rgb col
  */
 static void render_liquid(struct led_rgb color)
 {
-	clear_matrix();
+	fb_clear();
 	
 	for (int y = 0; y < MATRIX_HEIGHT; y++) {
 		for (int x = 0; x < MATRIX_WIDTH; x++) {
 			if (water_physics_get_cell(x, y) == 1) {
-				set_pixel(x, y, color);
+				fb_set_pixel(x, y, color);
 			}
 		}
 	}
@@ -397,6 +249,8 @@ int main(void)
 		return 0;
 	}
 
+	fb_init();
+
 	// Initialize I2C and IMU
 	i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c30));
 	if (device_is_ready(i2c_dev)) {
@@ -428,25 +282,26 @@ int main(void)
 	animations_init(MATRIX_WIDTH, MATRIX_HEIGHT);
 	LOG_INF("Animations initialized");
 
-	LOG_INF("LED Matrix: %dx%d (%d pixels) in raster format", 
-		MATRIX_WIDTH, MATRIX_HEIGHT, MATRIX_SIZE);
+	LOG_INF("LED Matrix: %dx%d (%d pixels) of %dx%d panels",
+		MATRIX_WIDTH, MATRIX_HEIGHT, MATRIX_SIZE,
+		CONFIG_MATRIX_PANEL_WIDTH, CONFIG_MATRIX_PANEL_HEIGHT);
 	LOG_INF("Max power at brightness 105: ~1435 mA (safe for 5 matrices @ 1.5A)");
 	LOG_INF("Current brightness: %d", CONFIG_SAMPLE_LED_BRIGHTNESS);
 	
 	// Flash all LEDs briefly to confirm connection
-	fill_matrix((struct led_rgb)RGB(CONFIG_SAMPLE_LED_BRIGHTNESS, 0, 0));
+	fb_fill((struct led_rgb)RGB(CONFIG_SAMPLE_LED_BRIGHTNESS, 0, 0));
 	update_display();
 	k_msleep(200);
 	
-	fill_matrix((struct led_rgb)RGB(0, CONFIG_SAMPLE_LED_BRIGHTNESS, 0));
+	fb_fill((struct led_rgb)RGB(0, CONFIG_SAMPLE_LED_BRIGHTNESS, 0));
 	update_display();
 	k_msleep(200);
 	
-	fill_matrix((struct led_rgb)RGB(0, 0, CONFIG_SAMPLE_LED_BRIGHTNESS));
+	fb_fill((struct led_rgb)RGB(0, 0, CONFIG_SAMPLE_LED_BRIGHTNESS));
 	update_display();
 	k_msleep(200);
 	
-	clear_matrix();
+	fb_clear();
 	update_display();
 	k_msleep(500);
 
@@ -474,6 +329,8 @@ int main(void)
 	
 	int frame_counter = 0;
 	bool first_frame = true;
+	int64_t next_frame = k_uptime_ticks();
+	uint32_t frame_start = k_cycle_get_32();
 	
 	while (1) {
 		uint32_t current_time = k_uptime_get_32();
@@ -491,7 +348,7 @@ int main(void)
 		if (animation_mode) {
 			// Animation mode - process audio and render animations
 			audio_viz_process();
-			animations_update(pixels, tilt_x, tilt_y, delta_time);
+			animations_update(tilt_x, tilt_y, delta_time);
 		} else {
 			// Water simulation mode
 			if (first_frame) {
@@ -505,13 +362,33 @@ int main(void)
 			render_liquid(water_color);
 		}
 		
+		// Queue the frame, it is sent while the next one is rendered
 		rc = update_display();
 		if (rc) {
 			LOG_ERR("Couldn't update display: %d", rc);
 		}
 		
 		frame_counter++;
-		// No sleep - run as fast as possible, delta_time handles frame rate
+		uint32_t busy_cycles = k_cycle_get_32() - frame_start;
+
+#if CONFIG_MATRIX_FRAME_RATE > 0
+		// Start the next frame one period after this one, delta_time handles late frames
+		next_frame += FRAME_PERIOD_TICKS;
+		if (next_frame < k_uptime_ticks()) {
+			next_frame = k_uptime_ticks();
+		}
+		k_sleep(K_TIMEOUT_ABS_TICKS(next_frame));
+#endif
+
+		uint32_t now = k_cycle_get_32();
+
+#if defined(CONFIG_MATRIX_FRAME_STATS)
+		frame_stats_record(k_cyc_to_us_floor32(now - frame_start),
+				   k_cyc_to_us_floor32(busy_cycles));
+#else
+		ARG_UNUSED(busy_cycles);
+#endif
+		frame_start = now;
 	}
 
 	return 0;
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "onset.h"
+#include <string.h>
+#include <math.h>
+#include <zephyr/sys/util.h>
+
+// Onset envelope kept for the tempo estimation, a power of 2 (~4 s at 16 ms per frame)
+#define ENVELOPE_LEN        256
+#define TEMPO_INTERVAL      32      // Frames between two tempo estimates
+#define LAG_LIMIT           64      // Longest beat period in frames
+#define MAX_LAGS            (2 * LAG_LIMIT + 4)
+
+// Flux threshold: mean + THRESHOLD_DEVS * mean deviation + THRESHOLD_FLOOR, averaged over
+// about THRESHOLD_FRAMES frames
+#define THRESHOLD_FRAMES    32
+#define THRESHOLD_DEVS      3.5f
+#define THRESHOLD_FLOOR     20.0f
+#define MIN_ONSET_US        100000  // Onsets closer than this are merged
+
+#define PRIOR_BPM           120.0f  // Preferred tempo, against double and half tempo errors
+#define PERIOD_SMOOTHING    0.25f
+#define PHASE_GAIN          0.2f
+#define PHASE_CAPTURE       0.25f   // Largest phase error corrected by an onset, in beats
+
+static uint32_t frame_period_us;
+static int lag_min;
+static int lag_max;
+static float lag_weight[LAG_LIMIT + 1];
+
+static uint8_t prev_bands[ONSET_MAX_BANDS];
+static bool have_prev;
+
+// Spectral flux of the last frames, flux[0] being the newest
+static uint16_t flux[3];
+static float flux_mean;
+static float flux_dev;
+static int frames_since_onset;
+
+static uint16_t envelope[ENVELOPE_LEN];
+static uint32_t envelope_pos;  // Frames written, the newest is at (pos - 1) % LEN
+
+static float period;      // Frames per beat, 0 if unknown
+static float phase;       // 0-1 at the last frame, 0 being on the beat
+static uint8_t confidence;
+
+void onset_init(uint32_t frame_us)
+{
+	frame_period_us = frame_us;
+
+	// Beat periods in frames, for the BPM range
+	lag_min = MAX((int)ceilf(60000000.0f / (ONSET_MAX_BPM * frame_us)), 4);
+	lag_max = MIN((int)(60000000.0f / (ONSET_MIN_BPM * frame_us)), LAG_LIMIT);
+	lag_min = MIN(lag_min, lag_max);
+
+	// Log-normal prior around PRIOR_BPM, one octave wide
+	for (int lag = lag_min; lag <= lag_max; lag++) {
+		float octaves = log2f(60000000.0f / (lag * frame_us) / PRIOR_BPM);
+
+		lag_weight[lag] = expf(-0.5f * octaves * octaves);
+	}
+
+	memset(prev_bands, 0, sizeof(prev_bands));
+	memset(flux, 0, sizeof(flux));
+	memset(envelope, 0, sizeof(envelope));
+	have_prev = false;
+	flux_mean = 0.0f;
+	flux_dev = 0.0f;
+	frames_since_onset = 0;
+	envelope_pos = 0;
+	period = 0.0f;
+	phase = 0.0f;
+	confidence = 0;
+}
+
+static inline uint16_t envelope_at(uint32_t pos)
+{
+	return envelope[pos & (ENVELOPE_LEN - 1)];
+}
+
+/**
+ * @brief Autocorrelation of the onset envelope around a lag
+ *
+ * Onsets are single frame peaks in the envelope, so a beat period between two frames splits
+ * its correlation over two lags. Summing the neighbours keeps periods that are a whole number
+ * of frames from winning over the real one.
+ */
+static inline float acf_around(const float *acf, int lag)
+{
+	return acf[lag - 1] + acf[lag] + acf[lag + 1];
+}
+
+/**
+ * @brief Score of a beat period
+ *
+ * A pulse train at the beat period also correlates at twice the period, and subdivisions of
+ * the beat (eighth notes) correlate at half the period. A period of 1.5 beats, that only
+ * matches beats with off-beats, gets nothing at half its period.
+ */
+static inline float tempo_score(const float *acf, int lag)
+{
+	return (acf_around(acf, lag) + acf_around(acf, 2 * lag) +
+		0.5f * acf_around(acf, lag / 2)) / 2.5f;
+}
+
+/**
+ * @brief Find the beat phase that best matches the onset envelope, for the current period
+ * @return Phase at the newest envelope frame, 0-1
+ */
+static float comb_phase(void)
+{
+	uint32_t newest = envelope_pos - 1;
+	float best_sum = -1.0f;
+	int best = 0;
+
+	// Sum the envelope around every beat of the window, for each offset from the newest frame
+	for (int offset = 0; offset < (int)ceilf(period); offset++) {
+		float sum = 0.0f;
+
+		for (float back = offset; back < ENVELOPE_LEN - 2; back += period) {
+			uint32_t pos = newest - (uint32_t)roundf(back);
+
+			sum += envelope_at(pos - 1) + envelope_at(pos) + envelope_at(pos + 1);
+		}
+
+		if (sum > best_sum) {
+			best_sum = sum;
+			best = offset;
+		}
+	}
+
+	return best / period;
+}
+
+/**
+ * @brief Estimate the beat period from the autocorrelation of the onset envelope
+ */
+static void estimate_tempo(void)
+{
+	float acf[MAX_LAGS];
+	uint64_t energy = 0;
+	uint32_t start = envelope_pos - ENVELOPE_LEN;
+	int best = 0;
+
+	for (int i = 0; i < ENVELOPE_LEN; i++) {
+		uint32_t e = envelope_at(start + i);
+
+		energy += e * e;
+	}
+
+	if (energy == 0) {
+		confidence = 0;
+		return;
+	}
+
+	// Unbiased autocorrelation normalized by the energy, up to twice the longest period
+	acf[0] = 1.0f;
+	for (int lag = 1; lag <= 2 * lag_max + 3; lag++) {
+		uint64_t sum = 0;
+
+		for (int i = lag; i < ENVELOPE_LEN; i++) {
+			sum += (uint32_t)envelope_at(start + i) * envelope_at(start + i - lag);
+		}
+
+		acf[lag] = (float)sum * ENVELOPE_LEN / ((ENVELOPE_LEN - lag) * (float)energy);
+	}
+
+	for (int lag = lag_min; lag <= lag_max; lag++) {
+		if (best == 0 || tempo_score(acf, lag) * lag_weight[lag] >
+				 tempo_score(acf, best) * lag_weight[best]) {
+			best = lag;
+		}
+	}
+
+	// Parabolic interpolation of the peak, for a period between two frames
+	float left = tempo_score(acf, best - 1);
+	float center = tempo_score(acf, best);
+	float right = tempo_score(acf, best + 1);
+	float denom = left - 2.0f * center + right;
+	float offset = (denom < 0.0f) ? 0.5f * (left - right) / denom : 0.0f;
+	float new_period = best + CLAMP(offset, -0.5f, 0.5f);
+
+	confidence = (uint8_t)CLAMP(center * 255.0f, 0.0f, 255.0f);
+
+	// Follow small tempo drifts smoothly, jump on tempo changes
+	if (period == 0.0f || fabsf(new_period - period) > 0.1f * period) {
+		period = new_period;
+	} else {
+		period += PERIOD_SMOOTHING * (new_period - period);
+	}
+
+	// Onsets only correct small phase errors, resync the phase if it is further off
+	float target = comb_phase();
+	float error = phase - target;
+
+	error -= floorf(error + 0.5f);
+	if (fabsf(error) >= PHASE_CAPTURE) {
+		phase = target;
+	}
+}
+
+/**
+ * @brief Pull the beat phase toward an onset that happened in the previous frame
+ */
+static void align_phase(void)
+{
+	float error = phase - 1.0f / period;
+
+	error -= floorf(error + 0.5f);
+
+	// Onsets between beats (off-beat hi-hats) don't move the phase
+	if (fabsf(error) < PHASE_CAPTURE) {
+		phase -= PHASE_GAIN * error;
+		phase -= floorf(phase);
+	}
+}
+
+bool onset_process(const uint8_t *bands, int num_bands)
+{
+	uint32_t sum = 0;
+	bool onset = false;
+
+	num_bands = MIN(num_bands, ONSET_MAX_BANDS);
+
+	// Spectral flux: only increasing bands count, decays aren't onsets
+	if (have_prev) {
+		for (int i = 0; i < num_bands; i++) {
+			if (bands[i] > prev_bands[i]) {
+				sum += bands[i] - prev_bands[i];
+			}
+		}
+	}
+
+	memcpy(prev_bands, bands, num_bands);
+	have_prev = true;
+
+	flux[2] = flux[1];
+	flux[1] = flux[0];
+	flux[0] = MIN(sum, UINT16_MAX);
+	frames_since_onset++;
+
+	// Peak picking on the previous frame, once the next one is known
+	float threshold = flux_mean + THRESHOLD_DEVS * flux_dev + THRESHOLD_FLOOR;
+
+	if (flux[1] > threshold && flux[1] > flux[2] && flux[1] >= flux[0] &&
+	    (uint32_t)frames_since_onset * frame_period_us >= MIN_ONSET_US) {
+		onset = true;
+		frames_since_onset = 0;
+	}
+
+	// The envelope keeps the flux above the threshold, the rest is noise
+	envelope[envelope_pos & (ENVELOPE_LEN - 1)] = (uint16_t)MAX(flux[1] - threshold, 0.0f);
+	envelope_pos++;
+
+	flux_mean += (flux[1] - flux_mean) / THRESHOLD_FRAMES;
+	flux_dev += (fabsf(flux[1] - flux_mean) - flux_dev) / THRESHOLD_FRAMES;
+
+	if (envelope_pos >= ENVELOPE_LEN && envelope_pos % TEMPO_INTERVAL == 0) {
+		estimate_tempo();
+	}
+
+	if (period > 0.0f) {
+		phase += 1.0f / period;
+		phase -= floorf(phase);
+
+		if (onset) {
+			align_phase();
+		}
+	}
+
+	return onset;
+}
+
+uint16_t onset_get_bpm(void)
+{
+	if (period == 0.0f) {
+		return 0;
+	}
+
+	return (uint16_t)roundf(60000000.0f / (period * frame_period_us));
+}
+
+uint8_t onset_get_confidence(void)
+{
+	return confidence;
+}
+
+uint8_t onset_get_phase(uint32_t us_since_frame)
+{
+	if (period == 0.0f) {
+		return 0;
+	}
+
+	float p = phase + (float)us_since_frame / frame_period_us / period;
+
+	return (uint8_t)((p - floorf(p)) * 256.0f);
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ONSET_H_
+#define ONSET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Onset detection and tempo tracking from the band levels of each FFT frame.
+ *
+ * Onsets are peaks of the spectral flux (sum of the level increases of all bands since the
+ * previous frame) above an adaptive threshold, so sustained sound doesn't trigger them and
+ * high frequency onsets count as much as bass. The tempo is the strongest period of the
+ * autocorrelation of the onset envelope over the last few seconds, between ONSET_MIN_BPM and
+ * ONSET_MAX_BPM. A beat phase runs at that tempo and is pulled toward the detected onsets.
+ */
+
+#define ONSET_MAX_BANDS  40
+#define ONSET_MIN_BPM    60
+#define ONSET_MAX_BPM    180
+
+/**
+ * @brief Reset the detector
+ * @param frame_us Time between two frames in microseconds
+ */
+void onset_init(uint32_t frame_us);
+
+/**
+ * @brief Process the band levels of the next frame
+ * @param bands Band levels 0-255
+ * @param num_bands Number of bands, up to ONSET_MAX_BANDS
+ * @return true if an onset was detected, in the previous frame
+ */
+bool onset_process(const uint8_t *bands, int num_bands);
+
+/**
+ * @brief Get the estimated tempo
+ * @return Beats per minute, 0 if no tempo was found yet
+ */
+uint16_t onset_get_bpm(void);
+
+/**
+ * @brief Get how periodic the onsets are at the estimated tempo
+ * @return Confidence 0-255
+ */
+uint8_t onset_get_confidence(void);
+
+/**
+ * @brief Get the beat phase
+ * @param us_since_frame Time elapsed since the last processed frame, in microseconds
+ * @return Phase 0-255, 0 being on the beat, 0 if no tempo was found yet
+ */
+uint8_t onset_get_phase(uint32_t us_since_frame);
+
+#endif /* ONSET_H_ */
@@ -7,6 +7,7 @@
 
 #include "water_physics.h"
 #include "font_5x5.h"
+#include "fixed_point.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,11 +15,18 @@
 
 // Particle structure (inspired by Powder Toy)
 typedef struct {
-	float vx;        // Velocity X
-	float vy;        // Velocity Y
+	phys_t vx;       // Velocity X
+	phys_t vy;       // Velocity Y
 	uint8_t flags;   // Flags for stagnation, etc.
+	uint8_t idle;    // Frames since the particle last moved
 } water_particle_t;
 
+// Range of columns to process in a row, empty if x0 > x1
+typedef struct {
+	int16_t x0;
+	int16_t x1;
+} row_span_t;
+
 // Flags
 #define FLAG_STAGNANT   0x01  // Particle hasn't moved recently
 #define FLAG_ACTIVE     0x02  // Particle moved this frame
@@ -30,18 +38,100 @@ static int matrix_width = 0;
 static int matrix_height = 0;
 static int initial_fill = 0;
 
+// Active regions: only cells near a recent move are processed, settled water is skipped
+static row_span_t *active = NULL;       // Cells to process this frame
+static row_span_t *next_active = NULL;  // Cells to process next frame
+
 // Physics constants (inspired by Powder Toy WATR element)
-#define GRAVITY         0.5f    // Gravity constant (scaled for small grid)
-#define COLLISION_LOSS  0.75f   // Velocity loss on collision
-#define VELOCITY_LOSS   0.95f   // Velocity dampening per frame
-#define MAX_VELOCITY    4.0f    // Maximum velocity
+#define GRAVITY         PHYS(0.5f)    // Gravity constant (scaled for small grid)
+#define COLLISION_LOSS  PHYS(0.75f)   // Velocity loss on collision
+#define VELOCITY_LOSS   PHYS(0.95f)   // Velocity dampening per frame
+#define MAX_VELOCITY    PHYS(4.0f)    // Maximum velocity
+#define MOVE_THRESHOLD  PHYS(0.3f)    // Minimum velocity to move
 #define SPREAD_RANGE    12      // How far to look for spreading (like Powder Toy's rt)
+#define WAKE_RANGE      4       // Cells around a move to wake up, MAX_VELOCITY rounded
+#define SETTLE_FRAMES   8       // Frames without moving before a particle is skipped
+#define WAKE_GRAVITY    PHYS(0.02f)   // Gravity change that wakes up all particles
 
 // Tilt state for gravity direction
 static float tilt_x = 0.0f;  // Roll (left/right)
 static float tilt_y = 0.0f;  // Pitch (forward/backward)
-static float grav_x = 0.0f;  // Gravity vector X
-static float grav_y = 1.0f;  // Gravity vector Y (default down)
+static phys_t grav_x = PHYS(0.0f);  // Gravity vector X
+static phys_t grav_y = PHYS(1.0f);  // Gravity vector Y (default down)
+static phys_t wake_grav_x;          // Gravity when all particles were last woken up
+static phys_t wake_grav_y;
+
+static inline void span_clear_all(row_span_t *spans)
+{
+	for (int y = 0; y < matrix_height; y++) {
+		spans[y].x0 = matrix_width;
+		spans[y].x1 = -1;
+	}
+}
+
+static inline void span_add(row_span_t *span, int x0, int x1)
+{
+	if (x0 < 0) x0 = 0;
+	if (x1 >= matrix_width) x1 = matrix_width - 1;
+	if (x0 < span->x0) span->x0 = x0;
+	if (x1 > span->x1) span->x1 = x1;
+}
+
+/**
+ * @brief Process every cell in the next frame
+ *
+ * Settled particles are also processed again until their velocity has settled under the
+ * new gravity, as a small velocity can round to no move and would leave them stranded.
+ */
+static void wake_all(void)
+{
+	for (int y = 0; y < matrix_height; y++) {
+		span_add(&next_active[y], 0, matrix_width - 1);
+	}
+
+	for (int i = 0; i < matrix_width * matrix_height; i++) {
+		particles[i].idle = 0;
+	}
+
+	wake_grav_x = grav_x;
+	wake_grav_y = grav_y;
+}
+
+/**
+ * @brief Process the cells next frame that a change of cell (x, y) can affect
+ *
+ * Particles can move up to WAKE_RANGE cells into the cell by velocity, and spread up to
+ * SPREAD_RANGE columns into the cell or onto the cell below or above it.
+ */
+static void wake_around(int x, int y)
+{
+	int y0 = (y - WAKE_RANGE < 0) ? 0 : y - WAKE_RANGE;
+	int y1 = (y + WAKE_RANGE >= matrix_height) ? matrix_height - 1 : y + WAKE_RANGE;
+
+	for (int row = y0; row <= y1; row++) {
+		int range = (row >= y - 1 && row <= y + 1) ? SPREAD_RANGE : WAKE_RANGE;
+
+		span_add(&next_active[row], x - range, x + range);
+	}
+}
+
+static int alloc_state(int width, int height)
+{
+	grid = (uint8_t *)malloc(width * height * sizeof(uint8_t));
+	particles = (water_particle_t *)malloc(width * height * sizeof(water_particle_t));
+	active = (row_span_t *)malloc(height * sizeof(row_span_t));
+	next_active = (row_span_t *)malloc(height * sizeof(row_span_t));
+
+	if (!grid || !particles || !active || !next_active) {
+		water_physics_deinit();
+		return -1;
+	}
+
+	span_clear_all(active);
+	span_clear_all(next_active);
+
+	return 0;
+}
 
 /**
  * @brief Initialize the water physics simulation
@@ -57,12 +147,7 @@ int water_physics_init(int width, int height, int initial_fill_rows)
 	initial_fill = initial_fill_rows;
 
 	// Allocate grids
-	grid = (uint8_t *)malloc(width * height * sizeof(uint8_t));
-	particles = (water_particle_t *)malloc(width * height * sizeof(water_particle_t));
-
-	if (!grid || !particles) {
-		if (grid) free(grid);
-		if (particles) free(particles);
+	if (alloc_state(width, height) != 0) {
 		return -1;
 	}
 
@@ -85,17 +170,24 @@ void water_physics_set_tilt(float new_tilt_x, float new_tilt_y)
 	// tilt_y = pitch (rotation around X axis) - affects forward/back tilt
 	
 	// Use sin/cos to properly convert angle to gravity components
-	float angle_rad_x = tilt_x * 3.14159f / 180.0f;
-	float angle_rad_y = tilt_y * 3.14159f / 180.0f;
+	phys_angle_t angle_x = PHYS_ANGLE_DEG(tilt_x);
+	phys_angle_t angle_y = PHYS_ANGLE_DEG(tilt_y);
 	
 	// Calculate gravity vector based on orientation
 	// X component: left/right gravity (from roll)
 	// Y component: up/down gravity (from roll, inverted when upside down)
-	grav_x = sinf(angle_rad_x) * GRAVITY;
-	grav_y = cosf(angle_rad_x) * GRAVITY;
+	grav_x = PHYS_MUL(PHYS_SIN(angle_x), GRAVITY);
+	grav_y = PHYS_MUL(PHYS_COS(angle_x), GRAVITY);
 	
 	// Add forward/back tilt influence on X axis
-	grav_x -= sinf(angle_rad_y) * GRAVITY * 0.5f;
+	grav_x = PHYS_SUB(grav_x, PHYS_MUL(PHYS_MUL(PHYS_SIN(angle_y), GRAVITY), PHYS(0.5f)));
+
+	// Settled water only needs to be processed again if gravity changed noticeably
+	if (next_active &&
+	    (PHYS_ABS(PHYS_SUB(grav_x, wake_grav_x)) > WAKE_GRAVITY ||
+	     PHYS_ABS(PHYS_SUB(grav_y, wake_grav_y)) > WAKE_GRAVITY)) {
+		wake_all();
+	}
 }
 
 /**
@@ -112,12 +204,7 @@ int water_physics_init_text(int width, int height, const char *text)
 	initial_fill = 0;  // No bottom fill for text mode
 
 	// Allocate grids
-	grid = (uint8_t *)malloc(width * height * sizeof(uint8_t));
-	particles = (water_particle_t *)malloc(width * height * sizeof(water_particle_t));
-
-	if (!grid || !particles) {
-		if (grid) free(grid);
-		if (particles) free(particles);
+	if (alloc_state(width, height) != 0) {
 		return -1;
 	}
 
@@ -157,6 +244,8 @@ int water_physics_init_text(int width, int height, const char *text)
 		}
 	}
 
+	wake_all();
+
 	return 0;
 }
 
@@ -191,11 +280,13 @@ void water_physics_reset(void)
 		for (int x = 0; x < matrix_width; x++) {
 			int idx = y * matrix_width + x;
 			grid[idx] = 1;
-			particles[idx].vx = 0.0f;
-			particles[idx].vy = 0.0f;
+			particles[idx].vx = PHYS(0.0f);
+			particles[idx].vy = PHYS(0.0f);
 			particles[idx].flags = 0;
 		}
 	}
+
+	wake_all();
 }
 
 /**
@@ -219,7 +310,12 @@ static int try_move(int old_x, int old_y, int new_x, int new_y)
 		grid[old_idx] = 0;
 		particles[new_idx] = particles[old_idx];
 		particles[new_idx].flags |= FLAG_ACTIVE;
+		particles[new_idx].idle = 0;
 		memset(&particles[old_idx], 0, sizeof(water_particle_t));
+
+		// Neighbours of both cells may be able to move now
+		wake_around(old_x, old_y);
+		wake_around(new_x, new_y);
 		return 1;
 	}
 
@@ -229,10 +325,10 @@ static int try_move(int old_x, int old_y, int new_x, int new_y)
 /**
  * @brief Clamp velocity to maximum
  */
-static inline float clamp_velocity(float v)
+static inline phys_t clamp_velocity(phys_t v)
 {
 	if (v > MAX_VELOCITY) return MAX_VELOCITY;
-	if (v < -MAX_VELOCITY) return -MAX_VELOCITY;
+	if (v < PHYS_NEG(MAX_VELOCITY)) return PHYS_NEG(MAX_VELOCITY);
 	return v;
 }
 
@@ -245,9 +341,18 @@ void water_physics_update(void)
 		return;
 	}
 
-	// Clear active flags from previous frame
-	for (int i = 0; i < matrix_width * matrix_height; i++) {
-		particles[i].flags &= ~FLAG_ACTIVE;
+	// Process the regions woken up during the previous frame. All particles that moved
+	// are in these regions, so only these need their active flags cleared.
+	row_span_t *spans = next_active;
+
+	next_active = active;
+	active = spans;
+	span_clear_all(next_active);
+
+	for (int y = 0; y < matrix_height; y++) {
+		for (int x = active[y].x0; x <= active[y].x1; x++) {
+			particles[y * matrix_width + x].flags &= ~FLAG_ACTIVE;
+		}
 	}
 
 	// Process particles in random-ish order to avoid directional bias
@@ -259,7 +364,7 @@ void water_physics_update(void)
 	int y_end = (scan_dir > 0) ? matrix_height : -1;
 
 	for (int y = y_start; y != y_end; y += scan_dir) {
-		for (int x = 0; x < matrix_width; x++) {
+		for (int x = active[y].x0; x <= active[y].x1; x++) {
 			int idx = y * matrix_width + x;
 			
 			if (grid[idx] == 0) continue;  // Empty cell
@@ -268,23 +373,23 @@ void water_physics_update(void)
 			water_particle_t *p = &particles[idx];
 			
 			// Apply gravity
-			p->vx += grav_x;
-			p->vy += grav_y;
+			p->vx = PHYS_ADD(p->vx, grav_x);
+			p->vy = PHYS_ADD(p->vy, grav_y);
 
 			// Clamp velocities
 			p->vx = clamp_velocity(p->vx);
 			p->vy = clamp_velocity(p->vy);
 
 			// Apply velocity dampening AFTER gravity
-			p->vx *= VELOCITY_LOSS;
-			p->vy *= VELOCITY_LOSS;
+			p->vx = PHYS_MUL(p->vx, VELOCITY_LOSS);
+			p->vy = PHYS_MUL(p->vy, VELOCITY_LOSS);
 
 			// Calculate target position (favor movement even with small velocities)
 			int new_x = x;
 			int new_y = y;
 			
-			if (fabsf(p->vx) > 0.3f) new_x = x + (int)roundf(p->vx);
-			if (fabsf(p->vy) > 0.3f) new_y = y + (int)roundf(p->vy);
+			if (PHYS_ABS(p->vx) > MOVE_THRESHOLD) new_x = x + PHYS_ROUND(p->vx);
+			if (PHYS_ABS(p->vy) > MOVE_THRESHOLD) new_y = y + PHYS_ROUND(p->vy);
 
 			// Clamp to bounds
 			if (new_x < 0) new_x = 0;
@@ -301,7 +406,7 @@ void water_physics_update(void)
 			// If blocked, try falling straight down
 			if (new_x == x && new_y == y) {
 				// No movement calculated, try direct fall
-				if (grav_y > 0.1f && try_move(x, y, x, y + 1)) {
+				if (grav_y > PHYS(0.1f) && try_move(x, y, x, y + 1)) {
 					p->flags &= ~FLAG_STAGNANT;
 					continue;
 				}
@@ -309,7 +414,7 @@ void water_physics_update(void)
 
 			// If still blocked, try spreading horizontally (Powder Toy style)
 			// Only spread if we were trying to move down
-			if (fabsf(grav_y) > 0.5f || fabsf(p->vy) > 0.5f) {
+			if (PHYS_ABS(grav_y) > PHYS(0.5f) || PHYS_ABS(p->vy) > PHYS(0.5f)) {
 				bool stagnant = (p->flags & FLAG_STAGNANT);
 				int range = stagnant ? 3 : SPREAD_RANGE;  // Reduce range for stagnant particles
 				
@@ -325,12 +430,12 @@ void water_physics_update(void)
 						int try_idx = y * matrix_width + try_x;
 						if (grid[try_idx] == 0) {
 							// Check if there's water below to rest on
-							int below_y = y + (int)roundf(grav_y);
+							int below_y = y + PHYS_ROUND(grav_y);
 							if (below_y < 0 || below_y >= matrix_height || 
 							    grid[below_y * matrix_width + try_x] != 0) {
 								if (try_move(x, y, try_x, y)) {
-									p->vx = (float)dir * 0.5f;  // Give it sideways velocity
-									p->vy *= COLLISION_LOSS;
+									p->vx = PHYS_MUL_INT(PHYS(0.5f), dir);  // Give it sideways velocity
+									p->vy = PHYS_MUL(p->vy, COLLISION_LOSS);
 									p->flags &= ~FLAG_STAGNANT;
 									moved = true;
 									break;
@@ -344,12 +449,12 @@ void water_physics_update(void)
 					if (try_x >= 0 && try_x < matrix_width) {
 						int try_idx = y * matrix_width + try_x;
 						if (grid[try_idx] == 0) {
-							int below_y = y + (int)roundf(grav_y);
+							int below_y = y + PHYS_ROUND(grav_y);
 							if (below_y < 0 || below_y >= matrix_height || 
 							    grid[below_y * matrix_width + try_x] != 0) {
 								if (try_move(x, y, try_x, y)) {
-									p->vx = (float)(-dir) * 0.5f;
-									p->vy *= COLLISION_LOSS;
+									p->vx = PHYS_MUL_INT(PHYS(0.5f), -dir);
+									p->vy = PHYS_MUL(p->vy, COLLISION_LOSS);
 									p->flags &= ~FLAG_STAGNANT;
 									moved = true;
 									break;
@@ -362,15 +467,21 @@ void water_physics_update(void)
 				if (!moved) {
 					// Particle couldn't move at all - mark as stagnant
 					p->flags |= FLAG_STAGNANT;
-					p->vx *= 0.5f;  // Slow down stagnant particles
-					p->vy *= 0.5f;
+					p->vx = PHYS_MUL(p->vx, PHYS(0.5f));  // Slow down stagnant particles
+					p->vy = PHYS_MUL(p->vy, PHYS(0.5f));
 				}
 			} else {
 				// Moving mostly horizontally, dampen and mark stagnant
-				p->vx *= COLLISION_LOSS;
-				p->vy *= COLLISION_LOSS;
+				p->vx = PHYS_MUL(p->vx, COLLISION_LOSS);
+				p->vy = PHYS_MUL(p->vy, COLLISION_LOSS);
 				p->flags |= FLAG_STAGNANT;
 			}
+
+			// Keep processing a blocked particle until its velocity has settled
+			if (grid[idx] != 0 && p->idle < SETTLE_FRAMES) {
+				p->idle++;
+				span_add(&next_active[y], x, x);
+			}
 		}
 	}
 }
@@ -388,6 +499,10 @@ void water_physics_deinit(void)
 		free(particles);
 		particles = NULL;
 	}
+	free(active);
+	free(next_active);
+	active = NULL;
+	next_active = NULL;
 	matrix_width = 0;
 	matrix_height = 0;
 }
@@ -44,6 +44,8 @@ void water_physics_set_tilt(float tilt_x, float tilt_y);
  * - Gravity influences velocity
  * - Horizontal spreading when particles can't fall
  * - Stagnation detection for performance
+ * - Settled regions are skipped, only cells near recent movement or a tilt change
+ *   are processed
  * - Collision dampening
  */
 void water_physics_update(void);
@@ -0,0 +1,686 @@
+/*
+ * Copyright (c) 2025 Water Physics Module
+ * Inspired by The Powder Toy's liquid simulation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Bitboard implementation of the water physics API.
+ *
+ * Occupancy is stored as one bit per cell, in rows of 64-bit words. The state of each
+ * particle (speed, stagnation) is stored in bit planes with the same layout, which are
+ * moved together with the occupancy bits. All particles of a row are moved with one
+ * shift-and-mask per word, so the cost of a frame depends on the number of rows and
+ * steps, not on the number of particles.
+ */
+
+#include "water_physics.h"
+#include "font_5x5.h"
+#include "fixed_point.h"
+#include <string.h>
+#include <stdlib.h>
+
+typedef uint64_t bb_word_t;
+#define BB_WORD_BITS    64
+
+// Bit planes, each with one bit per cell
+enum {
+	PLANE_OCC,       // Cell contains water
+	PLANE_SPEED0,    // Speed along gravity, bit-sliced over SPEED_BITS planes
+	PLANE_SPEED1,
+	PLANE_SPEED2,
+	PLANE_STAGNANT,  // Particle didn't move last frame
+	PLANE_MOVED,     // Particle moved this frame
+	NUM_PLANES
+};
+
+// Speed is in half cells per frame (fixed point with 1 fractional bit)
+#define SPEED_BITS      3
+#define SPEED_MAX       ((1 << SPEED_BITS) - 1)
+
+// Physics constants (inspired by Powder Toy WATR element)
+#define FALL_STEPS      4       // Cells moved per frame at max speed, like MAX_VELOCITY
+#define SPREAD_RANGE    12      // How far to look for spreading (like Powder Toy's rt)
+#define STAGNANT_RANGE  3       // Reduced spread range for stagnant particles
+#define GRAVITY         PHYS(0.5f)    // Same gravity vector as the per-cell engine
+#define GRAVITY_AXIS    PHYS(0.2f)    // Gravity component needed to fall along an axis
+
+// Water simulation state
+static bb_word_t *planes = NULL;   // NUM_PLANES grids
+static bb_word_t *scratch = NULL;  // Candidate, stopped and reach grids, and temporary rows
+static bb_word_t *cand = NULL;     // Particles taking part in the current step
+static bb_word_t *stopped = NULL;  // Particles blocked while falling this frame
+static bb_word_t *reach = NULL;    // Blocked particles in a row with an opening
+static bb_word_t *row_tmp[3];
+static int matrix_width = 0;
+static int matrix_height = 0;
+static int initial_fill = 0;
+static int row_words = 0;
+static int grid_words = 0;
+static bb_word_t last_word_mask;
+static bool frame_parity;
+
+// Movement directions, derived from the tilt
+struct dir {
+	int dx;
+	int dy;
+};
+
+static struct dir fall = {0, 1};                      // Direction of gravity
+static struct dir slide[2] = {{-1, 1}, {1, 1}};       // Falling sideways when blocked
+static struct dir spread = {1, 0};                    // Perpendicular to gravity
+
+// Which empty cells a particle can move into
+enum move_target {
+	TARGET_ANY,
+	TARGET_SUPPORTED,  // Cells with water or a wall next to them in the gravity direction
+	TARGET_OPEN,       // Cells with an empty cell next to them in the gravity direction
+};
+
+static inline bb_word_t *plane_row(int plane, int y)
+{
+	return &planes[plane * grid_words + y * row_words];
+}
+
+static inline bb_word_t *grid_row(bb_word_t *grid, int y)
+{
+	return &grid[y * row_words];
+}
+
+static inline int bb_count(bb_word_t word)
+{
+	return __builtin_popcountll(word);
+}
+
+static bool row_any(const bb_word_t *row)
+{
+	bb_word_t any = 0;
+
+	for (int i = 0; i < row_words; i++) {
+		any |= row[i];
+	}
+
+	return any != 0;
+}
+
+/**
+ * @brief Shift a row by n columns, so that dst bit x = src bit (x - n)
+ */
+static void row_shift(bb_word_t *dst, const bb_word_t *src, int n)
+{
+	int shift = abs(n);
+	int word_shift = shift / BB_WORD_BITS;
+	int bit_shift = shift % BB_WORD_BITS;
+
+	for (int i = 0; i < row_words; i++) {
+		bb_word_t v = 0;
+
+		if (n >= 0) {
+			int s = i - word_shift;
+
+			if (s >= 0) {
+				v = src[s] << bit_shift;
+				if (bit_shift && s > 0) {
+					v |= src[s - 1] >> (BB_WORD_BITS - bit_shift);
+				}
+			}
+		} else {
+			int s = i + word_shift;
+
+			if (s < row_words) {
+				v = src[s] >> bit_shift;
+				if (bit_shift && s + 1 < row_words) {
+					v |= src[s + 1] << (BB_WORD_BITS - bit_shift);
+				}
+			}
+		}
+
+		dst[i] = v;
+	}
+
+	dst[row_words - 1] &= last_word_mask;
+}
+
+/**
+ * @brief Get the cells of row y whose neighbour in the gravity direction is water or a wall
+ */
+static void support_row(bb_word_t *dst, int y)
+{
+	int below_y = y + fall.dy;
+
+	if (below_y < 0 || below_y >= matrix_height) {
+		for (int i = 0; i < row_words; i++) {
+			dst[i] = ~(bb_word_t)0;
+		}
+		dst[row_words - 1] &= last_word_mask;
+		return;
+	}
+
+	row_shift(dst, plane_row(PLANE_OCC, below_y), -fall.dx);
+
+	// The side walls support cells next to them
+	if (fall.dx > 0) {
+		int x = matrix_width - 1;
+
+		dst[x / BB_WORD_BITS] |= (bb_word_t)1 << (x % BB_WORD_BITS);
+	} else if (fall.dx < 0) {
+		dst[0] |= 1;
+	}
+}
+
+/**
+ * @brief Move particles by (dx, dy) cells into empty cells
+ *
+ * Each particle moves at most once. Moved particles are removed from src and marked in
+ * PLANE_MOVED, so src holds the particles that were blocked on return.
+ *
+ * @param src Grid of the particles to move, a subset of PLANE_OCC
+ * @param dx Number of columns to move
+ * @param dy Number of rows to move
+ * @param targets Empty cells that particles can move into
+ */
+static void bb_move(bb_word_t *src, int dx, int dy, enum move_target targets)
+{
+	bb_word_t *target = row_tmp[0];
+	bb_word_t *source = row_tmp[1];
+	bb_word_t *carry = row_tmp[2];
+
+	if (abs(dx) >= matrix_width || abs(dy) >= matrix_height) {
+		return;
+	}
+
+	// Rows are processed so that a target row has already been processed, which lets
+	// a column of falling particles move together without moving any particle twice
+	for (int i = 0; i < matrix_height; i++) {
+		int y = (dy > 0) ? matrix_height - 1 - i : i;
+		int ty = y + dy;
+		bb_word_t *src_row = grid_row(src, y);
+
+		if (ty < 0 || ty >= matrix_height || !row_any(src_row)) {
+			continue;
+		}
+
+		row_shift(target, src_row, dx);
+
+		const bb_word_t *occ = plane_row(PLANE_OCC, ty);
+
+		for (int w = 0; w < row_words; w++) {
+			target[w] &= ~occ[w];
+		}
+
+		if (targets != TARGET_ANY) {
+			bb_word_t open = (targets == TARGET_OPEN) ? ~(bb_word_t)0 : 0;
+
+			support_row(carry, ty);
+			for (int w = 0; w < row_words; w++) {
+				target[w] &= carry[w] ^ open;
+			}
+		}
+
+		if (!row_any(target)) {
+			continue;
+		}
+
+		row_shift(source, target, -dx);
+
+		// Targets are empty, so all their plane bits are clear
+		for (int p = 0; p < NUM_PLANES; p++) {
+			bb_word_t *from = plane_row(p, y);
+			bb_word_t *to = plane_row(p, ty);
+
+			row_shift(carry, from, dx);
+			for (int w = 0; w < row_words; w++) {
+				from[w] &= ~source[w];
+				to[w] |= carry[w] & target[w];
+			}
+		}
+
+		bb_word_t *moved = plane_row(PLANE_MOVED, ty);
+
+		for (int w = 0; w < row_words; w++) {
+			moved[w] |= target[w];
+			src_row[w] &= ~source[w];
+		}
+	}
+}
+
+/**
+ * @brief Get the particles of word i with speed >= min
+ */
+static bb_word_t speed_at_least(int i, unsigned int min)
+{
+	bb_word_t gt = 0;
+	bb_word_t eq = ~(bb_word_t)0;
+
+	for (int b = SPEED_BITS - 1; b >= 0; b--) {
+		bb_word_t bit = planes[(PLANE_SPEED0 + b) * grid_words + i];
+
+		if (min & (1U << b)) {
+			eq &= bit;
+		} else {
+			gt |= eq & bit;
+			eq &= ~bit;
+		}
+	}
+
+	return gt | eq;
+}
+
+/**
+ * @brief Add half a cell per frame to the speed of all particles, saturating at SPEED_MAX
+ */
+static void speed_accelerate(void)
+{
+	for (int i = 0; i < grid_words; i++) {
+		bb_word_t carry = planes[PLANE_OCC * grid_words + i];
+
+		carry &= ~speed_at_least(i, SPEED_MAX);
+
+		for (int b = 0; b < SPEED_BITS; b++) {
+			bb_word_t *bit = &planes[(PLANE_SPEED0 + b) * grid_words + i];
+			bb_word_t sum = *bit ^ carry;
+
+			carry &= *bit;
+			*bit = sum;
+		}
+	}
+}
+
+/**
+ * @brief Halve the speed of the particles in word i of mask (collision loss)
+ */
+static void speed_halve(int i, bb_word_t mask)
+{
+	for (int b = 0; b < SPEED_BITS; b++) {
+		bb_word_t *bit = &planes[(PLANE_SPEED0 + b) * grid_words + i];
+		bb_word_t upper = (b + 1 < SPEED_BITS) ?
+			planes[(PLANE_SPEED0 + b + 1) * grid_words + i] : 0;
+
+		*bit = (*bit & ~mask) | (upper & mask);
+	}
+}
+
+static void set_cell(int x, int y)
+{
+	plane_row(PLANE_OCC, y)[x / BB_WORD_BITS] |= (bb_word_t)1 << (x % BB_WORD_BITS);
+}
+
+static int alloc_grids(int width, int height)
+{
+	water_physics_deinit();
+
+	matrix_width = width;
+	matrix_height = height;
+	row_words = (width + BB_WORD_BITS - 1) / BB_WORD_BITS;
+	grid_words = row_words * height;
+	last_word_mask = (width % BB_WORD_BITS) ?
+		(((bb_word_t)1 << (width % BB_WORD_BITS)) - 1) : ~(bb_word_t)0;
+
+	planes = (bb_word_t *)calloc(NUM_PLANES * grid_words, sizeof(bb_word_t));
+	scratch = (bb_word_t *)calloc(3 * grid_words + 3 * row_words, sizeof(bb_word_t));
+
+	if (!planes || !scratch) {
+		water_physics_deinit();
+		return -1;
+	}
+
+	cand = scratch;
+	stopped = &scratch[grid_words];
+	reach = &scratch[2 * grid_words];
+	for (int i = 0; i < 3; i++) {
+		row_tmp[i] = &scratch[3 * grid_words + i * row_words];
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Initialize the water physics simulation
+ */
+int water_physics_init(int width, int height, int initial_fill_rows)
+{
+	if (width <= 0 || height <= 0) {
+		return -1;
+	}
+
+	if (alloc_grids(width, height) != 0) {
+		return -1;
+	}
+
+	initial_fill = initial_fill_rows;
+
+	// Initialize with water at bottom
+	water_physics_reset();
+
+	return 0;
+}
+
+/**
+ * @brief Update tilt angles and calculate gravity direction
+ */
+void water_physics_set_tilt(float tilt_x, float tilt_y)
+{
+	phys_angle_t angle_x = PHYS_ANGLE_DEG(tilt_x);
+	phys_angle_t angle_y = PHYS_ANGLE_DEG(tilt_y);
+	phys_t grav_x = PHYS_MUL(PHYS_SIN(angle_x), GRAVITY);
+	phys_t grav_y = PHYS_MUL(PHYS_COS(angle_x), GRAVITY);
+
+	grav_x = PHYS_SUB(grav_x, PHYS_MUL(PHYS_MUL(PHYS_SIN(angle_y), GRAVITY), PHYS(0.5f)));
+
+	fall.dx = (grav_x > GRAVITY_AXIS) ? 1 : ((grav_x < PHYS_NEG(GRAVITY_AXIS)) ? -1 : 0);
+	fall.dy = (grav_y > GRAVITY_AXIS) ? 1 : ((grav_y < PHYS_NEG(GRAVITY_AXIS)) ? -1 : 0);
+
+	if (fall.dx == 0 && fall.dy == 0) {
+		// Gravity too weak along both axes, fall along the strongest one
+		if (PHYS_ABS(grav_x) > PHYS_ABS(grav_y)) {
+			fall.dx = (grav_x > PHYS(0.0f)) ? 1 : -1;
+		} else {
+			fall.dy = (grav_y >= PHYS(0.0f)) ? 1 : -1;
+		}
+	}
+
+	if (fall.dx == 0 || fall.dy == 0) {
+		// Along an axis: slide diagonally, spread perpendicular to gravity
+		spread.dx = fall.dy != 0;
+		spread.dy = fall.dx != 0;
+		slide[0] = (struct dir){fall.dx - spread.dx, fall.dy - spread.dy};
+		slide[1] = (struct dir){fall.dx + spread.dx, fall.dy + spread.dy};
+	} else {
+		// Diagonal: slide along either axis, spread along the other diagonal
+		spread = (struct dir){fall.dx, -fall.dy};
+		slide[0] = (struct dir){fall.dx, 0};
+		slide[1] = (struct dir){0, fall.dy};
+	}
+}
+
+/**
+ * @brief Initialize water physics with text pattern
+ */
+int water_physics_init_text(int width, int height, const char *text)
+{
+	if (width <= 0 || height <= 0) {
+		return -1;
+	}
+
+	if (alloc_grids(width, height) != 0) {
+		return -1;
+	}
+
+	initial_fill = 0;  // No bottom fill for text mode
+
+	int start_y = (height - 5) / 2;  // Center vertically
+
+	// Draw each character (8 pixels wide including spacing for segment alignment)
+	for (int i = 0; text[i]; i++) {
+		char c = text[i];
+		if (c >= 'a' && c <= 'z') c = c - 'a' + 'A';  // Convert to uppercase
+		if (c < ' ' || c > 'Z') c = ' ';  // Default to space
+
+		const uint8_t *glyph = font_5x5[c - ' '];
+		int char_x = i * 8;
+
+		for (int row = 0; row < 5; row++) {
+			for (int col = 0; col < 5; col++) {
+				int px = char_x + col;
+				int py = start_y + row;
+
+				if ((glyph[row] & (1 << (4 - col))) &&
+				    px >= 0 && px < width && py >= 0 && py < height) {
+					set_cell(px, py);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Get the state of a specific cell in the water grid
+ */
+uint8_t water_physics_get_cell(int x, int y)
+{
+	if (!planes || x < 0 || x >= matrix_width || y < 0 || y >= matrix_height) {
+		return 0;
+	}
+
+	return (plane_row(PLANE_OCC, y)[x / BB_WORD_BITS] >> (x % BB_WORD_BITS)) & 1;
+}
+
+/**
+ * @brief Reset the water simulation to initial state
+ */
+void water_physics_reset(void)
+{
+	if (!planes) {
+		return;
+	}
+
+	memset(planes, 0, NUM_PLANES * grid_words * sizeof(bb_word_t));
+
+	// Fill bottom rows
+	int start_row = matrix_height - initial_fill;
+	if (start_row < 0) start_row = 0;
+
+	for (int y = start_row; y < matrix_height; y++) {
+		for (int x = 0; x < matrix_width; x++) {
+			set_cell(x, y);
+		}
+	}
+}
+
+/**
+ * @brief Move blocked particles over an opening in their line and let them fall into it
+ *
+ * Done for stagnant particles too, and over the whole line along spread: after a flip,
+ * particles that end up under the mass are otherwise stranded there, as spreading within
+ * the mass keeps moving the openings away from them. Only particles with an opening in
+ * their line are moved, and the search stops when the openings are filled, so settled
+ * water costs one support row per row. Moved particles are removed from cand.
+ *
+ * With diagonal gravity particles already slide along both axes, so nothing is done.
+ *
+ * @param dir Direction along spread to try first
+ */
+static void fill_openings(int dir)
+{
+	bb_word_t *moved = &planes[PLANE_MOVED * grid_words];
+	bb_word_t *open = row_tmp[0];
+	bb_word_t *open_cols = row_tmp[1];
+	bool along_rows = spread.dx != 0;
+	int span = along_rows ? matrix_width : matrix_height;
+	int openings = 0;
+	int remaining = 0;
+
+	if (fall.dx != 0 && fall.dy != 0) {
+		return;
+	}
+
+	memset(open_cols, 0, row_words * sizeof(bb_word_t));
+
+	// Openings are empty cells whose neighbour in the gravity direction is empty too
+	for (int y = 0; y < matrix_height; y++) {
+		const bb_word_t *occ = plane_row(PLANE_OCC, y);
+		bb_word_t *reach_row = grid_row(reach, y);
+		int row_openings = 0;
+		int row_reach = 0;
+
+		support_row(open, y);
+		for (int w = 0; w < row_words; w++) {
+			open[w] = ~(open[w] | occ[w]);
+		}
+		open[row_words - 1] &= last_word_mask;
+
+		if (!along_rows) {
+			for (int w = 0; w < row_words; w++) {
+				open_cols[w] |= open[w];
+			}
+			continue;
+		}
+
+		for (int w = 0; w < row_words; w++) {
+			row_openings += bb_count(open[w]);
+		}
+
+		for (int w = 0; w < row_words; w++) {
+			reach_row[w] = row_openings ? grid_row(cand, y)[w] : 0;
+			row_reach += bb_count(reach_row[w]);
+		}
+
+		if (row_reach) {
+			openings += row_openings;
+			remaining += row_reach;
+		}
+	}
+
+	if (!along_rows) {
+		// Spreading along columns, fill at least one opening per column each frame
+		bb_word_t *reach_cols = open;
+
+		memset(reach_cols, 0, row_words * sizeof(bb_word_t));
+		for (int y = 0; y < matrix_height; y++) {
+			for (int w = 0; w < row_words; w++) {
+				grid_row(reach, y)[w] = grid_row(cand, y)[w] & open_cols[w];
+				reach_cols[w] |= grid_row(reach, y)[w];
+				remaining += bb_count(grid_row(reach, y)[w]);
+			}
+		}
+
+		for (int w = 0; w < row_words; w++) {
+			openings += bb_count(reach_cols[w]);
+		}
+	}
+
+	if (!openings || !remaining) {
+		return;
+	}
+
+	// The stopped grid is not needed anymore, and holds the particles moved over an opening
+	memcpy(stopped, moved, grid_words * sizeof(bb_word_t));
+
+	// Each move fills an opening, and leaves a supported cell
+	int start = remaining;
+
+	for (int dist = 1; dist < span && remaining && start - remaining < openings; dist++) {
+		bb_move(reach, dist * dir * spread.dx, dist * dir * spread.dy, TARGET_OPEN);
+		bb_move(reach, -dist * dir * spread.dx, -dist * dir * spread.dy, TARGET_OPEN);
+
+		remaining = 0;
+		for (int i = 0; i < grid_words; i++) {
+			remaining += bb_count(reach[i]);
+		}
+	}
+
+	for (int i = 0; i < grid_words; i++) {
+		cand[i] &= planes[PLANE_OCC * grid_words + i];
+		stopped[i] = moved[i] & ~stopped[i];
+	}
+
+	bb_move(stopped, fall.dx, fall.dy, TARGET_ANY);
+}
+
+/**
+ * @brief Update liquid - Powder Toy style with speed, sliding and spreading
+ */
+void water_physics_update(void)
+{
+	if (!planes) {
+		return;
+	}
+
+	const bb_word_t *occ = &planes[PLANE_OCC * grid_words];
+	bb_word_t *moved = &planes[PLANE_MOVED * grid_words];
+	bb_word_t *stagnant = &planes[PLANE_STAGNANT * grid_words];
+	bb_word_t any;
+
+	// Alternate directions each frame for better mixing
+	frame_parity = !frame_parity;
+
+	speed_accelerate();
+	memset(moved, 0, grid_words * sizeof(bb_word_t));
+	memset(stopped, 0, grid_words * sizeof(bb_word_t));
+
+	// Fall along gravity, one cell per step for the particles fast enough for it
+	for (int step = 0; step < FALL_STEPS; step++) {
+		any = 0;
+		for (int i = 0; i < grid_words; i++) {
+			cand[i] = occ[i] & ~stopped[i] & speed_at_least(i, 2 * step + 1);
+			any |= cand[i];
+		}
+
+		if (!any) {
+			break;
+		}
+
+		bb_move(cand, fall.dx, fall.dy, TARGET_ANY);
+
+		// Blocked particles lose speed and stop falling for this frame
+		for (int i = 0; i < grid_words; i++) {
+			stopped[i] |= cand[i];
+			speed_halve(i, cand[i]);
+		}
+	}
+
+	// Particles that couldn't fall at all slide sideways
+	any = 0;
+	for (int i = 0; i < grid_words; i++) {
+		cand[i] = occ[i] & stopped[i] & ~moved[i];
+		any |= cand[i];
+	}
+
+	if (!any) {
+		memset(stagnant, 0, grid_words * sizeof(bb_word_t));
+		return;
+	}
+
+	bb_move(cand, slide[frame_parity].dx, slide[frame_parity].dy, TARGET_ANY);
+	bb_move(cand, slide[!frame_parity].dx, slide[!frame_parity].dy, TARGET_ANY);
+
+	int dir = frame_parity ? 1 : -1;
+
+	fill_openings(dir);
+
+	// Still blocked: jump to the nearest supported empty cell perpendicular to gravity.
+	// Unmoved particles stay in place, so the stagnant plane is valid for them.
+	for (int dist = 1; dist <= SPREAD_RANGE; dist++) {
+		any = 0;
+		for (int i = 0; i < grid_words; i++) {
+			if (dist > STAGNANT_RANGE) {
+				cand[i] &= ~stagnant[i];
+			}
+			any |= cand[i];
+		}
+
+		if (!any) {
+			break;
+		}
+
+		bb_move(cand, dist * dir * spread.dx, dist * dir * spread.dy, TARGET_SUPPORTED);
+		bb_move(cand, -dist * dir * spread.dx, -dist * dir * spread.dy, TARGET_SUPPORTED);
+	}
+
+	// Particles that couldn't move at all are stagnant and slow down
+	for (int i = 0; i < grid_words; i++) {
+		bb_word_t still = occ[i] & ~moved[i];
+
+		stagnant[i] = still;
+		speed_halve(i, still);
+	}
+}
+
+/**
+ * @brief Clean up and deallocate water physics resources
+ */
+void water_physics_deinit(void)
+{
+	free(planes);
+	free(scratch);
+	planes = NULL;
+	scratch = NULL;
+	cand = NULL;
+	stopped = NULL;
+	reach = NULL;
+	matrix_width = 0;
+	matrix_height = 0;
+}
@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+#include "mel_spectrum.h"
+
+// 100 ms DMIC blocks at 16 kHz, as in both visualizers
+#define SAMPLE_RATE     16000
+#define BLOCK_SAMPLES   (SAMPLE_RATE / 10)
+#define BLOCKS          8
+
+#define FFT_SIZE        MEL_SPECTRUM_FFT_SIZE
+#define FFT_HOP         MEL_SPECTRUM_HOP_SIZE
+#define FFT_BINS        (FFT_SIZE / 2)
+
+// Steps from the double precision reference. arm_rfft_q15 rounds at every stage.
+#ifdef CONFIG_MEL_SPECTRUM_Q15
+#define TOLERANCE       3
+#else
+#define TOLERANCE       1
+#endif
+
+// Band count and dB range of a visualizer
+struct analysis {
+	const char *name;
+	int num_bands;
+	double db_min;
+	double db_max;
+};
+
+static const struct analysis led_matrix = {"led_matrix", 40, 27.0, 48.0};
+static const struct analysis xiao = {"xiao", 32, 20.0, 100.0};
+
+struct signal {
+	const char *name;
+	double tone_hz;
+	int tone_amplitude;
+	int noise_amplitude;
+};
+
+// Loud signals are in the middle of the xiao range, soft ones in the led_matrix one
+static const struct signal signals[] = {
+	{"noise", 0.0, 0, 3000},
+	{"quiet noise", 0.0, 0, 100},
+	{"tone and noise", 1010.0, 8000, 300},
+	{"tone", 1010.0, 8000, 0},
+	{"soft noise", 0.0, 0, 170},
+	{"faint noise", 0.0, 0, 20},
+	{"soft tone and noise", 1010.0, 60, 30},
+	{"soft tone", 1010.0, 60, 0},
+};
+
+static int16_t block[BLOCK_SAMPLES];
+static uint8_t bands[MEL_SPECTRUM_MAX_BANDS];
+
+// Triangular filters of the old dense filterbank, the sparse one has the same weights
+static double filterbank[MEL_SPECTRUM_MAX_BANDS][FFT_BINS];
+static double cos_table[FFT_SIZE];
+
+// State of the reference of the new analysis
+static double ref_history[FFT_SIZE];
+static double ref_power[FFT_BINS];
+static size_t ref_fill;
+static int ref_frames;
+
+static uint32_t rand_state = 0x6A09E667;
+
+static uint32_t rand32(void)
+{
+	// xorshift32, the same sequence on every run
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+// Same bin computation as the filterbanks, in float
+static float hz_to_mel(float hz)
+{
+	return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+static float mel_to_hz(float mel)
+{
+	return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+static int hz_to_bin(float hz)
+{
+	return (int)(hz * FFT_SIZE / SAMPLE_RATE);
+}
+
+static void init_filterbank(int num_bands)
+{
+	float mel_min = hz_to_mel(0);
+	float mel_max = hz_to_mel(SAMPLE_RATE / 2.0f);
+	float mel_step = (mel_max - mel_min) / (num_bands + 1);
+
+	memset(filterbank, 0, sizeof(filterbank));
+
+	for (int i = 0; i < num_bands; i++) {
+		int bin_left = hz_to_bin(mel_to_hz(mel_min + i * mel_step));
+		int bin_center = hz_to_bin(mel_to_hz(mel_min + (i + 1) * mel_step));
+		int bin_right = hz_to_bin(mel_to_hz(mel_min + (i + 2) * mel_step));
+
+		for (int j = bin_left; j < bin_center && j < FFT_BINS; j++) {
+			filterbank[i][j] = (double)(j - bin_left) / (bin_center - bin_left);
+		}
+		for (int j = bin_center; j < bin_right && j < FFT_BINS; j++) {
+			filterbank[i][j] = (double)(bin_right - j) / (bin_right - bin_center);
+		}
+	}
+}
+
+// Power spectrum of FFT_SIZE samples
+static void dft_power(const double *in, double *power)
+{
+	for (int k = 0; k < FFT_BINS; k++) {
+		double re = 0.0;
+		double im = 0.0;
+
+		for (int t = 0; t < FFT_SIZE; t++) {
+			int n = (k * t) % FFT_SIZE;
+
+			// sin(x) is cos(x - pi / 2)
+			re += in[t] * cos_table[n];
+			im -= in[t] * cos_table[(n + FFT_SIZE * 3 / 4) % FFT_SIZE];
+		}
+
+		power[k] = re * re + im * im;
+	}
+}
+
+static double level_per_db(const struct analysis *analysis)
+{
+	return 255.0 / (analysis->db_max - analysis->db_min);
+}
+
+static int db_to_level(const struct analysis *analysis, double db)
+{
+	double level = (db - analysis->db_min) * level_per_db(analysis);
+
+	return (int)CLAMP(level, 0.0, 255.0);
+}
+
+// Hann windowed frames overlapping by half, power averaged over the frames of the call
+static void reference_new(const struct analysis *analysis, const int16_t *samples,
+			  size_t count, int *levels)
+{
+	static double frame[FFT_SIZE];
+	static double power[FFT_BINS];
+
+	for (size_t i = 0; i < count; i++) {
+		ref_history[FFT_HOP + ref_fill++] = samples[i];
+
+		if (ref_fill < FFT_HOP) {
+			continue;
+		}
+
+		// Window scaled by 2
+		for (int t = 0; t < FFT_SIZE; t++) {
+			frame[t] = ref_history[t] * (1.0 - cos_table[t]);
+		}
+
+		dft_power(frame, power);
+
+		for (int k = 0; k < FFT_BINS; k++) {
+			ref_power[k] += power[k];
+		}
+
+		ref_frames++;
+		memcpy(ref_history, &ref_history[FFT_HOP], FFT_HOP * sizeof(ref_history[0]));
+		ref_fill = 0;
+	}
+
+	// Power weighted by the filter and its width
+	for (int i = 0; i < analysis->num_bands; i++) {
+		double weight_sum = 0.0;
+		double energy = 0.0;
+
+		for (int k = 0; k < FFT_BINS; k++) {
+			weight_sum += filterbank[i][k];
+			energy += filterbank[i][k] * ref_power[k];
+		}
+
+		levels[i] = db_to_level(analysis,
+					5.0 * log10(energy * weight_sum / ref_frames + 1.0));
+	}
+
+	memset(ref_power, 0, sizeof(ref_power));
+	ref_frames = 0;
+}
+
+// The analysis before lib/mel_spectrum: magnitudes of the first FFT_SIZE samples of the
+// block, without window
+static void reference_old(const struct analysis *analysis, const int16_t *samples,
+			  int *levels)
+{
+	static double frame[FFT_SIZE];
+	static double power[FFT_BINS];
+
+	for (int t = 0; t < FFT_SIZE; t++) {
+		frame[t] = samples[t];
+	}
+
+	dft_power(frame, power);
+
+	for (int i = 0; i < analysis->num_bands; i++) {
+		double energy = 0.0;
+
+		for (int k = 0; k < FFT_BINS; k++) {
+			energy += filterbank[i][k] * sqrt(power[k]);
+		}
+
+		levels[i] = db_to_level(analysis, 10.0 * log10(energy + 1.0));
+	}
+}
+
+static int peak_band(const int *levels, int num_bands)
+{
+	int peak = 0;
+
+	for (int i = 1; i < num_bands; i++) {
+		if (levels[i] > levels[peak]) {
+			peak = i;
+		}
+	}
+
+	return peak;
+}
+
+static void fill_block(const struct signal *signal, int index)
+{
+	for (int i = 0; i < BLOCK_SAMPLES; i++) {
+		double t = (double)(index * BLOCK_SAMPLES + i) / SAMPLE_RATE;
+		double v = signal->tone_amplitude * sin(2.0 * M_PI * signal->tone_hz * t);
+
+		if (signal->noise_amplitude > 0) {
+			v += (int32_t)(rand32() % (2 * signal->noise_amplitude + 1)) -
+			     signal->noise_amplitude;
+		}
+
+		block[i] = (int16_t)lround(v);
+	}
+}
+
+/*
+ * Analyze BLOCKS blocks of a signal, and check every band against the reference. The band
+ * levels of the last block are left in bands and old.
+ */
+static void analyze(const struct analysis *analysis, const struct signal *signal, int *old)
+{
+	int ref[MEL_SPECTRUM_MAX_BANDS];
+	int max_error = 0;
+	int peak;
+
+	init_filterbank(analysis->num_bands);
+	zassert_ok(mel_spectrum_init(SAMPLE_RATE, analysis->num_bands, analysis->db_min,
+				     analysis->db_max));
+	memset(ref_history, 0, sizeof(ref_history));
+	ref_fill = 0;
+
+	for (int b = 0; b < BLOCKS; b++) {
+		fill_block(signal, b);
+
+		// 1600 samples complete 6 or 7 frames
+		zassert_not_equal(mel_spectrum_process(block, BLOCK_SAMPLES, bands), 0,
+				  "%s, %s: no frames in block %d", analysis->name, signal->name, b);
+
+		reference_new(analysis, block, BLOCK_SAMPLES, ref);
+		reference_old(analysis, block, old);
+		peak = peak_band(ref, analysis->num_bands);
+
+		for (int i = 0; i < analysis->num_bands; i++) {
+			// Bands away from a pure tone get the rounding floor of the q15 FFT, about
+			// 60 dB below the tone. The noise of a microphone is above it.
+			if (IS_ENABLED(CONFIG_MEL_SPECTRUM_Q15) && signal->noise_amplitude == 0 &&
+			    abs(i - peak) > 2) {
+				continue;
+			}
+
+			max_error = MAX(max_error, abs(bands[i] - ref[i]));
+		}
+	}
+
+	zassert_true(max_error <= TOLERANCE, "%s, %s: %d steps from the reference",
+		     analysis->name, signal->name, max_error);
+}
+
+/*
+ * Power with a window scaled by 2 instead of magnitude without window: broadband sound
+ * gains the noise gain of the window, 0.9 dB, and the 0.5 dB between the RMS magnitude
+ * of noise and its mean.
+ */
+static void compare_noise(const struct analysis *analysis, const struct signal *noise)
+{
+	int old[MEL_SPECTRUM_MAX_BANDS];
+	int sum_new = 0;
+	int sum_old = 0;
+	double diff_db;
+
+	analyze(analysis, noise, old);
+
+	for (int i = 0; i < analysis->num_bands; i++) {
+		sum_new += bands[i];
+		sum_old += old[i];
+	}
+
+	diff_db = (double)(sum_new - sum_old) / analysis->num_bands / level_per_db(analysis);
+
+	printk("%s: noise %+.1f dB from the previous analysis\n", analysis->name, diff_db);
+
+	zassert_true(fabs(diff_db) <= 2.0, "%s: noise %+.1f dB from the previous analysis",
+		     analysis->name, diff_db);
+}
+
+/*
+ * Without window, a tone between two bins leaks into every band. With the Hann window
+ * only the bands next to the tone get it, and the loudest one keeps its level within
+ * 3 dB.
+ */
+static void compare_tone(const struct analysis *analysis, const struct signal *tone)
+{
+	int old[MEL_SPECTRUM_MAX_BANDS];
+	int peak = 0;
+	int leak_new = 0;
+	int leak_old = 0;
+	double peak_db;
+
+	analyze(analysis, tone, old);
+
+	for (int i = 1; i < analysis->num_bands; i++) {
+		if (bands[i] > bands[peak]) {
+			peak = i;
+		}
+	}
+
+	for (int i = 0; i < analysis->num_bands; i++) {
+		if (abs(i - peak) > 2) {
+			leak_new = MAX(leak_new, bands[i]);
+			leak_old = MAX(leak_old, old[i]);
+		}
+	}
+
+	peak_db = (bands[peak] - old[peak]) / level_per_db(analysis);
+
+	printk("%s: tone in band %d, %+.1f dB from the previous analysis, leaks %d (was %d)\n",
+	       analysis->name, peak, peak_db, leak_new, leak_old);
+
+	zassert_equal(leak_new, 0, "%s: tone leaks %d", analysis->name, leak_new);
+	zassert_not_equal(leak_old, 0, "%s: tone did not leak without window", analysis->name);
+	zassert_true(fabs(peak_db) <= 3.0, "%s: tone %+.1f dB from the previous analysis",
+		     analysis->name, peak_db);
+}
+
+ZTEST(mel_spectrum, test_led_matrix_reference)
+{
+	int old[MEL_SPECTRUM_MAX_BANDS];
+
+	for (size_t i = 0; i < ARRAY_SIZE(signals); i++) {
+		analyze(&led_matrix, &signals[i], old);
+	}
+}
+
+ZTEST(mel_spectrum, test_xiao_reference)
+{
+	int old[MEL_SPECTRUM_MAX_BANDS];
+
+	for (size_t i = 0; i < ARRAY_SIZE(signals); i++) {
+		analyze(&xiao, &signals[i], old);
+	}
+}
+
+ZTEST(mel_spectrum, test_noise_previous_analysis)
+{
+	compare_noise(&led_matrix, &signals[4]);
+	compare_noise(&xiao, &signals[0]);
+}
+
+ZTEST(mel_spectrum, test_tone_previous_analysis)
+{
+	compare_tone(&led_matrix, &signals[7]);
+}
+
+static void *mel_spectrum_setup(void)
+{
+	for (int i = 0; i < FFT_SIZE; i++) {
+		cos_table[i] = cos(2.0 * M_PI * i / FFT_SIZE);
+	}
+
+	return NULL;
+}
+
+ZTEST_SUITE(mel_spectrum, NULL, mel_spectrum_setup, NULL, NULL, NULL);
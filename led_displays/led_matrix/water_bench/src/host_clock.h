@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2025 Water Physics Module
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * @brief Monotonic time of the host in nanoseconds, on native_sim only
+ */
+uint64_t host_clock_get_ns(void);
+
+#endif /* HOST_CLOCK_H */
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2025 Water Physics Module
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Built into the native_sim runner, against the host C library, so that the benchmark can
+ * read the host clock. Simulated time does not advance while the engine runs.
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include "host_clock.h"
+
+uint64_t host_clock_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000U + ts.tv_nsec;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2025 Water Physics Module
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include "water_physics.h"
+
+#define WIDTH       CONFIG_WATER_BENCH_WIDTH
+#define HEIGHT      CONFIG_WATER_BENCH_HEIGHT
+#define FRAMES      CONFIG_WATER_BENCH_FRAMES
+
+#if defined(CONFIG_BOARD_NATIVE_SIM)
+#include "host_clock.h"
+
+// Simulated time stands still while the engine runs, so native_sim reads the host clock
+#define CLOCK_NAME  "host"
+#define CLOCK_HZ    NSEC_PER_SEC
+
+static uint32_t clock_get(void)
+{
+	return (uint32_t)host_clock_get_ns();
+}
+#else
+#define CLOCK_NAME  "cycle"
+#define CLOCK_HZ    sys_clock_hw_cycles_per_sec()
+
+static uint32_t clock_get(void)
+{
+	return k_cycle_get_32();
+}
+#endif
+
+static uint32_t clock_to_ns(uint32_t ticks)
+{
+	return (uint64_t)ticks * NSEC_PER_SEC / CLOCK_HZ;
+}
+
+// Tilt schedule in degrees, each step held for FRAMES / ARRAY_SIZE(tilt_steps) frames
+static const int16_t tilt_steps[][2] = {
+	{0, 0}, {60, 0}, {-80, 0}, {20, -40}, {180, 0}, {-30, 30},
+};
+
+/**
+ * @brief Checksum of the grid contents, to compare the result of engines and builds
+ */
+static uint32_t grid_checksum(void)
+{
+	uint32_t hash = 2166136261U;
+
+	for (int y = 0; y < HEIGHT; y++) {
+		for (int x = 0; x < WIDTH; x++) {
+			hash = (hash ^ water_physics_get_cell(x, y)) * 16777619U;
+		}
+	}
+
+	return hash;
+}
+
+static int grid_count(void)
+{
+	int count = 0;
+
+	for (int y = 0; y < HEIGHT; y++) {
+		for (int x = 0; x < WIDTH; x++) {
+			count += water_physics_get_cell(x, y);
+		}
+	}
+
+	return count;
+}
+
+int main(void)
+{
+	const char *engine = IS_ENABLED(CONFIG_WATER_PHYSICS_ENGINE_BITBOARD) ?
+		"bitboard" : "cell";
+	int frames_per_step = MAX(FRAMES / (int)ARRAY_SIZE(tilt_steps), 1);
+	uint32_t min = UINT32_MAX;
+	uint32_t max = 0;
+	uint64_t total = 0;
+
+	if (water_physics_init(WIDTH, HEIGHT, CONFIG_WATER_BENCH_FILL_ROWS) != 0) {
+		printk("Failed to initialize water physics\n");
+		return -1;
+	}
+
+	printk("Water physics benchmark: %s engine, %dx%d, %d particles, %d frames\n",
+	       engine, WIDTH, HEIGHT, grid_count(), FRAMES);
+
+	for (int frame = 0; frame < FRAMES; frame++) {
+		int step = MIN(frame / frames_per_step, (int)ARRAY_SIZE(tilt_steps) - 1);
+
+		water_physics_set_tilt(tilt_steps[step][0], tilt_steps[step][1]);
+
+		uint32_t start = clock_get();
+
+		water_physics_update();
+
+		uint32_t ticks = clock_get() - start;
+
+		min = MIN(min, ticks);
+		max = MAX(max, ticks);
+		total += ticks;
+	}
+
+	printk("Time per frame: min %u avg %u max %u ns (%s clock)\n", clock_to_ns(min),
+	       clock_to_ns(total / FRAMES), clock_to_ns(max), CLOCK_NAME);
+	printk("Particles: %d, checksum: 0x%08x\n", grid_count(), grid_checksum());
+
+	water_physics_deinit();
+
+	return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "latency_hist.h"
+#include <errno.h>
+#include <string.h>
+
+#define SUB_MASK (LATENCY_HIST_SUB_COUNT - 1)
+
+static uint32_t bucket_index(uint32_t value)
+{
+	uint32_t shift;
+
+	if (value < LATENCY_HIST_SUB_COUNT) {
+		return value;
+	}
+
+	// Keep the top LATENCY_HIST_SUB_BITS + 1 bits, the leading one selects the group
+	shift = 31 - __builtin_clz(value) - LATENCY_HIST_SUB_BITS;
+
+	return (shift + 1) * LATENCY_HIST_SUB_COUNT + ((value >> shift) & SUB_MASK);
+}
+
+static uint32_t bucket_upper(uint32_t index)
+{
+	uint32_t group = index / LATENCY_HIST_SUB_COUNT;
+	uint32_t shift;
+	uint64_t upper;
+
+	if (group == 0) {
+		return index;
+	}
+
+	shift = group - 1;
+	upper = ((uint64_t)(LATENCY_HIST_SUB_COUNT + (index & SUB_MASK) + 1) << shift) - 1;
+
+	return (upper > UINT32_MAX) ? UINT32_MAX : (uint32_t)upper;
+}
+
+void latency_hist_reset(struct latency_hist *hist)
+{
+	memset(hist, 0, sizeof(*hist));
+	hist->min = UINT32_MAX;
+}
+
+void latency_hist_record(struct latency_hist *hist, uint32_t value)
+{
+	hist->counts[bucket_index(value)]++;
+	hist->total++;
+	hist->sum += value;
+
+	if (value < hist->min) {
+		hist->min = value;
+	}
+
+	if (value > hist->max) {
+		hist->max = value;
+	}
+}
+
+uint32_t latency_hist_percentile(const struct latency_hist *hist, uint32_t ppm)
+{
+	uint64_t rank;
+	uint64_t seen = 0;
+
+	if (hist->total == 0) {
+		return 0;
+	}
+
+	// Smallest rank covering the share, at least the first value
+	rank = ((uint64_t)hist->total * ppm + 999999) / 1000000;
+	if (rank == 0) {
+		rank = 1;
+	}
+
+	for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+		seen += hist->counts[i];
+		if (seen >= rank) {
+			uint32_t upper = bucket_upper(i);
+
+			return (upper < hist->max) ? upper : hist->max;
+		}
+	}
+
+	return hist->max;
+}
+
+void latency_hist_summarize(const struct latency_hist *hist,
+			    struct latency_hist_summary *summary)
+{
+	memset(summary, 0, sizeof(*summary));
+
+	if (hist->total == 0) {
+		return;
+	}
+
+	summary->count = hist->total;
+	summary->min = hist->min;
+	summary->mean = (uint32_t)(hist->sum / hist->total);
+	summary->p50 = latency_hist_percentile(hist, LATENCY_HIST_P50);
+	summary->p99 = latency_hist_percentile(hist, LATENCY_HIST_P99);
+	summary->p99_9 = latency_hist_percentile(hist, LATENCY_HIST_P99_9);
+	summary->max = hist->max;
+}
+
+void latency_ring_reset(struct latency_ring *ring)
+{
+	memset(ring, 0, sizeof(*ring));
+}
+
+uint32_t latency_ring_push(struct latency_ring *ring, uint32_t stamp, uint32_t tag)
+{
+	uint32_t seq = ring->next_seq++;
+	struct latency_ring_entry *entry = &ring->entries[seq % LATENCY_RING_SIZE];
+
+	if (entry->pending) {
+		ring->lost++;
+	}
+
+	entry->seq = seq;
+	entry->stamp = stamp;
+	entry->tag = tag;
+	entry->pending = 1;
+
+	return seq;
+}
+
+int latency_ring_pop(struct latency_ring *ring, uint32_t seq, struct latency_ring_entry *entry)
+{
+	struct latency_ring_entry *slot = &ring->entries[seq % LATENCY_RING_SIZE];
+
+	if (!slot->pending || (slot->seq != seq)) {
+		ring->unmatched++;
+		return -ENOENT;
+	}
+
+	*entry = *slot;
+	slot->pending = 0;
+
+	return 0;
+}
+
+void latency_ring_cancel(struct latency_ring *ring, uint32_t seq)
+{
+	struct latency_ring_entry *slot = &ring->entries[seq % LATENCY_RING_SIZE];
+
+	if (slot->pending && (slot->seq == seq)) {
+		slot->pending = 0;
+	}
+}
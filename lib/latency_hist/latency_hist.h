@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LATENCY_HIST_H_
+#define LATENCY_HIST_H_
+
+#include <stdint.h>
+
+/*
+ * Latency histogram and request ring, shared by the Bluetooth latency samples.
+ *
+ * The histogram is log-linear: values below LATENCY_HIST_SUB_COUNT have a bucket each, above
+ * that every power of two is split into LATENCY_HIST_SUB_COUNT buckets, so a bucket is never
+ * wider than 1/LATENCY_HIST_SUB_COUNT of its values. Any 32-bit value is recorded in constant
+ * time and memory, so long runs keep their tail.
+ *
+ * The request ring matches responses to requests by sequence number. A response that comes
+ * after its timeout is still matched, as long as the slot was not reused.
+ *
+ * Neither depends on Zephyr, both build and run on the host. Neither locks, the caller
+ * serializes access.
+ */
+
+#define LATENCY_HIST_SUB_BITS  4
+#define LATENCY_HIST_SUB_COUNT (1U << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_BUCKETS   ((32 - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_COUNT)
+
+/* Percentiles in parts per million. */
+#define LATENCY_HIST_P50   500000
+#define LATENCY_HIST_P99   990000
+#define LATENCY_HIST_P99_9 999000
+
+#define LATENCY_RING_SIZE 8
+
+struct latency_hist {
+	uint32_t counts[LATENCY_HIST_BUCKETS];
+	uint32_t total;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+};
+
+struct latency_hist_summary {
+	uint32_t count;
+	uint32_t min;
+	uint32_t mean;
+	uint32_t p50;
+	uint32_t p99;
+	uint32_t p99_9;
+	uint32_t max;
+};
+
+struct latency_ring_entry {
+	uint32_t seq;
+	/* Request time, in the caller's time base */
+	uint32_t stamp;
+	/* Caller data captured with the request, for example an error counter */
+	uint32_t tag;
+	uint8_t pending;
+};
+
+struct latency_ring {
+	struct latency_ring_entry entries[LATENCY_RING_SIZE];
+	uint32_t next_seq;
+	/* Requests whose slot was reused before a response came */
+	uint32_t lost;
+	/* Responses that matched no pending request */
+	uint32_t unmatched;
+};
+
+/**
+ * @brief Empty a histogram
+ * @param hist Histogram
+ */
+void latency_hist_reset(struct latency_hist *hist);
+
+/**
+ * @brief Add a value to a histogram
+ * @param hist Histogram
+ * @param value Value, for example a latency in microseconds
+ */
+void latency_hist_record(struct latency_hist *hist, uint32_t value);
+
+/**
+ * @brief Value below or at which a share of the recorded values lie
+ *
+ * Returns the upper bound of the bucket holding the value, capped to the largest recorded
+ * value, so the result is never below the exact percentile.
+ *
+ * @param hist Histogram
+ * @param ppm Share in parts per million, 1000000 for the largest value
+ * @return Value, 0 if the histogram is empty
+ */
+uint32_t latency_hist_percentile(const struct latency_hist *hist, uint32_t ppm);
+
+/**
+ * @brief Count, mean, p50, p99, p99.9 and extremes of a histogram
+ * @param hist Histogram
+ * @param summary Filled with zeros if the histogram is empty
+ */
+void latency_hist_summarize(const struct latency_hist *hist,
+			    struct latency_hist_summary *summary);
+
+/**
+ * @brief Empty a ring, sequence numbers restart from 0
+ * @param ring Request ring
+ */
+void latency_ring_reset(struct latency_ring *ring);
+
+/**
+ * @brief Add a request
+ *
+ * Reuses the oldest slot, a request still pending in it is counted as lost.
+ *
+ * @param ring Request ring
+ * @param stamp Request time
+ * @param tag Caller data returned with the matched entry
+ * @return Sequence number to send with the request
+ */
+uint32_t latency_ring_push(struct latency_ring *ring, uint32_t stamp, uint32_t tag);
+
+/**
+ * @brief Match a response to its request and release the slot
+ * @param ring Request ring
+ * @param seq Sequence number carried by the response
+ * @param entry Filled with the request
+ * @return 0 on success, -ENOENT if no request is pending with this number
+ */
+int latency_ring_pop(struct latency_ring *ring, uint32_t seq, struct latency_ring_entry *entry);
+
+/**
+ * @brief Release the slot of a request that was not sent
+ * @param ring Request ring
+ * @param seq Sequence number returned by latency_ring_push()
+ */
+void latency_ring_cancel(struct latency_ring *ring, uint32_t seq);
+
+#endif /* LATENCY_HIST_H_ */
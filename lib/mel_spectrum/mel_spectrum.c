@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mel_spectrum.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <zephyr/sys/__assert.h>
+#include <zephyr/sys/util.h>
+#include <arm_math.h>
+
+// FFT frames overlap by half, so every sample is analyzed twice
+#define FFT_SIZE        MEL_SPECTRUM_FFT_SIZE
+#define FFT_HOP         MEL_SPECTRUM_HOP_SIZE
+#define FFT_BINS        (FFT_SIZE / 2)
+
+// Sparse mel filterbank: each triangular filter only stores its non-zero weights.
+// Each bin is in at most two filters, so FFT_BINS * 2 weights are enough.
+typedef struct {
+	uint16_t start;    // First bin
+	uint16_t len;      // Number of bins
+	uint16_t offset;   // Index of the first weight in mel_weights
+} mel_filter_t;
+
+static mel_filter_t mel_filters[MEL_SPECTRUM_MAX_BANDS];
+static int mel_bands;
+
+static size_t hop_fill;  // Samples in the second half of sample_history
+static int frames;       // Frames since the bands were last computed
+
+static mel_spectrum_frame_handler_t frame_handler;
+static uint8_t frame_bands[MEL_SPECTRUM_MAX_BANDS];
+
+#ifdef CONFIG_MEL_SPECTRUM_Q15
+
+// 10 * log10 of magnitude, in log2 of power
+#define DB_PER_LOG2     1.50515f
+#define LOG2_FRAC_BITS  8
+
+// log2(1 + i / 64) in Q8
+static const uint8_t log2_lut[64] = {
+	0, 6, 11, 17, 22, 28, 33, 38, 44, 49, 54, 59, 63, 68, 73, 78,
+	82, 87, 92, 96, 100, 105, 109, 113, 118, 122, 126, 130, 134, 138, 142, 146,
+	150, 154, 157, 161, 165, 169, 172, 176, 179, 183, 186, 190, 193, 197, 200, 203,
+	207, 210, 213, 216, 220, 223, 226, 229, 232, 235, 238, 241, 244, 247, 250, 253,
+};
+
+static q15_t hann_window[FFT_SIZE];
+static q15_t sample_history[FFT_SIZE];  // Previous hop, then the hop being filled
+static q15_t fft_input[FFT_SIZE];
+static q15_t fft_output[FFT_SIZE * 2];
+static arm_rfft_instance_q15 fft_instance;
+
+static q15_t mel_weights[FFT_BINS * 2];
+static int32_t band_offset[MEL_SPECTRUM_MAX_BANDS];  // log2 of the band scale, in Q8
+static uint64_t band_sum[MEL_SPECTRUM_MAX_BANDS];    // Weighted power summed over frames
+static int32_t level_min;   // log2 of db_min, in Q8
+static int32_t level_span;  // log2 of db_max - db_min, in Q8
+
+/**
+ * @brief log2 of a non-zero integer, in Q8
+ */
+static int32_t log2_q8(uint64_t x)
+{
+	int msb = 63 - __builtin_clzll(x);
+	uint32_t frac = (msb >= 6) ? (uint32_t)(x >> (msb - 6)) : (uint32_t)(x << (6 - msb));
+
+	return (msb << LOG2_FRAC_BITS) + log2_lut[frac & 63];
+}
+
+/**
+ * @brief Left shift that brings the largest sample of a frame to full scale
+ */
+static int frame_headroom(const q15_t *frame)
+{
+	uint32_t bits = 0;
+
+	// The OR of the magnitudes has the same MSB as the largest one
+	for (int i = 0; i < FFT_SIZE; i++) {
+		bits |= (uint32_t)abs(frame[i]);
+	}
+
+	return MAX(__builtin_clz(bits | 1) - 17, 0);
+}
+
+#else
+
+static float32_t hann_window[FFT_SIZE];
+static float32_t sample_history[FFT_SIZE];  // Previous hop, then the hop being filled
+static float32_t fft_input[FFT_SIZE];
+static float32_t fft_output[FFT_SIZE];
+static arm_rfft_fast_instance_f32 fft_instance;
+
+static float32_t mel_weights[FFT_BINS * 2];
+static float32_t power_sum[FFT_BINS];  // Power spectrum summed over frames
+static float level_min;
+static float level_span;
+
+#endif /* CONFIG_MEL_SPECTRUM_Q15 */
+
+// Convert frequency to mel scale
+static float hz_to_mel(float hz)
+{
+	return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+// Convert mel scale to frequency
+static float mel_to_hz(float mel)
+{
+	return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+static int init_mel_filterbank(uint32_t sample_rate)
+{
+	// Bins of the filter edges, the center of a filter is the right edge of the previous one
+	int edges[MEL_SPECTRUM_MAX_BANDS + 2];
+	size_t offset = 0;
+
+	float mel_min = hz_to_mel(0);
+	float mel_max = hz_to_mel(sample_rate / 2.0f);
+	float mel_step = (mel_max - mel_min) / (mel_bands + 1);
+
+	for (int i = 0; i < mel_bands + 2; i++) {
+		edges[i] = (int)(mel_to_hz(mel_min + i * mel_step) * FFT_SIZE / sample_rate);
+
+		// Low bands can be narrower than a bin. Move edges that fall into the same bin
+		// apart, so that no filter is empty and the triangles never divide by zero.
+		if (i > 0) {
+			edges[i] = MAX(edges[i], edges[i - 1] + 1);
+		}
+	}
+
+	// Too many bands for the bins
+	if (edges[mel_bands + 1] > FFT_BINS) {
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < mel_bands; i++) {
+		int bin_left = edges[i];
+		int bin_center = edges[i + 1];
+		int bin_right = edges[i + 2];
+
+		// Triangular filter, without the zero weights at bin_left and bin_right
+		int start = bin_left + 1;
+		int end = bin_right;
+		float weight_sum = 0.0f;
+
+		// The edges increase, so each bin is in at most two filters
+		__ASSERT_NO_MSG(offset + (end - start) <= ARRAY_SIZE(mel_weights));
+
+		mel_filters[i].start = start;
+		mel_filters[i].len = end - start;
+		mel_filters[i].offset = offset;
+
+		for (int j = start; j < end; j++) {
+			float w = (j < bin_center) ?
+				(float)(j - bin_left) / (bin_center - bin_left) :
+				(float)(bin_right - j) / (bin_right - bin_center);
+
+#ifdef CONFIG_MEL_SPECTRUM_Q15
+			mel_weights[offset + j - start] = (q15_t)MIN(w * 32768.0f, 32767.0f);
+#else
+			mel_weights[offset + j - start] = w;
+#endif
+			weight_sum += w;
+		}
+
+		// Bands are computed from power instead of magnitude. Scaling by the filter
+		// width keeps the level of broadband sound the same as with magnitudes.
+#ifdef CONFIG_MEL_SPECTRUM_Q15
+		// arm_rfft_q15 scales the output down by FFT_SIZE and the window isn't scaled by 2,
+		// which is a factor (2 * FFT_SIZE)^2 in power. Weights are Q15.
+		float scale_log2 = log2f(weight_sum) + 2.0f * log2f(2 * FFT_SIZE) - 15.0f;
+
+		band_offset[i] = (weight_sum > 0.0f) ?
+			(int32_t)roundf(scale_log2 * (1 << LOG2_FRAC_BITS)) : 0;
+#else
+		for (int j = 0; j < mel_filters[i].len; j++) {
+			mel_weights[offset + j] *= weight_sum;
+		}
+#endif
+
+		offset += mel_filters[i].len;
+	}
+
+	return 0;
+}
+
+static void init_hann_window(void)
+{
+	for (int i = 0; i < FFT_SIZE; i++) {
+		float w = 0.5f - 0.5f * cosf(2.0f * PI * i / FFT_SIZE);
+
+#ifdef CONFIG_MEL_SPECTRUM_Q15
+		hann_window[i] = (q15_t)MIN(roundf(w * 32768.0f), 32767.0f);
+#else
+		// Scaled by 2, so that tones keep the same level as without window
+		hann_window[i] = 2.0f * w;
+#endif
+	}
+}
+
+#ifdef CONFIG_MEL_SPECTRUM_Q15
+
+static void add_samples(const int16_t *samples, q15_t *dst, size_t count)
+{
+	memcpy(dst, samples, count * sizeof(q15_t));
+}
+
+static void compute_levels(const uint64_t *sums, int n_frames, uint8_t *bands)
+{
+	int32_t frames_log2 = log2_q8(n_frames);
+
+	for (int i = 0; i < mel_bands; i++) {
+		int32_t level = 0;
+
+		if (sums[i] > 0) {
+			level = log2_q8(sums[i]) + band_offset[i] - frames_log2 - level_min;
+			level = level * 255 / level_span;
+		}
+
+		bands[i] = CLAMP(level, 0, 255);
+	}
+}
+
+// Window the last FFT_SIZE samples, and add the weighted power of the frame to each band
+static void process_frame(void)
+{
+	uint64_t frame_sum[MEL_SPECTRUM_MAX_BANDS];
+	int shift;
+
+	arm_mult_q15(sample_history, hann_window, fft_input, FFT_SIZE);
+
+	// arm_rfft_q15 scales its output down by FFT_SIZE, which leaves a few LSBs of a quiet
+	// frame. Scale the frame up to full scale, and its power back down after the FFT.
+	shift = frame_headroom(fft_input);
+	arm_shift_q15(fft_input, shift, fft_input, FFT_SIZE);
+
+	arm_rfft_q15(&fft_instance, fft_input, fft_output);
+
+	for (int i = 0; i < mel_bands; i++) {
+		const mel_filter_t *filter = &mel_filters[i];
+		const q15_t *bin = &fft_output[filter->start * 2];
+		const q15_t *w = &mel_weights[filter->offset];
+		uint64_t sum = 0;
+
+		for (int j = 0; j < filter->len; j++) {
+			int32_t re = bin[j * 2];
+			int32_t im = bin[j * 2 + 1];
+			uint32_t power = (uint32_t)(re * re) + (uint32_t)(im * im);
+
+			sum += (uint64_t)power * w[j];
+		}
+
+		frame_sum[i] = sum >> (2 * shift);
+		band_sum[i] += frame_sum[i];
+	}
+
+	if (frame_handler) {
+		compute_levels(frame_sum, 1, frame_bands);
+		frame_handler(frame_bands, mel_bands);
+	}
+}
+
+static void compute_bands(uint8_t *bands)
+{
+	compute_levels(band_sum, frames, bands);
+	memset(band_sum, 0, sizeof(band_sum));
+}
+
+#else
+
+static void add_samples(const int16_t *samples, float32_t *dst, size_t count)
+{
+	arm_q15_to_float(samples, dst, count);
+}
+
+static void compute_levels(const float32_t *power, int n_frames, uint8_t *bands)
+{
+	// arm_q15_to_float scales samples by 1/32768, undo it to keep the levels of raw samples
+	float32_t scale = 32768.0f * 32768.0f / n_frames;
+
+	for (int i = 0; i < mel_bands; i++) {
+		const mel_filter_t *filter = &mel_filters[i];
+		float32_t energy = 0.0f;
+
+		if (filter->len > 0) {
+			arm_dot_prod_f32(&power[filter->start], &mel_weights[filter->offset],
+					 filter->len, &energy);
+		}
+
+		// 5 * log10 of power is 10 * log10 of magnitude
+		float db = 5.0f * log10f(energy * scale + 1.0f);
+		float level = (db - level_min) / level_span * 255.0f;
+
+		bands[i] = (uint8_t)CLAMP(level, 0.0f, 255.0f);
+	}
+}
+
+// Window the last FFT_SIZE samples, and add their power spectrum to power_sum
+static void process_frame(void)
+{
+	float32_t power[FFT_BINS];
+
+	arm_mult_f32(sample_history, hann_window, fft_input, FFT_SIZE);
+	arm_rfft_fast_f32(&fft_instance, fft_input, fft_output, 0);
+
+	// Squared magnitudes, no square root needed as bands are computed from power
+	arm_cmplx_mag_squared_f32(fft_output, power, FFT_BINS);
+	arm_add_f32(power_sum, power, power_sum, FFT_BINS);
+
+	if (frame_handler) {
+		compute_levels(power, 1, frame_bands);
+		frame_handler(frame_bands, mel_bands);
+	}
+}
+
+static void compute_bands(uint8_t *bands)
+{
+	compute_levels(power_sum, frames, bands);
+	memset(power_sum, 0, sizeof(power_sum));
+}
+
+#endif /* CONFIG_MEL_SPECTRUM_Q15 */
+
+int mel_spectrum_init(uint32_t sample_rate, int num_bands, float db_min, float db_max)
+{
+	if (num_bands < 1 || num_bands > MEL_SPECTRUM_MAX_BANDS || db_max <= db_min) {
+		return -EINVAL;
+	}
+
+	mel_bands = num_bands;
+
+	if (init_mel_filterbank(sample_rate) != 0) {
+		return -EINVAL;
+	}
+
+#ifdef CONFIG_MEL_SPECTRUM_Q15
+	arm_rfft_init_q15(&fft_instance, FFT_SIZE, 0, 1);
+	level_min = (int32_t)roundf(db_min / DB_PER_LOG2 * (1 << LOG2_FRAC_BITS));
+	level_span = (int32_t)roundf((db_max - db_min) / DB_PER_LOG2 * (1 << LOG2_FRAC_BITS));
+	memset(band_sum, 0, sizeof(band_sum));
+#else
+	arm_rfft_fast_init_f32(&fft_instance, FFT_SIZE);
+	level_min = db_min;
+	level_span = db_max - db_min;
+	memset(power_sum, 0, sizeof(power_sum));
+#endif
+
+	init_hann_window();
+
+	memset(sample_history, 0, sizeof(sample_history));
+	hop_fill = 0;
+	frames = 0;
+
+	return 0;
+}
+
+void mel_spectrum_set_frame_handler(mel_spectrum_frame_handler_t handler)
+{
+	frame_handler = handler;
+}
+
+int mel_spectrum_process(const int16_t *samples, size_t count, uint8_t *bands)
+{
+	size_t pos = 0;
+
+	while (pos < count) {
+		size_t n = MIN(FFT_HOP - hop_fill, count - pos);
+
+		add_samples(&samples[pos], &sample_history[FFT_HOP + hop_fill], n);
+		pos += n;
+		hop_fill += n;
+
+		if (hop_fill == FFT_HOP) {
+			process_frame();
+			frames++;
+
+			// The new hop becomes the first half of the next frame
+			memcpy(sample_history, &sample_history[FFT_HOP],
+			       FFT_HOP * sizeof(sample_history[0]));
+			hop_fill = 0;
+		}
+	}
+
+	if (frames == 0) {
+		return 0;
+	}
+
+	int ret = frames;
+
+	compute_bands(bands);
+	frames = 0;
+
+	return ret;
+}
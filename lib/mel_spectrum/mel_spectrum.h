@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2025
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MEL_SPECTRUM_H_
+#define MEL_SPECTRUM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Mel spectrum of 16-bit PCM audio, shared by the audio visualizer samples.
+ *
+ * Samples are analyzed in Hann windowed frames of MEL_SPECTRUM_FFT_SIZE samples overlapping
+ * by half. The power spectrum of the frames is averaged until the bands are computed, at the
+ * end of each call to mel_spectrum_process(). Band levels are 0-255, mapped from a dB range.
+ *
+ * The FFT runs in float (arm_rfft_fast_f32) with CONFIG_MEL_SPECTRUM_FLOAT, or in q15
+ * (arm_rfft_q15) with CONFIG_MEL_SPECTRUM_Q15, where the dB conversion is an integer log2
+ * with a lookup table. Both give the same band levels within a few steps, the q15 one needs
+ * about half the RAM and no FPU.
+ *
+ * The state is static, there is one analyzer per application.
+ */
+
+#define MEL_SPECTRUM_FFT_SIZE   512
+#define MEL_SPECTRUM_HOP_SIZE   (MEL_SPECTRUM_FFT_SIZE / 2)
+#define MEL_SPECTRUM_MAX_BANDS  40
+
+/**
+ * @brief Called with the band levels of each FFT frame
+ * @param bands Band levels 0-255 of the frame
+ * @param num_bands Number of bands
+ */
+typedef void (*mel_spectrum_frame_handler_t)(const uint8_t *bands, int num_bands);
+
+/**
+ * @brief Build the mel filterbank and window, and reset the analysis
+ * @param sample_rate Sample rate in Hz
+ * @param num_bands Number of mel bands, up to MEL_SPECTRUM_MAX_BANDS
+ * @param db_min Band energy in dB mapped to level 0
+ * @param db_max Band energy in dB mapped to level 255
+ * @return 0 on success, -EINVAL if num_bands is out of range or above the number of FFT bins
+ */
+int mel_spectrum_init(uint32_t sample_rate, int num_bands, float db_min, float db_max);
+
+/**
+ * @brief Set a handler called with the bands of every frame, from mel_spectrum_process()
+ *
+ * Frames are MEL_SPECTRUM_HOP_SIZE samples apart, which gives a finer time resolution than
+ * the bands averaged over a whole call, for onset detection.
+ *
+ * @param handler Frame handler, NULL to disable
+ */
+void mel_spectrum_set_frame_handler(mel_spectrum_frame_handler_t handler);
+
+/**
+ * @brief Analyze samples, and compute the bands if a frame was completed
+ *
+ * Samples that don't complete a frame are kept for the next call.
+ *
+ * @param samples 16-bit PCM samples
+ * @param count Number of samples
+ * @param bands Band levels 0-255, num_bands entries, only written if a frame was completed
+ * @return Number of frames averaged into the bands, 0 if bands were not updated
+ */
+int mel_spectrum_process(const int16_t *samples, size_t count, uint8_t *bands);
+
+#endif /* MEL_SPECTRUM_H_ */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2018 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ *  @brief Packing of the data received over UART into NUS packets
+ */
+
+#include "nus_packer.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(nus_packer);
+
+static uint8_t *packet;
+static size_t packet_size;
+static uint16_t packet_fill;
+static nus_packer_send_t packet_send;
+
+/* Payload limit of the current connection, follows the ATT MTU. */
+static atomic_t packet_len;
+
+static atomic_t tx_bytes;
+static atomic_t tx_packets;
+static atomic_t tx_dropped;
+static int64_t tx_start;
+static int64_t tx_end;
+
+void nus_packer_init(uint8_t *buf, size_t size, nus_packer_send_t send)
+{
+	packet = buf;
+	packet_size = size;
+	packet_fill = 0;
+	packet_send = send;
+
+	atomic_set(&packet_len, size);
+}
+
+uint16_t nus_packer_len_set(uint16_t len)
+{
+	len = MIN(len, packet_size);
+	atomic_set(&packet_len, len);
+
+	return len;
+}
+
+static void packet_part_send(const uint8_t *data, uint16_t len)
+{
+	int err = packet_send(data, len);
+
+	if (err) {
+		LOG_WRN("Failed to send data over BLE connection (err %d)", err);
+		atomic_add(&tx_dropped, len);
+		return;
+	}
+
+	if (atomic_inc(&tx_packets) == 0) {
+		tx_start = k_uptime_get();
+	}
+
+	atomic_add(&tx_bytes, len);
+	tx_end = k_uptime_get();
+}
+
+void nus_packer_flush(void)
+{
+	/* A new connection can start with a smaller limit than the packet was filled for. */
+	for (uint16_t pos = 0; pos < packet_fill;) {
+		uint16_t len = MIN(packet_fill - pos, atomic_get(&packet_len));
+
+		packet_part_send(&packet[pos], len);
+		pos += len;
+	}
+
+	packet_fill = 0;
+}
+
+void nus_packer_add(const uint8_t *data, uint16_t len)
+{
+	for (uint16_t loc = 0; loc < len;) {
+		/* The MTU can change while waiting for a credit, and a new connection can
+		 * start with a smaller one.
+		 */
+		uint16_t max_len = atomic_get(&packet_len);
+		uint16_t plen;
+
+		if (packet_fill >= max_len) {
+			nus_packer_flush();
+		}
+
+		plen = MIN(max_len - packet_fill, len - loc);
+		memcpy(&packet[packet_fill], &data[loc], plen);
+		packet_fill += plen;
+		loc += plen;
+
+		if (packet_fill >= max_len) {
+			nus_packer_flush();
+		}
+	}
+}
+
+bool nus_packer_pending(void)
+{
+	return packet_fill != 0;
+}
+
+void nus_packer_stats_get(struct nus_packer_stats *stats)
+{
+	stats->bytes = atomic_get(&tx_bytes);
+	stats->packets = atomic_get(&tx_packets);
+	stats->duration = (stats->packets != 0) ? (tx_end - tx_start) : 0;
+	stats->dropped = atomic_get(&tx_dropped);
+}
+
+void nus_packer_stats_reset(void)
+{
+	atomic_clear(&tx_bytes);
+	atomic_clear(&tx_packets);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ *  @brief Packing of the data received over UART into NUS packets
+ */
+
+#ifndef NUS_PACKER_H_
+#define NUS_PACKER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Send a packet over Bluetooth.
+ *
+ *  @return 0 on success, a negative error code otherwise.
+ */
+typedef int (*nus_packer_send_t)(const uint8_t *data, uint16_t len);
+
+struct nus_packer_stats {
+	/* Bytes and packets sent since the last reset. */
+	uint32_t bytes;
+	uint32_t packets;
+	/* Milliseconds from the first to the last packet sent since the last reset. */
+	int64_t duration;
+	/* Bytes that could not be sent. */
+	uint32_t dropped;
+};
+
+/** @brief Initialize the packer, before the other functions.
+ *
+ *  @param buf Packet buffer, the largest packet size.
+ *  @param size Size of the buffer.
+ *  @param send Called with every packet, from the thread that adds data.
+ */
+void nus_packer_init(uint8_t *buf, size_t size, nus_packer_send_t send);
+
+/** @brief Set the payload limit of the connection, from its ATT MTU.
+ *
+ *  Can be called from any thread. A packet filled for a larger limit is split when sent.
+ *
+ *  @return The limit, at most the size of the packet buffer.
+ */
+uint16_t nus_packer_len_set(uint16_t len);
+
+/** @brief Add data received over UART, and send the packets it fills. */
+void nus_packer_add(const uint8_t *data, uint16_t len);
+
+/** @brief Send a partly filled packet, when no more data was received for a while. */
+void nus_packer_flush(void);
+
+/** @brief Check whether a partly filled packet waits for more data. */
+bool nus_packer_pending(void);
+
+void nus_packer_stats_get(struct nus_packer_stats *stats);
+
+/** @brief Start counting the sent bytes and packets again, on a new connection. */
+void nus_packer_stats_reset(void);
+
+#endif /* NUS_PACKER_H_ */
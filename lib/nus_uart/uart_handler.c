@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2018 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ *  @brief UART payload buffers and flow control of the NUS UART samples
+ */
+
+#include "uart_handler.h"
+
+#include <errno.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/atomic.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(uart_handler);
+
+#define UART_BUF_COUNT CONFIG_BT_NUS_UART_BUF_COUNT
+#define UART_RX_RESERVE CONFIG_BT_NUS_UART_RX_RESERVE
+
+static const struct device *uart;
+static struct k_work_delayable uart_work;
+
+static K_FIFO_DEFINE(fifo_uart_tx_data);
+static K_FIFO_DEFINE(fifo_uart_rx_data);
+
+/* Buffers of both directions, UART RX stops when only UART_RX_RESERVE are left. */
+K_MEM_SLAB_DEFINE_STATIC(uart_slab, sizeof(struct uart_data_t), UART_BUF_COUNT, 4);
+
+/* Taken to start a transmission, so that a buffer queued while the previous one
+ * completes is not left behind.
+ */
+static struct k_spinlock uart_tx_lock;
+static bool uart_tx_busy;
+
+static atomic_t uart_rx_paused;
+static atomic_t uart_rx_pauses;
+
+struct uart_data_t *uart_buf_alloc(void)
+{
+	struct uart_data_t *buf;
+
+	if (k_mem_slab_alloc(&uart_slab, (void **)&buf, K_NO_WAIT)) {
+		return NULL;
+	}
+
+	buf->len = 0;
+
+	return buf;
+}
+
+/* UART RX only gets a buffer if it leaves the reserve for data received over Bluetooth. */
+static struct uart_data_t *uart_rx_buf_alloc(void)
+{
+	if (k_mem_slab_num_free_get(&uart_slab) <= UART_RX_RESERVE) {
+		return NULL;
+	}
+
+	return uart_buf_alloc();
+}
+
+void uart_buf_free(struct uart_data_t *buf)
+{
+	k_mem_slab_free(&uart_slab, buf);
+
+	/* Resume UART RX stopped by uart_rx_start() once the pool recovered. */
+	if (atomic_get(&uart_rx_paused) &&
+	    (k_mem_slab_num_free_get(&uart_slab) > UART_RX_RESERVE) &&
+	    atomic_cas(&uart_rx_paused, 1, 0)) {
+		k_work_reschedule(&uart_work, K_NO_WAIT);
+	}
+}
+
+static void uart_rx_start(void)
+{
+	struct uart_data_t *buf;
+
+	/* Set before allocating, so a buffer freed in between resumes reception. */
+	atomic_set(&uart_rx_paused, 1);
+
+	buf = uart_rx_buf_alloc();
+	if (!buf) {
+		atomic_inc(&uart_rx_pauses);
+		LOG_DBG("UART RX paused, buffer pool low");
+		return;
+	}
+
+	atomic_set(&uart_rx_paused, 0);
+
+	if (uart_rx_enable(uart, buf->data, sizeof(buf->data), UART_RX_TIMEOUT)) {
+		uart_buf_free(buf);
+	}
+}
+
+/* Start the next queued buffer unless one is being sent, with uart_tx_lock held. */
+static void uart_tx_next(void)
+{
+	struct uart_data_t *buf;
+
+	while (!uart_tx_busy) {
+		buf = k_fifo_get(&fifo_uart_tx_data, K_NO_WAIT);
+		if (!buf) {
+			return;
+		}
+
+		if (uart_tx(uart, buf->data, buf->len, SYS_FOREVER_MS)) {
+			LOG_WRN("Failed to send data over UART");
+			uart_buf_free(buf);
+		} else {
+			uart_tx_busy = true;
+		}
+	}
+}
+
+void uart_buf_send(struct uart_data_t *buf)
+{
+	k_spinlock_key_t key = k_spin_lock(&uart_tx_lock);
+
+	k_fifo_put(&fifo_uart_tx_data, buf);
+	uart_tx_next();
+
+	k_spin_unlock(&uart_tx_lock, key);
+}
+
+struct uart_data_t *uart_rx_get(k_timeout_t timeout)
+{
+	return k_fifo_get(&fifo_uart_rx_data, timeout);
+}
+
+void uart_handler_stats_get(struct uart_handler_stats *stats)
+{
+	stats->num_free = k_mem_slab_num_free_get(&uart_slab);
+	stats->max_used = k_mem_slab_max_used_get(&uart_slab);
+	stats->rx_pauses = atomic_get(&uart_rx_pauses);
+}
+
+static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+	ARG_UNUSED(dev);
+
+	static size_t aborted_len;
+	struct uart_data_t *buf;
+	static uint8_t *aborted_buf;
+	static bool disable_req;
+	k_spinlock_key_t key;
+
+	switch (evt->type) {
+	case UART_TX_DONE:
+		LOG_DBG("UART_TX_DONE");
+		if ((evt->data.tx.len == 0) ||
+		    (!evt->data.tx.buf)) {
+			return;
+		}
+
+		if (aborted_buf) {
+			buf = CONTAINER_OF(aborted_buf, struct uart_data_t,
+					   data[0]);
+			aborted_buf = NULL;
+			aborted_len = 0;
+		} else {
+			buf = CONTAINER_OF(evt->data.tx.buf, struct uart_data_t,
+					   data[0]);
+		}
+
+		uart_buf_free(buf);
+
+		key = k_spin_lock(&uart_tx_lock);
+		uart_tx_busy = false;
+		uart_tx_next();
+		k_spin_unlock(&uart_tx_lock, key);
+
+		break;
+
+	case UART_RX_RDY:
+		LOG_DBG("UART_RX_RDY");
+		buf = CONTAINER_OF(evt->data.rx.buf, struct uart_data_t, data[0]);
+		buf->len += evt->data.rx.len;
+
+		if (disable_req) {
+			return;
+		}
+
+		/* A buffer that is not full was reported after UART_RX_TIMEOUT of idle
+		 * line. Release it, so that the data doesn't wait for more input.
+		 */
+		if (buf->len < sizeof(buf->data)) {
+			disable_req = true;
+			uart_rx_disable(uart);
+		}
+
+		break;
+
+	case UART_RX_DISABLED:
+		LOG_DBG("UART_RX_DISABLED");
+		disable_req = false;
+
+		uart_rx_start();
+
+		break;
+
+	case UART_RX_BUF_REQUEST:
+		LOG_DBG("UART_RX_BUF_REQUEST");
+		buf = uart_rx_buf_alloc();
+		if (buf) {
+			uart_rx_buf_rsp(uart, buf->data, sizeof(buf->data));
+		} else {
+			/* Reception stops when the current buffer is full. */
+			LOG_DBG("No UART receive buffer, pool low");
+		}
+
+		break;
+
+	case UART_RX_BUF_RELEASED:
+		LOG_DBG("UART_RX_BUF_RELEASED");
+		buf = CONTAINER_OF(evt->data.rx_buf.buf, struct uart_data_t,
+				   data[0]);
+
+		if (buf->len > 0) {
+			k_fifo_put(&fifo_uart_rx_data, buf);
+		} else {
+			uart_buf_free(buf);
+		}
+
+		break;
+
+	case UART_TX_ABORTED:
+		LOG_DBG("UART_TX_ABORTED");
+		if (!aborted_buf) {
+			aborted_buf = (uint8_t *)evt->data.tx.buf;
+		}
+
+		aborted_len += evt->data.tx.len;
+		buf = CONTAINER_OF((void *)aborted_buf, struct uart_data_t,
+				   data);
+
+		uart_tx(uart, &buf->data[aborted_len],
+			buf->len - aborted_len, SYS_FOREVER_MS);
+
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void uart_work_handler(struct k_work *item)
+{
+	uart_rx_start();
+}
+
+int uart_handler_init(const struct device *dev)
+{
+	uart = dev;
+	k_work_init_delayable(&uart_work, uart_work_handler);
+
+	return uart_callback_set(uart, uart_cb, NULL);
+}
+
+int uart_handler_rx_enable(void)
+{
+	int err;
+	struct uart_data_t *rx = uart_buf_alloc();
+
+	if (!rx) {
+		return -ENOMEM;
+	}
+
+	err = uart_rx_enable(uart, rx->data, sizeof(rx->data), UART_RX_TIMEOUT);
+	if (err) {
+		uart_buf_free(rx);
+	}
+
+	return err;
+}
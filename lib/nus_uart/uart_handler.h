@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ *  @brief UART payload buffers and flow control of the NUS UART samples
+ */
+
+#ifndef UART_HANDLER_H_
+#define UART_HANDLER_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+#define UART_BUF_SIZE CONFIG_BT_NUS_UART_BUFFER_SIZE
+
+/* Wait for RX complete event time in microseconds. */
+#define UART_RX_TIMEOUT CONFIG_BT_NUS_UART_RX_WAIT_TIME
+
+struct uart_data_t {
+	void *fifo_reserved;
+	uint8_t data[UART_BUF_SIZE];
+	uint16_t len;
+};
+
+struct uart_handler_stats {
+	/* Buffers free in the pool. */
+	uint32_t num_free;
+	/* Most buffers used at a time. */
+	uint32_t max_used;
+	/* Times UART RX was paused because the pool was low. */
+	uint32_t rx_pauses;
+};
+
+/** @brief Set the UART callback, before uart_handler_rx_enable().
+ *
+ *  @param dev UART device with the asynchronous API.
+ *
+ *  @return 0 on success, a negative error code otherwise.
+ */
+int uart_handler_init(const struct device *dev);
+
+/** @brief Start UART reception.
+ *
+ *  Reception is paused when no more than CONFIG_BT_NUS_UART_RX_RESERVE buffers
+ *  are free, and resumed when buffers are freed.
+ *
+ *  @return 0 on success, a negative error code otherwise.
+ */
+int uart_handler_rx_enable(void);
+
+/** @brief Allocate a payload buffer, with no data.
+ *
+ *  @return The buffer, or NULL if the pool is empty.
+ */
+struct uart_data_t *uart_buf_alloc(void);
+
+/** @brief Return a buffer to the pool, and resume UART RX if it was paused. */
+void uart_buf_free(struct uart_data_t *buf);
+
+/** @brief Send the data of a buffer over UART, after the buffers sent before.
+ *
+ *  The buffer is freed once sent.
+ */
+void uart_buf_send(struct uart_data_t *buf);
+
+/** @brief Get the next buffer of data received over UART.
+ *
+ *  Free it with uart_buf_free(), so that UART RX can use it again.
+ *
+ *  @return The buffer, or NULL if none was received within the timeout.
+ */
+struct uart_data_t *uart_rx_get(k_timeout_t timeout);
+
+void uart_handler_stats_get(struct uart_handler_stats *stats);
+
+#endif /* UART_HANDLER_H_ */
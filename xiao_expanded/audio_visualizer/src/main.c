@@ -16,8 +16,8 @@
 #include <zephyr/audio/dmic.h>
 #include <zephyr/logging/log.h>
 
-// CMSIS-DSP for FFT
-#include <arm_math.h>
+// Mel spectrum shared with led_displays/led_matrix
+#include "mel_spectrum.h"
 
 // U8g2 for OLED display
 #include "../../../lib/u8g2/csrc/u8g2.h"
@@ -33,9 +33,6 @@ LOG_MODULE_REGISTER(audio_viz, CONFIG_LOG_DEFAULT_LEVEL);
 #define BYTES_PER_SAMPLE sizeof(int16_t)
 #define READ_TIMEOUT     1000
 
-// FFT Configuration
-#define FFT_SIZE         512  // Must be power of 2
-#define FFT_HALF         (FFT_SIZE / 2)
 #define BLOCK_SIZE(_sample_rate, _number_of_channels) \
 	(BYTES_PER_SAMPLE * (_sample_rate / 10) * _number_of_channels)
 
@@ -101,76 +98,10 @@ uint8_t u8x8_gpio_and_delay_zephyr(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, v
 static u8g2_t u8g2;
 
 // ===================================================================================
-// FFT and Audio Processing
+// Audio Processing
 // ===================================================================================
-static float32_t fft_input[FFT_SIZE * 2];  // Complex input (real + imaginary)
-static float32_t fft_output[FFT_SIZE];     // Magnitude output
-static arm_rfft_fast_instance_f32 fft_instance;
-
-// Mel filter bank (simplified - triangular filters)
-static float mel_filterbank[MEL_BANDS][FFT_HALF];
 static uint8_t mel_values[MEL_BANDS];
 
-// Convert frequency to mel scale
-static float hz_to_mel(float hz) {
-    return 2595.0f * log10f(1.0f + hz / 700.0f);
-}
-
-// Convert mel scale to frequency
-static float mel_to_hz(float mel) {
-    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
-}
-
-// Initialize mel filterbank
-static void init_mel_filterbank(void) {
-    memset(mel_filterbank, 0, sizeof(mel_filterbank));
-    
-    float mel_min = hz_to_mel(0);
-    float mel_max = hz_to_mel(SAMPLE_RATE / 2.0f);
-    float mel_step = (mel_max - mel_min) / (MEL_BANDS + 1);
-    
-    for (int i = 0; i < MEL_BANDS; i++) {
-        float mel_center = mel_min + (i + 1) * mel_step;
-        float mel_left = mel_min + i * mel_step;
-        float mel_right = mel_min + (i + 2) * mel_step;
-        
-        float hz_center = mel_to_hz(mel_center);
-        float hz_left = mel_to_hz(mel_left);
-        float hz_right = mel_to_hz(mel_right);
-        
-        int bin_left = (int)(hz_left * FFT_SIZE / SAMPLE_RATE);
-        int bin_center = (int)(hz_center * FFT_SIZE / SAMPLE_RATE);
-        int bin_right = (int)(hz_right * FFT_SIZE / SAMPLE_RATE);
-        
-        // Create triangular filter
-        for (int j = bin_left; j < bin_center && j < FFT_HALF; j++) {
-            mel_filterbank[i][j] = (float)(j - bin_left) / (bin_center - bin_left);
-        }
-        for (int j = bin_center; j < bin_right && j < FFT_HALF; j++) {
-            mel_filterbank[i][j] = (float)(bin_right - j) / (bin_right - bin_center);
-        }
-    }
-}
-
-// Apply mel filterbank and compute band energies
-static void compute_mel_spectrogram(float32_t *fft_mag) {
-    for (int i = 0; i < MEL_BANDS; i++) {
-        float energy = 0.0f;
-        for (int j = 0; j < FFT_HALF; j++) {
-            energy += fft_mag[j] * mel_filterbank[i][j];
-        }
-        
-        // Convert to dB scale and normalize with wider dynamic range
-        float db = 10.0f * log10f(energy + 1.0f);
-        db = (db - 20.0f) / 80.0f * 255.0f;  // Wider range, higher threshold
-        
-        if (db < 0) db = 0;
-        if (db > 255) db = 255;
-        
-        mel_values[i] = (uint8_t)db;
-    }
-}
-
 // Draw spectrogram on OLED
 static void draw_spectrogram(void) {
     u8g2_ClearBuffer(&u8g2);
@@ -194,32 +125,13 @@ static void draw_spectrogram(void) {
     u8g2_SendBuffer(&u8g2);
 }
 
-// Process audio buffer with FFT
+// Process audio buffer and update display
 static void process_audio(int16_t *buffer, size_t sample_count) {
-    // Copy samples to FFT input buffer (zero-pad if needed)
-    size_t copy_count = (sample_count < FFT_SIZE) ? sample_count : FFT_SIZE;
-    
-    for (size_t i = 0; i < copy_count; i++) {
-        fft_input[i] = (float32_t)buffer[i];
-    }
-    for (size_t i = copy_count; i < FFT_SIZE; i++) {
-        fft_input[i] = 0.0f;
+    // Bands are only updated once a whole FFT frame has been received
+    if (mel_spectrum_process(buffer, sample_count, mel_values) == 0) {
+        return;
     }
     
-    // Perform FFT
-    arm_rfft_fast_f32(&fft_instance, fft_input, fft_output, 0);
-    
-    // Compute magnitude spectrum
-    float32_t magnitudes[FFT_HALF];
-    for (int i = 0; i < FFT_HALF; i++) {
-        float real = fft_output[i * 2];
-        float imag = fft_output[i * 2 + 1];
-        magnitudes[i] = sqrtf(real * real + imag * imag);
-    }
-    
-    // Compute mel spectrogram
-    compute_mel_spectrogram(magnitudes);
-    
     // Draw on display
     draw_spectrogram();
 }
@@ -263,11 +175,8 @@ int main(void) {
     u8g2_SendBuffer(&u8g2);
     k_sleep(K_MSEC(2000));
     
-    // Initialize FFT
-    arm_rfft_fast_init_f32(&fft_instance, FFT_SIZE);
-    
-    // Initialize mel filterbank
-    init_mel_filterbank();
+    // Initialize mel spectrum, with a wide 20-100 dB range
+    mel_spectrum_init(SAMPLE_RATE, MEL_BANDS, 20.0f, 100.0f);
     
     // Initialize DMIC
     const struct device *const dmic_dev = DEVICE_DT_GET(DT_NODELABEL(dmic_dev));